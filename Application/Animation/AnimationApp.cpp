@@ -5,21 +5,48 @@
 #include <Engine/Render/Texture.h>
 #include <Engine/Render/Shader.h>
 #include <Engine/Loading/ModelLoading.h>
-#include <Engine/Loading/TextureLoading.h>
 #include <Engine/Loading/AnimationOperations.h>
+#include <Engine/Loading/AnimationSystem.h>
 #include <Engine/Utility/MathUtility.h>
 
 #include "Animation/AnimationAppGUI.h"
 #include "Common/ConstantBuffer.h"
 
+static constexpr const char* StreamingRequestLogPath = "Application/Animation/Resources/texture_requests.rqlog";
+
 void AnimationApp::OnInit(GraphicsContext& context)
 {
-	ModelLoading::Loader loader{ context };
-	m_Scene = loader.Load("Application/Animation/Resources/scene.gltf");
-	
+	ModelLoading::LoaderSettings loaderSettings{};
+	loaderSettings.QuantizeVertices = true;
+
+	// Streamer cooks its own uncompressed mip chains, COMPRESSTEXTURES loads block compressed textures with every mip instead
+	if (AppConfig.Settings.contains("COMPRESSTEXTURES"))
+		loaderSettings.CompressTextures = true;
+	else
+		loaderSettings.TextureStreamer = &m_TextureStreamer;
+
+	// Objects show up as they are loaded, see TakeLoadedObjects
+	ModelLoading::Loader loader{ context, loaderSettings };
+	m_SceneLoad = loader.LoadAsync("Application/Animation/Resources/scene.gltf", [this](uint32_t objectIndex, ModelLoading::SceneObject& object)
+	{
+		if (object.Skeleton.empty()) return;
+
+		const AnimationCompression::Settings compressionSettings{};
+		SkinnedObject skinnedObject{};
+		skinnedObject.ObjectIndex = objectIndex;
+		skinnedObject.Skeleton = m_AnimationSystem.AddSkeleton(object.Skeleton, &compressionSettings);
+		m_SkinnedObjects.push_back(skinnedObject);
+	});
+
 	m_GeometryShader = ScopedRef<Shader>(new Shader{ "Application/Animation/geometry.hlsl" });
 	m_BackgroundShader = ScopedRef<Shader>(new Shader("Application/Animation/background.hlsl"));
-	m_EmptyBuffer = ScopedRef<Buffer>(GFX::CreateBuffer(1, 1, RCF::None));
+	m_MorphBlendShader = ScopedRef<Shader>(new Shader("Application/Animation/morph_blend.hlsl"));
+
+	// Every config used by OnDraw and BlendMorphs, compiled up front so objects don't stall the frame they show up in
+	m_GeometryShader->AddPermutations({ { "", "QUANTIZED_VERTICES" }, { "", "APPLY_MORPHS" }, { "", "APPLY_SKIN" } });
+	m_BackgroundShader->AddPermutations({});
+	m_MorphBlendShader->AddPermutations({ { "", "CLEAR" } }, CS);
+	GFX::WarmUpShaders({ m_GeometryShader.get(), m_BackgroundShader.get(), m_MorphBlendShader.get() });
 
 	m_Camera.Position = Float3(0.5f, 0.7f, 15.0f);
 	m_Camera.Rotation = Float3(-0.15f, -1.6f, 0.0f);
@@ -30,10 +57,16 @@ void AnimationApp::OnInit(GraphicsContext& context)
 
 void AnimationApp::OnDestroy(GraphicsContext& context)
 {
+	m_SceneLoad->Cancel();
+	m_SceneLoad->Wait();
+	m_SceneLoad->TakeLoadedObjects(m_Scene);
+
 	for (ModelLoading::SceneObject& obj : m_Scene.Objects)
 	{
 		ModelLoading::Free(context, obj);
 	}
+	m_TextureStreamer.Free(context);
+	m_AnimationSystem.Free(context);
 	AnimationAppGUI::RemoveGUI();
 }
 
@@ -52,7 +85,7 @@ Texture* AnimationApp::OnDraw(GraphicsContext& context)
 		cb.Add(SkyColor);
 
 		GraphicsState state{};
-		state.Table.CBVs[0] = cb.GetBuffer(context);
+		state.RootCBVs[0] = cb.Upload(context);
 		state.Shader = m_BackgroundShader.get();
 		state.RenderTargets[0] = m_FinalResult.get();
 		GFX::Cmd::DrawFC(context, state);
@@ -60,6 +93,10 @@ Texture* AnimationApp::OnDraw(GraphicsContext& context)
 		GFX::Cmd::MarkerEnd(context);
 	}
 
+	m_AnimationSystem.Upload(context);
+	BlendMorphs(context);
+	RequestTextureMips();
+
 	GFX::Cmd::MarkerBegin(context, "Geometry");
 
 	GraphicsState state{};
@@ -68,8 +105,11 @@ Texture* AnimationApp::OnDraw(GraphicsContext& context)
 	state.DepthStencilState.DepthEnable = true;
 	state.Table.SMPs[0] = Sampler{ D3D12_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR, D3D12_TEXTURE_ADDRESS_MODE_WRAP };
 	
-	for (const ModelLoading::SceneObject& object : m_Scene.Objects)
+	uint32_t skinnedObjectIndex = 0;
+	for (uint32_t objectIndex = 0; objectIndex < m_Scene.Objects.size(); objectIndex++)
 	{
+		const ModelLoading::SceneObject& object = m_Scene.Objects[objectIndex];
+		uint32_t instanceCount = 1;
 		state.ShaderConfig.clear();
 		
 		DirectX::XMFLOAT4X4 animationTransform = AnimationOperations::GetAnimationTransformation(object.AnimcationData, m_AnimationTime, AnimationOperations::AnimationType::Repeat);
@@ -81,87 +121,205 @@ Texture* AnimationApp::OnDraw(GraphicsContext& context)
 		cb.Add(object.Material.AlbedoFactor);
 
 		state.Table.SRVs[0] = object.Material.Albedo;
-		state.VertexBuffers[0] = object.Mesh.Positions;
-		state.VertexBuffers[1] = object.Mesh.Texcoords;
-		state.VertexBuffers[2] = object.Mesh.Normals;
+		state.VertexBuffers = {};
+		if (object.Mesh.Vertices)
+		{
+			state.ShaderConfig.push_back("QUANTIZED_VERTICES");
+			state.VertexBuffers[0] = object.Mesh.Vertices;
+		}
+		else
+		{
+			state.VertexBuffers[0] = object.Mesh.Positions;
+			state.VertexBuffers[1] = object.Mesh.Texcoords;
+			state.VertexBuffers[2] = object.Mesh.Normals;
+		}
 		state.IndexBuffer = object.Mesh.Indices;
 		state.Shader = m_GeometryShader.get();
 
-		// Object is using morphs
-		if (!object.MorphTargets.empty())
+		// Object has active morph targets
+		if (m_MorphsBlended[objectIndex])
 		{
-			// Must match with geometry.hlsl
-			constexpr uint32_t MaxMorphWeights = 16;
-
 			state.ShaderConfig.push_back("APPLY_MORPHS");
 
-			std::vector<float> morphWeights = {};
-			if(m_EnableWeightAnimation)
-				morphWeights = AnimationOperations::GetAnimatedMorphWeights(object, m_AnimationTime, AnimationOperations::AnimationType::PingPong);
-			else
-			{
-				for (const ModelLoading::MorphTarget& target : object.MorphTargets)
-					morphWeights.push_back(target.Weight);
-			}
-			
-			const uint32_t numWeights = min((uint32_t) morphWeights.size(), MaxMorphWeights);
-			
-			cb.Add(numWeights);
-			const uint32_t morphTargetsBinding = 1;
-			for (uint32_t i = 0; i < MaxMorphWeights; i++)
-			{
-				cb.Add(i < numWeights ? morphWeights[i] : 0.0f);
-				state.Table.SRVs[i+ morphTargetsBinding] = i < numWeights ? object.MorphTargets[i].Data : m_EmptyBuffer.get();
-			}
+			constexpr uint32_t blendedMorphBinding = 1;
+			state.Table.SRVs[blendedMorphBinding] = object.BlendedMorph;
 		}
 
 		// Object is using skinning
 		if (!object.Skeleton.empty())
 		{
-			// Must match with geometry.hlsl
-			constexpr uint32_t MaxSkeletonJoints = 128;
-			ASSERT(object.Skeleton.size() < MaxSkeletonJoints, "Too much skeleton joints!");
-
 			state.ShaderConfig.push_back("APPLY_SKIN");
-			state.VertexBuffers[3] = object.Mesh.Weights;
-			state.VertexBuffers[4] = object.Mesh.Joints;
-
-			std::vector<DirectX::XMFLOAT4X4> jointTransforms;
-			std::vector<DirectX::XMFLOAT4X4> jointAnimationTransformations;
-			std::vector<DirectX::XMFLOAT4X4> modelToJointTransforms;
-			jointTransforms.resize(MaxSkeletonJoints);
-			jointAnimationTransformations.resize(MaxSkeletonJoints);
-			modelToJointTransforms.resize(MaxSkeletonJoints);
-
-			for (size_t i = 0; i < min(MaxSkeletonJoints, object.Skeleton.size()); i++)
+			if (!object.Mesh.Vertices)
 			{
-				const ModelLoading::SkeletonJoint& joint = object.Skeleton[i];
-
-				jointTransforms[i] = joint.Transform;
-				jointAnimationTransformations[i] = AnimationOperations::GetAnimationTransformation(joint.Animations, m_AnimationTime, AnimationOperations::AnimationType::Repeat);
-				modelToJointTransforms[i] = joint.ModelToJoint;
+				state.VertexBuffers[3] = object.Mesh.Weights;
+				state.VertexBuffers[4] = object.Mesh.Joints;
 			}
 
-			for (uint32_t i = 0; i < MaxSkeletonJoints; i++) cb.Add(XMUtility::ToHLSLFloat4x4(jointTransforms[i]));
-			for (uint32_t i = 0; i < MaxSkeletonJoints; i++) cb.Add(XMUtility::ToHLSLFloat4x4(jointAnimationTransformations[i]));
-			for (uint32_t i = 0; i < MaxSkeletonJoints; i++) cb.Add(XMUtility::ToHLSLFloat4x4(modelToJointTransforms[i]));
+			// Instances of the object are next to each other in the palette
+			const SkinnedObject& skinnedObject = m_SkinnedObjects[skinnedObjectIndex++];
+			ASSERT(skinnedObject.ObjectIndex == objectIndex, "Skinned objects are out of sync with the scene!");
+			const AnimationSystem::Instance& firstInstance = m_AnimationSystem.GetInstance(skinnedObject.FirstInstance);
+
+			instanceCount = m_CrowdSize;
+			cb.Add(firstInstance.PaletteOffset);
+			cb.Add(m_AnimationSystem.GetSkeleton(skinnedObject.Skeleton).NumJoints);
+			cb.Add(m_CrowdSpacing);
+			cb.Add((uint32_t) std::ceil(std::sqrt((float) m_CrowdSize)));
+
+			constexpr uint32_t skinPaletteBinding = 17;
+			state.Table.SRVs[skinPaletteBinding] = m_AnimationSystem.GetPaletteBuffer();
 		}
 
-		state.Table.CBVs[0] = cb.GetBuffer(context);
+		state.RootCBVs[0] = cb.Upload(context);
 		context.ApplyState(state);
-		context.CmdList->DrawIndexedInstanced(object.Mesh.PrimitiveCount, 1, 0, 0, 0);
+		context.CmdList->DrawIndexedInstanced(object.Mesh.PrimitiveCount, instanceCount, 0, 0, 0);
 	}
 
 	GFX::Cmd::MarkerEnd(context);
 	return m_FinalResult.get();
 }
 
+void AnimationApp::BlendMorphs(GraphicsContext& context)
+{
+	m_MorphsBlended.assign(m_Scene.Objects.size(), false);
+	m_MorphStats = {};
+
+	GFX::Cmd::MarkerBegin(context, "Morph blend");
+
+	for (uint32_t objectIndex = 0; objectIndex < m_Scene.Objects.size(); objectIndex++)
+	{
+		const ModelLoading::SceneObject& object = m_Scene.Objects[objectIndex];
+		if (object.MorphTargets.empty()) continue;
+
+		std::vector<float> morphWeights = {};
+		if (m_EnableWeightAnimation)
+			morphWeights = AnimationOperations::GetAnimatedMorphWeights(object, m_AnimationTime, AnimationOperations::AnimationType::PingPong);
+		else
+		{
+			for (const ModelLoading::MorphTarget& target : object.MorphTargets)
+				morphWeights.push_back(target.Weight);
+		}
+
+		// Targets with near zero weight are dropped, cost of the blend scales with the deltas of the remaining ones
+		const std::vector<uint32_t> activeTargets = AnimationOperations::GetActiveMorphTargets(object, morphWeights, m_MorphWeightThreshold);
+		m_MorphStats.NumTargets += (uint32_t) object.MorphTargets.size();
+		if (activeTargets.empty()) continue;
+
+		GraphicsState state{};
+		state.Shader = m_MorphBlendShader.get();
+		state.ShaderStages = CS;
+		state.Table.UAVs[0] = object.BlendedMorph;
+
+		// Clear
+		{
+			const uint32_t numVertices = object.BlendedMorph->ByteSize / sizeof(ModelLoading::BlendedMorphVertex);
+
+			ConstantBuffer cb{};
+			cb.Add(numVertices);
+			cb.Add(0.0f);
+
+			state.ShaderConfig = { "CLEAR" };
+			state.RootCBVs[0] = cb.Upload(context);
+			context.ApplyState(state);
+			context.CmdList->Dispatch(MathUtility::CeilDiv(numVertices, 64u), 1, 1);
+		}
+
+		// One dispatch per target, UAV barrier between them is added by ApplyState
+		state.ShaderConfig.clear();
+		for (uint32_t targetIndex : activeTargets)
+		{
+			const ModelLoading::MorphTarget& target = object.MorphTargets[targetIndex];
+
+			ConstantBuffer cb{};
+			cb.Add(target.NumDeltas);
+			cb.Add(morphWeights[targetIndex]);
+
+			state.Table.SRVs[0] = target.Deltas;
+			state.RootCBVs[0] = cb.Upload(context);
+			context.ApplyState(state);
+			context.CmdList->Dispatch(MathUtility::CeilDiv(target.NumDeltas, 64u), 1, 1);
+
+			m_MorphStats.NumActiveDeltas += target.NumDeltas;
+		}
+
+		m_MorphStats.NumActiveTargets += (uint32_t) activeTargets.size();
+		m_MorphsBlended[objectIndex] = true;
+	}
+
+	GFX::Cmd::MarkerEnd(context);
+}
+
+// Height of the object bounding sphere on the screen in pixels
+static float GetScreenSize(const Camera& camera, const ModelLoading::SceneObject& object)
+{
+	using namespace DirectX;
+
+	const XMMATRIX modelToWorld = XMLoadFloat4x4(&object.ModelToWorld);
+	const ModelLoading::BoundingSphere& sphere = object.BoundingVolume;
+	const XMVECTOR center = XMVector3Transform(XMVectorSet(sphere.Center.x, sphere.Center.y, sphere.Center.z, 1.0f), modelToWorld);
+	const float scale = MAX(XMVectorGetX(XMVector3Length(modelToWorld.r[0])), MAX(XMVectorGetX(XMVector3Length(modelToWorld.r[1])), XMVectorGetX(XMVector3Length(modelToWorld.r[2]))));
+	const float radius = sphere.Radius * scale;
+	const float distance = XMVectorGetX(XMVector3Length(center - XMVectorSet(camera.Position.x, camera.Position.y, camera.Position.z, 1.0f)));
+
+	if (distance <= radius) return (float) AppConfig.WindowHeight;
+	return radius / (distance * std::tan(XMConvertToRadians(camera.FOV / 2.0f))) * AppConfig.WindowHeight;
+}
+
+void AnimationApp::RequestTextureMips()
+{
+	for (const ModelLoading::SceneObject& object : m_Scene.Objects)
+	{
+		const float screenSize = GetScreenSize(m_Camera, object);
+		m_TextureStreamer.Request(object.Material.Albedo, screenSize);
+		m_TextureStreamer.Request(object.Material.Normal, screenSize);
+		m_TextureStreamer.Request(object.Material.MetallicRoughness, screenSize);
+	}
+}
+
+void AnimationApp::TakeLoadedObjects()
+{
+	const size_t numSkinnedObjects = m_SkinnedObjects.size();
+	m_SceneLoad->TakeLoadedObjects(m_Scene);
+	if (m_SkinnedObjects.size() != numSkinnedObjects) SetCrowdSize(m_CrowdSize);
+}
+
 void AnimationApp::OnUpdate(GraphicsContext& context, float dt)
 {
 	m_Camera.Update(dt);
+	TakeLoadedObjects();
+	m_TextureStreamer.Update(context);
 
 	constexpr float animationSpeed = 1.0f;
 	m_AnimationTime += dt * animationSpeed / 1000.0f;
+	m_AnimationSystem.Update(dt * animationSpeed / 1000.0f);
+}
+
+void AnimationApp::SetCrowdSize(uint32_t crowdSize)
+{
+	m_CrowdSize = MAX(crowdSize, 1u);
+	m_AnimationSystem.RemoveAllInstances();
+
+	// Instances are offset in time so the crowd doesn't move in sync
+	for (SkinnedObject& skinnedObject : m_SkinnedObjects)
+	{
+		for (uint32_t i = 0; i < m_CrowdSize; i++)
+		{
+			const AnimationSystem::InstanceHandle instance = m_AnimationSystem.AddInstance(skinnedObject.Skeleton, m_AnimationTime + i * 0.137f);
+			if (i == 0) skinnedObject.FirstInstance = instance;
+		}
+	}
+	m_AnimationSystem.Update(0.0f);
+}
+
+void AnimationApp::SetStreamingRecording(bool recording)
+{
+	const bool wasRecording = m_TextureStreamer.IsRecording();
+	m_TextureStreamer.SetRecording(recording);
+	if (!wasRecording || recording) return;
+
+	const TextureStreaming::RequestLog log = m_TextureStreamer.GetRecordedLog();
+	if (TextureStreaming::WriteRequestLog(StreamingRequestLogPath, log))
+		std::cout << "[AnimationApp] Saved " << log.NumFrames << " frames of texture requests to " << StreamingRequestLogPath << std::endl;
 }
 
 void AnimationApp::OnShaderReload(GraphicsContext& context)
@@ -4,6 +4,8 @@
 #include <Engine/Core/Application.h>
 #include <Engine/System/ApplicationConfiguration.h>
 #include <Engine/Loading/ModelLoading.h>
+#include <Engine/Loading/AnimationSystem.h>
+#include <Engine/Loading/TextureStreaming.h>
 
 #include "Common/Camera.h"
 
@@ -14,11 +16,15 @@ struct Buffer;
 namespace AnimationAppGUI
 {
 	class MorphsGUI;
+	class CrowdGUI;
+	class StreamingGUI;
 }
 
 class AnimationApp : public Application
 {
 	friend class AnimationAppGUI::MorphsGUI;
+	friend class AnimationAppGUI::CrowdGUI;
+	friend class AnimationAppGUI::StreamingGUI;
 public:
 	void OnInit(GraphicsContext& context) override;
 	void OnDestroy(GraphicsContext& context) override;
@@ -30,17 +36,59 @@ public:
 	void OnWindowResize(GraphicsContext& context) override;
 
 private:
-	Camera m_Camera = Camera::CreatePerspective(75.0f, (float)AppConfig.WindowWidth / AppConfig.WindowHeight, 0.1f, 1000.0f);
+	// Adds objects that finished loading to the scene and animates the skinned ones
+	void TakeLoadedObjects();
+
+	// Blends the active morph targets of every object into its BlendedMorph buffer, objects without active targets are drawn without morphs
+	void BlendMorphs(GraphicsContext& context);
+
+	// Recreates animation instances so every skinned object is drawn crowdSize times
+	void SetCrowdSize(uint32_t crowdSize);
 
-	ScopedRef<Buffer> m_EmptyBuffer;
+	// Requests mips of every object texture by the screen size of the object
+	void RequestTextureMips();
+
+	// Texture requests are saved to a log when recording stops
+	void SetStreamingRecording(bool recording);
+
+private:
+	Camera m_Camera = Camera::CreatePerspective(75.0f, (float)AppConfig.WindowWidth / AppConfig.WindowHeight, 0.1f, 1000.0f);
 
 	ScopedRef<Texture> m_FinalResult;
 	ScopedRef<Texture> m_DepthTexture;
 
 	ScopedRef<Shader> m_GeometryShader;
 	ScopedRef<Shader> m_BackgroundShader;
+	ScopedRef<Shader> m_MorphBlendShader;
 
 	bool m_EnableWeightAnimation = true;
+	float m_MorphWeightThreshold = 0.001f;
+
+	// Per scene object, set by BlendMorphs each frame
+	std::vector<bool> m_MorphsBlended;
+
+	struct MorphStats
+	{
+		uint32_t NumTargets = 0;
+		uint32_t NumActiveTargets = 0;
+		uint32_t NumActiveDeltas = 0;
+	};
+	MorphStats m_MorphStats;
+
 	float m_AnimationTime = 0.0f;
 	ModelLoading::Scene m_Scene;
+	std::shared_ptr<ModelLoading::AsyncSceneLoad> m_SceneLoad;
+	TextureStreaming::TextureStreamer m_TextureStreamer;
+
+	struct SkinnedObject
+	{
+		uint32_t ObjectIndex = 0;
+		AnimationSystem::SkeletonHandle Skeleton = 0;
+		AnimationSystem::InstanceHandle FirstInstance = 0;
+	};
+
+	AnimationSystem m_AnimationSystem;
+	std::vector<SkinnedObject> m_SkinnedObjects;
+	uint32_t m_CrowdSize = 1;
+	float m_CrowdSpacing = 2.0f;
 };
\ No newline at end of file
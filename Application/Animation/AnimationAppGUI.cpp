@@ -3,6 +3,7 @@
 #include <vector>
 
 #include <Engine/Loading/ModelLoading.h>
+#include <Engine/Render/Shader.h>
 #include <Engine/Gui/GUI.h>
 #include <Engine/Gui/ImGui_Core.h>
 
@@ -23,6 +24,12 @@ namespace AnimationAppGUI
 		void Render(GraphicsContext& context) override
 		{
 			ImGui::Checkbox("Weight animation", &m_Application->m_EnableWeightAnimation);
+			ImGui::DragFloat("Weight threshold", &m_Application->m_MorphWeightThreshold, 0.001f, 0.0f, 1.0f);
+
+			const AnimationApp::MorphStats& stats = m_Application->m_MorphStats;
+			ImGui::Text("Active targets: %u/%u", stats.NumActiveTargets, stats.NumTargets);
+			ImGui::Text("Blended deltas: %u", stats.NumActiveDeltas);
+			ImGui::Separator();
 
 			uint32_t objectIndex = 0;
 			for (ModelLoading::SceneObject& object : m_Application->m_Scene.Objects)
@@ -48,11 +55,82 @@ namespace AnimationAppGUI
 		AnimationApp* m_Application;
 	};
 
+	class CrowdGUI : public GUIElement
+	{
+	public:
+		CrowdGUI(AnimationApp* app) :
+			GUIElement("Crowd"),
+			m_Application(app)
+		{}
+
+		void Update(float dt) override {}
+
+		void Render(GraphicsContext& context) override
+		{
+			int crowdSize = (int) m_Application->m_CrowdSize;
+			if (ImGui::SliderInt("Crowd size", &crowdSize, 1, 10000)) m_Application->SetCrowdSize((uint32_t) crowdSize);
+			ImGui::DragFloat("Spacing", &m_Application->m_CrowdSpacing, 0.1f);
+
+			const AnimationSystem& animationSystem = m_Application->m_AnimationSystem;
+			ImGui::Text("Instances: %u", animationSystem.GetInstanceCount());
+			ImGui::Text("Update: %.3f ms", animationSystem.GetUpdateTimeMS());
+			ImGui::Text("Palette: %.1f KB", animationSystem.GetPalette().size() * sizeof(AnimationOperations::SkinMatrix) / 1024.0f);
+		}
+
+	private:
+		AnimationApp* m_Application;
+	};
+
+	class StreamingGUI : public GUIElement
+	{
+	public:
+		StreamingGUI(AnimationApp* app) :
+			GUIElement("Texture streaming"),
+			m_Application(app)
+		{}
+
+		void Update(float dt) override {}
+
+		void Render(GraphicsContext& context) override
+		{
+			TextureStreaming::TextureStreamer& streamer = m_Application->m_TextureStreamer;
+			TextureStreaming::ResidencySettings settings = streamer.GetSettings();
+
+			int budgetMB = (int) (settings.BudgetBytes / (1024 * 1024));
+			int maxPromotions = (int) settings.MaxPromotionsPerUpdate;
+			bool changed = ImGui::SliderInt("Budget (MB)", &budgetMB, 1, 2048);
+			changed = ImGui::SliderInt("Promotions per frame", &maxPromotions, 1, 64) || changed;
+			changed = ImGui::DragFloat("Mip bias", &settings.MipBias, 0.1f, -4.0f, 4.0f) || changed;
+			if (changed)
+			{
+				settings.BudgetBytes = (uint64_t) budgetMB * 1024 * 1024;
+				settings.MaxPromotionsPerUpdate = (uint32_t) maxPromotions;
+				streamer.SetSettings(settings);
+			}
+
+			const TextureStreaming::ResidencyStats stats = streamer.GetStats();
+			ImGui::Text("Resident: %.1f MB", streamer.GetResidentBytes() / (1024.0f * 1024.0f));
+			ImGui::Text("Uploads in flight: %u", streamer.GetUploadsInFlight());
+			ImGui::Text("Promotions: %llu (%.1f MB)", stats.NumPromotions, stats.PromotedBytes / (1024.0f * 1024.0f));
+			ImGui::Text("Evictions: %llu (%.1f MB)", stats.NumEvictions, stats.EvictedBytes / (1024.0f * 1024.0f));
+			ImGui::Text("Missed requests: %llu/%llu", stats.NumMissedRequests, stats.NumRequests);
+			ImGui::Separator();
+
+			bool recording = streamer.IsRecording();
+			if (ImGui::Checkbox("Record requests", &recording)) m_Application->SetStreamingRecording(recording);
+		}
+
+	private:
+		AnimationApp* m_Application;
+	};
+
 	void AddGUI(AnimationApp* app)
 	{
 		GUI* gui = GUI::Get();
 		gui->PushMenu("Animations");
 		gui->AddElement(new MorphsGUI(app));
+		gui->AddElement(new CrowdGUI(app));
+		gui->AddElement(new StreamingGUI(app));
 		gui->PopMenu();
 	}
 
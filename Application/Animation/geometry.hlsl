@@ -1,9 +1,26 @@
 #include "../Common/common_shader.h"
+#include "../Common/quantized_vertex.h"
 
-// Must be divisible by 4
-#define MAX_MORPH_WEIGHTS 16
-#define MAX_SKELETON_JOINTS 128
+#ifdef QUANTIZED_VERTICES
+// Single interleaved stream, see VertexQuantization::Vertex and VertexQuantization::SkinnedVertex
+struct VertexIN
+{
+	float3 Position : SV_POSITION;
+	uint Texcoord	: TEXCOORD;
+	uint Normal		: NORMAL;
+	uint Tangent	: TANGENT;
+
+#ifdef APPLY_SKIN
+	uint Joints		: JOINTS;
+	uint Weights	: WEIGHTS;
+	uint InstanceID	: SV_InstanceID;
+#endif // APPLY_SKIN
 
+#ifdef APPLY_MORPHS
+	uint VertexID	: SV_VertexID;
+#endif // APPLY_MORPHS
+};
+#else
 struct VertexIN
 {
 	float3 Position : SV_POSITION;
@@ -17,6 +34,25 @@ struct VertexIN
 #ifdef APPLY_SKIN
 	float4 Weights	: WEIGHTS;
 	uint4 Joints	: JOINTS;
+	uint InstanceID	: SV_InstanceID;
+#endif // APPLY_SKIN
+};
+#endif // QUANTIZED_VERTICES
+
+struct Vertex
+{
+	float3 Position;
+	float2 Texcoord;
+	float3 Normal;
+
+#ifdef APPLY_MORPHS
+	uint VertexID;
+#endif // APPLY_MORPHS
+
+#ifdef APPLY_SKIN
+	float4 Weights;
+	uint4 Joints;
+	uint InstanceID;
 #endif // APPLY_SKIN
 };
 
@@ -28,12 +64,12 @@ struct VertexOUT
 	float3 Normal	: NORMAL;
 };
 
-struct MorphVertex
+// Must match with ModelLoading::BlendedMorphVertex
+struct BlendedMorphVertex
 {
 	float3 Position;
 	float2 Texcoord;
 	float3 Normal;
-	float4 Tangent;
 };
 
 cbuffer Constants : register(b0)
@@ -43,15 +79,11 @@ cbuffer Constants : register(b0)
 	float4x4 ModelToWorld;
 	float3 AlbedoFactor;
 
-#ifdef APPLY_MORPHS
-	uint MorphWeightCount;
-	float4 MorphWeights[MAX_MORPH_WEIGHTS / 4];
-#endif // APPLY_MORPHS
-
 #ifdef APPLY_SKIN
-	float4x4 JointTransformations[MAX_SKELETON_JOINTS];
-	float4x4 JointAnimationTransformations[MAX_SKELETON_JOINTS];
-	float4x4 ModelToJointTransformations[MAX_SKELETON_JOINTS];
+	uint PaletteOffset;	// Skin matrix of the first joint of the first instance
+	uint JointCount;
+	float CrowdSpacing;
+	uint CrowdRowSize;
 #endif // APPLY_SKIN
 }
 
@@ -59,49 +91,83 @@ SamplerState s_LinearWrap : register(s0);
 Texture2D<float4> Albedo : register(t0);
 
 #ifdef APPLY_MORPHS
-StructuredBuffer<MorphVertex> MorphTargets[MAX_MORPH_WEIGHTS] : register(t1);
+// Active morph targets already blended by morph_blend.hlsl
+StructuredBuffer<BlendedMorphVertex> BlendedMorph : register(t1);
+#endif // APPLY_MORPHS
+
+#ifdef APPLY_SKIN
+// Transposed 4x3 matrices, three rows per joint, see AnimationOperations::SkinMatrix
+StructuredBuffer<float4> SkinPalette : register(t17);
+#endif // APPLY_SKIN
+
+void ApplyMorph(inout Vertex vertex)
+{
+#ifdef APPLY_MORPHS
+	const BlendedMorphVertex morph = BlendedMorph[vertex.VertexID];
+	vertex.Position += morph.Position;
+	vertex.Texcoord += morph.Texcoord;
+	vertex.Normal += morph.Normal;
 #endif // APPLY_MORPHS
+}
 
-void ApplyMorph(inout VertexIN vertex)
+Vertex DecodeVertex(VertexIN IN)
 {
+	Vertex vertex;
+	vertex.Position = IN.Position;
+
+#ifdef QUANTIZED_VERTICES
+	vertex.Texcoord = UnpackHalf2(IN.Texcoord);
+	vertex.Normal = UnpackOctahedral(IN.Normal);
+#else
+	vertex.Texcoord = IN.Texcoord;
+	vertex.Normal = IN.Normal;
+#endif // QUANTIZED_VERTICES
+
 #ifdef APPLY_MORPHS
-	 for (uint i = 0; i < MorphWeightCount; i++)
-	 {
-	 	const float weight = MorphWeights[i/4][i%4];
-	 	MorphVertex targetVert = MorphTargets[i][vertex.VertexID];
-		vertex.Position += weight * targetVert.Position;
-		vertex.Texcoord += weight * targetVert.Texcoord;
-		vertex.Normal += weight * targetVert.Normal;
-	 }
+	vertex.VertexID = IN.VertexID;
 #endif // APPLY_MORPHS
+
+#ifdef APPLY_SKIN
+#ifdef QUANTIZED_VERTICES
+	vertex.Weights = UnpackUnorm8x4(IN.Weights);
+	vertex.Joints = UnpackUint8x4(IN.Joints);
+#else
+	vertex.Weights = IN.Weights;
+	vertex.Joints = IN.Joints;
+#endif // QUANTIZED_VERTICES
+	vertex.InstanceID = IN.InstanceID;
+#endif // APPLY_SKIN
+
+	return vertex;
 }
 
-void ApplySkin(inout VertexIN vertex)
+void ApplySkin(inout Vertex vertex)
 {
 #ifdef APPLY_SKIN
-	float4x4 skinMatrix = 0.0f;
+	float3x4 skinMatrix = 0.0f;
 	[unroll]
 	for (uint i = 0; i < 4; i++)
 	{
-		const uint jointIndex = vertex.Joints[i];
-		const float4x4 toModel = mul(JointTransformations[jointIndex], JointAnimationTransformations[jointIndex]);
-		const float4x4 jointTransformation = mul(ModelToJointTransformations[jointIndex], toModel);
-		skinMatrix += vertex.Weights[i] * jointTransformation;
+		const uint matrixIndex = (PaletteOffset + vertex.InstanceID * JointCount + vertex.Joints[i]) * 3;
+		skinMatrix += vertex.Weights[i] * float3x4(SkinPalette[matrixIndex], SkinPalette[matrixIndex + 1], SkinPalette[matrixIndex + 2]);
 	}
-	vertex.Position = mul(float4(vertex.Position, 1.0f), skinMatrix).xyz;
-	vertex.Normal = mul(vertex.Normal, (float3x3) skinMatrix);
+	vertex.Position = mul(skinMatrix, float4(vertex.Position, 1.0f));
+	vertex.Normal = mul((float3x3) skinMatrix, vertex.Normal);
 #endif // APPLY_SKIN
 }
 
 
 VertexOUT VS(VertexIN IN)
 {
-	VertexIN vertex = IN;
+	Vertex vertex = DecodeVertex(IN);
 	ApplyMorph(vertex);
-	// ApplySkin(vertex);
+	ApplySkin(vertex);
 
 	vertex.Position = mul(float4(vertex.Position, 1.0f), AnimationTransformation).xyz;
 	vertex.Position = mul(float4(vertex.Position, 1.0f), ModelToWorld).xyz;
+#ifdef APPLY_SKIN
+	vertex.Position += CrowdSpacing * float3(vertex.InstanceID % CrowdRowSize, 0.0f, vertex.InstanceID / CrowdRowSize);
+#endif // APPLY_SKIN
 	vertex.Normal = mul(vertex.Normal, (float3x3) AnimationTransformation);
 	vertex.Normal = mul(vertex.Normal, (float3x3) ModelToWorld);
 
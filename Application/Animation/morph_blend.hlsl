@@ -0,0 +1,50 @@
+#include "../Common/quantized_vertex.h"
+
+// Must match with ModelLoading::MorphDelta
+struct MorphDelta
+{
+	uint VertexIndex;
+	float3 Position;
+	uint Texcoord;
+	uint NormalXY;
+	uint NormalZ;
+};
+
+// Must match with ModelLoading::BlendedMorphVertex
+struct BlendedMorphVertex
+{
+	float3 Position;
+	float2 Texcoord;
+	float3 Normal;
+};
+
+cbuffer Constants : register(b0)
+{
+	uint Count;		// Vertices to clear or deltas to add
+	float Weight;
+}
+
+#ifndef CLEAR
+StructuredBuffer<MorphDelta> Deltas : register(t0);
+#endif // CLEAR
+
+RWStructuredBuffer<BlendedMorphVertex> BlendedMorph : register(u0);
+
+// Targets are added one dispatch at a time, deltas of a single target never share a vertex so no atomics are needed
+[numthreads(64, 1, 1)]
+void CS(uint3 threadID : SV_DispatchThreadID)
+{
+	if (threadID.x >= Count) return;
+
+#ifdef CLEAR
+	BlendedMorph[threadID.x] = (BlendedMorphVertex) 0;
+#else
+	const MorphDelta delta = Deltas[threadID.x];
+
+	BlendedMorphVertex vertex = BlendedMorph[delta.VertexIndex];
+	vertex.Position += Weight * delta.Position;
+	vertex.Texcoord += Weight * UnpackHalf2(delta.Texcoord);
+	vertex.Normal += Weight * float3(UnpackHalf2(delta.NormalXY), f16tof32(delta.NormalZ));
+	BlendedMorph[delta.VertexIndex] = vertex;
+#endif // CLEAR
+}
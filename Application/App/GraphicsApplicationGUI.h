@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Engine/Gui/GUI.h>
+#include <Engine/Render/Context.h>
 #include <Engine/Gui/ImGui_Core.h>
 
 #include "App/GraphicsApplication.h"
@@ -97,6 +98,11 @@ public:
 	{
 		ImGui::Text("Frame: %.2f ms", m_CurrentDT);
 		ImGui::Text("FPS:   %u", static_cast<uint32_t>(1000.0f / m_CurrentDT));
+
+		// Frame so far, the GUI is recorded last
+		const DescriptorTableStats& tableStats = context.TableStats;
+		ImGui::Text("Descriptor tables: %u (%u reused)", tableStats.NumTables, tableStats.NumHits);
+		ImGui::Text("Copied descriptors: %u in %u copies", tableStats.NumCopiedDescriptors, tableStats.NumCopyCalls);
 	}
 
 private:
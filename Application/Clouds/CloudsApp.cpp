@@ -56,7 +56,7 @@ static Texture* GenerateWorleyNoise(GraphicsContext& context)
 	GraphicsState state{};
 	state.Shader = worleyShader;
 	state.ShaderStages = CS;
-	state.Table.CBVs[0] = cbData.GetBuffer(context);
+	state.RootCBVs[0] = cbData.Upload(context);
 	state.Table.SRVs[0] = pointsBuffer;
 	state.Table.UAVs[0] = outputTexture;
 	context.ApplyState(state);
@@ -106,7 +106,7 @@ Texture* CloudsApp::OnDraw(GraphicsContext& context)
 
 	GraphicsState state{};
 	state.Shader = m_CloudsShader.get();
-	state.Table.CBVs[0] = cb.GetBuffer(context);
+	state.RootCBVs[0] = cb.Upload(context);
 	state.Table.SRVs[0] = m_CloudNoise;
 	state.Table.SRVs[1] = m_CloudDetailNoise;
 	state.Table.SMPs[0] = Sampler{ D3D12_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR, D3D12_TEXTURE_ADDRESS_MODE_WRAP };
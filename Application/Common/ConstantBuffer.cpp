@@ -1,17 +1,11 @@
 #include "ConstantBuffer.h"
 
-#include <Engine/Render/Commands.h>
-#include <Engine/Render/Buffer.h>
-#include <Engine/Render/DescriptorHeap.h>
+#include <Engine/Render/Context.h>
 
-Buffer* ConstantBuffer::GetBuffer(GraphicsContext& context)
+D3D12_GPU_VIRTUAL_ADDRESS ConstantBuffer::Upload(GraphicsContext& context)
 {
-	uint32_t bufferSize = (m_DataSize + 255) & ~255;
-	Buffer* buffer = GFX::CreateBuffer(bufferSize, bufferSize, RCF::CBV | RCF::CPU_Access);
-	GFX::SetDebugName(buffer, "ConstantManager::Buffer");
-	GFX::Cmd::UploadToBufferImmediate(buffer, 0, m_Data.data(), 0, m_DataSize);
-	GFX::Cmd::Delete(context, buffer);
-	return buffer;
+	// Allocations are 256 byte aligned, a shader reading the whole register of the last constant stays inside the allocation
+	return context.UploadMemory.Upload(m_Data.data(), m_DataSize).GPUAddress;
 }
 
 void ConstantBuffer::AddInternal(const uint8_t* data, uint32_t stride)
@@ -3,8 +3,8 @@
 #include <vector>
 
 #include <Engine/Common.h>
+#include <Engine/Render/RenderAPI.h>
 
-struct Buffer;
 struct GraphicsContext;
 
 class ConstantBuffer
@@ -19,7 +19,8 @@ public:
 
 	}
 
-	Buffer* GetBuffer(GraphicsContext& context);
+	// Copies the constants to the upload memory of the context, the address is bound with GraphicsState::RootCBVs
+	D3D12_GPU_VIRTUAL_ADDRESS Upload(GraphicsContext& context);
 
 private:
 	void AddInternal(const uint8_t* data, uint32_t stride);
@@ -116,7 +116,7 @@ namespace DebugRender
 		cb.Add(position);
 		cb.Add(radius);
 
-		DebugState.Table.CBVs[0] = cb.GetBuffer(context);
+		DebugState.RootCBVs[0] = cb.Upload(context);
 		DebugState.RenderTargets[0] = colorTarget;
 		DebugState.DepthStencil = depthDarget;
 		context.ApplyState(DebugState);
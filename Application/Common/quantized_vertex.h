@@ -0,0 +1,36 @@
+// Decoding of the quantized vertex attributes, must match with Engine/Loading/VertexQuantization.h
+
+float2 UnpackHalf2(uint packed)
+{
+	return float2(f16tof32(packed & 0xFFFF), f16tof32(packed >> 16));
+}
+
+float2 UnpackSnorm16x2(uint packed)
+{
+	const int2 value = int2(packed << 16, packed) >> 16;
+	return max(float2(value) / 32767.0f, -1.0f);
+}
+
+float3 UnpackOctahedral(uint packed)
+{
+	const float2 encoded = UnpackSnorm16x2(packed);
+	float3 normal = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+	const float fold = saturate(-normal.z);
+	normal.xy += (1.0f - 2.0f * step(0.0f, encoded)) * fold;
+	return normalize(normal);
+}
+
+float4 UnpackTangent(uint packed)
+{
+	return float4(UnpackOctahedral(packed), (packed & 1) ? -1.0f : 1.0f);
+}
+
+float4 UnpackUnorm8x4(uint packed)
+{
+	return float4(packed & 0xFF, (packed >> 8) & 0xFF, (packed >> 16) & 0xFF, packed >> 24) / 255.0f;
+}
+
+uint4 UnpackUint8x4(uint packed)
+{
+	return uint4(packed & 0xFF, (packed >> 8) & 0xFF, (packed >> 16) & 0xFF, packed >> 24);
+}
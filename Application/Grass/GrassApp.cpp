@@ -92,7 +92,7 @@ void GrassApp::OnInit(GraphicsContext& context)
 
 	m_BackgroundShader = ScopedRef<Shader>(new Shader("Application/Grass/Shaders/background.hlsl"));
 
-	m_HeightMap = ScopedRef<Texture>(TextureLoading::LoadTexture(context, "Application/Grass/Resources/HeightMap.jpg", RCF::None));
+	m_HeightMap = ScopedRef<Texture>(TextureLoading::LoadTexture(context, "Application/Grass/Resources/HeightMap.jpg", RCF::None, 1, TextureLoading::DecodeChannels::Narrow));
 	m_GrassPlaneVB = ScopedRef<Buffer>(GenerateGrassPlane(context));
 	m_GrassPlaneShader = ScopedRef<Shader>(new Shader("Application/Grass/Shaders/grass_plane.hlsl"));
 
@@ -154,7 +154,7 @@ Texture* GrassApp::OnDraw(GraphicsContext& context)
 		state.Shader = m_WindShader.get();
 		state.ShaderStages = CS;
 		state.Table.UAVs[0] = m_WindTexture.get();
-		state.Table.CBVs[0] = cb.GetBuffer(context);
+		state.RootCBVs[0] = cb.Upload(context);
 		context.ApplyState(state);
 		context.CmdList->Dispatch(MathUtility::CeilDiv(m_WindTexture->Width, 8u), MathUtility::CeilDiv(m_WindTexture->Width, 8u), 1);
 
@@ -176,7 +176,7 @@ Texture* GrassApp::OnDraw(GraphicsContext& context)
 
 		GraphicsState state{};
 		state.Shader = m_BackgroundShader.get();
-		state.Table.CBVs[0] = cb.GetBuffer(context);
+		state.RootCBVs[0] = cb.Upload(context);
 		state.RenderTargets[0] = m_FinalResult.get();
 		GFX::Cmd::DrawFC(context, state);
 		GFX::Cmd::MarkerEnd(context);
@@ -195,7 +195,7 @@ Texture* GrassApp::OnDraw(GraphicsContext& context)
 		state.Shader = m_GrassPlaneShader.get();
 		state.DepthStencilState.DepthEnable = true;
 		state.Table.SRVs[0] = m_HeightMap.get();
-		state.Table.CBVs[0] = cb.GetBuffer(context);
+		state.RootCBVs[0] = cb.Upload(context);
 		state.Table.SMPs[0] = Sampler{ D3D12_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR, D3D12_TEXTURE_ADDRESS_MODE_WRAP };
 		state.VertexBuffers[0] = m_GrassPlaneVB.get();
 		state.RenderTargets[0] = m_FinalResult.get();
@@ -231,7 +231,7 @@ Texture* GrassApp::OnDraw(GraphicsContext& context)
 		GraphicsState state{};
 		state.Shader = m_GrassPrepareShader.get();
 		state.ShaderStages = CS;
-		state.Table.CBVs[0] = cb.GetBuffer(context);
+		state.RootCBVs[0] = cb.Upload(context);
 		state.Table.SRVs[0] = m_GrassPatchDataBuffer.get();
 		state.Table.UAVs[0] = m_IndirectArgsBufferHP.get();
 		state.Table.UAVs[1] = m_IndirectArgsCountBufferHP.get();
@@ -267,7 +267,7 @@ Texture* GrassApp::OnDraw(GraphicsContext& context)
 		GraphicsState state{};
 		state.Shader = m_GrassShader.get();
 		state.DepthStencilState.DepthEnable = true;
-		state.Table.CBVs[0] = cb.GetBuffer(context);
+		state.RootCBVs[0] = cb.Upload(context);
 		state.Table.SRVs[0] = m_GrassInstanceData.get();
 		state.Table.SRVs[1] = m_WindTexture.get();
 		state.Table.SRVs[2] = m_HeightMap.get();
@@ -21,7 +21,11 @@ void MeshletsApp::OnInit(GraphicsContext& context)
 	MeshletsAppGUI::AddGUI();
 	OnWindowResize(context);
 
-	ModelLoading::Loader loader{ context };
+	ModelLoading::LoaderSettings loaderSettings{};
+	loaderSettings.KeepMeshData = true;
+	loaderSettings.SplitLargeMeshes = false;
+
+	ModelLoading::Loader loader{ context, loaderSettings };
 	m_Scene = loader.Load("Application/Meshlets/Resources/Dragon/DragonAttenuation.gltf");
 	ASSERT_CORE(m_Scene.Objects.size() > SampleSceneObjectIndex, "Invalid sample scene for model loading in MeshletsApp!");
 
@@ -69,7 +73,7 @@ Texture* MeshletsApp::OnDraw(GraphicsContext& context)
 	GraphicsState state{};
 	state.Shader = m_Shader.get();
 	state.ShaderStages = MS | PS;
-	state.Table.CBVs[0] = cb.GetBuffer(context);
+	state.RootCBVs[0] = cb.Upload(context);
 	state.Table.SRVs[0] = mesh.Positions;
 	state.Table.SRVs[1] = mesh.Normals;
 	state.Table.SRVs[2] = m_MeshletsBuffer.get();
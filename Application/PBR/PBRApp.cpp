@@ -77,6 +77,11 @@ void PBRApp::OnInit(GraphicsContext& context)
 	m_PBRShader = ScopedRef<Shader>(new Shader("Application/PBR/Shaders/pbr.hlsl"));
 	m_BackgroundShader = ScopedRef<Shader>(new Shader("Application/Animation/background.hlsl"));
 
+	// Every config FillShaderConfig can make, switching settings in the GUI doesn't stall on the compiler
+	m_PBRShader->AddPermutations({ { "", "BRDF_Lambert" }, { "", "Illumination_Directional", "Illumination_Point" }, { "", "Fresnel_Shlick" } });
+	m_BackgroundShader->AddPermutations({});
+	GFX::WarmUpShaders({ m_PBRShader.get(), m_BackgroundShader.get() });
+
 	m_Camera.Position = Float3(7.5f, 3.0f, 0.0f);
 	m_Camera.Rotation = Float3(-0.3f, -34.6f, 0.0f);
 
@@ -110,7 +115,7 @@ Texture* PBRApp::OnDraw(GraphicsContext& context)
 		cb.Add(SkyColor);
 
 		GraphicsState state{};
-		state.Table.CBVs[0] = cb.GetBuffer(context);
+		state.RootCBVs[0] = cb.Upload(context);
 		state.Shader = m_BackgroundShader.get();
 		state.RenderTargets[0] = m_FinalResult.get();
 		GFX::Cmd::DrawFC(context, state);
@@ -140,7 +145,7 @@ Texture* PBRApp::OnDraw(GraphicsContext& context)
 		cb.Add(m_Camera.ConstantData);
 		cb.Add(XMUtility::ToHLSLFloat4x4(rotatedModelToWorld));
 
-		state.Table.CBVs[0] = cb.GetBuffer(context);
+		state.RootCBVs[0] = cb.Upload(context);
 		state.VertexBuffers[0] = object.Mesh.Positions;
 		state.VertexBuffers[1] = object.Mesh.Normals;
 		state.IndexBuffer = object.Mesh.Indices;
@@ -71,7 +71,7 @@ Texture* VolumetricLightsApp::OnDraw(GraphicsContext& context)
 
 		GraphicsState state{};
 		state.Shader = m_BackgroundShader.get();
-		state.Table.CBVs[0] = cb.GetBuffer(context);
+		state.RootCBVs[0] = cb.Upload(context);
 		state.RenderTargets[0] = m_FinalResult.get();
 		GFX::Cmd::DrawFC(context, state);
 	}
@@ -88,7 +88,7 @@ Texture* VolumetricLightsApp::OnDraw(GraphicsContext& context)
 		GraphicsState state{};
 		state.Shader = m_ShadowShader.get();
 		state.ShaderStages = VS;
-		state.Table.CBVs[0] = cb.GetBuffer(context);
+		state.RootCBVs[0] = cb.Upload(context);
 		state.DepthStencil = m_Shadowmap.get();
 		state.DepthStencilState.DepthEnable = true;
 
@@ -97,7 +97,7 @@ Texture* VolumetricLightsApp::OnDraw(GraphicsContext& context)
 			ConstantBuffer objectCB{};
 			objectCB.Add(XMUtility::ToHLSLFloat4x4(object.ModelToWorld));
 
-			state.Table.CBVs[1] = objectCB.GetBuffer(context);
+			state.RootCBVs[1] = objectCB.Upload(context);
 			state.VertexBuffers[0] = object.Mesh.Positions;
 			state.IndexBuffer = object.Mesh.Indices;
 
@@ -117,7 +117,7 @@ Texture* VolumetricLightsApp::OnDraw(GraphicsContext& context)
 
 		GraphicsState state{};
 		state.Shader = m_SceneShader.get();
-		state.Table.CBVs[0] = cb.GetBuffer(context);
+		state.RootCBVs[0] = cb.Upload(context);
 		state.Table.SRVs[0] = m_Shadowmap.get();
 		state.Table.SMPs[0] = Sampler{ D3D12_FILTER_MIN_MAG_MIP_POINT , D3D12_TEXTURE_ADDRESS_MODE_WRAP };
 		state.RenderTargets[0] = m_FinalResult.get();
@@ -137,7 +137,7 @@ Texture* VolumetricLightsApp::OnDraw(GraphicsContext& context)
 			objectCB.Add(XMUtility::ToHLSLFloat4x4(modelToWorldNormal));
 			objectCB.Add(object.Material.AlbedoFactor);
 			
-			state.Table.CBVs[1] = objectCB.GetBuffer(context);
+			state.RootCBVs[1] = objectCB.Upload(context);
 			state.VertexBuffers[0] = object.Mesh.Positions;
 			state.VertexBuffers[1] = object.Mesh.Normals;
 			state.IndexBuffer = object.Mesh.Indices;
@@ -158,7 +158,7 @@ Texture* VolumetricLightsApp::OnDraw(GraphicsContext& context)
 
 		GraphicsState state{};
 		state.Shader = m_VolumetricFogShader.get();
-		state.Table.CBVs[0] = cb.GetBuffer(context);
+		state.RootCBVs[0] = cb.Upload(context);
 		state.Table.SMPs[0] = Sampler{ D3D12_FILTER_MIN_MAG_MIP_POINT , D3D12_TEXTURE_ADDRESS_MODE_WRAP };
 		state.Table.SRVs[0] = m_DepthTexture.get();
 		state.Table.SRVs[1] = m_Shadowmap.get();
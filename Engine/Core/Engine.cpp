@@ -7,13 +7,16 @@
 #include "Render/Device.h"
 #include "Render/Texture.h"
 #include "Render/Shader.h"
+#include "Render/PipelineLibrary.h"
 #include "Render/RenderThread.h"
 #include "Render/RenderResources.h"
+#include "Loading/TextureCache.h"
 #include "Gui/GUI.h"
 #include "Gui/EngineGUI/ShaderCompilerGUI.h"
 #include "System/ApplicationConfiguration.h"
 #include "System/Window.h"
 #include "System/Input.h"
+#include "System/JobPool.h"
 
 struct Texture;
 
@@ -25,8 +28,10 @@ Engine::Engine(Application* app)
 	Window::Get()->ShowCursor(false);
 	
 	Device::Init();
-	GFX::InitShaderCompiler();
+	GFX::InitShaderCompiler("shaders.dxcache");
+	PipelineLibrary::Init("pipelines.psolib");
 	RenderThreadPool::Init(8);
+	JobPool::Init();
 
 	GraphicsContext& context = ContextManager::Get().GetCreationContext();
 	ID3D12CommandList* cmdList = context.CmdList.Get();
@@ -34,6 +39,7 @@ Engine::Engine(Application* app)
 
 	GFX::Cmd::BeginRecording(context);
 	GFX::InitRenderingResources(context);
+	TextureCache::Init();
 
 	GUI::Init();
 	GUI::Get()->AddElement(new ShaderCompilerGUI());
@@ -53,6 +59,10 @@ Engine::~Engine()
 	m_Application->OnDestroy(context);
 	GUI::Destroy();
 	delete m_Application;
+	ContextManager::Get().Flush();
+	TextureCache::Destroy();
+	PipelineLibrary::Destroy();
+	JobPool::Destroy();
 	RenderThreadPool::Destroy();
 	GFX::DestroyShaderCompiler();
 	GFX::DestroyRenderingResources(context);
@@ -12,4 +12,8 @@ void ShaderCompilerGUI::Update(float dt)
 void ShaderCompilerGUI::Render()
 {
 	ImGui::Text("Number of failed shaders: %u", GFX::GetFailedShaderCount());
+
+	const ShaderCacheStats stats = GFX::GetShaderCacheStats();
+	ImGui::Text("Shader cache: %u hits, %u misses, %u entries loaded", stats.NumHits, stats.NumMisses, stats.NumLoadedEntries);
+	ImGui::Text("Hashing %.1f ms, compiling misses %.1f ms", stats.KeyTimeMS, stats.CompileTimeMS);
 }
@@ -0,0 +1,295 @@
+#include "AnimationCompression.h"
+
+#include <cfloat>
+
+#include "Utility/MathUtility.h"
+
+namespace AnimationCompression
+{
+	using namespace AnimationOperations;
+
+	// Components other than the largest one are within [-1/sqrt(2), 1/sqrt(2)]
+	static constexpr float RotationComponentRange = 0.70710678f;
+	static constexpr uint32_t RotationComponentMax = (1 << 15) - 1;
+	static constexpr float RangeValueMax = 65535.0f;
+
+	// Vector values are sampled this often between keyframes when measuring the error
+	static constexpr float ErrorSampleRate = 240.0f;
+
+	void PackRotation(const Quaternion& rotation, uint16_t* packed)
+	{
+		const float length = std::sqrt(rotation.x * rotation.x + rotation.y * rotation.y + rotation.z * rotation.z + rotation.w * rotation.w);
+		const float invLength = length > 0.0f ? 1.0f / length : 0.0f;
+		const float components[4] = { rotation.x * invLength, rotation.y * invLength, rotation.z * invLength, rotation.w * invLength };
+
+		uint32_t largest = 0;
+		for (uint32_t i = 1; i < 4; i++)
+		{
+			if (std::abs(components[i]) > std::abs(components[largest])) largest = i;
+		}
+
+		// q and -q are the same rotation, flip it so the dropped component is positive
+		const float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+
+		uint64_t bits = largest;
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			if (i == largest) continue;
+			const float normalized = std::clamp(components[i] * sign / RotationComponentRange * 0.5f + 0.5f, 0.0f, 1.0f);
+			bits = (bits << 15) | static_cast<uint64_t>(std::round(normalized * RotationComponentMax));
+		}
+
+		packed[0] = static_cast<uint16_t>(bits);
+		packed[1] = static_cast<uint16_t>(bits >> 16);
+		packed[2] = static_cast<uint16_t>(bits >> 32);
+	}
+
+	Quaternion UnpackRotation(const uint16_t* packed)
+	{
+		const uint64_t bits = packed[0] | (static_cast<uint64_t>(packed[1]) << 16) | (static_cast<uint64_t>(packed[2]) << 32);
+		const uint32_t largest = static_cast<uint32_t>(bits >> 45) & 0x3;
+
+		float components[4];
+		float lengthSq = 0.0f;
+		int shift = 30;
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			if (i == largest) continue;
+			const uint32_t quantized = static_cast<uint32_t>(bits >> shift) & RotationComponentMax;
+			components[i] = (quantized / static_cast<float>(RotationComponentMax) * 2.0f - 1.0f) * RotationComponentRange;
+			lengthSq += components[i] * components[i];
+			shift -= 15;
+		}
+		components[largest] = std::sqrt(std::max(1.0f - lengthSq, 0.0f));
+
+		return Quaternion{ components[0], components[1], components[2], components[3] };
+	}
+
+	uint32_t GetPackedValueSize(ModelLoading::AnimTarget target)
+	{
+		return target == ModelLoading::AnimTarget::Rotation ? 3 : GetTrackValueSize(target);
+	}
+
+	void DecodeValue(const AnimationTrack& track, uint32_t keyFrame, float* value)
+	{
+		const uint32_t packedSize = GetPackedValueSize(track.Target);
+		const uint16_t* packed = track.PackedValues.data() + keyFrame * packedSize;
+
+		if (track.Target == ModelLoading::AnimTarget::Rotation)
+		{
+			const Quaternion rotation = UnpackRotation(packed);
+			memcpy(value, &rotation, sizeof(Quaternion));
+			return;
+		}
+
+		const float rangeMin[3] = { track.RangeMin.x, track.RangeMin.y, track.RangeMin.z };
+		const float rangeStep[3] = { track.RangeStep.x, track.RangeStep.y, track.RangeStep.z };
+		for (uint32_t i = 0; i < packedSize; i++) value[i] = rangeMin[i] + packed[i] * rangeStep[i];
+	}
+
+	static void PackValue(const AnimationTrack& track, const float* value, uint16_t* packed)
+	{
+		if (track.Target == ModelLoading::AnimTarget::Rotation)
+		{
+			PackRotation(Quaternion{ value[0], value[1], value[2], value[3] }, packed);
+			return;
+		}
+
+		const float rangeMin[3] = { track.RangeMin.x, track.RangeMin.y, track.RangeMin.z };
+		const float rangeStep[3] = { track.RangeStep.x, track.RangeStep.y, track.RangeStep.z };
+		for (uint32_t i = 0; i < GetPackedValueSize(track.Target); i++)
+		{
+			const float quantized = rangeStep[i] > 0.0f ? std::round((value[i] - rangeMin[i]) / rangeStep[i]) : 0.0f;
+			packed[i] = static_cast<uint16_t>(std::clamp(quantized, 0.0f, RangeValueMax));
+		}
+	}
+
+	static float GetTolerance(ModelLoading::AnimTarget target, const Settings& settings)
+	{
+		switch (target)
+		{
+		case ModelLoading::AnimTarget::Translation: return settings.TranslationTolerance;
+		case ModelLoading::AnimTarget::Rotation: return settings.RotationToleranceDegrees;
+		case ModelLoading::AnimTarget::Scale: return settings.ScaleTolerance;
+		case ModelLoading::AnimTarget::Weights: return settings.WeightTolerance;
+		default: NOT_IMPLEMENTED;
+		}
+		return 0.0f;
+	}
+
+	// Angle in degrees for rotations, largest component difference otherwise
+	static float GetValueError(ModelLoading::AnimTarget target, const float* a, const float* b)
+	{
+		if (target == ModelLoading::AnimTarget::Rotation)
+		{
+			// Doubles since acos of a float dot can't resolve angles under a few hundredths of a degree
+			double dot = 0.0, lengthSqA = 0.0, lengthSqB = 0.0;
+			for (uint32_t i = 0; i < 4; i++)
+			{
+				dot += (double) a[i] * b[i];
+				lengthSqA += (double) a[i] * a[i];
+				lengthSqB += (double) b[i] * b[i];
+			}
+			const double cosHalfAngle = std::abs(dot) / std::max(std::sqrt(lengthSqA * lengthSqB), (double) FLT_MIN);
+			return (float) (2.0 * std::acos(std::min(cosHalfAngle, 1.0)) * 180.0 / DirectX::XM_PI);
+		}
+
+		float error = 0.0f;
+		for (uint32_t i = 0; i < GetTrackValueSize(target); i++) error = std::max(error, std::abs(a[i] - b[i]));
+		return error;
+	}
+
+	// Same interpolation as the sampler uses for linear and step tracks
+	static void InterpolateValue(const AnimationTrack& track, const float* a, const float* b, float factor, float* result)
+	{
+		const uint32_t valueSize = GetTrackValueSize(track.Target);
+		if (track.Interpolation == ModelLoading::AnimInterpolation::Step)
+		{
+			memcpy(result, a, valueSize * sizeof(float));
+		}
+		else if (track.Target == ModelLoading::AnimTarget::Rotation)
+		{
+			const Quaternion rotation = MathUtility::Lerp(Quaternion{ a[0], a[1], a[2], a[3] }, Quaternion{ b[0], b[1], b[2], b[3] }, factor);
+			memcpy(result, &rotation, sizeof(Quaternion));
+		}
+		else
+		{
+			for (uint32_t i = 0; i < valueSize; i++) result[i] = MathUtility::Lerp(a[i], b[i], factor);
+		}
+	}
+
+	static void CompressTrack(AnimationTrack& track, const Settings& settings)
+	{
+		const uint32_t valueSize = GetTrackValueSize(track.Target);
+		const uint32_t packedSize = GetPackedValueSize(track.Target);
+		const uint32_t numKeyFrames = (uint32_t) track.Times.size();
+		const float tolerance = GetTolerance(track.Target, settings);
+
+		if (track.Target != ModelLoading::AnimTarget::Rotation)
+		{
+			float rangeMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+			float rangeMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			float rangeStep[3] = { 0.0f, 0.0f, 0.0f };
+			for (uint32_t i = 0; i < valueSize; i++)
+			{
+				for (uint32_t keyFrame = 0; keyFrame < numKeyFrames; keyFrame++)
+				{
+					rangeMin[i] = std::min(rangeMin[i], track.Values[keyFrame * valueSize + i]);
+					rangeMax[i] = std::max(rangeMax[i], track.Values[keyFrame * valueSize + i]);
+				}
+				rangeStep[i] = (rangeMax[i] - rangeMin[i]) / RangeValueMax;
+			}
+			track.RangeMin = Float3{ rangeMin[0], valueSize > 1 ? rangeMin[1] : 0.0f, valueSize > 2 ? rangeMin[2] : 0.0f };
+			track.RangeStep = Float3{ rangeStep[0], rangeStep[1], rangeStep[2] };
+		}
+
+		// Keys are quantized first so the key reduction measures the error of the values the sampler will actually see
+		std::vector<float> decodedValues(numKeyFrames * valueSize);
+		track.PackedValues.resize(numKeyFrames * packedSize);
+		for (uint32_t keyFrame = 0; keyFrame < numKeyFrames; keyFrame++)
+		{
+			PackValue(track, track.Values.data() + keyFrame * valueSize, track.PackedValues.data() + keyFrame * packedSize);
+			DecodeValue(track, keyFrame, decodedValues.data() + keyFrame * valueSize);
+		}
+
+		// Greedy reduction, the segment from the last kept key grows until one of the skipped source keys is off by more than the tolerance.
+		// Both curves are piecewise linear so checking the source keys bounds the error in between too.
+		std::vector<uint32_t> keptKeyFrames{ 0 };
+		float interpolated[4];
+		uint32_t anchor = 0;
+		for (uint32_t end = 2; end < numKeyFrames; end++)
+		{
+			const float* anchorValue = decodedValues.data() + anchor * valueSize;
+			const float* endValue = decodedValues.data() + end * valueSize;
+			const float segmentTime = track.Times[end] - track.Times[anchor];
+
+			bool withinTolerance = true;
+			for (uint32_t keyFrame = anchor + 1; keyFrame < end && withinTolerance; keyFrame++)
+			{
+				const float factor = segmentTime > 0.0f ? (track.Times[keyFrame] - track.Times[anchor]) / segmentTime : 0.0f;
+				InterpolateValue(track, anchorValue, endValue, factor, interpolated);
+				withinTolerance = GetValueError(track.Target, interpolated, track.Values.data() + keyFrame * valueSize) <= tolerance;
+			}
+
+			if (!withinTolerance)
+			{
+				anchor = end - 1;
+				keptKeyFrames.push_back(anchor);
+			}
+		}
+		if (numKeyFrames > 1) keptKeyFrames.push_back(numKeyFrames - 1);
+
+		std::vector<float> times(keptKeyFrames.size());
+		std::vector<uint16_t> keptPackedValues(keptKeyFrames.size() * packedSize);
+		for (size_t i = 0; i < keptKeyFrames.size(); i++)
+		{
+			times[i] = track.Times[keptKeyFrames[i]];
+			memcpy(keptPackedValues.data() + i * packedSize, track.PackedValues.data() + keptKeyFrames[i] * packedSize, packedSize * sizeof(uint16_t));
+		}
+
+		if (keptKeyFrames.size() != numKeyFrames) track.InvKeyFrameInterval = 0.0f;
+		track.Times = std::move(times);
+		track.PackedValues = std::move(keptPackedValues);
+		track.Values = {};
+		track.Compressed = true;
+	}
+
+	static void MeasureError(const AnimationTrack& source, const AnimationTrack& compressed, Report& report)
+	{
+		if (source.Times.empty()) return;
+
+		const uint32_t valueSize = GetTrackValueSize(source.Target);
+		std::vector<float> sourceValue(valueSize);
+		std::vector<float> compressedValue(valueSize);
+		uint32_t sourceCursor = 0;
+		uint32_t compressedCursor = 0;
+
+		float maxError = 0.0f;
+		const auto measure = [&](float t)
+		{
+			SampleTrack(source, t, AnimationType::Once, sourceCursor, sourceValue.data());
+			SampleTrack(compressed, t, AnimationType::Once, compressedCursor, compressedValue.data());
+			maxError = std::max(maxError, GetValueError(source.Target, sourceValue.data(), compressedValue.data()));
+		};
+
+		for (float keyFrameTime : source.Times) measure(keyFrameTime);
+
+		const float startTime = source.Times.front();
+		const uint32_t numSamples = (uint32_t) ((source.Times.back() - startTime) * ErrorSampleRate);
+		for (uint32_t i = 0; i < numSamples; i++) measure(startTime + i / ErrorSampleRate);
+
+		switch (source.Target)
+		{
+		case ModelLoading::AnimTarget::Translation: report.MaxTranslationError = std::max(report.MaxTranslationError, maxError); break;
+		case ModelLoading::AnimTarget::Rotation: report.MaxRotationErrorDegrees = std::max(report.MaxRotationErrorDegrees, maxError); break;
+		case ModelLoading::AnimTarget::Scale: report.MaxScaleError = std::max(report.MaxScaleError, maxError); break;
+		case ModelLoading::AnimTarget::Weights: report.MaxWeightError = std::max(report.MaxWeightError, maxError); break;
+		default: NOT_IMPLEMENTED;
+		}
+	}
+
+	Report CompressClip(AnimationClip& clip, const Settings& settings)
+	{
+		Report report{};
+		for (AnimationTrack& track : clip.Tracks)
+		{
+			report.NumTracks++;
+			report.SourceKeyFrames += (uint32_t) track.Times.size();
+			report.SourceBytes += GetTrackByteSize(track);
+
+			const bool canCompress = !track.Compressed && !track.Times.empty() &&
+				(track.Interpolation == ModelLoading::AnimInterpolation::Lerp || track.Interpolation == ModelLoading::AnimInterpolation::Step);
+			if (canCompress)
+			{
+				const AnimationTrack source = track;
+				CompressTrack(track, settings);
+				MeasureError(source, track, report);
+				report.NumCompressedTracks++;
+			}
+
+			report.CompressedKeyFrames += (uint32_t) track.Times.size();
+			report.CompressedBytes += GetTrackByteSize(track);
+		}
+		return report;
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Loading/AnimationOperations.h"
+
+// Lossy compression of compiled animation clips.
+// Keys that interpolation rebuilds within the tolerance are removed, rotations are stored as 48 bit smallest three
+// and other values as 16 bit fractions of the track bounds. AnimationOperations sampling decodes compressed tracks on the fly.
+namespace AnimationCompression
+{
+	struct Settings
+	{
+		float TranslationTolerance = 0.0001f;
+		float RotationToleranceDegrees = 0.02f;
+		float ScaleTolerance = 0.0001f;
+		float WeightTolerance = 0.001f;
+	};
+
+	// Errors are measured in the joint space of every track against the source clip
+	struct Report
+	{
+		uint32_t NumTracks = 0;
+		uint32_t NumCompressedTracks = 0; // Cubic tracks are left as they are
+		uint32_t SourceKeyFrames = 0;
+		uint32_t CompressedKeyFrames = 0;
+		size_t SourceBytes = 0;
+		size_t CompressedBytes = 0;
+
+		float MaxTranslationError = 0.0f;
+		float MaxRotationErrorDegrees = 0.0f;
+		float MaxScaleError = 0.0f;
+		float MaxWeightError = 0.0f;
+	};
+
+	// Smallest three: index of the dropped largest component in 2 bits and the other three in 15 bits each
+	void PackRotation(const Quaternion& rotation, uint16_t* packed);
+	Quaternion UnpackRotation(const uint16_t* packed);
+
+	// Number of uint16 values per keyframe in AnimationTrack::PackedValues
+	uint32_t GetPackedValueSize(ModelLoading::AnimTarget target);
+
+	// Writes GetTrackValueSize floats of a compressed keyframe
+	void DecodeValue(const AnimationOperations::AnimationTrack& track, uint32_t keyFrame, float* value);
+
+	Report CompressClip(AnimationOperations::AnimationClip& clip, const Settings& settings);
+}
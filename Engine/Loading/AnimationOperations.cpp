@@ -1,5 +1,8 @@
 #include "AnimationOperations.h"
 
+#include "Loading/AnimationCompression.h"
+#include "Utility/BatchMath.h"
+
 namespace AnimationOperations
 {
 	template<typename T>
@@ -17,6 +20,8 @@ namespace AnimationOperations
 			value = a;
 			break;
 		case ModelLoading::AnimInterpolation::Cubic:
+			ASSERT(0, "[AnimationOperations] Cubic interpolation needs tangents, use Hermite");
+			break;
 		case ModelLoading::AnimInterpolation::Invalid:
 		default:
 			NOT_IMPLEMENTED;
@@ -24,23 +29,52 @@ namespace AnimationOperations
 		return value;
 	}
 
-	static DirectX::XMMATRIX GetFrameTransform(const ModelLoading::AnimKeyFrame& keyFrameA, const ModelLoading::AnimKeyFrame& keyFrameB, float animationTime,
-		ModelLoading::AnimInterpolation interpolationType, ModelLoading::AnimTarget targetType)
+	// glTF cubic spline between two keyframes, tangents are per second so they get scaled by the keyframe interval
+	template<typename T>
+	static T Hermite(const T& valueA, const T& outTangentA, const T& inTangentB, const T& valueB, float t, float interval)
+	{
+		const float t2 = t * t;
+		const float t3 = t2 * t;
+		return (2.0f * t3 - 3.0f * t2 + 1.0f) * valueA + (interval * (t3 - 2.0f * t2 + t)) * outTangentA + (-2.0f * t3 + 3.0f * t2) * valueB + (interval * (t3 - t2)) * inTangentB;
+	}
+
+	// Spline of the quaternion components, the result has to be normalized
+	template<>
+	Quaternion Hermite(const Quaternion& valueA, const Quaternion& outTangentA, const Quaternion& inTangentB, const Quaternion& valueB, float t, float interval)
+	{
+		const auto toFloat4 = [](const Quaternion& q) { return Float4{ q.x, q.y, q.z, q.w }; };
+		return Quaternion{ Hermite(toFloat4(valueA), toFloat4(outTangentA), toFloat4(inTangentB), toFloat4(valueB), t, interval).Normalize() };
+	}
+
+	// Value picked by getValue interpolated between keyFrame and the next one
+	template<typename GetValue>
+	static auto InterpolateEntry(const ModelLoading::AnimationEntry& entry, uint32_t keyFrame, float animationTime, const GetValue& getValue)
+	{
+		const uint32_t nextKeyFrame = MIN(keyFrame + 1, (uint32_t) entry.KeyFrames.size() - 1);
+		const auto valueA = getValue(entry.KeyFrames[keyFrame]);
+		const auto valueB = getValue(entry.KeyFrames[nextKeyFrame]);
+		if (entry.Interpolation != ModelLoading::AnimInterpolation::Cubic) return Interpolate(valueA, valueB, animationTime, entry.Interpolation);
+
+		const float interval = entry.KeyFrames[nextKeyFrame].Time - entry.KeyFrames[keyFrame].Time;
+		return Hermite(valueA, getValue(entry.OutTangents[keyFrame]), getValue(entry.InTangents[nextKeyFrame]), valueB, animationTime, interval);
+	}
+
+	static DirectX::XMMATRIX GetFrameTransform(const ModelLoading::AnimationEntry& entry, uint32_t keyFrame, float animationTime)
 	{
 		using namespace DirectX;
 
 		XMMATRIX transformation = XMMatrixIdentity();
 
-		switch (targetType)
+		switch (entry.Target)
 		{
 		case ModelLoading::AnimTarget::Translation: 
-			transformation = XMMatrixTranslationFromVector(Interpolate(keyFrameA.Translation, keyFrameB.Translation, animationTime, interpolationType));
+			transformation = XMMatrixTranslationFromVector(InterpolateEntry(entry, keyFrame, animationTime, [](const ModelLoading::AnimKeyFrame& k) { return k.Translation; }));
 			break;
 		case ModelLoading::AnimTarget::Rotation:	
-			transformation = XMMatrixRotationQuaternion(Interpolate(keyFrameA.Rotation, keyFrameB.Rotation, animationTime, interpolationType).ToXM());
+			transformation = XMMatrixRotationQuaternion(InterpolateEntry(entry, keyFrame, animationTime, [](const ModelLoading::AnimKeyFrame& k) { return k.Rotation; }).ToXM());
 			break;
 		case ModelLoading::AnimTarget::Scale:	
-			transformation = XMMatrixScalingFromVector(Interpolate(keyFrameA.Scale, keyFrameB.Scale, animationTime, interpolationType));
+			transformation = XMMatrixScalingFromVector(InterpolateEntry(entry, keyFrame, animationTime, [](const ModelLoading::AnimKeyFrame& k) { return k.Scale; }));
 			break;
 		case ModelLoading::AnimTarget::Weights:
 		case ModelLoading::AnimTarget::Invalid:
@@ -57,53 +91,60 @@ namespace AnimationOperations
 		return a - div * b;
 	}
 
-	static void CalculateTargetKeyframes(const ModelLoading::AnimationEntry& entry, float t, ModelLoading::AnimKeyFrame& kfA, ModelLoading::AnimKeyFrame& kfB, float& animationTime, AnimationType animationType)
+	static float GetFrameTime(float duration, float t, AnimationType animationType)
 	{
 		float frameTime = 0.0f;
 		switch (animationType)
 		{
 		case AnimationType::Once:
-			frameTime = MIN(entry.Duration, t);
+			frameTime = MIN(duration, t);
 			break;
 		case AnimationType::Repeat:
-			frameTime = floatMod(t, entry.Duration);
+			frameTime = floatMod(t, duration);
 			break;
 		case AnimationType::PingPong:
-			frameTime = floatMod(t, 2.0f * entry.Duration);
-			if (frameTime > entry.Duration) frameTime = 2.0f * entry.Duration - frameTime;
+			frameTime = floatMod(t, 2.0f * duration);
+			if (frameTime > duration) frameTime = 2.0f * duration - frameTime;
 			break;
 		default:
 			NOT_IMPLEMENTED;
 		}
+		return frameTime;
+	}
+
+	// Returns index of the first keyframe of the pair that contains the frame time
+	static uint32_t CalculateTargetKeyframes(const ModelLoading::AnimationEntry& entry, float t, float& animationTime, AnimationType animationType)
+	{
+		const float frameTime = GetFrameTime(entry.Duration, t, animationType);
 
+		uint32_t keyFrame = 0;
 		for (uint32_t i = 1; i < entry.KeyFrames.size(); i++)
 		{
 			if (entry.KeyFrames[i].Time >= frameTime)
 			{
-				kfA = entry.KeyFrames[i - 1];
-				kfB = entry.KeyFrames[i];
+				keyFrame = i - 1;
 				break;
 			}
 		}
-		animationTime = (frameTime - kfA.Time) / (kfB.Time - kfA.Time);
+
+		const float timeA = entry.KeyFrames[keyFrame].Time;
+		const float timeB = entry.KeyFrames[MIN(keyFrame + 1, (uint32_t) entry.KeyFrames.size() - 1)].Time;
+		animationTime = timeB > timeA ? (frameTime - timeA) / (timeB - timeA) : 0.0f;
+		return keyFrame;
 	}
 
 	static DirectX::XMMATRIX ProcessAnimationEntry(const ModelLoading::AnimationEntry& entry, float t, AnimationType animationType)
 	{
-		ModelLoading::AnimKeyFrame keyFrameA;
-		ModelLoading::AnimKeyFrame keyFrameB;
 		float animationTime;
-		CalculateTargetKeyframes(entry, t, keyFrameA, keyFrameB, animationTime, animationType);
-		return GetFrameTransform(keyFrameA, keyFrameB, animationTime, entry.Interpolation, entry.Target);
+		const uint32_t keyFrame = CalculateTargetKeyframes(entry, t, animationTime, animationType);
+		return GetFrameTransform(entry, keyFrame, animationTime);
 	}
 
 	static void AnimateWeight(float& weight, const ModelLoading::AnimationEntry& entry, float t, AnimationType animationType)
 	{
-		ModelLoading::AnimKeyFrame keyFrameA;
-		ModelLoading::AnimKeyFrame keyFrameB;
 		float animationTime;
-		CalculateTargetKeyframes(entry, t, keyFrameA, keyFrameB, animationTime, animationType);
-		weight += Interpolate(keyFrameA.Weight, keyFrameB.Weight, animationTime, entry.Interpolation);
+		const uint32_t keyFrame = CalculateTargetKeyframes(entry, t, animationTime, animationType);
+		weight += InterpolateEntry(entry, keyFrame, animationTime, [](const ModelLoading::AnimKeyFrame& k) { return k.Weight; });
 	}
 
 	DirectX::XMFLOAT4X4 GetAnimationTransformation(const std::vector<ModelLoading::AnimationEntry>& animations, float t, AnimationType animationType)
@@ -136,4 +177,396 @@ namespace AnimationOperations
 		}
 		return weights;
 	}
+
+	std::vector<uint32_t> GetActiveMorphTargets(const ModelLoading::SceneObject& object, const std::vector<float>& weights, float weightThreshold)
+	{
+		std::vector<uint32_t> activeTargets{};
+		for (uint32_t i = 0; i < weights.size() && i < object.MorphTargets.size(); i++)
+		{
+			if (object.MorphTargets[i].NumDeltas > 0 && std::abs(weights[i]) > weightThreshold)
+				activeTargets.push_back(i);
+		}
+		return activeTargets;
+	}
+
+	uint32_t GetTrackValueSize(ModelLoading::AnimTarget target)
+	{
+		switch (target)
+		{
+		case ModelLoading::AnimTarget::Translation:
+		case ModelLoading::AnimTarget::Scale:
+			return 3;
+		case ModelLoading::AnimTarget::Rotation:
+			return 4;
+		case ModelLoading::AnimTarget::Weights:
+			return 1;
+		case ModelLoading::AnimTarget::Invalid:
+		default:
+			NOT_IMPLEMENTED;
+		}
+		return 0;
+	}
+
+	static void CopyKeyFrameValue(const ModelLoading::AnimKeyFrame& keyFrame, ModelLoading::AnimTarget target, float* value)
+	{
+		switch (target)
+		{
+		case ModelLoading::AnimTarget::Translation: memcpy(value, &keyFrame.Translation, sizeof(Float3)); break;
+		case ModelLoading::AnimTarget::Rotation: memcpy(value, &keyFrame.Rotation, sizeof(Quaternion)); break;
+		case ModelLoading::AnimTarget::Scale: memcpy(value, &keyFrame.Scale, sizeof(Float3)); break;
+		case ModelLoading::AnimTarget::Weights: *value = keyFrame.Weight; break;
+		default: NOT_IMPLEMENTED;
+		}
+	}
+
+	static AnimationTrack CompileTrack(const ModelLoading::AnimationEntry& entry, uint32_t nodeIndex)
+	{
+		AnimationTrack track{};
+		track.NodeIndex = nodeIndex;
+		track.WeightTargetIndex = entry.WeightTargetIndex;
+		track.Target = entry.Target;
+		track.Interpolation = entry.Interpolation;
+		track.Duration = entry.Duration;
+
+		const uint32_t valueSize = GetTrackValueSize(entry.Target);
+		const size_t numKeyFrames = entry.KeyFrames.size();
+		track.Times.resize(numKeyFrames);
+		track.Values.resize(numKeyFrames * valueSize);
+		for (size_t i = 0; i < numKeyFrames; i++)
+		{
+			track.Times[i] = entry.KeyFrames[i].Time;
+			CopyKeyFrameValue(entry.KeyFrames[i], entry.Target, track.Values.data() + i * valueSize);
+		}
+
+		if (entry.Interpolation == ModelLoading::AnimInterpolation::Cubic)
+		{
+			ASSERT(entry.InTangents.size() == numKeyFrames && entry.OutTangents.size() == numKeyFrames, "[AnimationOperations] Cubic animation entry is missing tangents");
+
+			track.Tangents.resize(numKeyFrames * valueSize * 2);
+			for (size_t i = 0; i < numKeyFrames; i++)
+			{
+				float* tangents = track.Tangents.data() + i * valueSize * 2;
+				CopyKeyFrameValue(entry.InTangents[i], entry.Target, tangents);
+				CopyKeyFrameValue(entry.OutTangents[i], entry.Target, tangents + valueSize);
+			}
+		}
+
+		// Exported animations are usually baked with fixed frame rate
+		if (numKeyFrames > 2)
+		{
+			const float interval = (track.Times.back() - track.Times.front()) / (numKeyFrames - 1);
+			bool uniform = interval > 0.0f;
+			for (size_t i = 1; i < numKeyFrames && uniform; i++)
+			{
+				uniform = std::abs(track.Times[i] - track.Times[i - 1] - interval) < interval * 1e-3f;
+			}
+			track.InvKeyFrameInterval = uniform ? 1.0f / interval : 0.0f;
+		}
+
+		return track;
+	}
+
+	AnimationClip CompileClip(const std::vector<ModelLoading::AnimationEntry>& animations)
+	{
+		AnimationClip clip{};
+		clip.NumNodes = 1;
+		for (const ModelLoading::AnimationEntry& entry : animations)
+		{
+			if (entry.KeyFrames.empty()) continue;
+			clip.Tracks.push_back(CompileTrack(entry, 0));
+		}
+		return clip;
+	}
+
+	AnimationClip CompileClip(const std::vector<ModelLoading::SkeletonJoint>& skeleton)
+	{
+		AnimationClip clip{};
+		clip.NumNodes = (uint32_t) skeleton.size();
+		for (uint32_t jointIndex = 0; jointIndex < skeleton.size(); jointIndex++)
+		{
+			for (const ModelLoading::AnimationEntry& entry : skeleton[jointIndex].Animations)
+			{
+				if (entry.KeyFrames.empty()) continue;
+				clip.Tracks.push_back(CompileTrack(entry, jointIndex));
+			}
+		}
+		return clip;
+	}
+
+	// Returns index of the first keyframe of the pair that contains frameTime
+	static uint32_t FindKeyFrame(const AnimationTrack& track, float frameTime, uint32_t& cursor)
+	{
+		const uint32_t lastPair = (uint32_t) track.Times.size() - 2;
+
+		uint32_t keyFrame = MIN(cursor, lastPair);
+		if (track.InvKeyFrameInterval > 0.0f)
+		{
+			const float position = (frameTime - track.Times[0]) * track.InvKeyFrameInterval;
+			keyFrame = position > 0.0f ? MIN((uint32_t) position, lastPair) : 0;
+		}
+
+		// Small steps from the cursor, time moves backwards only on loop or in ping pong
+		while (keyFrame > 0 && track.Times[keyFrame] > frameTime) keyFrame--;
+		while (keyFrame < lastPair && track.Times[keyFrame + 1] < frameTime) keyFrame++;
+
+		cursor = keyFrame;
+		return keyFrame;
+	}
+
+	template<typename T>
+	static T LoadTrackValue(const AnimationTrack& track, uint32_t keyFrame)
+	{
+		T value;
+		if (track.Compressed)
+		{
+			float decoded[4];
+			AnimationCompression::DecodeValue(track, keyFrame, decoded);
+			memcpy(&value, decoded, sizeof(T));
+		}
+		else
+		{
+			memcpy(&value, track.Values.data() + keyFrame * GetTrackValueSize(track.Target), sizeof(T));
+		}
+		return value;
+	}
+
+	// outTangent selects the out tangent of the keyframe, the in tangent otherwise
+	template<typename T>
+	static T LoadTrackTangent(const AnimationTrack& track, uint32_t keyFrame, bool outTangent)
+	{
+		const uint32_t valueSize = GetTrackValueSize(track.Target);
+		T value;
+		memcpy(&value, track.Tangents.data() + keyFrame * valueSize * 2 + (outTangent ? valueSize : 0), sizeof(T));
+		return value;
+	}
+
+	template<typename T>
+	static T SampleTrack(const AnimationTrack& track, float t, AnimationType animationType, uint32_t& cursor)
+	{
+		if (track.Times.size() == 1) return LoadTrackValue<T>(track, 0);
+
+		const float frameTime = GetFrameTime(track.Duration, t, animationType);
+		const uint32_t keyFrame = FindKeyFrame(track, frameTime, cursor);
+
+		const float timeA = track.Times[keyFrame];
+		const float timeB = track.Times[keyFrame + 1];
+		const float factor = timeB > timeA ? std::clamp((frameTime - timeA) / (timeB - timeA), 0.0f, 1.0f) : 0.0f;
+
+		const T valueA = LoadTrackValue<T>(track, keyFrame);
+		const T valueB = LoadTrackValue<T>(track, keyFrame + 1);
+		if (track.Interpolation != ModelLoading::AnimInterpolation::Cubic) return Interpolate(valueA, valueB, factor, track.Interpolation);
+
+		return Hermite(valueA, LoadTrackTangent<T>(track, keyFrame, true), LoadTrackTangent<T>(track, keyFrame + 1, false), valueB, factor, timeB - timeA);
+	}
+
+	void SampleTrack(const AnimationTrack& track, float t, AnimationType animationType, uint32_t& cursor, float* value)
+	{
+		switch (track.Target)
+		{
+		case ModelLoading::AnimTarget::Translation:
+		case ModelLoading::AnimTarget::Scale:
+		{
+			const Float3 sample = SampleTrack<Float3>(track, t, animationType, cursor);
+			memcpy(value, &sample, sizeof(Float3));
+			break;
+		}
+		case ModelLoading::AnimTarget::Rotation:
+		{
+			const Quaternion sample = SampleTrack<Quaternion>(track, t, animationType, cursor);
+			memcpy(value, &sample, sizeof(Quaternion));
+			break;
+		}
+		case ModelLoading::AnimTarget::Weights:
+			*value = SampleTrack<float>(track, t, animationType, cursor);
+			break;
+		default:
+			NOT_IMPLEMENTED;
+		}
+	}
+
+	AnimationTrack ResampleTrack(const AnimationTrack& track, float frameRate)
+	{
+		const uint32_t valueSize = GetTrackValueSize(track.Target);
+		const float startTime = track.Times.front();
+		const float endTime = track.Times.back();
+		const uint32_t numKeyFrames = MAX(2u, (uint32_t) std::ceil((endTime - startTime) * frameRate) + 1);
+		const float interval = (endTime - startTime) / (numKeyFrames - 1);
+
+		AnimationTrack resampled{};
+		resampled.NodeIndex = track.NodeIndex;
+		resampled.WeightTargetIndex = track.WeightTargetIndex;
+		resampled.Target = track.Target;
+		resampled.Interpolation = ModelLoading::AnimInterpolation::Lerp;
+		resampled.Duration = track.Duration;
+		resampled.InvKeyFrameInterval = interval > 0.0f ? 1.0f / interval : 0.0f;
+		resampled.Times.resize(numKeyFrames);
+		resampled.Values.resize(numKeyFrames * valueSize);
+
+		uint32_t cursor = 0;
+		for (uint32_t i = 0; i < numKeyFrames; i++)
+		{
+			resampled.Times[i] = i + 1 == numKeyFrames ? endTime : startTime + i * interval;
+			SampleTrack(track, resampled.Times[i], AnimationType::Once, cursor, resampled.Values.data() + i * valueSize);
+		}
+		return resampled;
+	}
+
+	size_t GetTrackByteSize(const AnimationTrack& track)
+	{
+		const size_t rangeSize = track.Compressed ? 2 * sizeof(Float3) : 0;
+		return (track.Times.size() + track.Values.size() + track.Tangents.size()) * sizeof(float) + track.PackedValues.size() * sizeof(uint16_t) + rangeSize;
+	}
+
+	void SampleClip(const AnimationClip& clip, float t, AnimationType animationType, AnimationCursor& cursor, NodePose* poses)
+	{
+		cursor.KeyFrames.resize(clip.Tracks.size(), 0);
+
+		for (size_t i = 0; i < clip.Tracks.size(); i++)
+		{
+			const AnimationTrack& track = clip.Tracks[i];
+			NodePose& pose = poses[track.NodeIndex];
+			switch (track.Target)
+			{
+			case ModelLoading::AnimTarget::Translation:
+				pose.Translation = SampleTrack<Float3>(track, t, animationType, cursor.KeyFrames[i]);
+				break;
+			case ModelLoading::AnimTarget::Rotation:
+				pose.Rotation = SampleTrack<Quaternion>(track, t, animationType, cursor.KeyFrames[i]);
+				break;
+			case ModelLoading::AnimTarget::Scale:
+				pose.Scale = SampleTrack<Float3>(track, t, animationType, cursor.KeyFrames[i]);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	void SampleClipWeights(const AnimationClip& clip, float t, AnimationType animationType, AnimationCursor& cursor, float* weights)
+	{
+		cursor.KeyFrames.resize(clip.Tracks.size(), 0);
+
+		for (size_t i = 0; i < clip.Tracks.size(); i++)
+		{
+			const AnimationTrack& track = clip.Tracks[i];
+			if (track.Target != ModelLoading::AnimTarget::Weights) continue;
+
+			weights[track.WeightTargetIndex] += SampleTrack<float>(track, t, animationType, cursor.KeyFrames[i]);
+		}
+	}
+
+	DirectX::XMMATRIX GetPoseTransformation(const NodePose& pose)
+	{
+		using namespace DirectX;
+
+		const XMMATRIX scale = XMMatrixScalingFromVector(pose.Scale.ToXM());
+		const XMMATRIX rotation = XMMatrixRotationQuaternion(pose.Rotation.ToXM());
+		const XMMATRIX translation = XMMatrixTranslationFromVector(pose.Translation.ToXM());
+		return XMMatrixMultiply(XMMatrixMultiply(scale, rotation), translation);
+	}
+
+	void GetPoseTransformations(const NodePose* poses, uint32_t count, DirectX::XMFLOAT4X4* transformations)
+	{
+		// Poses are split into SoA streams for the batch kernels, scratch memory is reused per thread
+		thread_local std::vector<float> streams;
+		streams.resize(count * 10);
+
+		float* data = streams.data();
+		const BatchMath::Float3Streams translation{ data, data + count, data + count * 2 };
+		const BatchMath::QuaternionStreams rotation{ data + count * 3, data + count * 4, data + count * 5, data + count * 6 };
+		const BatchMath::Float3Streams scale{ data + count * 7, data + count * 8, data + count * 9 };
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const NodePose& pose = poses[i];
+			translation.X[i] = pose.Translation.x;
+			translation.Y[i] = pose.Translation.y;
+			translation.Z[i] = pose.Translation.z;
+			rotation.X[i] = pose.Rotation.x;
+			rotation.Y[i] = pose.Rotation.y;
+			rotation.Z[i] = pose.Rotation.z;
+			rotation.W[i] = pose.Rotation.w;
+			scale.X[i] = pose.Scale.x;
+			scale.Y[i] = pose.Scale.y;
+			scale.Z[i] = pose.Scale.z;
+		}
+
+		BatchMath::ComposeTransforms(translation, rotation, scale, transformations, count);
+	}
+
+	CompiledSkeleton CompileSkeleton(const std::vector<ModelLoading::SkeletonJoint>& skeleton)
+	{
+		const uint32_t numJoints = (uint32_t) skeleton.size();
+
+		CompiledSkeleton compiled{};
+		compiled.NumJoints = numJoints;
+		compiled.Clip = CompileClip(skeleton);
+		compiled.ParentIndices.resize(numJoints);
+		compiled.RestPose.resize(numJoints);
+		compiled.ParentTransforms.resize(numJoints);
+		compiled.ModelToJoint.resize(numJoints);
+
+		std::vector<uint32_t> depths(numJoints, 0);
+		for (uint32_t i = 0; i < numJoints; i++)
+		{
+			const ModelLoading::SkeletonJoint& joint = skeleton[i];
+			compiled.ParentIndices[i] = joint.ParentIndex;
+			compiled.RestPose[i] = NodePose{ joint.RestTranslation, joint.RestRotation, joint.RestScale };
+			compiled.ParentTransforms[i] = joint.ParentTransform;
+			compiled.ModelToJoint[i] = joint.ModelToJoint;
+
+			for (uint32_t parent = joint.ParentIndex; parent != ModelLoading::SkeletonJoint::INVALID_PARENT && depths[i] <= numJoints; parent = skeleton[parent].ParentIndex)
+				depths[i]++;
+			ASSERT(depths[i] <= numJoints, "[AnimationOperations] Skeleton hierarchy has a cycle");
+		}
+
+		compiled.EvaluationOrder.resize(numJoints);
+		for (uint32_t i = 0; i < numJoints; i++) compiled.EvaluationOrder[i] = i;
+		std::stable_sort(compiled.EvaluationOrder.begin(), compiled.EvaluationOrder.end(), [&depths](uint32_t a, uint32_t b) { return depths[a] < depths[b]; });
+
+		return compiled;
+	}
+
+	void EvaluateSkeleton(const CompiledSkeleton& skeleton, float t, AnimationType animationType, AnimationCursor& cursor, SkinMatrix* skinMatrices, float blendWeight)
+	{
+		using namespace DirectX;
+
+		// Scratch memory is reused between calls, evaluation can run on many threads at once
+		thread_local std::vector<NodePose> poses;
+		thread_local std::vector<XMFLOAT4X4> localTransforms;
+		thread_local std::vector<XMMATRIX> jointToModel;
+
+		poses.assign(skeleton.RestPose.begin(), skeleton.RestPose.end());
+		localTransforms.resize(skeleton.NumJoints);
+		jointToModel.resize(skeleton.NumJoints);
+
+		SampleClip(skeleton.Clip, t, animationType, cursor, poses.data());
+
+		if (blendWeight < 1.0f)
+		{
+			for (uint32_t i = 0; i < skeleton.NumJoints; i++)
+			{
+				const NodePose& restPose = skeleton.RestPose[i];
+				NodePose& pose = poses[i];
+				pose.Translation = MathUtility::Lerp(restPose.Translation, pose.Translation, blendWeight);
+				pose.Rotation = MathUtility::Lerp(restPose.Rotation, pose.Rotation, blendWeight);
+				pose.Scale = MathUtility::Lerp(restPose.Scale, pose.Scale, blendWeight);
+			}
+		}
+
+		GetPoseTransformations(poses.data(), skeleton.NumJoints, localTransforms.data());
+
+		for (uint32_t jointIndex : skeleton.EvaluationOrder)
+		{
+			const uint32_t parentIndex = skeleton.ParentIndices[jointIndex];
+			const XMMATRIX parentToModel = parentIndex == ModelLoading::SkeletonJoint::INVALID_PARENT ? XMLoadFloat4x4(&skeleton.ParentTransforms[jointIndex]) : jointToModel[parentIndex];
+			jointToModel[jointIndex] = XMMatrixMultiply(XMLoadFloat4x4(&localTransforms[jointIndex]), parentToModel);
+
+			const XMMATRIX skinMatrix = XMMatrixTranspose(XMMatrixMultiply(XMLoadFloat4x4(&skeleton.ModelToJoint[jointIndex]), jointToModel[jointIndex]));
+			SkinMatrix& output = skinMatrices[jointIndex];
+			XMStoreFloat4(&output.Rows[0], skinMatrix.r[0]);
+			XMStoreFloat4(&output.Rows[1], skinMatrix.r[1]);
+			XMStoreFloat4(&output.Rows[2], skinMatrix.r[2]);
+		}
+	}
 }
\ No newline at end of file
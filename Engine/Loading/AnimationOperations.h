@@ -14,4 +14,97 @@ namespace AnimationOperations
 
 	DirectX::XMFLOAT4X4 GetAnimationTransformation(const std::vector<ModelLoading::AnimationEntry>& animations, float t, AnimationType animationType);
 	std::vector<float> GetAnimatedMorphWeights(const ModelLoading::SceneObject& object, float t, AnimationType animationType);
+
+	// Indices of the morph targets that move any vertex and have a weight above the threshold, the others add nothing to the blend
+	std::vector<uint32_t> GetActiveMorphTargets(const ModelLoading::SceneObject& object, const std::vector<float>& weights, float weightThreshold);
+
+	// Local transformation of an animated node
+	struct NodePose
+	{
+		Float3 Translation{ 0.0f, 0.0f, 0.0f };
+		Quaternion Rotation{ 0.0f, 0.0f, 0.0f, 1.0f };
+		Float3 Scale{ 1.0f, 1.0f, 1.0f };
+	};
+
+	// Keyframes of a single animation entry with separate time and value arrays
+	struct AnimationTrack
+	{
+		uint32_t NodeIndex = 0;
+		uint32_t WeightTargetIndex = 0;
+		ModelLoading::AnimTarget Target = ModelLoading::AnimTarget::Invalid;
+		ModelLoading::AnimInterpolation Interpolation = ModelLoading::AnimInterpolation::Invalid;
+		float Duration = 1.0f;
+
+		// Non zero when keyframes are evenly spaced, keyframe is then found directly from the time
+		float InvKeyFrameInterval = 0.0f;
+
+		std::vector<float> Times;
+		std::vector<float> Values; // GetTrackValueSize floats per keyframe
+		std::vector<float> Tangents; // Only for cubic interpolation, in and out tangent per keyframe with GetTrackValueSize floats each
+
+		// Set by AnimationCompression, Values is then empty and keyframes are decoded from PackedValues
+		bool Compressed = false;
+		std::vector<uint16_t> PackedValues; // AnimationCompression::GetPackedValueSize values per keyframe
+		Float3 RangeMin{ 0.0f, 0.0f, 0.0f };
+		Float3 RangeStep{ 0.0f, 0.0f, 0.0f };
+	};
+
+	// Animation entries of one node or of the whole skeleton compiled for sampling
+	struct AnimationClip
+	{
+		uint32_t NumNodes = 0;
+		std::vector<AnimationTrack> Tracks;
+	};
+
+	// Last sampled keyframe per track, sampling continues the search from it so playing forward costs O(1) per track.
+	// Every instance playing the clip should own its cursor.
+	struct AnimationCursor
+	{
+		std::vector<uint32_t> KeyFrames;
+	};
+
+	uint32_t GetTrackValueSize(ModelLoading::AnimTarget target);
+
+	AnimationClip CompileClip(const std::vector<ModelLoading::AnimationEntry>& animations);
+	// Node index of the tracks is the joint index
+	AnimationClip CompileClip(const std::vector<ModelLoading::SkeletonJoint>& skeleton);
+
+	// Overwrites animated channels of poses[track.NodeIndex] for all tracks, channels that aren't animated are left untouched
+	void SampleClip(const AnimationClip& clip, float t, AnimationType animationType, AnimationCursor& cursor, NodePose* poses);
+	// Adds animated weights to weights[track.WeightTargetIndex]
+	void SampleClipWeights(const AnimationClip& clip, float t, AnimationType animationType, AnimationCursor& cursor, float* weights);
+
+	// Writes GetTrackValueSize floats
+	void SampleTrack(const AnimationTrack& track, float t, AnimationType animationType, uint32_t& cursor, float* value);
+
+	// Evenly spaced linear keyframes sampled from any track, the way cubic clips used to be baked offline
+	AnimationTrack ResampleTrack(const AnimationTrack& track, float frameRate);
+	size_t GetTrackByteSize(const AnimationTrack& track);
+
+	DirectX::XMMATRIX GetPoseTransformation(const NodePose& pose);
+	void GetPoseTransformations(const NodePose* poses, uint32_t count, DirectX::XMFLOAT4X4* transformations);
+
+	// Transposed 4x3 skinning matrix, skinned position is float3(dot(Rows[0], p), dot(Rows[1], p), dot(Rows[2], p)) with p = float4(position, 1)
+	struct SkinMatrix
+	{
+		DirectX::XMFLOAT4 Rows[3];
+	};
+
+	// Skeleton flattened for evaluation, EvaluationOrder lists joints so that parents come before their children
+	struct CompiledSkeleton
+	{
+		uint32_t NumJoints = 0;
+		std::vector<uint32_t> EvaluationOrder;
+		std::vector<uint32_t> ParentIndices;
+		std::vector<NodePose> RestPose;
+		std::vector<DirectX::XMFLOAT4X4> ParentTransforms;
+		std::vector<DirectX::XMFLOAT4X4> ModelToJoint;
+		AnimationClip Clip;
+	};
+
+	CompiledSkeleton CompileSkeleton(const std::vector<ModelLoading::SkeletonJoint>& skeleton);
+
+	// Samples the local pose of every joint, composes the hierarchy in one pass and writes NumJoints skinning matrices.
+	// Blend weight blends between the rest pose (0) and the animated pose (1).
+	void EvaluateSkeleton(const CompiledSkeleton& skeleton, float t, AnimationType animationType, AnimationCursor& cursor, SkinMatrix* skinMatrices, float blendWeight = 1.0f);
 }
\ No newline at end of file
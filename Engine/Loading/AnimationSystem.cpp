@@ -0,0 +1,101 @@
+#include "AnimationSystem.h"
+
+#include "Render/Buffer.h"
+#include "Render/Commands.h"
+#include "System/JobPool.h"
+#include "Utility/MathUtility.h"
+#include "Utility/Timer.h"
+
+AnimationSystem::~AnimationSystem()
+{
+	ASSERT(!m_PaletteBuffer, "[AnimationSystem] Palette buffer wasn't freed");
+}
+
+AnimationSystem::SkeletonHandle AnimationSystem::AddSkeleton(const std::vector<ModelLoading::SkeletonJoint>& skeleton, const AnimationCompression::Settings* compression)
+{
+	m_Skeletons.push_back(AnimationOperations::CompileSkeleton(skeleton));
+
+	if (compression)
+	{
+		const AnimationCompression::Report report = AnimationCompression::CompressClip(m_Skeletons.back().Clip, *compression);
+		const float ratio = report.CompressedBytes > 0 ? (float) report.SourceBytes / report.CompressedBytes : 1.0f;
+		std::cout << "[AnimationSystem] Compressed skeleton clip " << m_Skeletons.size() - 1 << ": " << report.NumCompressedTracks << "/" << report.NumTracks << " tracks, "
+			<< report.SourceKeyFrames << " -> " << report.CompressedKeyFrames << " keyframes, " << report.SourceBytes << " -> " << report.CompressedBytes << " bytes (" << ratio << "x)" << std::endl;
+		std::cout << "[AnimationSystem] Max error: translation " << report.MaxTranslationError << ", rotation " << report.MaxRotationErrorDegrees << " deg, scale "
+			<< report.MaxScaleError << ", weight " << report.MaxWeightError << std::endl;
+	}
+
+	return (SkeletonHandle) m_Skeletons.size() - 1;
+}
+
+AnimationSystem::InstanceHandle AnimationSystem::AddInstance(SkeletonHandle skeleton, float playhead, float speed, float blendWeight)
+{
+	ASSERT(skeleton < m_Skeletons.size(), "[AnimationSystem] Invalid skeleton handle");
+
+	Instance& instance = m_Instances.emplace_back();
+	instance.Skeleton = skeleton;
+	instance.Playhead = playhead;
+	instance.Speed = speed;
+	instance.BlendWeight = blendWeight;
+	instance.PaletteOffset = (uint32_t) m_Palette.size();
+
+	m_Palette.resize(m_Palette.size() + m_Skeletons[skeleton].NumJoints);
+
+	return (InstanceHandle) m_Instances.size() - 1;
+}
+
+void AnimationSystem::RemoveAllInstances()
+{
+	m_Instances.clear();
+	m_Palette.clear();
+}
+
+void AnimationSystem::Update(float dt, uint32_t numJobs)
+{
+	PROFILE_SECTION_CPU("AnimationSystem::Update");
+
+	Timer updateTimer;
+	updateTimer.Start();
+
+	const uint32_t numInstances = (uint32_t) m_Instances.size();
+	if (numJobs == 0) numJobs = JobPool::Get()->GetThreadCount() + 1;
+	numJobs = MIN(numJobs, numInstances);
+
+	// Every job takes a contiguous range of instances so jobs write to separate parts of the palette
+	const uint32_t instancesPerJob = numJobs ? MathUtility::CeilDiv(numInstances, numJobs) : 0;
+	JobPool::Get()->ParallelFor(numJobs, [this, dt, numInstances, instancesPerJob](uint32_t jobIndex)
+	{
+		const uint32_t firstInstance = jobIndex * instancesPerJob;
+		const uint32_t lastInstance = MIN(firstInstance + instancesPerJob, numInstances);
+		for (uint32_t i = firstInstance; i < lastInstance; i++)
+		{
+			Instance& instance = m_Instances[i];
+			instance.Playhead += dt * instance.Speed;
+			AnimationOperations::EvaluateSkeleton(m_Skeletons[instance.Skeleton], instance.Playhead, instance.PlayType, instance.Cursor, m_Palette.data() + instance.PaletteOffset, instance.BlendWeight);
+		}
+	});
+
+	updateTimer.Stop();
+	m_UpdateTimeMS = updateTimer.GetTimeMS();
+}
+
+void AnimationSystem::Upload(GraphicsContext& context)
+{
+	if (m_Palette.empty()) return;
+
+	const uint32_t paletteSize = (uint32_t) (m_Palette.size() * sizeof(AnimationOperations::SkinMatrix));
+	if (!m_PaletteBuffer || m_PaletteBuffer->ByteSize < paletteSize)
+	{
+		if (m_PaletteBuffer) GFX::Cmd::Delete(context, m_PaletteBuffer);
+		m_PaletteBuffer = GFX::CreateBuffer(paletteSize, sizeof(DirectX::XMFLOAT4), RCF::None);
+		GFX::SetDebugName(m_PaletteBuffer, "AnimationSystem::PaletteBuffer");
+	}
+
+	GFX::Cmd::UploadToBuffer(context, m_PaletteBuffer, 0, m_Palette.data(), 0, paletteSize);
+}
+
+void AnimationSystem::Free(GraphicsContext& context)
+{
+	if (m_PaletteBuffer) GFX::Cmd::Delete(context, m_PaletteBuffer);
+	m_PaletteBuffer = nullptr;
+}
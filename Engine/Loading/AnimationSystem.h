@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+
+#include "Common.h"
+#include "Loading/AnimationCompression.h"
+#include "Loading/AnimationOperations.h"
+
+struct Buffer;
+struct GraphicsContext;
+
+// Animates many instances that share a small number of skeletons.
+// Instances are evaluated in parallel on the JobPool into one palette of skin matrices that is uploaded with a single copy per frame.
+// Skin matrices of an instance are at [PaletteOffset, PaletteOffset + NumJoints) and instances added one after another are next to each other.
+class AnimationSystem
+{
+public:
+	using SkeletonHandle = uint32_t;
+	using InstanceHandle = uint32_t;
+
+	struct Instance
+	{
+		SkeletonHandle Skeleton = 0;
+		AnimationOperations::AnimationType PlayType = AnimationOperations::AnimationType::Repeat;
+		float Playhead = 0.0f;
+		float Speed = 1.0f;
+		float BlendWeight = 1.0f; // Rest pose (0) to animated pose (1)
+		uint32_t PaletteOffset = 0;
+		AnimationOperations::AnimationCursor Cursor;
+	};
+
+	AnimationSystem() = default;
+	~AnimationSystem();
+
+	AnimationSystem(const AnimationSystem&) = delete;
+	AnimationSystem& operator=(const AnimationSystem&) = delete;
+
+	// Clip of the skeleton is compressed with the given settings, nullptr keeps it uncompressed
+	SkeletonHandle AddSkeleton(const std::vector<ModelLoading::SkeletonJoint>& skeleton, const AnimationCompression::Settings* compression = nullptr);
+	InstanceHandle AddInstance(SkeletonHandle skeleton, float playhead = 0.0f, float speed = 1.0f, float blendWeight = 1.0f);
+	void RemoveAllInstances();
+
+	// Advances playheads by dt seconds and evaluates all instances, numJobs = 0 splits the instances between all JobPool threads
+	void Update(float dt, uint32_t numJobs = 0);
+
+	// Copies the palette to the palette buffer, the buffer is recreated when the palette grows
+	void Upload(GraphicsContext& context);
+
+	// Frees GPU resources, has to be called before the graphics context is destroyed
+	void Free(GraphicsContext& context);
+
+	Instance& GetInstance(InstanceHandle instance) { return m_Instances[instance]; }
+	const AnimationOperations::CompiledSkeleton& GetSkeleton(SkeletonHandle skeleton) const { return m_Skeletons[skeleton]; }
+	uint32_t GetInstanceCount() const { return (uint32_t) m_Instances.size(); }
+
+	// StructuredBuffer<float4>, three rows per joint (see AnimationOperations::SkinMatrix)
+	Buffer* GetPaletteBuffer() const { return m_PaletteBuffer; }
+	const std::vector<AnimationOperations::SkinMatrix>& GetPalette() const { return m_Palette; }
+
+	float GetUpdateTimeMS() const { return m_UpdateTimeMS; }
+
+private:
+	std::vector<AnimationOperations::CompiledSkeleton> m_Skeletons;
+	std::vector<Instance> m_Instances;
+	std::vector<AnimationOperations::SkinMatrix> m_Palette;
+
+	Buffer* m_PaletteBuffer = nullptr;
+	float m_UpdateTimeMS = 0.0f;
+};
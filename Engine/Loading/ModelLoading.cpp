@@ -14,8 +14,16 @@
 #include "Render/Commands.h"
 #include "Render/RenderThread.h"
 #include "Loading/TextureLoading.h"
+#include "Loading/SceneCooking.h"
+#include "Loading/TextureStreaming.h"
+#include "Loading/VertexQuantization.h"
 #include "Utility/PathUtility.h"
+#include "Utility/Timer.h"
 #include "System/ApplicationConfiguration.h"
+#include "System/JobPool.h"
+
+#include <fstream>
+#include <psapi.h>
 
 #define CGTF_CALL(X) { cgltf_result result = X; ASSERT(result == cgltf_result_success, "CGTF_CALL_FAIL") }
 
@@ -204,7 +212,7 @@ namespace ModelLoading
 	{
 		switch (interpolationType)
 		{
-		case cgltf_interpolation_type_cubic_spline:		// return AnimInterpolation::Cubic; Not implemented
+		case cgltf_interpolation_type_cubic_spline:		return AnimInterpolation::Cubic;
 		case cgltf_interpolation_type_linear:			return AnimInterpolation::Lerp;
 		case cgltf_interpolation_type_step:				return AnimInterpolation::Step;
 		default: NOT_IMPLEMENTED;
@@ -212,19 +220,18 @@ namespace ModelLoading
 		return AnimInterpolation::Invalid;
 	}
 
-	static BoundingSphere CalculateBoundingSphere(cgltf_primitive* meshData)
+	static BoundingSphere CalculateBoundingSphere(const MeshStreams& mesh)
 	{
-		VertexAttributesData vertexData = LoadAttributes(meshData->attributes, meshData->attributes_count);
-		if (vertexData.Positions == nullptr || vertexData.NumVertices == 0) return BoundingSphere{};
+		if (mesh.Positions == nullptr || mesh.NumVertices == 0) return BoundingSphere{};
 
 		static constexpr float MAX_FLOAT = std::numeric_limits<float>::max();
 		static constexpr float MIN_FLOAT = -MAX_FLOAT;
 
 		Float3 minAABB{ MAX_FLOAT , MAX_FLOAT, MAX_FLOAT };
 		Float3 maxAABB{ MIN_FLOAT, MIN_FLOAT, MIN_FLOAT };
-		for (uint32_t i = 0; i < vertexData.NumVertices; i++)
+		for (uint32_t i = 0; i < mesh.NumVertices; i++)
 		{
-			const Float3 pos = vertexData.Positions[i];
+			const Float3 pos = mesh.Positions[i];
 
 			minAABB.x = MIN(minAABB.x, pos.x);
 			minAABB.y = MIN(minAABB.y, pos.y);
@@ -242,28 +249,386 @@ namespace ModelLoading
 		return bs;
 	}
 
+	// Part of a mesh that was split so it fits in 16 bit indices
+	struct MeshPart
+	{
+		MeshStreams Streams;
+
+		std::vector<Float3> Positions;
+		std::vector<Float2> Texcoords;
+		std::vector<Float3> Normals;
+		std::vector<Float4> Tangents;
+		std::vector<Float4> Weights;
+		std::vector<uint32_t> Joints;
+		std::vector<uint32_t> Indices;
+	};
+
+	template<typename T>
+	static void GatherVertices(const T* source, const std::vector<uint32_t>& vertexIndices, std::vector<T>& destination, uint32_t elementsPerVertex = 1)
+	{
+		if (!source) return;
+
+		destination.resize(vertexIndices.size() * elementsPerVertex);
+		for (size_t i = 0; i < vertexIndices.size(); i++)
+		{
+			for (uint32_t j = 0; j < elementsPerVertex; j++)
+				destination[i * elementsPerVertex + j] = source[vertexIndices[i] * elementsPerVertex + j];
+		}
+	}
+
+	// Walks the triangles in order and starts a new part once the next triangle wouldn't fit in maxVertices
+	static std::vector<MeshPart> SplitMesh(const MeshStreams& mesh, uint32_t maxVertices)
+	{
+		static constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+
+		std::vector<MeshPart> parts;
+		std::vector<uint32_t> remap(mesh.NumVertices, INVALID_INDEX);
+		std::vector<uint32_t> partVertices;
+		std::vector<uint32_t> partIndices;
+
+		const auto finishPart = [&]()
+		{
+			MeshPart& part = parts.emplace_back();
+			GatherVertices(mesh.Positions, partVertices, part.Positions);
+			GatherVertices(mesh.Texcoords, partVertices, part.Texcoords);
+			GatherVertices(mesh.Normals, partVertices, part.Normals);
+			GatherVertices(mesh.Tangents, partVertices, part.Tangents);
+			GatherVertices(mesh.Weights, partVertices, part.Weights);
+			GatherVertices(mesh.Joints, partVertices, part.Joints, 4);
+			part.Indices = std::move(partIndices);
+
+			for (uint32_t vertexIndex : partVertices) remap[vertexIndex] = INVALID_INDEX;
+			partVertices.clear();
+			partIndices.clear();
+		};
+
+		for (uint32_t triangle = 0; triangle < mesh.NumIndices / 3; triangle++)
+		{
+			const uint32_t* triangleIndices = mesh.Indices + triangle * 3;
+
+			uint32_t newVertices = 0;
+			for (uint32_t i = 0; i < 3; i++)
+			{
+				const bool repeated = (i > 0 && triangleIndices[i] == triangleIndices[0]) || (i > 1 && triangleIndices[i] == triangleIndices[1]);
+				if (!repeated && remap[triangleIndices[i]] == INVALID_INDEX) newVertices++;
+			}
+
+			if (partVertices.size() + newVertices > maxVertices) finishPart();
+
+			for (uint32_t i = 0; i < 3; i++)
+			{
+				const uint32_t vertexIndex = triangleIndices[i];
+				if (remap[vertexIndex] == INVALID_INDEX)
+				{
+					remap[vertexIndex] = (uint32_t) partVertices.size();
+					partVertices.push_back(vertexIndex);
+				}
+				partIndices.push_back(remap[vertexIndex]);
+			}
+		}
+		if (!partIndices.empty()) finishPart();
+
+		// Views are set once all parts are in place
+		for (MeshPart& part : parts)
+		{
+			MeshStreams& streams = part.Streams;
+			streams.NumVertices = (uint32_t) part.Positions.size();
+			streams.NumIndices = (uint32_t) part.Indices.size();
+			streams.Positions = part.Positions.data();
+			streams.Texcoords = part.Texcoords.empty() ? nullptr : part.Texcoords.data();
+			streams.Normals = part.Normals.empty() ? nullptr : part.Normals.data();
+			streams.Tangents = part.Tangents.empty() ? nullptr : part.Tangents.data();
+			streams.Weights = part.Weights.empty() ? nullptr : part.Weights.data();
+			streams.Joints = part.Joints.empty() ? nullptr : part.Joints.data();
+			streams.Indices = part.Indices.data();
+		}
+
+		return parts;
+	}
+
+	static std::string GetTextureURI(cgltf_texture* textureData)
+	{
+		if (!textureData || !textureData->image || !textureData->image->uri) return "";
+		return textureData->image->uri;
+	}
+
+	static std::vector<uint8_t> ReadFileData(const std::string& path)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file.is_open()) return {};
+
+		const std::streamsize fileSize = file.tellg();
+		if (fileSize <= 0) return {};
+
+		std::vector<uint8_t> fileData((size_t) fileSize);
+		file.seekg(0, std::ios::beg);
+		file.read(reinterpret_cast<char*>(fileData.data()), fileSize);
+		return fileData;
+	}
+
+	static float GetPeakMemoryUsageMB()
+	{
+		PROCESS_MEMORY_COUNTERS memoryCounters{};
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters))) return 0.0f;
+		return static_cast<float>(memoryCounters.PeakWorkingSetSize) / (1024.0f * 1024.0f);
+	}
+
 	Scene Loader::Load(const std::string& path)
 	{
-		const std::string& ext = PathUtility::GetFileExtension(path);
-		if (ext != "gltf")
+		Timer loadTimer;
+		loadTimer.Start();
+
+		std::string loadedPath = path;
+		bool loadCooked = false;
+		const std::string ext = PathUtility::GetFileExtension(path);
+		if (ext == "gltf")
+		{
+			const std::string cookedPath = SceneCooking::GetCookedPath(path);
+			if (AppConfig.Settings.contains("COOKSCENES"))
+			{
+				Cook(path, cookedPath);
+			}
+
+			if (!AppConfig.Settings.contains("NOCOOKEDSCENES") && SceneCooking::IsCookedSceneUpToDate(cookedPath, path))
+			{
+				loadedPath = cookedPath;
+				loadCooked = true;
+			}
+		}
+		else if (ext == SceneCooking::COOKED_SCENE_EXTENSION)
+		{
+			loadCooked = true;
+		}
+		else
 		{
 			ASSERT(0, "[SceneLoading] For now we only support glTF 3D format.");
 			return {};
 		}
+
+		m_IndexStats = {};
+		Scene scene = loadCooked ? LoadCooked(loadedPath) : LoadGLTF(loadedPath);
+
+		loadTimer.Stop();
+		std::cout << "[SceneLoading] Loaded " << loadedPath << " in " << loadTimer.GetTimeMS() << " ms (peak working set " << GetPeakMemoryUsageMB() << " MB)" << std::endl;
+		std::cout << "[SceneLoading] Index buffers take " << m_IndexStats.Bytes / 1024 << " KB, saved " << (m_IndexStats.UnpackedBytes - m_IndexStats.Bytes) / 1024 << " KB with 16 bit indices"
+			<< " (split " << m_IndexStats.SplitMeshes << " meshes into " << m_IndexStats.MeshParts << " parts)" << std::endl;
+
+		return scene;
+	}
+
+	float AsyncSceneLoad::GetProgress() const
+	{
+		if (m_Done) return 1.0f;
+		const uint32_t numObjectSources = m_NumObjectSources;
+		return numObjectSources > 0 ? (float) m_NumCreatedObjectSources / numObjectSources : 0.0f;
+	}
+
+	void AsyncSceneLoad::Cancel()
+	{
+		m_Mutex.Lock();
+		m_Cancelled = true;
+		if (m_Task) m_Task->SetRunning(false);
+		m_Mutex.Unlock();
+	}
+
+	void AsyncSceneLoad::Wait() const
+	{
+		while (!m_Done) MTR::ThreadSleepMS(1);
+	}
+
+	uint32_t AsyncSceneLoad::TakeLoadedObjects(Scene& scene)
+	{
+		m_Mutex.Lock();
+		std::vector<SceneObject> loadedObjects = std::move(m_LoadedObjects);
+		m_LoadedObjects.clear();
+		if (m_Done && !m_CamerasAndLightsTaken)
+		{
+			scene.Cameras.insert(scene.Cameras.end(), m_Cameras.begin(), m_Cameras.end());
+			scene.Lights.insert(scene.Lights.end(), m_Lights.begin(), m_Lights.end());
+			m_CamerasAndLightsTaken = true;
+		}
+		m_Mutex.Unlock();
+
+		for (SceneObject& object : loadedObjects)
+		{
+			scene.Objects.push_back(std::move(object));
+			if (m_OnObjectLoaded) m_OnObjectLoaded((uint32_t) scene.Objects.size() - 1, scene.Objects.back());
+		}
+		return (uint32_t) loadedObjects.size();
+	}
+
+	bool AsyncSceneLoad::ShouldStop() const
+	{
+		m_Mutex.Lock();
+		const bool shouldStop = m_Cancelled || (m_Task && m_Task->ShouldStop());
+		m_Mutex.Unlock();
+		return shouldStop;
+	}
+
+	void AsyncSceneLoad::AddObjects(std::vector<SceneObject>&& objects)
+	{
+		m_Mutex.Lock();
+		for (SceneObject& object : objects) m_LoadedObjects.push_back(std::move(object));
+		m_Mutex.Unlock();
+	}
+
+	void AsyncSceneLoad::Finish(Scene&& scene)
+	{
+		m_Mutex.Lock();
+		m_Cameras = std::move(scene.Cameras);
+		m_Lights = std::move(scene.Lights);
+		m_Done = true;
+		m_Mutex.Unlock();
+	}
+
+	class SceneLoadTask : public RenderTask
+	{
+	public:
+		SceneLoadTask(const std::string& path, const LoaderSettings& settings, const std::shared_ptr<AsyncSceneLoad>& load) :
+			m_Path(path),
+			m_Settings(settings),
+			m_Load(load)
+		{}
+
+		~SceneLoadTask()
+		{
+			// Render threads delete tasks that never ran when they shut down
+			if (!m_Load->IsDone())
+			{
+				m_Load->m_Cancelled = true;
+				m_Load->Finish({});
+			}
+		}
+
+		void Run(GraphicsContext& context) override
+		{
+			m_Load->m_Mutex.Lock();
+			m_Load->m_Task = this;
+			m_Load->m_Mutex.Unlock();
+
+			Scene scene{};
+			if (!m_Load->ShouldStop())
+			{
+				Loader loader{ context, m_Settings };
+				loader.m_AsyncLoad = m_Load.get();
+				scene = loader.Load(m_Path);
+			}
+
+			m_Load->m_Mutex.Lock();
+			m_Load->m_Task = nullptr;
+			m_Load->m_Mutex.Unlock();
+
+			m_Load->Finish(std::move(scene));
+		}
+
+	private:
+		std::string m_Path;
+		LoaderSettings m_Settings;
+		std::shared_ptr<AsyncSceneLoad> m_Load;
+	};
+
+	std::shared_ptr<AsyncSceneLoad> Loader::LoadAsync(const std::string& path, AsyncSceneLoad::ObjectLoadedCallback onObjectLoaded)
+	{
+		std::shared_ptr<AsyncSceneLoad> load = std::make_shared<AsyncSceneLoad>();
+		load->m_OnObjectLoaded = std::move(onObjectLoaded);
+		RenderThreadPool::Get()->Submit(new SceneLoadTask(path, m_Settings, load));
+		return load;
+	}
+
+	bool Loader::Cook(const std::string& scenePath, const std::string& cookedPath)
+	{
+		cgltf_data* data = ParseGLTF(scenePath);
+		if (!data) return false;
+
+		ReadScene(data->scene);
+		if (!ProcessWorkItems(m_ObjectSources, false))
+		{
+			m_ObjectSources.clear();
+			m_Scene = Scene{};
+			cgltf_free(data);
+			return false;
+		}
+
+		const bool success = SceneCooking::WriteScene(cookedPath, m_Scene.Cameras, m_Scene.Lights, m_ObjectSources);
+		ASSERT(success, "[SceneLoading] Failed to cook " << scenePath);
+
+		m_ObjectSources.clear();
+		m_Scene = Scene{};
+		cgltf_free(data);
+
+		return success;
+	}
+
+	cgltf_data* Loader::ParseGLTF(const std::string& path)
+	{
 		m_DirectoryPath = PathUtility::GetPathWitoutFile(path);
 
 		cgltf_options options = {};
 		cgltf_data* data = NULL;
 		CGTF_CALL(cgltf_parse_file(&options, path.c_str(), &data));
+		if (data && ShouldStop())
+		{
+			cgltf_free(data);
+			return nullptr;
+		}
+
 		CGTF_CALL(cgltf_load_buffers(&options, data, path.c_str()));
+		if (data && ShouldStop())
+		{
+			cgltf_free(data);
+			return nullptr;
+		}
 
-		ASSERT(data->scene, "Missing scene!");
+		if (!data || !data->scene)
+		{
+			ASSERT(0, "Missing scene!");
+			if (data) cgltf_free(data);
+			return nullptr;
+		}
 
 		FillNodeAnimationMap(data);
-		const Scene scene = LoadScene(data->scene);
-		
+		return data;
+	}
+
+	Scene Loader::LoadGLTF(const std::string& path)
+	{
+		cgltf_data* data = ParseGLTF(path);
+		if (!data) return {};
+
+		ReadScene(data->scene);
+		if (ProcessWorkItems(m_ObjectSources, true))
+			CreateSceneObjects(m_ObjectSources, m_Scene.Objects);
+		m_ObjectSources.clear();
+		ReleaseTextureWorkItems();
+
 		cgltf_free(data);
 
+		return std::move(m_Scene);
+	}
+
+	Scene Loader::LoadCooked(const std::string& path)
+	{
+		m_DirectoryPath = PathUtility::GetPathWitoutFile(path);
+
+		SceneCooking::SceneReader reader;
+		if (!reader.Open(path))
+		{
+			ASSERT(0, "[SceneLoading] Failed to open cooked scene " << path);
+			return {};
+		}
+
+		Scene scene{};
+		if (ProcessWorkItems(reader.GetObjects(), true))
+		{
+			scene.Cameras = reader.GetCameras();
+			scene.Lights = reader.GetLights();
+			CreateSceneObjects(reader.GetObjects(), scene.Objects);
+		}
+		ReleaseTextureWorkItems();
+
+		// Streams are already copied to the upload memory, mapping is not needed anymore
+		reader.Close();
+
 		return scene;
 	}
 
@@ -349,14 +714,15 @@ namespace ModelLoading
 		}
 	}
 
-	ModelLoading::Scene Loader::LoadScene(cgltf_scene* scene)
+	void Loader::ReadScene(cgltf_scene* scene)
 	{
 		m_Scene = Scene{};
+		m_ObjectSources.clear();
+		m_PrimitiveWorkItems.clear();
 		XMStoreFloat4x4(&m_CurrentTransform, DirectX::XMMatrixIdentity());
 
 		for (size_t i = 0; i < scene->nodes_count; i++) 
-			LoadNode(*(scene->nodes + i));
-		return m_Scene;
+			ReadNode(*(scene->nodes + i));
 	}
 
 	struct NodeTransform
@@ -386,7 +752,7 @@ namespace ModelLoading
 		return t;
 	}
 
-	void Loader::LoadNode(cgltf_node* nodeData)
+	void Loader::ReadNode(cgltf_node* nodeData)
 	{
 		using namespace DirectX;
 
@@ -402,22 +768,17 @@ namespace ModelLoading
 		{
 			cgltf_mesh* mesh = nodeData->mesh;
 
-			std::vector<float> morphWeights{};
-			for (cgltf_size i = 0; i < mesh->weights_count; i++) morphWeights.push_back(*(mesh->weights + i));
-
 			for (cgltf_size i = 0; i < mesh->primitives_count; i++)
 			{
 				cgltf_primitive* primitive = mesh->primitives + i;
 				
-				SceneObject object{};
-				object.BoundingVolume = CalculateBoundingSphere(primitive);
+				// Mesh data is read later in ProcessWorkItems
+				SceneObjectSource& object = m_ObjectSources.emplace_back();
 				object.ModelToWorld = m_CurrentTransform;
-				object.Mesh = LoadMesh(primitive);
-				object.Material = LoadMaterial(primitive->material);
-				object.MorphTargets = LoadMorph(primitive, morphWeights);
+				object.Material = ReadMaterial(primitive->material);
 				object.Skeleton = LoadSkin(nodeData->skin);
-				object.AnimcationData = animationData;
-				m_Scene.Objects.push_back(object);
+				object.Animations = animationData;
+				m_PrimitiveWorkItems.push_back(PrimitiveWorkItem{ mesh, primitive });
 			}
 		}
 
@@ -433,12 +794,151 @@ namespace ModelLoading
 
 		for (uint32_t i = 0; i < nodeData->children_count; i++)
 		{
-			LoadNode(*(nodeData->children + i));
+			ReadNode(*(nodeData->children + i));
 		}
 
 		m_CurrentTransform = parentTransform;
 	}
 
+	void Loader::ReadPrimitive(const PrimitiveWorkItem& workItem, SceneObjectSource& object)
+	{
+		const std::vector<float> morphWeights(workItem.Mesh->weights, workItem.Mesh->weights + workItem.Mesh->weights_count);
+
+		ReadMesh(workItem.Primitive, object);
+		ReadMorph(workItem.Primitive, morphWeights, object);
+		object.BoundingVolume = CalculateBoundingSphere(object.Mesh);
+	}
+
+	void Loader::ReadTexture(TextureWorkItem& workItem)
+	{
+		const uint32_t cacheMips = GetTextureCacheMips(workItem.Usage);
+		const std::vector<uint8_t> fileData = ReadFileData(workItem.CanonicalPath);
+		workItem.ContentHash = TextureCache::HashContent(fileData.data(), fileData.size());
+		workItem.CachedTexture = TextureCache::Get()->FindByContent(workItem.ContentHash, cacheMips);
+
+		if (workItem.CachedTexture)
+			TextureCache::Get()->AddPath(workItem.CanonicalPath, cacheMips, workItem.CachedTexture);
+		else if (m_Settings.CompressTextures)
+			CookTexture(fileData, workItem);
+		else
+			workItem.Decoded = TextureLoading::DecodeTexture(fileData.data(), fileData.size(), workItem.CanonicalPath, TextureLoading::DecodeChannels::Expand);
+	}
+
+	void Loader::CookTexture(const std::vector<uint8_t>& fileData, TextureWorkItem& workItem)
+	{
+		PROFILE_SECTION_CPU("Loader::CookTexture");
+
+		const std::string cookedPath = TextureCooking::GetCookedPath(workItem.CanonicalPath, workItem.Usage);
+		if (TextureCooking::IsCookedTextureUpToDate(cookedPath, workItem.CanonicalPath) && TextureCooking::ReadTexture(cookedPath, workItem.Cooked))
+			return;
+
+		// Source is already in memory, cook it from there instead of reading it again
+		TextureCooking::Settings settings{};
+		settings.Usage = workItem.Usage;
+
+		TextureLoading::DecodedTexture decoded = TextureLoading::DecodeTexture(fileData.data(), fileData.size(), workItem.CanonicalPath);
+		workItem.Cooked = TextureCooking::CookImage(decoded.Pixels, decoded.Width, decoded.Height, settings);
+		TextureLoading::FreeDecodedTexture(decoded);
+
+		TextureCooking::WriteTexture(cookedPath, workItem.Cooked);
+	}
+
+	std::string Loader::GetTextureWorkItemKey(const std::string& textureURI, TextureCooking::TextureUsage usage) const
+	{
+		if (!m_Settings.CompressTextures) return textureURI;
+		return textureURI + "#" + std::to_string((uint32_t) usage);
+	}
+
+	uint32_t Loader::GetTextureCacheMips(TextureCooking::TextureUsage usage) const
+	{
+		return m_Settings.CompressTextures ? TextureCache::COOKED_MIPS + (uint32_t) usage : m_Settings.TextureNumMips;
+	}
+
+	bool Loader::ProcessWorkItems(const std::vector<SceneObjectSource>& objects, bool decodeTextures)
+	{
+		PROFILE_SECTION_CPU("Loader::ProcessWorkItems");
+
+		Timer processTimer;
+		processTimer.Start();
+
+		// Textures that are already cached by path don't need any work
+		std::vector<TextureWorkItem*> textureJobs;
+		if (decodeTextures && !m_Settings.TextureStreamer)
+		{
+			const auto addTexture = [this, &textureJobs](const std::string& textureURI, TextureCooking::TextureUsage usage)
+			{
+				const std::string workItemKey = GetTextureWorkItemKey(textureURI, usage);
+				if (textureURI.empty() || m_TextureWorkItems.contains(workItemKey)) return;
+
+				TextureWorkItem& workItem = m_TextureWorkItems[workItemKey];
+				workItem.CanonicalPath = TextureCache::GetCanonicalPath(m_DirectoryPath + "/" + textureURI);
+				workItem.Usage = usage;
+				workItem.CachedTexture = TextureCache::Get()->FindByPath(workItem.CanonicalPath, GetTextureCacheMips(usage));
+				if (!workItem.CachedTexture) textureJobs.push_back(&workItem);
+			};
+
+			for (const SceneObjectSource& object : objects)
+			{
+				addTexture(object.Material.AlbedoPath, TextureCooking::TextureUsage::Albedo);
+				addTexture(object.Material.NormalPath, TextureCooking::TextureUsage::Normal);
+				addTexture(object.Material.MetallicRoughnessPath, TextureCooking::TextureUsage::MetallicRoughness);
+			}
+		}
+
+		ASSERT(m_PrimitiveWorkItems.empty() || m_PrimitiveWorkItems.size() == m_ObjectSources.size(), "[SceneLoading] Primitive work items don't match object sources");
+
+		// Textures go first since they are the longest jobs
+		const uint32_t textureCount = (uint32_t) textureJobs.size();
+		const uint32_t primitiveCount = (uint32_t) m_PrimitiveWorkItems.size();
+		std::atomic<bool> stopped = false;
+		JobPool::Get()->ParallelFor(textureCount + primitiveCount, [&](uint32_t jobIndex)
+		{
+			// Jobs that didn't start yet are skipped once the load is cancelled
+			if (stopped || ShouldStop())
+			{
+				stopped = true;
+				return;
+			}
+
+			if (jobIndex < textureCount)
+			{
+				ReadTexture(*textureJobs[jobIndex]);
+			}
+			else
+			{
+				const uint32_t primitiveIndex = jobIndex - textureCount;
+				ReadPrimitive(m_PrimitiveWorkItems[primitiveIndex], m_ObjectSources[primitiveIndex]);
+			}
+		});
+
+		m_PrimitiveWorkItems.clear();
+
+		processTimer.Stop();
+		if (stopped)
+		{
+			std::cout << "[SceneLoading] Stopped processing of " << primitiveCount << " primitives and " << textureCount << " textures after " << processTimer.GetTimeMS() << " ms" << std::endl;
+			return false;
+		}
+
+		std::cout << "[SceneLoading] Processed " << primitiveCount << " primitives and " << textureCount << " textures on " << JobPool::Get()->GetThreadCount() + 1 << " threads in " << processTimer.GetTimeMS() << " ms" << std::endl;
+		return true;
+	}
+
+	bool Loader::ShouldStop() const
+	{
+		return m_AsyncLoad && m_AsyncLoad->ShouldStop();
+	}
+
+	void Loader::ReleaseTextureWorkItems()
+	{
+		for (auto& [textureURI, workItem] : m_TextureWorkItems)
+		{
+			if (workItem.Decoded.Pixels) TextureLoading::FreeDecodedTexture(workItem.Decoded);
+			if (workItem.CachedTexture) TextureCache::Get()->Release(m_Context, workItem.CachedTexture);
+		}
+		m_TextureWorkItems.clear();
+	}
+
 	std::vector<ModelLoading::AnimationEntry> Loader::LoadAnimations(cgltf_node* nodeData)
 	{
 		if (!m_NodeAnimationMap.contains(nodeData)) return {};
@@ -461,8 +961,34 @@ namespace ModelLoading
 			Float3* valueDataF3 = (Float3*)valueData;
 			float* valueDataF = (float*)valueData;
 
+			const auto readValue = [&](AnimKeyFrame& keyFrame, cgltf_size valueIndex)
+			{
+				switch (animationTarget)
+				{
+				case AnimTarget::Translation:
+					keyFrame.Translation = *(valueDataF3 + valueIndex);
+					break;
+				case AnimTarget::Rotation:
+					keyFrame.Rotation = *(valueDataQuat + valueIndex);
+					break;
+				case AnimTarget::Scale:
+					keyFrame.Scale = *(valueDataF3 + valueIndex);
+					break;
+				case AnimTarget::Weights:
+					keyFrame.Weight = *(valueDataF + valueIndex);
+					break;
+				case AnimTarget::Invalid:
+				default:
+					NOT_IMPLEMENTED;
+				}
+			};
+
+			// Cubic spline outputs are (in tangent, value, out tangent) triplets per keyframe
+			const bool cubic = animationInterpolation == AnimInterpolation::Cubic;
+			const cgltf_size elementsPerKeyFrame = cubic ? 3 : 1;
+
 			// Insert entries
-			const cgltf_size entriesCount = animationSampler->output->count / animationSampler->input->count;
+			const cgltf_size entriesCount = animationSampler->output->count / animationSampler->input->count / elementsPerKeyFrame;
 			ASSERT(entriesCount == 1 || animationTarget == AnimTarget::Weights, "entriesCount == 1 || animationTarget == AnimTarget::Weights");
 			for (cgltf_size i = 0; i < entriesCount; i++)
 			{
@@ -476,30 +1002,29 @@ namespace ModelLoading
 				entry.KeyFrames.resize(keyFrameCount);
 				entry.WeightTargetIndex = (uint32_t) i;
 
+				if (cubic)
+				{
+					entry.InTangents.resize(keyFrameCount);
+					entry.OutTangents.resize(keyFrameCount);
+				}
+
 				// Insert keyframes
 				for (cgltf_size keyFrameIndex = 0; keyFrameIndex < keyFrameCount; keyFrameIndex++)
 				{
 					entry.KeyFrames[keyFrameIndex].Time = *(timeData + keyFrameIndex);
 
-					const cgltf_size valueIndex = i + keyFrameIndex * entriesCount;
-					switch (entry.Target)
+					const cgltf_size elementIndex = keyFrameIndex * elementsPerKeyFrame;
+					if (cubic)
 					{
-					case AnimTarget::Translation:
-						entry.KeyFrames[keyFrameIndex].Translation = *(valueDataF3 + valueIndex);
-						break;
-					case AnimTarget::Rotation:
-						entry.KeyFrames[keyFrameIndex].Rotation = *(valueDataQuat + valueIndex);
-						break;
-					case AnimTarget::Scale:
-						entry.KeyFrames[keyFrameIndex].Scale = *(valueDataF3 + valueIndex);
-						break;
-					case AnimTarget::Weights:
-						entry.KeyFrames[keyFrameIndex].Weight = *(valueDataF + valueIndex);
-						break;
-					case AnimTarget::Invalid:
-					default:
-						NOT_IMPLEMENTED;
-
+						entry.InTangents[keyFrameIndex].Time = entry.KeyFrames[keyFrameIndex].Time;
+						entry.OutTangents[keyFrameIndex].Time = entry.KeyFrames[keyFrameIndex].Time;
+						readValue(entry.InTangents[keyFrameIndex], i + elementIndex * entriesCount);
+						readValue(entry.KeyFrames[keyFrameIndex], i + (elementIndex + 1) * entriesCount);
+						readValue(entry.OutTangents[keyFrameIndex], i + (elementIndex + 2) * entriesCount);
+					}
+					else
+					{
+						readValue(entry.KeyFrames[keyFrameIndex], i + elementIndex * entriesCount);
 					}
 				}
 				animations.push_back(entry);
@@ -509,58 +1034,106 @@ namespace ModelLoading
 		return animations;
 	}
 
-	std::vector<MorphTarget> Loader::LoadMorph(cgltf_primitive* meshData, const std::vector<float>& weights)
+	void Loader::ReadMorph(cgltf_primitive* meshData, const std::vector<float>& weights, SceneObjectSource& object)
 	{
-		if (weights.empty()) return {};
+		if (weights.empty()) return;
 
 		ASSERT(weights.size() == meshData->targets_count, "weights.size() != meshData->targets_count");
 
-		std::vector<MorphTarget> morphTargets;
-
+		object.MorphTargetsStorage.resize(meshData->targets_count);
 		for (cgltf_size targetIndex = 0; targetIndex < meshData->targets_count; targetIndex++)
 		{
 			cgltf_morph_target* morphTarget = meshData->targets + targetIndex;
 
 			VertexAttributesData vertices = LoadAttributes(morphTarget->attributes, morphTarget->attributes_count);
-			ASSERT(!vertices.Joints8 && !vertices.Joints16 && !vertices.Weights && !vertices.Colors, "[Loader::LoadMorph] Using not supported morph vertex attributes");
+			ASSERT(!vertices.Joints8 && !vertices.Joints16 && !vertices.Weights && !vertices.Colors, "[Loader::ReadMorph] Using not supported morph vertex attributes");
 
-			std::vector<MorphVertex> morphTargetData{};
-			morphTargetData.resize(vertices.NumVertices);
+			// Only vertices that the target moves are kept, tangent deltas are not used by the shaders
+			std::vector<MorphDelta>& morphTargetData = object.MorphTargetsStorage[targetIndex];
 			for (uint32_t i = 0; i < vertices.NumVertices; i++)
 			{
-				if (vertices.Positions) morphTargetData[i].Position = *(vertices.Positions + i);
-				if (vertices.Texcoords) morphTargetData[i].Texcoord = *(vertices.Texcoords + i);
-				if (vertices.Normals) morphTargetData[i].Normal = *(vertices.Normals + i);
-				if (vertices.Tangents) morphTargetData[i].Tangent = *(vertices.Tangents + i);
+				const Float3 position = vertices.Positions ? vertices.Positions[i] : Float3{ 0.0f, 0.0f, 0.0f };
+				const Float2 texcoord = vertices.Texcoords ? vertices.Texcoords[i] : Float2{ 0.0f, 0.0f };
+				const Float3 normal = vertices.Normals ? vertices.Normals[i] : Float3{ 0.0f, 0.0f, 0.0f };
+
+				const bool movesVertex = position.x != 0.0f || position.y != 0.0f || position.z != 0.0f || texcoord.x != 0.0f || texcoord.y != 0.0f ||
+					normal.x != 0.0f || normal.y != 0.0f || normal.z != 0.0f;
+				if (!movesVertex) continue;
+
+				MorphDelta& delta = morphTargetData.emplace_back();
+				delta.VertexIndex = i;
+				delta.Position = position;
+				delta.Texcoord = VertexQuantization::PackHalf2(texcoord);
+				delta.NormalXY = VertexQuantization::PackHalf2(Float2{ normal.x, normal.y });
+				delta.NormalZ = VertexQuantization::PackHalf2(Float2{ normal.z, 0.0f });
 			}
-			
-			ResourceInitData initData{};
-			initData.Context = &m_Context;
-			initData.Data = morphTargetData.data();
 
-			MorphTarget targetData{};
-			targetData.Weight = weights[targetIndex];
-			targetData.Data = GFX::CreateBuffer(vertices.NumVertices * sizeof(MorphVertex), sizeof(MorphVertex), RCF::None, &initData);
-
-			morphTargets.push_back(targetData);
+			MorphTargetSource targetSource{};
+			targetSource.Weight = weights[targetIndex];
+			targetSource.NumDeltas = (uint32_t) morphTargetData.size();
+			targetSource.Deltas = morphTargetData.data();
+			object.MorphTargets.push_back(targetSource);
 		}
-		return morphTargets;
 	}
 
 	std::vector<SkeletonJoint> Loader::LoadSkin(cgltf_skin* skinData)
 	{
+		using namespace DirectX;
+
 		if (!skinData) return {};
 
+		std::unordered_map<cgltf_node*, uint32_t> jointIndices;
+		for (cgltf_size i = 0; i < skinData->joints_count; i++)
+		{
+			jointIndices[*(skinData->joints + i)] = (uint32_t) i;
+		}
+
+		// Skinned vertices end up in the model space of the mesh node, ModelToWorld is applied after skinning
+		const XMMATRIX worldToModel = XMMatrixInverse(nullptr, XMLoadFloat4x4(&m_CurrentTransform));
+
 		std::vector<SkeletonJoint> joints;
+		joints.reserve(skinData->joints_count);
 
-		DirectX::XMFLOAT4X4* jointMatrices = GetBufferData<DirectX::XMFLOAT4X4>(skinData->inverse_bind_matrices);
+		DirectX::XMFLOAT4X4* jointMatrices = skinData->inverse_bind_matrices ? GetBufferData<DirectX::XMFLOAT4X4>(skinData->inverse_bind_matrices) : nullptr;
 		for (cgltf_size i = 0; i < skinData->joints_count; i++)
 		{
 			cgltf_node* jointNode = *(skinData->joints + i);
 			
 			SkeletonJoint joint;
-			joint.ModelToJoint = *(jointMatrices + i);
-			joint.Transform = m_CurrentTransform;
+			joint.ModelToJoint = jointMatrices ? *(jointMatrices + i) : XMUtility::ToXMFloat4x4(XMMatrixIdentity());
+			joint.ParentTransform = XMUtility::ToXMFloat4x4(XMMatrixIdentity());
+
+			if (jointNode->parent && jointIndices.contains(jointNode->parent))
+			{
+				joint.ParentIndex = jointIndices[jointNode->parent];
+			}
+			else
+			{
+				XMMATRIX parentToWorld = XMMatrixIdentity();
+				if (jointNode->parent)
+				{
+					float parentMatrix[16];
+					cgltf_node_transform_world(jointNode->parent, parentMatrix);
+					const XMFLOAT4X4 parentTransform{ parentMatrix };
+					parentToWorld = XMLoadFloat4x4(&parentTransform);
+				}
+				joint.ParentTransform = XMUtility::ToXMFloat4x4(XMMatrixMultiply(parentToWorld, worldToModel));
+			}
+
+			if (jointNode->has_matrix)
+			{
+				const auto matrixData = XMUtility::DecomposeMatrix(XMFLOAT4X4{ jointNode->matrix });
+				joint.RestTranslation = matrixData.Position;
+				joint.RestRotation = matrixData.Rotation;
+				joint.RestScale = matrixData.Scale;
+			}
+			else
+			{
+				if (jointNode->has_translation) joint.RestTranslation = ToFloat3(jointNode->translation);
+				if (jointNode->has_rotation) joint.RestRotation = ToQuaternion(jointNode->rotation);
+				if (jointNode->has_scale) joint.RestScale = ToFloat3(jointNode->scale);
+			}
+
 			joint.Animations = LoadAnimations(jointNode);
 			joints.push_back(joint);
 		}
@@ -568,75 +1141,48 @@ namespace ModelLoading
 		return joints;
 	}
 
-	MeshData Loader::LoadMesh(cgltf_primitive* meshData)
+	void Loader::ReadMesh(cgltf_primitive* meshData, SceneObjectSource& object)
 	{
 		ASSERT(meshData->type == cgltf_primitive_type_triangles, "[SceneLoading] Scene contains quad meshes. We are supporting just triangle meshes.");
 
-		MeshData mesh;
-
-		const uint32_t vertCount = (uint32_t) meshData->attributes[0].data->count;
-
 		const VertexAttributesData vertices = LoadAttributes(meshData->attributes, meshData->attributes_count);
-		mesh.PositionsData.resize(vertCount);
-		for (uint32_t i = 0; i < vertCount; i++)
-		{
-			mesh.PositionsData[i] = vertices.Positions[i];
-		}
 
-		std::vector<uint32_t> joints;
+		MeshStreams& mesh = object.Mesh;
+		mesh.NumVertices = vertices.NumVertices;
+		mesh.Positions = vertices.Positions;
+		mesh.Texcoords = vertices.Texcoords;
+		mesh.Normals = vertices.Normals;
+		mesh.Tangents = vertices.Tangents;
+		mesh.Weights = vertices.Weights;
+
 		if (vertices.Joints8)
 		{
-			joints.resize(vertices.NumVertices * 4);
-			for (uint16_t i = 0; i < vertices.NumVertices * 4; i++) 
-				joints[i] = vertices.Joints8[i];
+			object.JointsStorage.resize(vertices.NumVertices * 4);
+			for (uint32_t i = 0; i < vertices.NumVertices * 4; i++) 
+				object.JointsStorage[i] = vertices.Joints8[i];
 		}
 
 		if (vertices.Joints16)
 		{
-			joints.resize(vertices.NumVertices * 4);
-			for (uint16_t i = 0; i < vertices.NumVertices * 4; i++)
-				joints[i] = vertices.Joints16[i];
+			object.JointsStorage.resize(vertices.NumVertices * 4);
+			for (uint32_t i = 0; i < vertices.NumVertices * 4; i++)
+				object.JointsStorage[i] = vertices.Joints16[i];
 		}
+		mesh.Joints = object.JointsStorage.empty() ? nullptr : object.JointsStorage.data();
 
-		if(meshData->indices)
-			LoadIB(meshData->indices, mesh.IndicesData);
-
-		const auto createBuffer = [this](const void* data, uint32_t stride, uint32_t numElements)
+		if (meshData->indices)
 		{
-			std::vector<uint8_t> defaultData{};
-			if (!data)
-			{
-				defaultData.resize(stride * numElements);
-				memset(defaultData.data(), 0, stride * numElements);
-				data = defaultData.data();
-			}
-			ResourceInitData initData{ &this->m_Context, data };
-			return GFX::CreateBuffer(numElements * stride, stride, RCF::None, &initData);
-		};
-
-		mesh.Positions = createBuffer(vertices.Positions, sizeof(DirectX::XMFLOAT3), vertCount);
-		mesh.Texcoords = createBuffer(vertices.Texcoords, sizeof(DirectX::XMFLOAT2), vertCount);
-		mesh.Normals = createBuffer(vertices.Normals, sizeof(DirectX::XMFLOAT3), vertCount);
-		mesh.Tangents = createBuffer(vertices.Tangents, sizeof(DirectX::XMFLOAT4), vertCount);
-		mesh.Weights = createBuffer(vertices.Weights, sizeof(Float4), vertCount);
-		mesh.Joints = createBuffer(joints.empty() ? nullptr : joints.data(), sizeof(uint32_t) * 4, vertCount);
-		mesh.Indices = createBuffer(mesh.IndicesData.empty() ? nullptr : mesh.IndicesData.data(), sizeof(uint32_t), (uint32_t)mesh.IndicesData.size());
-		mesh.PrimitiveCount = mesh.Indices ? (uint32_t) mesh.IndicesData.size() : vertices.NumVertices;
-
-		return mesh;
+			LoadIB(meshData->indices, object.IndicesStorage);
+			mesh.NumIndices = (uint32_t) object.IndicesStorage.size();
+			mesh.Indices = object.IndicesStorage.data();
+		}
 	}
 
-	MaterialData Loader::LoadMaterial(cgltf_material* materialData)
+	MaterialSource Loader::ReadMaterial(cgltf_material* materialData)
 	{
-		MaterialData material{};
+		MaterialSource material{};
 
-		if (!materialData || !materialData->has_pbr_metallic_roughness)
-		{
-			material.Albedo = LoadTexture(nullptr);
-			material.Normal = LoadTexture(nullptr, ColorUNORM(0.5f, 0.5f, 1.0f, 1.0f));
-			material.MetallicRoughness = LoadTexture(nullptr);
-			return material;
-		}
+		if (!materialData || !materialData->has_pbr_metallic_roughness) return material;
 
 		cgltf_pbr_metallic_roughness& mat = materialData->pbr_metallic_roughness;
 		
@@ -656,26 +1202,229 @@ namespace ModelLoading
 		material.MetallicFactor = mat.metallic_factor;
 		material.RoughnessFactor = mat.roughness_factor;
 
-		material.Albedo = LoadTexture(mat.base_color_texture.texture);
-		material.Normal = LoadTexture(materialData->normal_texture.texture, ColorUNORM(0.5f, 0.5f, 1.0f, 1.0f));
-		material.MetallicRoughness = LoadTexture(mat.metallic_roughness_texture.texture);
+		material.AlbedoPath = GetTextureURI(mat.base_color_texture.texture);
+		material.NormalPath = GetTextureURI(materialData->normal_texture.texture);
+		material.MetallicRoughnessPath = GetTextureURI(mat.metallic_roughness_texture.texture);
 
 		return material;
 	}
 
-	Texture* Loader::LoadTexture(cgltf_texture* textureData, ColorUNORM defaultColor)
+	void Loader::CreateSceneObjects(const std::vector<SceneObjectSource>& objectSources, std::vector<SceneObject>& objects)
+	{
+		if (!m_AsyncLoad)
+		{
+			for (const SceneObjectSource& objectSource : objectSources) CreateObjects(objectSource, objects);
+			return;
+		}
+
+		m_AsyncLoad->m_NumObjectSources = (uint32_t) objectSources.size();
+		for (const SceneObjectSource& objectSource : objectSources)
+		{
+			if (ShouldStop()) break;
+
+			std::vector<SceneObject> createdObjects;
+			CreateObjects(objectSource, createdObjects);
+
+			// Main context submissions go to the same queue, everything submitted after the objects are taken sees the uploads
+			GFX::Cmd::EndRecordingAndSubmit(m_Context);
+			GFX::Cmd::BeginRecording(m_Context);
+
+			m_AsyncLoad->AddObjects(std::move(createdObjects));
+			m_AsyncLoad->m_NumCreatedObjectSources++;
+		}
+	}
+
+	void Loader::CreateObjects(const SceneObjectSource& objectSource, std::vector<SceneObject>& objects)
+	{
+		const auto createObject = [&](const MeshStreams& mesh, const BoundingSphere& boundingVolume)
+		{
+			SceneObject& object = objects.emplace_back();
+			object.BoundingVolume = boundingVolume;
+			object.ModelToWorld = objectSource.ModelToWorld;
+			object.Mesh = CreateMesh(mesh);
+			object.Material = CreateMaterial(objectSource.Material);
+			object.MorphTargets = CreateMorph(objectSource.MorphTargets);
+			object.BlendedMorph = CreateBlendedMorph(mesh, objectSource.MorphTargets);
+			object.Skeleton = objectSource.Skeleton;
+			object.AnimcationData = objectSource.Animations;
+		};
+
+		// Morph targets are indexed by the vertex id so meshes using them are kept in one piece
+		const MeshStreams& mesh = objectSource.Mesh;
+		const bool splitMesh = m_Settings.SplitLargeMeshes && mesh.NumVertices > MAX_16BIT_INDEX_VERTICES && mesh.NumIndices > 0 && mesh.Positions && objectSource.MorphTargets.empty();
+		if (!splitMesh)
+		{
+			createObject(mesh, objectSource.BoundingVolume);
+			return;
+		}
+
+		const std::vector<MeshPart> parts = SplitMesh(mesh, MAX_16BIT_INDEX_VERTICES);
+		for (const MeshPart& part : parts)
+		{
+			createObject(part.Streams, CalculateBoundingSphere(part.Streams));
+		}
+		m_IndexStats.SplitMeshes++;
+		m_IndexStats.MeshParts += (uint32_t) parts.size();
+	}
+
+	MeshData Loader::CreateMesh(const MeshStreams& streams)
 	{
-		if (textureData)
+		MeshData mesh;
+
+		const uint32_t vertCount = streams.NumVertices;
+
+		if (m_Settings.KeepMeshData)
+		{
+			if (streams.Positions) mesh.PositionsData.assign(streams.Positions, streams.Positions + vertCount);
+			if (streams.Indices) mesh.IndicesData.assign(streams.Indices, streams.Indices + streams.NumIndices);
+		}
+
+		const auto createBuffer = [this](const void* data, uint32_t stride, uint32_t numElements)
+		{
+			std::vector<uint8_t> defaultData{};
+			if (!data)
+			{
+				defaultData.resize(stride * numElements);
+				memset(defaultData.data(), 0, stride * numElements);
+				data = defaultData.data();
+			}
+			ResourceInitData initData{ &this->m_Context, data };
+			return GFX::CreateBuffer(numElements * stride, stride, RCF::None, &initData);
+		};
+
+		if (m_Settings.QuantizeVertices && VertexQuantization::CanQuantize(streams))
 		{
-			const std::string textureURI = textureData->image->uri;
-			const std::string texturePath = m_DirectoryPath + "/" + textureURI;
-			return TextureLoading::LoadTexture(m_Context, texturePath, RCF::None, m_TextureNumMips);
+			const std::vector<uint8_t> vertices = VertexQuantization::Quantize(streams);
+			const uint32_t stride = VertexQuantization::GetVertexStride(streams);
+			const VertexQuantization::QuantizationError error = VertexQuantization::MeasureError(streams, vertices);
+
+			const uint32_t unquantizedSize = vertCount * VertexQuantization::UnquantizedVertexSize;
+			const uint32_t quantizedSize = vertCount * stride;
+			std::cout << "[SceneLoading] Quantized " << vertCount << " vertices: " << unquantizedSize / 1024 << " KB -> " << quantizedSize / 1024 << " KB"
+				<< " (saved " << (unquantizedSize - quantizedSize) / 1024 << " KB), max error: normal " << error.NormalDegrees << " deg, tangent " << error.TangentDegrees
+				<< " deg, texcoord " << error.Texcoord << ", weight " << error.Weight << std::endl;
+			ASSERT(error.TangentSignMismatches == 0, "[SceneLoading] Quantization changed " << error.TangentSignMismatches << " tangent signs");
+
+			mesh.Vertices = createBuffer(vertices.data(), stride, vertCount);
 		}
 		else
 		{
-			ResourceInitData initData = { &m_Context, &defaultColor };
-			return GFX::CreateTexture(1, 1, RCF::None, 1, DXGI_FORMAT_R8G8B8A8_UNORM, &initData);
+			if (m_Settings.QuantizeVertices)
+				std::cout << "[SceneLoading] Mesh without positions or with joint indices over 255 can't be quantized, using float streams" << std::endl;
+
+			mesh.Positions = createBuffer(streams.Positions, sizeof(DirectX::XMFLOAT3), vertCount);
+			mesh.Texcoords = createBuffer(streams.Texcoords, sizeof(DirectX::XMFLOAT2), vertCount);
+			mesh.Normals = createBuffer(streams.Normals, sizeof(DirectX::XMFLOAT3), vertCount);
+			mesh.Tangents = createBuffer(streams.Tangents, sizeof(DirectX::XMFLOAT4), vertCount);
+			mesh.Weights = createBuffer(streams.Weights, sizeof(Float4), vertCount);
+			mesh.Joints = createBuffer(streams.Joints, sizeof(uint32_t) * 4, vertCount);
+		}
+
+		if (streams.NumIndices && vertCount <= MAX_16BIT_INDEX_VERTICES)
+		{
+			std::vector<uint16_t> indices(streams.NumIndices);
+			for (uint32_t i = 0; i < streams.NumIndices; i++) indices[i] = (uint16_t) streams.Indices[i];
+			mesh.Indices = createBuffer(indices.data(), sizeof(uint16_t), streams.NumIndices);
+		}
+		else if (streams.NumIndices)
+		{
+			mesh.Indices = createBuffer(streams.Indices, sizeof(uint32_t), streams.NumIndices);
 		}
+		mesh.PrimitiveCount = mesh.Indices ? streams.NumIndices : vertCount;
+
+		if (mesh.Indices)
+		{
+			m_IndexStats.UnpackedBytes += streams.NumIndices * sizeof(uint32_t);
+			m_IndexStats.Bytes += streams.NumIndices * mesh.Indices->Stride;
+		}
+
+		return mesh;
+	}
+
+	std::vector<MorphTarget> Loader::CreateMorph(const std::vector<MorphTargetSource>& morphTargets)
+	{
+		std::vector<MorphTarget> targets;
+		targets.reserve(morphTargets.size());
+		for (const MorphTargetSource& morphTarget : morphTargets)
+		{
+			MorphTarget targetData{};
+			targetData.Weight = morphTarget.Weight;
+			targetData.NumDeltas = morphTarget.NumDeltas;
+			targetData.Deltas = nullptr;
+			if (morphTarget.NumDeltas > 0)
+			{
+				ResourceInitData initData{};
+				initData.Context = &m_Context;
+				initData.Data = morphTarget.Deltas;
+				targetData.Deltas = GFX::CreateBuffer(morphTarget.NumDeltas * sizeof(MorphDelta), sizeof(MorphDelta), RCF::None, &initData);
+			}
+			targets.push_back(targetData);
+		}
+		return targets;
+	}
+
+	Buffer* Loader::CreateBlendedMorph(const MeshStreams& mesh, const std::vector<MorphTargetSource>& morphTargets)
+	{
+		if (morphTargets.empty()) return nullptr;
+		return GFX::CreateBuffer(mesh.NumVertices * sizeof(BlendedMorphVertex), sizeof(BlendedMorphVertex), RCF::UAV);
+	}
+
+	MaterialData Loader::CreateMaterial(const MaterialSource& materialSource)
+	{
+		MaterialData material{};
+		material.MatType = materialSource.MatType;
+		material.AlbedoFactor = materialSource.AlbedoFactor;
+		material.MetallicFactor = materialSource.MetallicFactor;
+		material.RoughnessFactor = materialSource.RoughnessFactor;
+		material.Albedo = LoadTexture(materialSource.AlbedoPath, TextureCooking::TextureUsage::Albedo);
+		material.Normal = LoadTexture(materialSource.NormalPath, TextureCooking::TextureUsage::Normal, ColorUNORM(0.5f, 0.5f, 1.0f, 1.0f));
+		material.MetallicRoughness = LoadTexture(materialSource.MetallicRoughnessPath, TextureCooking::TextureUsage::MetallicRoughness);
+		return material;
+	}
+
+	Texture* Loader::LoadTexture(const std::string& textureURI, TextureCooking::TextureUsage usage, ColorUNORM defaultColor)
+	{
+		if (textureURI.empty())
+		{
+			return TextureCache::Get()->GetDefaultTexture(m_Context, defaultColor);
+		}
+
+		// Streamer uploads only the tail here, it doesn't need decoded work items
+		if (m_Settings.TextureStreamer)
+		{
+			return m_Settings.TextureStreamer->Load(m_Context, m_DirectoryPath + "/" + textureURI);
+		}
+
+		const std::string workItemKey = GetTextureWorkItemKey(textureURI, usage);
+		if (!m_TextureWorkItems.contains(workItemKey))
+		{
+			ASSERT(0, "[SceneLoading] Texture " << textureURI << " wasn't processed before loading");
+			return TextureCache::Get()->GetDefaultTexture(m_Context, defaultColor);
+		}
+
+		TextureCache* textureCache = TextureCache::Get();
+		TextureWorkItem& workItem = m_TextureWorkItems[workItemKey];
+		if (!workItem.CachedTexture)
+		{
+			// Another path in this scene could have the same content
+			const uint32_t cacheMips = GetTextureCacheMips(usage);
+			workItem.CachedTexture = textureCache->FindByContent(workItem.ContentHash, cacheMips);
+			if (workItem.CachedTexture)
+			{
+				textureCache->AddPath(workItem.CanonicalPath, cacheMips, workItem.CachedTexture);
+			}
+			else
+			{
+				if (m_Settings.CompressTextures)
+					workItem.CachedTexture = TextureLoading::CreateTexture(m_Context, workItem.Cooked, RCF::None);
+				else
+					workItem.CachedTexture = TextureLoading::CreateTexture(m_Context, workItem.Decoded, RCF::None, m_Settings.TextureNumMips);
+				textureCache->Add(workItem.CanonicalPath, workItem.ContentHash, cacheMips, workItem.CachedTexture);
+			}
+		}
+
+		textureCache->AddReference(workItem.CachedTexture);
+		return workItem.CachedTexture;
 	}
 
 	template<typename T>
@@ -685,6 +1434,13 @@ namespace ModelLoading
 		*res = nullptr;
 	}
 
+	// Loaded textures are owned by the texture cache
+	static void ReleaseTexture(GraphicsContext& context, Texture** texture)
+	{
+		if (*texture && !TextureCache::Get()->Release(context, *texture)) GFX::Cmd::Delete(context, *texture);
+		*texture = nullptr;
+	}
+
 	void Free(GraphicsContext& context, SceneObject& sceneObject)
 	{
 		Free(context, &sceneObject.Mesh.Positions);
@@ -694,13 +1450,16 @@ namespace ModelLoading
 		Free(context, &sceneObject.Mesh.Weights);
 		Free(context, &sceneObject.Mesh.Joints);
 		Free(context, &sceneObject.Mesh.Indices);
-		Free(context, &sceneObject.Material.Albedo);
-		Free(context, &sceneObject.Material.Normal);
-		Free(context, &sceneObject.Material.MetallicRoughness);
+		Free(context, &sceneObject.Mesh.Vertices);
+		ReleaseTexture(context, &sceneObject.Material.Albedo);
+		ReleaseTexture(context, &sceneObject.Material.Normal);
+		ReleaseTexture(context, &sceneObject.Material.MetallicRoughness);
+
+		Free(context, &sceneObject.BlendedMorph);
 
 		for (MorphTarget& morphTarget : sceneObject.MorphTargets)
 		{
-			GFX::Cmd::Delete(context, morphTarget.Data);
+			Free(context, &morphTarget.Deltas);
 		}
 	}
 	
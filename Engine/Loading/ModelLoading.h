@@ -1,13 +1,21 @@
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
 #include "Common.h"
+#include "Loading/TextureLoading.h"
+#include "Loading/TextureCache.h"
+#include "Loading/TextureCooking.h"
+#include "Utility/Multithreading.h"
 
 struct Buffer;
 struct Texture;
 struct GraphicsContext;
+class RenderTask;
 
 struct cgltf_data;
 struct cgltf_node;
@@ -21,6 +29,8 @@ struct cgltf_light;
 struct cgltf_mesh;
 struct cgltf_camera;
 
+namespace TextureStreaming { class TextureStreamer; }
+
 #undef OPAQUE
 
 namespace ModelLoading
@@ -62,26 +72,53 @@ namespace ModelLoading
 		AnimInterpolation Interpolation = AnimInterpolation::Invalid;
 		std::vector<AnimKeyFrame> KeyFrames = {};
 		float Duration = 1.0f;
+
+		// Only for cubic interpolation, one per keyframe. Tangents use the value of the keyframe, the time is unused.
+		std::vector<AnimKeyFrame> InTangents = {};
+		std::vector<AnimKeyFrame> OutTangents = {};
 	};
 
-	struct MorphVertex
+	// Morph target delta of a single vertex, targets store only the vertices they move
+	struct MorphDelta
+	{
+		uint32_t VertexIndex;
+		Float3 Position;
+		uint32_t Texcoord;	// half2
+		uint32_t NormalXY;	// half2
+		uint32_t NormalZ;	// half in the low 16 bits
+	};
+
+	// Weighted sum of the active morph targets of one vertex, must match with the morph shaders
+	struct BlendedMorphVertex
 	{
 		Float3 Position;
 		Float2 Texcoord;
 		Float3 Normal;
-		Float4 Tangent;
 	};
 
 	struct MorphTarget
 	{
 		float Weight;
-		Buffer* Data; // MorphVertex
+		uint32_t NumDeltas;
+		Buffer* Deltas; // MorphDelta, null when the target doesn't move any vertex
 	};
 
 	struct SkeletonJoint
 	{
-		DirectX::XMFLOAT4X4 Transform;
+		static constexpr uint32_t INVALID_PARENT = std::numeric_limits<uint32_t>::max();
+
+		// Index of the parent joint in the skeleton, joints without one are roots
+		uint32_t ParentIndex = INVALID_PARENT;
+
+		// For root joints transforms from the parent node space to the model space of the skinned mesh, identity otherwise
+		DirectX::XMFLOAT4X4 ParentTransform;
 		DirectX::XMFLOAT4X4 ModelToJoint;
+
+		// Local transformation in the parent space, animated channels override it
+		Float3 RestTranslation{ 0.0f, 0.0f, 0.0f };
+		Quaternion RestRotation{ 0.0f, 0.0f, 0.0f, 1.0f };
+		Float3 RestScale{ 1.0f, 1.0f, 1.0f };
+
 		std::vector<AnimationEntry> Animations;
 	};
 
@@ -104,7 +141,10 @@ namespace ModelLoading
 		Buffer* Tangents = nullptr;		// float4
 		Buffer* Weights = nullptr;		// float4
 		Buffer* Joints = nullptr;		// uint4
-		Buffer* Indices = nullptr;		// uint32_t
+		Buffer* Indices = nullptr;		// uint16_t when mesh has at most 64K vertices, otherwise uint32_t
+
+		// Interleaved quantized vertices (see VertexQuantization.h), streams above except Indices are not created when this is used
+		Buffer* Vertices = nullptr;		// VertexQuantization::Vertex or VertexQuantization::SkinnedVertex
 	};
 
 	struct MaterialData
@@ -139,6 +179,8 @@ namespace ModelLoading
 		std::vector<MorphTarget> MorphTargets;
 		std::vector<SkeletonJoint> Skeleton;
 
+		// BlendedMorphVertex per vertex, UAV that the application blends the active morph targets into
+		Buffer* BlendedMorph = nullptr;
 	};
 
 	struct SceneCamera
@@ -179,40 +221,239 @@ namespace ModelLoading
 		std::vector<SceneLight> Lights;
 	};
 
+	// View over the vertex streams of a single primitive.
+	// Streams point either into glTF buffers or into a mapped cooked scene and are copied only on upload.
+	struct MeshStreams
+	{
+		uint32_t NumVertices = 0;
+		uint32_t NumIndices = 0;
+
+		const Float3* Positions = nullptr;
+		const Float2* Texcoords = nullptr;
+		const Float3* Normals = nullptr;
+		const Float4* Tangents = nullptr;
+		const Float4* Weights = nullptr;
+		const uint32_t* Joints = nullptr;	// uint4
+		const uint32_t* Indices = nullptr;
+	};
+
+	struct MorphTargetSource
+	{
+		float Weight = 0.0f;
+		uint32_t NumDeltas = 0;
+		const MorphDelta* Deltas = nullptr; // Sorted by the vertex index
+	};
+
+	struct MaterialSource
+	{
+		MaterialData::MaterialType MatType = MaterialData::MaterialType::OPAQUE;
+
+		Float3 AlbedoFactor{ 1.0f, 1.0f, 1.0f };
+		float MetallicFactor = 1.0f;
+		float RoughnessFactor = 1.0f;
+
+		// Relative to the scene directory, empty path means default color
+		std::string AlbedoPath;
+		std::string NormalPath;
+		std::string MetallicRoughnessPath;
+	};
+
+	// CPU side description of a scene object before any GPU resource is created
+	struct SceneObjectSource
+	{
+		BoundingSphere BoundingVolume;
+		DirectX::XMFLOAT4X4 ModelToWorld;
+
+		MeshStreams Mesh;
+		MaterialSource Material;
+
+		std::vector<AnimationEntry> Animations;
+		std::vector<MorphTargetSource> MorphTargets;
+		std::vector<SkeletonJoint> Skeleton;
+
+		// Storage for the streams that needed conversion from glTF layout, views above can point here
+		std::vector<uint32_t> JointsStorage;
+		std::vector<uint32_t> IndicesStorage;
+		std::vector<std::vector<MorphDelta>> MorphTargetsStorage;
+	};
+
+	// Meshes up to this vertex count use 16 bit indices
+	constexpr uint32_t MAX_16BIT_INDEX_VERTICES = 1 << 16;
+
+	struct LoaderSettings
+	{
+		uint32_t TextureNumMips = 1;
+
+		// Keeps CPU copy of positions and indices in MeshData
+		bool KeepMeshData = false;
+
+		// Creates single interleaved vertex stream with quantized attributes in MeshData::Vertices
+		bool QuantizeVertices = false;
+
+		// Splits meshes without morph targets into objects with at most 64K vertices so they can use 16 bit indices
+		bool SplitLargeMeshes = true;
+
+		// Material textures are streamed when set, TextureNumMips is ignored for them
+		TextureStreaming::TextureStreamer* TextureStreamer = nullptr;
+
+		// Material textures are cooked to block compressed DDS files next to the source (see TextureCooking), TextureNumMips is ignored for them
+		bool CompressTextures = false;
+	};
+
+	// Scene loaded in the background by Loader::LoadAsync, shared by the loading task and the caller.
+	// Objects are handed out once their uploads are submitted, so GPU work submitted after TakeLoadedObjects sees their data.
+	class AsyncSceneLoad
+	{
+	public:
+		// Called by TakeLoadedObjects for every object it adds, objectIndex is the index in Scene::Objects
+		using ObjectLoadedCallback = std::function<void(uint32_t objectIndex, SceneObject& object)>;
+
+		// Created objects / objects in the scene, stays at 0 while the scene is parsed and textures are decoded
+		float GetProgress() const;
+		bool IsDone() const { return m_Done; }
+		bool IsCancelled() const { return m_Cancelled; }
+
+		// Loading stops before the next object, objects loaded until then are still handed out
+		void Cancel();
+		void Wait() const;
+
+		// Moves objects loaded since the last call to the scene, cameras and lights are added once the loading is done.
+		// Returns number of added objects, has to be called from the thread that owns the scene.
+		uint32_t TakeLoadedObjects(Scene& scene);
+
+	private:
+		friend class Loader;
+		friend class SceneLoadTask;
+
+		bool ShouldStop() const;
+		void AddObjects(std::vector<SceneObject>&& objects);
+		void Finish(Scene&& scene);
+
+	private:
+		ObjectLoadedCallback m_OnObjectLoaded;
+
+		std::atomic<uint32_t> m_NumObjectSources = 0;
+		std::atomic<uint32_t> m_NumCreatedObjectSources = 0;
+		std::atomic<bool> m_Done = false;
+		std::atomic<bool> m_Cancelled = false;
+
+		// Guards everything below
+		mutable MTR::Mutex m_Mutex;
+		RenderTask* m_Task = nullptr; // Only while the task is running
+		std::vector<SceneObject> m_LoadedObjects;
+		std::vector<SceneCamera> m_Cameras;
+		std::vector<SceneLight> m_Lights;
+		bool m_CamerasAndLightsTaken = false;
+	};
+
+	// Loads glTF or cooked scenes (see SceneCooking.h)
+	// For glTF scenes an up to date cooked scene next to it is used instead when available.
+	// Loading is done in phases:
+	//   1. Gather  : walks the node tree and collects object sources, primitives and used textures
+	//   2. Process : converts primitives and decodes textures in parallel on the JobPool
+	//   3. Create  : creates GPU resources for the objects in node tree order
+	// Command line settings:
+	//   -cookscenes     : cooks every loaded glTF scene next to the source file
+	//   -nocookedscenes : always loads glTF scenes from source
 	class Loader
 	{
+		friend class SceneLoadTask;
+
 	public:
-		Loader(GraphicsContext& context): 
-			m_Context(context)
+		Loader(GraphicsContext& context, const LoaderSettings& settings = {}):
+			m_Context(context),
+			m_Settings(settings)
 		{}
 
 		Scene Load(const std::string& path);
+		bool Cook(const std::string& scenePath, const std::string& cookedPath);
+
+		// Loads the scene on a RenderThreadPool thread with its own context, the loader context is not used.
+		// Uploads are submitted after every object so objects can be drawn while the rest of the scene is loading.
+		std::shared_ptr<AsyncSceneLoad> LoadAsync(const std::string& path, AsyncSceneLoad::ObjectLoadedCallback onObjectLoaded = {});
 
 	private:
+		Scene LoadGLTF(const std::string& path);
+		Scene LoadCooked(const std::string& path);
+		cgltf_data* ParseGLTF(const std::string& path);
+
+		// Async loads stop when cancelled or when their render thread shuts down
+		bool ShouldStop() const;
+
 		void FillNodeAnimationMap(cgltf_data* sceneData);
 
-		Scene LoadScene(cgltf_scene* scene);
-		void LoadNode(cgltf_node* nodeData);
+		struct PrimitiveWorkItem
+		{
+			cgltf_mesh* Mesh;
+			cgltf_primitive* Primitive;
+		};
+
+		void ReadScene(cgltf_scene* scene);
+		void ReadNode(cgltf_node* nodeData);
+		// Texture used by the scene being loaded, holds one cache reference until the loading is done
+		struct TextureWorkItem
+		{
+			std::string CanonicalPath;
+			TextureCooking::TextureUsage Usage = TextureCooking::TextureUsage::Albedo;
+			TextureCache::ContentHash ContentHash = 0;
+			TextureLoading::DecodedTexture Decoded;
+			TextureCooking::CookedTexture Cooked;	// Used instead of Decoded when compressing textures
+			Texture* CachedTexture = nullptr;
+		};
+
+		void ReadPrimitive(const PrimitiveWorkItem& workItem, SceneObjectSource& object);
+		void ReadTexture(TextureWorkItem& workItem);
+		void CookTexture(const std::vector<uint8_t>& fileData, TextureWorkItem& workItem);
+		// Returns false when an async load was cancelled before every work item was processed
+		bool ProcessWorkItems(const std::vector<SceneObjectSource>& objects, bool decodeTextures);
+		void ReleaseTextureWorkItems();
 		SceneCamera LoadCamera(cgltf_camera* cameraNode);
 		SceneLight LoadLight(cgltf_light* lightNode);
 
 		std::vector<AnimationEntry> LoadAnimations(cgltf_node* nodeData);
-		std::vector<MorphTarget> LoadMorph(cgltf_primitive* meshData, const std::vector<float>& weights);
 		std::vector<SkeletonJoint> LoadSkin(cgltf_skin* skinData);
-		MeshData LoadMesh(cgltf_primitive* meshData);
-		MaterialData LoadMaterial(cgltf_material* materialData);
-		Texture* LoadTexture(cgltf_texture* textureData, ColorUNORM defaultColor = {0.0f, 0.0f, 0.0f, 0.0f});
+		void ReadMesh(cgltf_primitive* meshData, SceneObjectSource& object);
+		void ReadMorph(cgltf_primitive* meshData, const std::vector<float>& weights, SceneObjectSource& object);
+		MaterialSource ReadMaterial(cgltf_material* materialData);
+
+		// Hands the objects to m_AsyncLoad after each source when loading asynchronously
+		void CreateSceneObjects(const std::vector<SceneObjectSource>& objectSources, std::vector<SceneObject>& objects);
+		// Can create more than one object when the mesh is split
+		void CreateObjects(const SceneObjectSource& object, std::vector<SceneObject>& objects);
+		MeshData CreateMesh(const MeshStreams& streams);
+		std::vector<MorphTarget> CreateMorph(const std::vector<MorphTargetSource>& morphTargets);
+		Buffer* CreateBlendedMorph(const MeshStreams& mesh, const std::vector<MorphTargetSource>& morphTargets);
+		MaterialData CreateMaterial(const MaterialSource& material);
+		Texture* LoadTexture(const std::string& textureURI, TextureCooking::TextureUsage usage, ColorUNORM defaultColor = {0.0f, 0.0f, 0.0f, 0.0f});
+
+		// Compressed textures are cooked per usage, the same image can be used as albedo in one material and as normal in another
+		std::string GetTextureWorkItemKey(const std::string& textureURI, TextureCooking::TextureUsage usage) const;
+		uint32_t GetTextureCacheMips(TextureCooking::TextureUsage usage) const;
 
 	private:
 		// Configurations
 		GraphicsContext& m_Context;
-		uint32_t m_TextureNumMips = 1;
+		LoaderSettings m_Settings;
+		AsyncSceneLoad* m_AsyncLoad = nullptr;
 
 		// Intermediate variables
 		Scene m_Scene;
+		std::vector<SceneObjectSource> m_ObjectSources;
+		std::vector<PrimitiveWorkItem> m_PrimitiveWorkItems; // Matches m_ObjectSources by index
+		std::unordered_map<std::string, TextureWorkItem> m_TextureWorkItems;
 		DirectX::XMFLOAT4X4 m_CurrentTransform;
 		std::string m_DirectoryPath;
 		std::unordered_map<cgltf_node*, std::vector<cgltf_animation_channel*>> m_NodeAnimationMap;
+
+		// Statistics
+		struct IndexStats
+		{
+			uint64_t Bytes = 0;
+			uint64_t UnpackedBytes = 0; // With 32 bit indices
+			uint32_t SplitMeshes = 0;
+			uint32_t MeshParts = 0;
+		};
+		IndexStats m_IndexStats;
 	};
 
 	void Free(GraphicsContext& context, SceneObject& sceneObject);
@@ -0,0 +1,404 @@
+#include "SceneCooking.h"
+
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+
+#include "Utility/MathUtility.h"
+#include "Utility/PathUtility.h"
+
+namespace SceneCooking
+{
+	using namespace ModelLoading;
+
+	class BinaryWriter
+	{
+	public:
+		template<typename T>
+		void Write(const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "BinaryWriter::Write supports only trivially copyable types");
+			WriteBytes(&value, sizeof(T));
+		}
+
+		template<typename T>
+		void WriteVector(const std::vector<T>& values)
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "BinaryWriter::WriteVector supports only trivially copyable types");
+			Write<uint64_t>(values.size());
+			WriteBytes(values.data(), values.size() * sizeof(T));
+		}
+
+		void WriteString(const std::string& value)
+		{
+			Write<uint64_t>(value.size());
+			WriteBytes(value.data(), value.size());
+		}
+
+		void WriteBytes(const void* data, size_t byteSize)
+		{
+			if (byteSize == 0) return;
+			const uint8_t* bytes = static_cast<const uint8_t*>(data);
+			m_Bytes.insert(m_Bytes.end(), bytes, bytes + byteSize);
+		}
+
+		void Align(uint64_t alignment)
+		{
+			m_Bytes.resize(MathUtility::Align<uint64_t>(m_Bytes.size(), alignment), 0);
+		}
+
+		uint64_t GetSize() const { return m_Bytes.size(); }
+		const std::vector<uint8_t>& GetBytes() const { return m_Bytes; }
+
+	private:
+		std::vector<uint8_t> m_Bytes;
+	};
+
+	class BinaryReader
+	{
+	public:
+		BinaryReader(const uint8_t* data, uint64_t byteSize):
+			m_Data(data),
+			m_ByteSize(byteSize)
+		{}
+
+		template<typename T>
+		T Read()
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "BinaryReader::Read supports only trivially copyable types");
+			T value{};
+			ReadBytes(&value, sizeof(T));
+			return value;
+		}
+
+		template<typename T>
+		std::vector<T> ReadVector()
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "BinaryReader::ReadVector supports only trivially copyable types");
+			const uint64_t count = Read<uint64_t>();
+			if (!CanRead(count * sizeof(T))) return {};
+
+			std::vector<T> values(count);
+			ReadBytes(values.data(), count * sizeof(T));
+			return values;
+		}
+
+		std::string ReadString()
+		{
+			const uint64_t length = Read<uint64_t>();
+			if (!CanRead(length)) return "";
+
+			std::string value(length, '\0');
+			ReadBytes(value.data(), length);
+			return value;
+		}
+
+		bool IsValid() const { return m_Valid; }
+
+	private:
+		bool CanRead(uint64_t byteSize)
+		{
+			m_Valid = m_Valid && m_Offset + byteSize <= m_ByteSize;
+			return m_Valid;
+		}
+
+		void ReadBytes(void* destination, uint64_t byteSize)
+		{
+			if (byteSize == 0 || !CanRead(byteSize)) return;
+			memcpy(destination, m_Data + m_Offset, byteSize);
+			m_Offset += byteSize;
+		}
+
+	private:
+		const uint8_t* m_Data;
+		uint64_t m_ByteSize;
+		uint64_t m_Offset = 0;
+		bool m_Valid = true;
+	};
+
+	static StreamRef WriteStream(BinaryWriter& data, const void* streamData, uint64_t byteSize)
+	{
+		if (!streamData || byteSize == 0) return StreamRef{};
+
+		data.Align(COOKED_SCENE_STREAM_ALIGNMENT);
+
+		StreamRef stream{};
+		stream.Offset = data.GetSize();
+		stream.ByteSize = byteSize;
+		data.WriteBytes(streamData, byteSize);
+		return stream;
+	}
+
+	template<typename T>
+	static const T* GetStream(const uint8_t* data, uint64_t dataSize, const StreamRef& stream, uint64_t numElements, bool& valid)
+	{
+		if (stream.ByteSize == 0) return nullptr;
+
+		const bool streamValid = stream.Offset + stream.ByteSize <= dataSize && stream.ByteSize == numElements * sizeof(T) && stream.Offset % alignof(T) == 0;
+		ASSERT(streamValid, "[SceneCooking] Invalid stream in cooked scene");
+		valid = valid && streamValid;
+		return streamValid ? reinterpret_cast<const T*>(data + stream.Offset) : nullptr;
+	}
+
+	static void WriteAnimations(BinaryWriter& metadata, const std::vector<AnimationEntry>& animations)
+	{
+		metadata.Write<uint64_t>(animations.size());
+		for (const AnimationEntry& entry : animations)
+		{
+			metadata.Write(entry.WeightTargetIndex);
+			metadata.Write(EnumToInt(entry.Target));
+			metadata.Write(EnumToInt(entry.Interpolation));
+			metadata.Write(entry.Duration);
+			metadata.WriteVector(entry.KeyFrames);
+			metadata.WriteVector(entry.InTangents);
+			metadata.WriteVector(entry.OutTangents);
+		}
+	}
+
+	static std::vector<AnimationEntry> ReadAnimations(BinaryReader& metadata)
+	{
+		const uint64_t animationCount = metadata.Read<uint64_t>();
+
+		std::vector<AnimationEntry> animations;
+		for (uint64_t i = 0; i < animationCount && metadata.IsValid(); i++)
+		{
+			AnimationEntry entry{};
+			entry.WeightTargetIndex = metadata.Read<uint32_t>();
+			entry.Target = IntToEnum<AnimTarget>(metadata.Read<uint32_t>());
+			entry.Interpolation = IntToEnum<AnimInterpolation>(metadata.Read<uint32_t>());
+			entry.Duration = metadata.Read<float>();
+			entry.KeyFrames = metadata.ReadVector<AnimKeyFrame>();
+			entry.InTangents = metadata.ReadVector<AnimKeyFrame>();
+			entry.OutTangents = metadata.ReadVector<AnimKeyFrame>();
+			animations.push_back(std::move(entry));
+		}
+		return animations;
+	}
+
+	static void WriteObject(BinaryWriter& metadata, BinaryWriter& data, const SceneObjectSource& object)
+	{
+		// Keep every object on its own pages so the streams of one object are touched together
+		data.Align(COOKED_SCENE_PAGE_SIZE);
+
+		metadata.Write(object.BoundingVolume);
+		metadata.Write(object.ModelToWorld);
+
+		const MaterialSource& material = object.Material;
+		metadata.Write(EnumToInt(material.MatType));
+		metadata.Write(material.AlbedoFactor);
+		metadata.Write(material.MetallicFactor);
+		metadata.Write(material.RoughnessFactor);
+		metadata.WriteString(material.AlbedoPath);
+		metadata.WriteString(material.NormalPath);
+		metadata.WriteString(material.MetallicRoughnessPath);
+
+		const MeshStreams& mesh = object.Mesh;
+		const uint64_t numVertices = mesh.NumVertices;
+		metadata.Write(mesh.NumVertices);
+		metadata.Write(mesh.NumIndices);
+		metadata.Write(WriteStream(data, mesh.Positions, numVertices * sizeof(Float3)));
+		metadata.Write(WriteStream(data, mesh.Texcoords, numVertices * sizeof(Float2)));
+		metadata.Write(WriteStream(data, mesh.Normals, numVertices * sizeof(Float3)));
+		metadata.Write(WriteStream(data, mesh.Tangents, numVertices * sizeof(Float4)));
+		metadata.Write(WriteStream(data, mesh.Weights, numVertices * sizeof(Float4)));
+		metadata.Write(WriteStream(data, mesh.Joints, numVertices * sizeof(uint32_t) * 4));
+		metadata.Write(WriteStream(data, mesh.Indices, mesh.NumIndices * sizeof(uint32_t)));
+
+		metadata.Write<uint64_t>(object.MorphTargets.size());
+		for (const MorphTargetSource& morphTarget : object.MorphTargets)
+		{
+			metadata.Write(morphTarget.Weight);
+			metadata.Write(morphTarget.NumDeltas);
+			metadata.Write(WriteStream(data, morphTarget.Deltas, morphTarget.NumDeltas * sizeof(MorphDelta)));
+		}
+
+		WriteAnimations(metadata, object.Animations);
+
+		metadata.Write<uint64_t>(object.Skeleton.size());
+		for (const SkeletonJoint& joint : object.Skeleton)
+		{
+			metadata.Write(joint.ParentIndex);
+			metadata.Write(joint.ParentTransform);
+			metadata.Write(joint.ModelToJoint);
+			metadata.Write(joint.RestTranslation);
+			metadata.Write(joint.RestRotation);
+			metadata.Write(joint.RestScale);
+			WriteAnimations(metadata, joint.Animations);
+		}
+	}
+
+	static bool ReadObject(BinaryReader& metadata, const uint8_t* data, uint64_t dataSize, SceneObjectSource& object)
+	{
+		object.BoundingVolume = metadata.Read<BoundingSphere>();
+		object.ModelToWorld = metadata.Read<DirectX::XMFLOAT4X4>();
+
+		MaterialSource& material = object.Material;
+		material.MatType = IntToEnum<MaterialData::MaterialType>(metadata.Read<uint32_t>());
+		material.AlbedoFactor = metadata.Read<Float3>();
+		material.MetallicFactor = metadata.Read<float>();
+		material.RoughnessFactor = metadata.Read<float>();
+		material.AlbedoPath = metadata.ReadString();
+		material.NormalPath = metadata.ReadString();
+		material.MetallicRoughnessPath = metadata.ReadString();
+
+		bool valid = true;
+
+		MeshStreams& mesh = object.Mesh;
+		mesh.NumVertices = metadata.Read<uint32_t>();
+		mesh.NumIndices = metadata.Read<uint32_t>();
+		mesh.Positions = GetStream<Float3>(data, dataSize, metadata.Read<StreamRef>(), mesh.NumVertices, valid);
+		mesh.Texcoords = GetStream<Float2>(data, dataSize, metadata.Read<StreamRef>(), mesh.NumVertices, valid);
+		mesh.Normals = GetStream<Float3>(data, dataSize, metadata.Read<StreamRef>(), mesh.NumVertices, valid);
+		mesh.Tangents = GetStream<Float4>(data, dataSize, metadata.Read<StreamRef>(), mesh.NumVertices, valid);
+		mesh.Weights = GetStream<Float4>(data, dataSize, metadata.Read<StreamRef>(), mesh.NumVertices, valid);
+		mesh.Joints = GetStream<uint32_t>(data, dataSize, metadata.Read<StreamRef>(), mesh.NumVertices * 4ull, valid);
+		mesh.Indices = GetStream<uint32_t>(data, dataSize, metadata.Read<StreamRef>(), mesh.NumIndices, valid);
+
+		const uint64_t morphTargetCount = metadata.Read<uint64_t>();
+		for (uint64_t i = 0; i < morphTargetCount && metadata.IsValid(); i++)
+		{
+			MorphTargetSource morphTarget{};
+			morphTarget.Weight = metadata.Read<float>();
+			morphTarget.NumDeltas = metadata.Read<uint32_t>();
+			morphTarget.Deltas = GetStream<MorphDelta>(data, dataSize, metadata.Read<StreamRef>(), morphTarget.NumDeltas, valid);
+			object.MorphTargets.push_back(morphTarget);
+		}
+
+		object.Animations = ReadAnimations(metadata);
+
+		const uint64_t jointCount = metadata.Read<uint64_t>();
+		for (uint64_t i = 0; i < jointCount && metadata.IsValid(); i++)
+		{
+			SkeletonJoint joint{};
+			joint.ParentIndex = metadata.Read<uint32_t>();
+			joint.ParentTransform = metadata.Read<DirectX::XMFLOAT4X4>();
+			joint.ModelToJoint = metadata.Read<DirectX::XMFLOAT4X4>();
+			joint.RestTranslation = metadata.Read<Float3>();
+			joint.RestRotation = metadata.Read<Quaternion>();
+			joint.RestScale = metadata.Read<Float3>();
+			joint.Animations = ReadAnimations(metadata);
+			object.Skeleton.push_back(std::move(joint));
+		}
+
+		return valid && metadata.IsValid();
+	}
+
+	static bool ReadHeader(const std::string& path, FileHeader& header)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open()) return false;
+
+		file.read(reinterpret_cast<char*>(&header), sizeof(FileHeader));
+		return file.gcount() == sizeof(FileHeader);
+	}
+
+	static bool IsHeaderValid(const FileHeader& header, uint64_t fileSize)
+	{
+		return header.Magic == COOKED_SCENE_MAGIC &&
+			header.Version == COOKED_SCENE_VERSION &&
+			header.MetadataOffset + header.MetadataSize <= fileSize &&
+			header.DataOffset % COOKED_SCENE_PAGE_SIZE == 0 &&
+			header.DataOffset + header.DataSize <= fileSize;
+	}
+
+	std::string GetCookedPath(const std::string& scenePath)
+	{
+		const std::string ext = PathUtility::GetFileExtension(scenePath);
+		return scenePath.substr(0, scenePath.length() - ext.length()) + COOKED_SCENE_EXTENSION;
+	}
+
+	bool IsCookedSceneUpToDate(const std::string& cookedPath, const std::string& scenePath)
+	{
+		std::error_code error;
+		if (!std::filesystem::exists(cookedPath, error)) return false;
+
+		const auto cookedTime = std::filesystem::last_write_time(cookedPath, error);
+		if (error) return false;
+
+		const auto sceneTime = std::filesystem::last_write_time(scenePath, error);
+		if (error || cookedTime < sceneTime) return false;
+
+		const uint64_t fileSize = std::filesystem::file_size(cookedPath, error);
+		if (error) return false;
+
+		FileHeader header{};
+		return ReadHeader(cookedPath, header) && IsHeaderValid(header, fileSize);
+	}
+
+	bool WriteScene(const std::string& path, const std::vector<SceneCamera>& cameras, const std::vector<SceneLight>& lights, const std::vector<SceneObjectSource>& objects)
+	{
+		BinaryWriter metadata;
+		BinaryWriter data;
+
+		metadata.WriteVector(cameras);
+		metadata.WriteVector(lights);
+		metadata.Write<uint64_t>(objects.size());
+		for (const SceneObjectSource& object : objects)
+		{
+			WriteObject(metadata, data, object);
+		}
+
+		FileHeader header{};
+		header.MetadataOffset = sizeof(FileHeader);
+		header.MetadataSize = metadata.GetSize();
+		header.DataOffset = MathUtility::Align<uint64_t>(header.MetadataOffset + header.MetadataSize, COOKED_SCENE_PAGE_SIZE);
+		header.DataSize = data.GetSize();
+
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) return false;
+
+		const std::vector<char> padding(header.DataOffset - header.MetadataOffset - header.MetadataSize, 0);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+		file.write(reinterpret_cast<const char*>(metadata.GetBytes().data()), metadata.GetSize());
+		file.write(padding.data(), padding.size());
+		file.write(reinterpret_cast<const char*>(data.GetBytes().data()), data.GetSize());
+
+		return file.good();
+	}
+
+	bool SceneReader::Open(const std::string& path)
+	{
+		Close();
+
+		if (!m_File.Open(path)) return false;
+
+		FileHeader header{};
+		if (m_File.GetSize() < sizeof(FileHeader)) return false;
+		memcpy(&header, m_File.GetData(), sizeof(FileHeader));
+
+		if (!IsHeaderValid(header, m_File.GetSize()))
+		{
+			ASSERT(0, "[SceneCooking] Cooked scene " << path << " is invalid or has an old version");
+			Close();
+			return false;
+		}
+
+		const uint8_t* data = m_File.GetData() + header.DataOffset;
+		BinaryReader metadata{ m_File.GetData() + header.MetadataOffset, header.MetadataSize };
+
+		m_Cameras = metadata.ReadVector<SceneCamera>();
+		m_Lights = metadata.ReadVector<SceneLight>();
+
+		const uint64_t objectCount = metadata.Read<uint64_t>();
+		m_Objects.resize(metadata.IsValid() ? objectCount : 0);
+		for (SceneObjectSource& object : m_Objects)
+		{
+			if (!ReadObject(metadata, data, header.DataSize, object))
+			{
+				ASSERT(0, "[SceneCooking] Failed to read objects from " << path);
+				Close();
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void SceneReader::Close()
+	{
+		m_Cameras.clear();
+		m_Lights.clear();
+		m_Objects.clear();
+		m_File.Close();
+	}
+}
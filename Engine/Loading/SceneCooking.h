@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+
+#include "Common.h"
+#include "Loading/ModelLoading.h"
+#include "System/MappedFile.h"
+
+// Cooked scene is a binary snapshot of a loaded glTF scene that is mapped and uploaded without any parsing or conversion.
+// File layout:
+//   FileHeader
+//   Metadata : cameras, lights and objects (materials, animations, skeletons and stream references)
+//   Data     : vertex, index and morph streams, every object starts on a new page
+namespace SceneCooking
+{
+	static constexpr uint32_t COOKED_SCENE_MAGIC = 0x4E435347; // GSCN
+	static constexpr uint32_t COOKED_SCENE_VERSION = 4;
+	static constexpr uint64_t COOKED_SCENE_PAGE_SIZE = 4096;
+	static constexpr uint64_t COOKED_SCENE_STREAM_ALIGNMENT = 16;
+	static constexpr const char* COOKED_SCENE_EXTENSION = "cscene";
+
+	struct FileHeader
+	{
+		uint32_t Magic = COOKED_SCENE_MAGIC;
+		uint32_t Version = COOKED_SCENE_VERSION;
+		uint64_t MetadataOffset = 0;
+		uint64_t MetadataSize = 0;
+		uint64_t DataOffset = 0;
+		uint64_t DataSize = 0;
+	};
+
+	// Relative to the start of the data section
+	struct StreamRef
+	{
+		uint64_t Offset = 0;
+		uint64_t ByteSize = 0;
+	};
+
+	std::string GetCookedPath(const std::string& scenePath);
+	bool IsCookedSceneUpToDate(const std::string& cookedPath, const std::string& scenePath);
+
+	bool WriteScene(const std::string& path, const std::vector<ModelLoading::SceneCamera>& cameras, const std::vector<ModelLoading::SceneLight>& lights, const std::vector<ModelLoading::SceneObjectSource>& objects);
+
+	// Object streams point directly into the mapped file and are valid until the reader is closed
+	class SceneReader
+	{
+	public:
+		bool Open(const std::string& path);
+		void Close();
+
+		const std::vector<ModelLoading::SceneCamera>& GetCameras() const { return m_Cameras; }
+		const std::vector<ModelLoading::SceneLight>& GetLights() const { return m_Lights; }
+		const std::vector<ModelLoading::SceneObjectSource>& GetObjects() const { return m_Objects; }
+
+	private:
+		MappedFile m_File;
+
+		std::vector<ModelLoading::SceneCamera> m_Cameras;
+		std::vector<ModelLoading::SceneLight> m_Lights;
+		std::vector<ModelLoading::SceneObjectSource> m_Objects;
+	};
+}
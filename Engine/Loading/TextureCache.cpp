@@ -0,0 +1,169 @@
+#include "TextureCache.h"
+
+#include <filesystem>
+
+#include "Render/Commands.h"
+#include "Render/Texture.h"
+#include "Utility/Hash.h"
+
+TextureCache* TextureCache::s_Instance = nullptr;
+
+TextureCache::~TextureCache()
+{
+	// Whatever is still referenced here was leaked by its owner, context is already flushed at this point
+	if (!m_Entries.empty())
+	{
+		std::cout << "[TextureCache] " << m_Entries.size() << " textures are still referenced on shutdown" << std::endl;
+	}
+
+	for (auto& [texture, entry] : m_Entries)
+	{
+		delete texture;
+	}
+}
+
+std::string TextureCache::GetCanonicalPath(const std::string& path)
+{
+	std::error_code error;
+	const std::filesystem::path canonicalPath = std::filesystem::weakly_canonical(path, error);
+	return error ? path : canonicalPath.string();
+}
+
+TextureCache::ContentHash TextureCache::HashContent(const void* data, size_t byteSize)
+{
+	return Hash::Hash64(data, byteSize);
+}
+
+std::string TextureCache::GetPathKey(const std::string& canonicalPath, uint32_t numMips)
+{
+	return canonicalPath + "#" + std::to_string(numMips);
+}
+
+template<typename LookupMap, typename Key>
+Texture* TextureCache::FindAndAddReference(const LookupMap& lookup, const Key& key)
+{
+	const auto it = lookup.find(key);
+	if (it == lookup.end()) return nullptr;
+
+	m_Entries[it->second].RefCount++;
+	return it->second;
+}
+
+Texture* TextureCache::FindByPath(const std::string& canonicalPath, uint32_t numMips)
+{
+	m_Mutex.Lock();
+	Texture* texture = FindAndAddReference(m_PathLookup, GetPathKey(canonicalPath, numMips));
+	m_Mutex.Unlock();
+	return texture;
+}
+
+Texture* TextureCache::FindByContent(ContentHash contentHash, uint32_t numMips)
+{
+	m_Mutex.Lock();
+	Texture* texture = FindAndAddReference(m_ContentLookup, ContentKey{ contentHash, numMips });
+	m_Mutex.Unlock();
+	return texture;
+}
+
+void TextureCache::Add(const std::string& canonicalPath, ContentHash contentHash, uint32_t numMips, Texture* texture)
+{
+	m_Mutex.Lock();
+
+	ASSERT(!m_Entries.contains(texture), "[TextureCache] Texture is already cached");
+
+	const std::string pathKey = GetPathKey(canonicalPath, numMips);
+	const ContentKey contentKey{ contentHash, numMips };
+
+	CacheEntry& entry = m_Entries[texture];
+	entry.RefCount = 1;
+
+	// Older entries stay reachable through their other keys until they are released
+	if (!m_PathLookup.contains(pathKey))
+	{
+		m_PathLookup[pathKey] = texture;
+		entry.PathKeys.push_back(pathKey);
+	}
+
+	if (!m_ContentLookup.contains(contentKey))
+	{
+		m_ContentLookup[contentKey] = texture;
+		entry.ContentKeys.push_back(contentKey);
+	}
+
+	m_Mutex.Unlock();
+}
+
+void TextureCache::AddPath(const std::string& canonicalPath, uint32_t numMips, Texture* texture)
+{
+	m_Mutex.Lock();
+
+	ASSERT(m_Entries.contains(texture), "[TextureCache] Adding path to the texture that is not cached");
+
+	const std::string pathKey = GetPathKey(canonicalPath, numMips);
+	if (m_Entries.contains(texture) && !m_PathLookup.contains(pathKey))
+	{
+		m_PathLookup[pathKey] = texture;
+		m_Entries[texture].PathKeys.push_back(pathKey);
+	}
+
+	m_Mutex.Unlock();
+}
+
+Texture* TextureCache::GetDefaultTexture(GraphicsContext& context, ColorUNORM color)
+{
+	const uint32_t colorKey = color.r | (color.g << 8) | (color.b << 16) | (color.a << 24);
+
+	m_Mutex.Lock();
+
+	Texture* texture = FindAndAddReference(m_DefaultLookup, colorKey);
+	if (!texture)
+	{
+		ResourceInitData initData = { &context, &color };
+		texture = GFX::CreateTexture(1, 1, RCF::None, 1, DXGI_FORMAT_R8G8B8A8_UNORM, &initData);
+
+		CacheEntry& entry = m_Entries[texture];
+		entry.RefCount = 1;
+		entry.DefaultKeys.push_back(colorKey);
+		m_DefaultLookup[colorKey] = texture;
+	}
+
+	m_Mutex.Unlock();
+
+	return texture;
+}
+
+void TextureCache::AddReference(Texture* texture)
+{
+	m_Mutex.Lock();
+	ASSERT(m_Entries.contains(texture), "[TextureCache] Adding reference to the texture that is not cached");
+	m_Entries[texture].RefCount++;
+	m_Mutex.Unlock();
+}
+
+bool TextureCache::Release(GraphicsContext& context, Texture* texture)
+{
+	m_Mutex.Lock();
+
+	const auto it = m_Entries.find(texture);
+	if (it == m_Entries.end())
+	{
+		m_Mutex.Unlock();
+		return false;
+	}
+
+	CacheEntry& entry = it->second;
+	ASSERT(entry.RefCount > 0, "[TextureCache] Releasing texture with no references");
+	if (--entry.RefCount == 0)
+	{
+		for (const std::string& pathKey : entry.PathKeys) m_PathLookup.erase(pathKey);
+		for (const ContentKey& contentKey : entry.ContentKeys) m_ContentLookup.erase(contentKey);
+		for (uint32_t defaultKey : entry.DefaultKeys) m_DefaultLookup.erase(defaultKey);
+		m_Entries.erase(it);
+
+		GFX::Cmd::Delete(context, texture);
+	}
+
+	m_Mutex.Unlock();
+
+	return true;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <unordered_map>
+
+#include "Common.h"
+#include "Utility/Multithreading.h"
+
+struct Texture;
+struct GraphicsContext;
+
+// Reference counted textures shared by everything loaded during the app lifetime.
+// File textures are keyed by canonical path and by content hash, so the same image behind different paths is decoded and uploaded once.
+// Default color textures are interned by their color.
+class TextureCache
+{
+public:
+	static void Init() { s_Instance = new TextureCache(); }
+	static TextureCache* Get() { return s_Instance; }
+	static void Destroy() { SAFE_DELETE(s_Instance); }
+
+private:
+	static TextureCache* s_Instance;
+
+	TextureCache() = default;
+	~TextureCache();
+
+public:
+	using ContentHash = uint64_t;
+
+	// Textures that aren't created from decoded images are keyed by these instead of the mip count, so they never share entries with decoded ones
+	static constexpr uint32_t STREAMED_MIPS = 0;
+	static constexpr uint32_t COOKED_MIPS = 0x80000000; // Usage of the cooked texture is added to it
+
+	static std::string GetCanonicalPath(const std::string& path);
+	static ContentHash HashContent(const void* data, size_t byteSize);
+
+	// Find functions add a reference to the returned texture, nullptr means it isn't cached
+	Texture* FindByPath(const std::string& canonicalPath, uint32_t numMips);
+	Texture* FindByContent(ContentHash contentHash, uint32_t numMips);
+
+	// Takes ownership of the texture with one reference
+	void Add(const std::string& canonicalPath, ContentHash contentHash, uint32_t numMips, Texture* texture);
+
+	// Makes cached texture reachable through another path
+	void AddPath(const std::string& canonicalPath, uint32_t numMips, Texture* texture);
+
+	Texture* GetDefaultTexture(GraphicsContext& context, ColorUNORM color);
+
+	void AddReference(Texture* texture);
+
+	// Deletes the texture when the last reference is released, returns false if the texture isn't owned by the cache
+	bool Release(GraphicsContext& context, Texture* texture);
+
+private:
+	struct ContentKey
+	{
+		ContentHash Hash = 0;
+		uint32_t NumMips = 1;
+
+		bool operator==(const ContentKey& other) const = default;
+	};
+
+	struct ContentKeyHasher
+	{
+		size_t operator()(const ContentKey& key) const { return std::hash<uint64_t>{}(key.Hash ^ (static_cast<uint64_t>(key.NumMips) << 56)); }
+	};
+
+	struct CacheEntry
+	{
+		uint32_t RefCount = 0;
+		std::vector<std::string> PathKeys;
+		std::vector<ContentKey> ContentKeys;
+		std::vector<uint32_t> DefaultKeys;
+	};
+
+	static std::string GetPathKey(const std::string& canonicalPath, uint32_t numMips);
+
+	template<typename LookupMap, typename Key>
+	Texture* FindAndAddReference(const LookupMap& lookup, const Key& key);
+
+private:
+	MTR::Mutex m_Mutex;
+
+	std::unordered_map<Texture*, CacheEntry> m_Entries;
+	std::unordered_map<std::string, Texture*> m_PathLookup;
+	std::unordered_map<ContentKey, Texture*, ContentKeyHasher> m_ContentLookup;
+	std::unordered_map<uint32_t, Texture*> m_DefaultLookup;
+};
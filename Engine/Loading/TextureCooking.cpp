@@ -0,0 +1,485 @@
+#include "TextureCooking.h"
+
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <DirectXPackedVector.h>
+
+#define STB_DXT_IMPLEMENTATION
+#include <stb/stb_dxt.h>
+
+#include "Loading/TextureLoading.h"
+#include "System/JobPool.h"
+#include "Utility/Timer.h"
+
+namespace TextureCooking
+{
+	using namespace DirectX;
+
+	static constexpr uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+	static constexpr uint32_t DDS_FOURCC_DX10 = 0x30315844; // "DX10"
+
+	static constexpr uint32_t DDSD_CAPS = 0x1;
+	static constexpr uint32_t DDSD_HEIGHT = 0x2;
+	static constexpr uint32_t DDSD_WIDTH = 0x4;
+	static constexpr uint32_t DDSD_PITCH = 0x8;
+	static constexpr uint32_t DDSD_PIXELFORMAT = 0x1000;
+	static constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+	static constexpr uint32_t DDSD_LINEARSIZE = 0x80000;
+	static constexpr uint32_t DDPF_FOURCC = 0x4;
+	static constexpr uint32_t DDSCAPS_COMPLEX = 0x8;
+	static constexpr uint32_t DDSCAPS_TEXTURE = 0x1000;
+	static constexpr uint32_t DDSCAPS_MIPMAP = 0x400000;
+	static constexpr uint32_t DDSCAPS2_CUBEMAP_ALLFACES = 0xFE00;
+	static constexpr uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+	static constexpr uint32_t DDS_MISC_TEXTURECUBE = 0x4;
+
+	struct DDSPixelFormat
+	{
+		uint32_t Size = sizeof(DDSPixelFormat);
+		uint32_t Flags = DDPF_FOURCC;
+		uint32_t FourCC = DDS_FOURCC_DX10;
+		uint32_t RGBBitCount = 0;
+		uint32_t RBitMask = 0;
+		uint32_t GBitMask = 0;
+		uint32_t BBitMask = 0;
+		uint32_t ABitMask = 0;
+	};
+
+	struct DDSHeader
+	{
+		uint32_t Size = sizeof(DDSHeader);
+		uint32_t Flags = 0;
+		uint32_t Height = 0;
+		uint32_t Width = 0;
+		uint32_t PitchOrLinearSize = 0;
+		uint32_t Depth = 0;
+		uint32_t MipMapCount = 0;
+		uint32_t Reserved1[11] = {};
+		DDSPixelFormat PixelFormat;
+		uint32_t Caps = 0;
+		uint32_t Caps2 = 0;
+		uint32_t Caps3 = 0;
+		uint32_t Caps4 = 0;
+		uint32_t Reserved2 = 0;
+	};
+
+	struct DDSHeaderDX10
+	{
+		DXGI_FORMAT Format = DXGI_FORMAT_UNKNOWN;
+		uint32_t ResourceDimension = DDS_DIMENSION_TEXTURE2D;
+		uint32_t MiscFlag = 0;
+		uint32_t ArraySize = 1;
+		uint32_t MiscFlags2 = 0;
+	};
+
+	static_assert(sizeof(DDSHeader) == 124 && sizeof(DDSHeaderDX10) == 20, "DDS headers don't match the file format");
+
+	// Linear space texels of one mip
+	struct FloatImage
+	{
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		std::vector<XMFLOAT4> Texels;
+
+		const XMFLOAT4& Get(uint32_t x, uint32_t y) const { return Texels[MIN(y, Height - 1) * Width + MIN(x, Width - 1)]; }
+	};
+
+	static uint32_t GetBlockByteSize(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC4_UNORM:
+			return 8;
+		default:
+			return 16;
+		}
+	}
+
+	static uint32_t GetTexelByteSize(DXGI_FORMAT format)
+	{
+		return format == DXGI_FORMAT_R16G16B16A16_FLOAT ? 8 : 4;
+	}
+
+	bool IsBlockCompressed(DXGI_FORMAT format)
+	{
+		return format >= DXGI_FORMAT_BC1_TYPELESS && format <= DXGI_FORMAT_BC5_SNORM || format >= DXGI_FORMAT_BC6H_TYPELESS && format <= DXGI_FORMAT_BC7_UNORM_SRGB;
+	}
+
+	uint64_t GetMipByteSize(DXGI_FORMAT format, uint32_t width, uint32_t height, uint32_t mipIndex)
+	{
+		const uint64_t mipWidth = MAX(width >> mipIndex, 1u);
+		const uint64_t mipHeight = MAX(height >> mipIndex, 1u);
+		if (IsBlockCompressed(format)) return ((mipWidth + 3) / 4) * ((mipHeight + 3) / 4) * GetBlockByteSize(format);
+		return mipWidth * mipHeight * GetTexelByteSize(format);
+	}
+
+	static DXGI_FORMAT GetFormat(const Settings& settings, uint32_t width, uint32_t height, bool hasAlpha)
+	{
+		if (settings.Usage == TextureUsage::HDR) return DXGI_FORMAT_R16G16B16A16_FLOAT;
+		if (width % 4 != 0 || height % 4 != 0) return DXGI_FORMAT_R8G8B8A8_UNORM;
+
+		switch (settings.Usage)
+		{
+		case TextureUsage::Albedo: return hasAlpha ? DXGI_FORMAT_BC3_UNORM : DXGI_FORMAT_BC1_UNORM;
+		case TextureUsage::Normal: return DXGI_FORMAT_BC5_UNORM;
+		case TextureUsage::MetallicRoughness: return DXGI_FORMAT_BC1_UNORM;
+		default: NOT_IMPLEMENTED;
+		}
+		return DXGI_FORMAT_R8G8B8A8_UNORM;
+	}
+
+	static XMVECTOR DecodeTexel(const uint8_t* texel, TextureUsage usage)
+	{
+		const XMVECTOR value = XMVectorScale(XMVectorSet(texel[0], texel[1], texel[2], texel[3]), 1.0f / 255.0f);
+		switch (usage)
+		{
+		case TextureUsage::Albedo: return XMColorSRGBToRGB(value);
+		case TextureUsage::Normal: return XMVectorSetW(XMVectorMultiplyAdd(value, XMVectorReplicate(2.0f), XMVectorReplicate(-1.0f)), 1.0f);
+		default: return value;
+		}
+	}
+
+	static void EncodeTexel(FXMVECTOR value, TextureUsage usage, uint8_t* texel)
+	{
+		XMVECTOR encoded = value;
+		if (usage == TextureUsage::Albedo) encoded = XMColorRGBToSRGB(value);
+		else if (usage == TextureUsage::Normal) encoded = XMVectorMultiplyAdd(value, XMVectorReplicate(0.5f), XMVectorReplicate(0.5f));
+
+		encoded = XMVectorRound(XMVectorScale(XMVectorSaturate(encoded), 255.0f));
+		XMFLOAT4 bytes;
+		XMStoreFloat4(&bytes, encoded);
+		texel[0] = (uint8_t) bytes.x;
+		texel[1] = (uint8_t) bytes.y;
+		texel[2] = (uint8_t) bytes.z;
+		texel[3] = (uint8_t) bytes.w;
+	}
+
+	// 2x2 box filter in linear space, odd sizes clamp to the last row and column
+	static FloatImage Downsample(const FloatImage& source, TextureUsage usage)
+	{
+		FloatImage mip{};
+		mip.Width = MAX(source.Width >> 1, 1u);
+		mip.Height = MAX(source.Height >> 1, 1u);
+		mip.Texels.resize((size_t) mip.Width * mip.Height);
+
+		JobPool::Get()->ParallelFor(mip.Height, [&](uint32_t y)
+		{
+			for (uint32_t x = 0; x < mip.Width; x++)
+			{
+				XMVECTOR sum = XMLoadFloat4(&source.Get(2 * x, 2 * y));
+				sum = XMVectorAdd(sum, XMLoadFloat4(&source.Get(2 * x + 1, 2 * y)));
+				sum = XMVectorAdd(sum, XMLoadFloat4(&source.Get(2 * x, 2 * y + 1)));
+				sum = XMVectorAdd(sum, XMLoadFloat4(&source.Get(2 * x + 1, 2 * y + 1)));
+
+				XMVECTOR average = XMVectorScale(sum, 0.25f);
+				if (usage == TextureUsage::Normal) average = XMVectorSetW(XMVector3Normalize(average), 1.0f);
+				XMStoreFloat4(&mip.Texels[(size_t) y * mip.Width + x], average);
+			}
+		});
+
+		return mip;
+	}
+
+	static void EncodeBlock(const uint8_t* texels, DXGI_FORMAT format, int mode, uint8_t* block)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_BC1_UNORM:
+			stb_compress_dxt_block(block, texels, 0, mode);
+			break;
+		case DXGI_FORMAT_BC3_UNORM:
+			stb_compress_dxt_block(block, texels, 1, mode);
+			break;
+		case DXGI_FORMAT_BC5_UNORM:
+		{
+			uint8_t rg[32];
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				rg[2 * i] = texels[4 * i];
+				rg[2 * i + 1] = texels[4 * i + 1];
+			}
+			stb_compress_bc5_block(block, rg);
+			break;
+		}
+		default:
+			NOT_IMPLEMENTED;
+		}
+	}
+
+	// Appends the mip in its final format, rows of blocks are encoded in parallel
+	static void EncodeMip(const FloatImage& mip, DXGI_FORMAT format, const Settings& settings, std::vector<uint8_t>& data)
+	{
+		const size_t offset = data.size();
+		data.resize(offset + GetMipByteSize(format, mip.Width, mip.Height, 0));
+		uint8_t* destination = data.data() + offset;
+
+		if (format == DXGI_FORMAT_R16G16B16A16_FLOAT)
+		{
+			PackedVector::XMHALF4* halfTexels = reinterpret_cast<PackedVector::XMHALF4*>(destination);
+			JobPool::Get()->ParallelFor(mip.Height, [&](uint32_t y)
+			{
+				for (uint32_t x = 0; x < mip.Width; x++)
+				{
+					const size_t index = (size_t) y * mip.Width + x;
+					PackedVector::XMStoreHalf4(&halfTexels[index], XMLoadFloat4(&mip.Texels[index]));
+				}
+			});
+			return;
+		}
+
+		if (!IsBlockCompressed(format))
+		{
+			JobPool::Get()->ParallelFor(mip.Height, [&](uint32_t y)
+			{
+				for (uint32_t x = 0; x < mip.Width; x++)
+				{
+					const size_t index = (size_t) y * mip.Width + x;
+					EncodeTexel(XMLoadFloat4(&mip.Texels[index]), settings.Usage, destination + index * 4);
+				}
+			});
+			return;
+		}
+
+		const uint32_t blockByteSize = GetBlockByteSize(format);
+		const uint32_t numBlocksX = (mip.Width + 3) / 4;
+		const uint32_t numBlocksY = (mip.Height + 3) / 4;
+		const int mode = settings.HighQuality ? STB_DXT_HIGHQUAL : STB_DXT_NORMAL;
+		JobPool::Get()->ParallelFor(numBlocksY, [&](uint32_t blockY)
+		{
+			uint8_t texels[16 * 4];
+			for (uint32_t blockX = 0; blockX < numBlocksX; blockX++)
+			{
+				// Blocks of mips smaller than 4x4 repeat the edge texels
+				for (uint32_t i = 0; i < 16; i++)
+					EncodeTexel(XMLoadFloat4(&mip.Get(blockX * 4 + i % 4, blockY * 4 + i / 4)), settings.Usage, texels + i * 4);
+
+				EncodeBlock(texels, format, mode, destination + ((size_t) blockY * numBlocksX + blockX) * blockByteSize);
+			}
+		});
+	}
+
+	static FloatImage ReadFace(const void* pixels, uint32_t width, uint32_t faceHeight, uint32_t faceIndex, TextureUsage usage)
+	{
+		FloatImage face{};
+		face.Width = width;
+		face.Height = faceHeight;
+		face.Texels.resize((size_t) width * faceHeight);
+
+		const size_t faceOffset = (size_t) faceIndex * width * faceHeight;
+		JobPool::Get()->ParallelFor(faceHeight, [&](uint32_t y)
+		{
+			for (uint32_t x = 0; x < width; x++)
+			{
+				const size_t index = (size_t) y * width + x;
+				if (usage == TextureUsage::HDR)
+					face.Texels[index] = static_cast<const XMFLOAT4*>(pixels)[faceOffset + index];
+				else
+					XMStoreFloat4(&face.Texels[index], DecodeTexel(static_cast<const uint8_t*>(pixels) + (faceOffset + index) * 4, usage));
+			}
+		});
+
+		return face;
+	}
+
+	CookedTexture CookImage(const void* pixels, uint32_t width, uint32_t height, const Settings& settings, CookStats* stats)
+	{
+		PROFILE_SECTION_CPU("TextureCooking::CookImage");
+
+		// Encoder builds its lookup tables on the first block, that isn't thread safe
+		static std::once_flag encoderInit;
+		std::call_once(encoderInit, []()
+		{
+			uint8_t texels[16 * 4] = {};
+			uint8_t block[16];
+			stb_compress_dxt_block(block, texels, 1, STB_DXT_NORMAL);
+		});
+
+		bool hasAlpha = false;
+		if (settings.Usage == TextureUsage::Albedo)
+		{
+			const uint8_t* bytes = static_cast<const uint8_t*>(pixels);
+			for (size_t i = 0; i < (size_t) width * height && !hasAlpha; i++) hasAlpha = bytes[i * 4 + 3] != 255;
+		}
+
+		const uint32_t numFaces = settings.Cubemap ? 6 : 1;
+		const uint32_t faceHeight = height / numFaces;
+
+		CookedTexture texture{};
+		texture.Format = GetFormat(settings, width, faceHeight, hasAlpha);
+		texture.Width = width;
+		texture.Height = faceHeight;
+		texture.ArraySize = numFaces;
+		texture.NumMips = settings.GenerateMips ? TextureLoading::GetNumMips(width, faceHeight) : 1;
+		texture.Cubemap = settings.Cubemap;
+
+		uint64_t dataSize = 0;
+		for (uint32_t mipIndex = 0; mipIndex < texture.NumMips; mipIndex++) dataSize += GetMipByteSize(texture.Format, width, faceHeight, mipIndex);
+		texture.Data.reserve(dataSize * numFaces);
+
+		Timer filterTimer;
+		Timer encodeTimer;
+		float filterTimeMS = 0.0f;
+		float encodeTimeMS = 0.0f;
+		uint64_t numTexels = 0;
+		for (uint32_t faceIndex = 0; faceIndex < numFaces; faceIndex++)
+		{
+			filterTimer.Start();
+			FloatImage mip = ReadFace(pixels, width, faceHeight, faceIndex, settings.Usage);
+			filterTimer.Stop();
+			filterTimeMS += filterTimer.GetTimeMS();
+
+			for (uint32_t mipIndex = 0; mipIndex < texture.NumMips; mipIndex++)
+			{
+				if (mipIndex > 0)
+				{
+					filterTimer.Start();
+					mip = Downsample(mip, settings.Usage);
+					filterTimer.Stop();
+					filterTimeMS += filterTimer.GetTimeMS();
+				}
+
+				encodeTimer.Start();
+				EncodeMip(mip, texture.Format, settings, texture.Data);
+				encodeTimer.Stop();
+				encodeTimeMS += encodeTimer.GetTimeMS();
+
+				numTexels += mip.Texels.size();
+			}
+		}
+
+		if (stats)
+		{
+			stats->NumTexels = numTexels;
+			stats->FilterTimeMS = filterTimeMS;
+			stats->EncodeTimeMS = encodeTimeMS;
+		}
+
+		return texture;
+	}
+
+	static const char* GetUsageName(TextureUsage usage)
+	{
+		switch (usage)
+		{
+		case TextureUsage::Albedo: return "albedo";
+		case TextureUsage::Normal: return "normal";
+		case TextureUsage::MetallicRoughness: return "mr";
+		case TextureUsage::HDR: return "hdr";
+		default: NOT_IMPLEMENTED;
+		}
+		return "";
+	}
+
+	std::string GetCookedPath(const std::string& sourcePath, TextureUsage usage)
+	{
+		// Source extension is kept so images with the same name and different formats don't share the cooked file
+		return sourcePath + "." + GetUsageName(usage) + "." + COOKED_TEXTURE_EXTENSION;
+	}
+
+	bool IsCookedTextureUpToDate(const std::string& cookedPath, const std::string& sourcePath)
+	{
+		std::error_code error;
+		if (!std::filesystem::exists(cookedPath, error)) return false;
+
+		const auto cookedTime = std::filesystem::last_write_time(cookedPath, error);
+		if (error) return false;
+
+		const auto sourceTime = std::filesystem::last_write_time(sourcePath, error);
+		return !error && cookedTime >= sourceTime;
+	}
+
+	bool CookTexture(const std::string& sourcePath, const std::string& cookedPath, const Settings& settings, CookStats* stats)
+	{
+		PROFILE_SECTION_CPU("TextureCooking::CookTexture");
+
+		TextureLoading::DecodedTexture decodedTexture = settings.Usage == TextureUsage::HDR ? TextureLoading::DecodeTextureHDR(sourcePath) : TextureLoading::DecodeTexture(sourcePath);
+		const CookedTexture texture = CookImage(decodedTexture.Pixels, decodedTexture.Width, decodedTexture.Height, settings, stats);
+		TextureLoading::FreeDecodedTexture(decodedTexture);
+
+		return WriteTexture(cookedPath, texture);
+	}
+
+	bool WriteTexture(const std::string& path, const CookedTexture& texture)
+	{
+		std::ofstream file(path, std::ios::binary);
+		if (!file.is_open())
+		{
+			std::cout << "[TextureCooking] Failed to write cooked texture " << path << std::endl;
+			return false;
+		}
+
+		DDSHeader header{};
+		header.Flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT;
+		header.Flags |= IsBlockCompressed(texture.Format) ? DDSD_LINEARSIZE : DDSD_PITCH;
+		header.Width = texture.Width;
+		header.Height = texture.Height;
+		header.PitchOrLinearSize = IsBlockCompressed(texture.Format) ? (uint32_t) GetMipByteSize(texture.Format, texture.Width, texture.Height, 0) : texture.Width * GetTexelByteSize(texture.Format);
+		header.MipMapCount = texture.NumMips;
+		header.Caps = DDSCAPS_TEXTURE | (texture.NumMips > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0) | (texture.ArraySize > 1 ? DDSCAPS_COMPLEX : 0);
+		header.Caps2 = texture.Cubemap ? DDSCAPS2_CUBEMAP_ALLFACES : 0;
+
+		// Cubemaps count cubes, not faces
+		DDSHeaderDX10 headerDX10{};
+		headerDX10.Format = texture.Format;
+		headerDX10.MiscFlag = texture.Cubemap ? DDS_MISC_TEXTURECUBE : 0;
+		headerDX10.ArraySize = texture.Cubemap ? texture.ArraySize / 6 : texture.ArraySize;
+
+		file.write(reinterpret_cast<const char*>(&DDS_MAGIC), sizeof(DDS_MAGIC));
+		file.write(reinterpret_cast<const char*>(&header), sizeof(DDSHeader));
+		file.write(reinterpret_cast<const char*>(&headerDX10), sizeof(DDSHeaderDX10));
+		file.write(reinterpret_cast<const char*>(texture.Data.data()), texture.Data.size());
+		return file.good();
+	}
+
+	bool ReadTexture(const std::string& path, CookedTexture& texture)
+	{
+		PROFILE_SECTION_CPU("TextureCooking::ReadTexture");
+
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+		{
+			std::cout << "[TextureCooking] Failed to open cooked texture " << path << std::endl;
+			return false;
+		}
+		const uint64_t fileSize = (uint64_t) file.tellg();
+		file.seekg(0);
+
+		uint32_t magic = 0;
+		DDSHeader header{};
+		DDSHeaderDX10 headerDX10{};
+		file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+		file.read(reinterpret_cast<char*>(&header), sizeof(DDSHeader));
+		file.read(reinterpret_cast<char*>(&headerDX10), sizeof(DDSHeaderDX10));
+
+		// Only DX10 headers are supported, that's what WriteTexture produces
+		if (!file.good() || magic != DDS_MAGIC || header.Size != sizeof(DDSHeader) || header.PixelFormat.FourCC != DDS_FOURCC_DX10 || headerDX10.ResourceDimension != DDS_DIMENSION_TEXTURE2D)
+		{
+			std::cout << "[TextureCooking] Unsupported DDS file " << path << std::endl;
+			return false;
+		}
+
+		texture.Format = headerDX10.Format;
+		texture.Width = header.Width;
+		texture.Height = header.Height;
+		texture.NumMips = MAX(header.MipMapCount, 1u);
+		texture.Cubemap = (headerDX10.MiscFlag & DDS_MISC_TEXTURECUBE) != 0;
+		texture.ArraySize = MAX(headerDX10.ArraySize, 1u) * (texture.Cubemap ? 6 : 1);
+
+		uint64_t dataSize = 0;
+		for (uint32_t mipIndex = 0; mipIndex < texture.NumMips; mipIndex++) dataSize += GetMipByteSize(texture.Format, texture.Width, texture.Height, mipIndex);
+		dataSize *= texture.ArraySize;
+
+		const uint64_t headerSize = sizeof(DDS_MAGIC) + sizeof(DDSHeader) + sizeof(DDSHeaderDX10);
+		if (fileSize < headerSize + dataSize)
+		{
+			std::cout << "[TextureCooking] Cooked texture " << path << " is truncated" << std::endl;
+			return false;
+		}
+
+		texture.Data.resize(dataSize);
+		file.read(reinterpret_cast<char*>(texture.Data.data()), dataSize);
+		return file.good();
+	}
+}
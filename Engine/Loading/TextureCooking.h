@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <dxgiformat.h>
+
+#include "Common.h"
+
+// Cooked texture is a DDS file (DX10 header) with every mip filtered on the CPU and already in its GPU format, so it's uploaded without any conversion.
+// Format is picked by the usage of the texture:
+//   Albedo            : BC1, BC3 when any texel is transparent, mips are filtered in linear space
+//   Normal            : BC5 with XY, Z has to be reconstructed when sampled, mips are renormalized
+//   MetallicRoughness : BC1, keeps glTF channels (G roughness, B metallic)
+//   HDR               : R16G16B16A16_FLOAT
+// Block compression needs the size of the first mip to be a multiple of 4, other sizes fall back to R8G8B8A8_UNORM.
+namespace TextureCooking
+{
+	static constexpr const char* COOKED_TEXTURE_EXTENSION = "dds";
+
+	enum class TextureUsage : uint32_t
+	{
+		Albedo,
+		Normal,
+		MetallicRoughness,
+		HDR,
+	};
+
+	struct Settings
+	{
+		TextureUsage Usage = TextureUsage::Albedo;
+
+		// Source is a vertical strip of 6 faces, same layout as TextureLoading::LoadCubemap
+		bool Cubemap = false;
+
+		bool GenerateMips = true;
+
+		// Two refinement passes in the block encoder, about a third slower
+		bool HighQuality = false;
+	};
+
+	struct CookedTexture
+	{
+		DXGI_FORMAT Format = DXGI_FORMAT_UNKNOWN;
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint32_t ArraySize = 1;
+		uint32_t NumMips = 1;
+		bool Cubemap = false;
+
+		// Every mip of the first slice then every mip of the next one, same order as in the DDS file
+		std::vector<uint8_t> Data;
+	};
+
+	struct CookStats
+	{
+		uint64_t NumTexels = 0;		// Every mip of every slice
+		float FilterTimeMS = 0.0f;
+		float EncodeTimeMS = 0.0f;
+	};
+
+	bool IsBlockCompressed(DXGI_FORMAT format);
+	uint64_t GetMipByteSize(DXGI_FORMAT format, uint32_t width, uint32_t height, uint32_t mipIndex);
+
+	// Same image can be cooked for different usages, usage is part of the name (e.g. brick.png.albedo.dds)
+	std::string GetCookedPath(const std::string& sourcePath, TextureUsage usage);
+	bool IsCookedTextureUpToDate(const std::string& cookedPath, const std::string& sourcePath);
+
+	// Pixels are R8G8B8A8, or R32G32B32A32_FLOAT for HDR. Filtering and encoding are split between JobPool threads.
+	CookedTexture CookImage(const void* pixels, uint32_t width, uint32_t height, const Settings& settings, CookStats* stats = nullptr);
+
+	bool CookTexture(const std::string& sourcePath, const std::string& cookedPath, const Settings& settings, CookStats* stats = nullptr);
+
+	bool WriteTexture(const std::string& path, const CookedTexture& texture);
+	bool ReadTexture(const std::string& path, CookedTexture& texture);
+}
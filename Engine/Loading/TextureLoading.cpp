@@ -1,22 +1,52 @@
 #include "TextureLoading.h"
 
+#include <filesystem>
+#include <fstream>
+#include <DirectXPackedVector.h>
+
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 
+#include "Loading/TextureCooking.h"
 #include "Render/Commands.h"
 #include "Render/RenderAPI.h"
 #include "Render/Resource.h"
 #include "Render/Texture.h"
+#include "System/JobPool.h"
 
 namespace TextureLoading
 {
 	static unsigned char INVALID_TEXTURE_COLOR[] = { 0xff, 0x00, 0x33, 0xff };
+	static float INVALID_TEXTURE_COLOR_F[] = { 1.0f, 0.0f, 0.2f, 1.0f };
+
+	static constexpr uint32_t COOKED_MIP_CHAIN_MAGIC = 0x50494D47; // GMIP
+	static constexpr uint32_t COOKED_MIP_CHAIN_VERSION = 1;
+	static constexpr const char* COOKED_MIP_CHAIN_EXTENSION = "cmips";
+	static constexpr uint32_t MIP_CHAIN_BPP = 4;
+
+	struct MipChainFileHeader
+	{
+		uint32_t Magic = COOKED_MIP_CHAIN_MAGIC;
+		uint32_t Version = COOKED_MIP_CHAIN_VERSION;
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint32_t NumMips = 0;
+	};
 
-	static void* LoadTexture(const std::string& path, int& width, int& height, int& bpp)
+	// Channels requested from stb_image, 0 keeps the channels of the image
+	static int GetRequiredChannels(DecodeChannels channels)
+	{
+		return channels == DecodeChannels::RGBA ? 4 : 0;
+	}
+
+	// numChannels is the number of channels in the returned data
+	static void* LoadTexture(const std::string& path, int requiredChannels, int& width, int& height, int& numChannels)
 	{
 		PROFILE_SECTION_CPU("STBI::LoadTexture");
 
-		void* data = stbi_load(path.c_str(), &width, &height, &bpp, 4);
+		int fileChannels;
+		void* data = stbi_load(path.c_str(), &width, &height, &fileChannels, requiredChannels);
+		numChannels = requiredChannels ? requiredChannels : fileChannels;
 
 		if (!data)
 		{
@@ -24,25 +54,47 @@ namespace TextureLoading
 			data = INVALID_TEXTURE_COLOR;
 			width = 1;
 			height = 1;
-			bpp = 4;
+			numChannels = 4;
+		}
+
+		return data;
+	}
+
+	static void* LoadTexture(const void* fileData, size_t fileByteSize, const std::string& debugName, int requiredChannels, int& width, int& height, int& numChannels)
+	{
+		PROFILE_SECTION_CPU("STBI::LoadTextureFromMemory");
+
+		int fileChannels;
+		void* data = fileData ? stbi_load_from_memory(static_cast<const stbi_uc*>(fileData), (int) fileByteSize, &width, &height, &fileChannels, requiredChannels) : nullptr;
+		numChannels = requiredChannels ? requiredChannels : fileChannels;
+
+		if (!data)
+		{
+			std::cout << "Warning: Failed to load texture: " << debugName << std::endl;
+			data = INVALID_TEXTURE_COLOR;
+			width = 1;
+			height = 1;
+			numChannels = 4;
 		}
 
 		return data;
 	}
 
-	static void* LoadTextureF(const std::string& path, int& width, int& height, int& bpp)
+	static void* LoadTextureF(const std::string& path, int requiredChannels, int& width, int& height, int& numChannels)
 	{
 		PROFILE_SECTION_CPU("STBI::LoadTextureF");
 
-		void* data = stbi_loadf(path.c_str(), &width, &height, &bpp, 4);
+		int fileChannels;
+		void* data = stbi_loadf(path.c_str(), &width, &height, &fileChannels, requiredChannels);
+		numChannels = requiredChannels ? requiredChannels : fileChannels;
 
 		if (!data)
 		{
 			std::cout << "Warning: Failed to load texture: " << path << std::endl;
-			data = INVALID_TEXTURE_COLOR;
+			data = INVALID_TEXTURE_COLOR_F;
 			width = 1;
 			height = 1;
-			bpp = 4;
+			numChannels = 4;
 		}
 
 		return data;
@@ -52,43 +104,456 @@ namespace TextureLoading
 	{
 		PROFILE_SECTION_CPU("STBI::FreeTexture");
 
-		if (data != INVALID_TEXTURE_COLOR)
+		if (data != INVALID_TEXTURE_COLOR && data != INVALID_TEXTURE_COLOR_F)
 			stbi_image_free(data);
 	}
 
+	static DXGI_FORMAT GetTextureFormat(uint32_t numChannels, bool isHDR, DecodeChannels channels)
+	{
+		if (isHDR) return numChannels == 4 && channels == DecodeChannels::RGBA ? DXGI_FORMAT_R32G32B32A32_FLOAT : DXGI_FORMAT_R16G16B16A16_FLOAT;
+		if (channels == DecodeChannels::Narrow && numChannels == 1) return DXGI_FORMAT_R8_UNORM;
+		if (channels == DecodeChannels::Narrow && numChannels == 2) return DXGI_FORMAT_R8G8_UNORM;
+		return DXGI_FORMAT_R8G8B8A8_UNORM;
+	}
+
+	static DecodedTexture MakeDecodedTexture(void* pixels, int width, int height, int numChannels, bool isHDR, DecodeChannels channels)
+	{
+		DecodedTexture decodedTexture{};
+		decodedTexture.Width = (uint32_t) width;
+		decodedTexture.Height = (uint32_t) height;
+		decodedTexture.NumChannels = (uint32_t) numChannels;
+		decodedTexture.IsHDR = isHDR;
+		decodedTexture.Format = GetTextureFormat(decodedTexture.NumChannels, isHDR, channels);
+		decodedTexture.Pixels = pixels;
+		return decodedTexture;
+	}
+
+	// Texture format has the same texel layout as the decoded pixels, so they are uploaded without conversion
+	static bool IsUploadLayout(const DecodedTexture& decodedTexture)
+	{
+		switch (decodedTexture.Format)
+		{
+		case DXGI_FORMAT_R8_UNORM: return !decodedTexture.IsHDR && decodedTexture.NumChannels == 1;
+		case DXGI_FORMAT_R8G8_UNORM: return !decodedTexture.IsHDR && decodedTexture.NumChannels == 2;
+		case DXGI_FORMAT_R8G8B8A8_UNORM: return !decodedTexture.IsHDR && decodedTexture.NumChannels == 4;
+		case DXGI_FORMAT_R32G32B32A32_FLOAT: return decodedTexture.IsHDR && decodedTexture.NumChannels == 4;
+		default: return false;
+		}
+	}
+
+	// Source channel of every RGBA channel by the decoded channel count, grey is broadcast to RGB and missing alpha is opaque
+	static constexpr int NO_SOURCE_CHANNEL = -1;
+	static constexpr int EXPAND_CHANNELS[5][4] = {
+		{ NO_SOURCE_CHANNEL, NO_SOURCE_CHANNEL, NO_SOURCE_CHANNEL, NO_SOURCE_CHANNEL },
+		{ 0, 0, 0, NO_SOURCE_CHANNEL },
+		{ 0, 0, 0, 1 },
+		{ 0, 1, 2, NO_SOURCE_CHANNEL },
+		{ 0, 1, 2, 3 },
+	};
+
+	// Expands one row of the decoded image to R8G8B8A8 or R16G16B16A16_FLOAT straight into the upload staging memory
+	static void WriteExpandedRow(const DecodedTexture& decodedTexture, uint32_t rowIndex, uint8_t* destination)
+	{
+		using namespace DirectX::PackedVector;
+
+		const uint32_t width = decodedTexture.Width;
+		const uint32_t numChannels = decodedTexture.NumChannels;
+		const size_t rowOffset = (size_t) rowIndex * width * numChannels;
+		const int* sourceChannels = EXPAND_CHANNELS[numChannels];
+
+		if (decodedTexture.IsHDR)
+		{
+			static const HALF HALF_ONE = XMConvertFloatToHalf(1.0f);
+
+			const float* source = static_cast<const float*>(decodedTexture.Pixels) + rowOffset;
+			HALF* halfDestination = reinterpret_cast<HALF*>(destination);
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				if (sourceChannels[c] != NO_SOURCE_CHANNEL)
+				{
+					XMConvertFloatToHalfStream(halfDestination + c, 4 * sizeof(HALF), source + sourceChannels[c], numChannels * sizeof(float), width);
+					continue;
+				}
+				for (uint32_t x = 0; x < width; x++) halfDestination[x * 4 + c] = HALF_ONE;
+			}
+			return;
+		}
+
+		const uint8_t* source = static_cast<const uint8_t*>(decodedTexture.Pixels) + rowOffset;
+		switch (numChannels)
+		{
+		case 1:
+			for (uint32_t x = 0; x < width; x++)
+			{
+				destination[x * 4 + 0] = destination[x * 4 + 1] = destination[x * 4 + 2] = source[x];
+				destination[x * 4 + 3] = 0xff;
+			}
+			break;
+		case 2:
+			for (uint32_t x = 0; x < width; x++)
+			{
+				destination[x * 4 + 0] = destination[x * 4 + 1] = destination[x * 4 + 2] = source[x * 2];
+				destination[x * 4 + 3] = source[x * 2 + 1];
+			}
+			break;
+		case 3:
+			for (uint32_t x = 0; x < width; x++)
+			{
+				destination[x * 4 + 0] = source[x * 3 + 0];
+				destination[x * 4 + 1] = source[x * 3 + 1];
+				destination[x * 4 + 2] = source[x * 3 + 2];
+				destination[x * 4 + 3] = 0xff;
+			}
+			break;
+		default:
+			memcpy(destination, source, (size_t) width * 4);
+			break;
+		}
+	}
+
 	Texture* LoadTextureHDR(GraphicsContext& context, const std::string& path, RCF creationFlags)
 	{
-		static constexpr DXGI_FORMAT TEXTURE_FORMAT = DXGI_FORMAT_R32G32B32A32_FLOAT;
-		int width, height, bpp;
-		void* texData = LoadTextureF(path, width, height, bpp);
-		ResourceInitData initData = { &context, texData };
-		Texture* texture = GFX::CreateTexture(width, height, creationFlags, 1, TEXTURE_FORMAT, &initData);
-		FreeTexture(texData);
+		DecodedTexture decodedTexture = DecodeTextureHDR(path, DecodeChannels::Expand);
+		Texture* texture = CreateTexture(context, decodedTexture, creationFlags);
+		FreeDecodedTexture(decodedTexture);
 		return texture;
 	}
 
-	Texture* LoadTexture(GraphicsContext& context, const std::string& path, RCF creationFlags, uint32_t numMips)
+	DecodedTexture DecodeTexture(const std::string& path, DecodeChannels channels)
 	{
-		static constexpr DXGI_FORMAT TEXTURE_FORMAT = DXGI_FORMAT_R8G8B8A8_UNORM;
+		int width, height, numChannels;
+		void* texData = LoadTexture(path, GetRequiredChannels(channels), width, height, numChannels);
+		return MakeDecodedTexture(texData, width, height, numChannels, false, channels);
+	}
 
-		int width, height, bpp;
-		void* texData = LoadTexture(path, width, height, bpp);
+	DecodedTexture DecodeTexture(const void* fileData, size_t fileByteSize, const std::string& debugName, DecodeChannels channels)
+	{
+		int width, height, numChannels;
+		void* texData = LoadTexture(fileData, fileByteSize, debugName, GetRequiredChannels(channels), width, height, numChannels);
+		return MakeDecodedTexture(texData, width, height, numChannels, false, channels);
+	}
+
+	DecodedTexture DecodeTextureHDR(const std::string& path, DecodeChannels channels)
+	{
+		int width, height, numChannels;
+		void* texData = LoadTextureF(path, GetRequiredChannels(channels), width, height, numChannels);
+		return MakeDecodedTexture(texData, width, height, numChannels, true, channels);
+	}
+
+	bool IsHDRFile(const std::string& path)
+	{
+		return stbi_is_hdr(path.c_str()) != 0;
+	}
+
+	std::vector<DecodedTexture> DecodeTextures(const std::vector<std::string>& paths, DecodeChannels channels)
+	{
+		PROFILE_SECTION_CPU("TextureLoading::DecodeTextures");
+
+		std::vector<DecodedTexture> decodedTextures(paths.size());
+		JobPool::Get()->ParallelFor((uint32_t) paths.size(), [&](uint32_t pathIndex)
+		{
+			const std::string& path = paths[pathIndex];
+			decodedTextures[pathIndex] = IsHDRFile(path) ? DecodeTextureHDR(path, channels) : DecodeTexture(path, channels);
+		});
+		return decodedTextures;
+	}
+
+	uint64_t GetDecodedByteSize(const DecodedTexture& decodedTexture)
+	{
+		return (uint64_t) decodedTexture.Width * decodedTexture.Height * decodedTexture.NumChannels * (decodedTexture.IsHDR ? sizeof(float) : sizeof(uint8_t));
+	}
+
+	void FreeDecodedTexture(DecodedTexture& decodedTexture)
+	{
+		FreeTexture(decodedTexture.Pixels);
+		decodedTexture = DecodedTexture{};
+	}
+
+	Texture* CreateTexture(GraphicsContext& context, const DecodedTexture& decodedTexture, RCF creationFlags, uint32_t numMips)
+	{
+		const uint32_t width = decodedTexture.Width;
+		const uint32_t height = decodedTexture.Height;
+		const bool uploadLayout = IsUploadLayout(decodedTexture);
 		Texture* texture;
-		if (numMips == 1)
+		if (numMips == 1 && uploadLayout)
 		{
-			ResourceInitData initData = { &context, texData };
-			texture = GFX::CreateTexture(width, height, creationFlags, numMips, TEXTURE_FORMAT, &initData);
+			ResourceInitData initData = { &context, decodedTexture.Pixels };
+			texture = GFX::CreateTexture(width, height, creationFlags, numMips, decodedTexture.Format, &initData);
 		}
 		else
 		{
 			const uint32_t maxWH = MAX(width, height);
 			while (maxWH >> (numMips-1) == 0) numMips--;
 
-			texture = GFX::CreateTexture(width, height, creationFlags, numMips, TEXTURE_FORMAT);
-			GFX::Cmd::UploadToTexture(context, texData, texture, 0);
-			GFX::Cmd::GenerateMips(context, texture);
+			texture = GFX::CreateTexture(width, height, creationFlags, numMips, decodedTexture.Format);
+			if (uploadLayout)
+				GFX::Cmd::UploadToTexture(context, decodedTexture.Pixels, texture, 0);
+			else
+				GFX::Cmd::UploadToTexture(context, texture, 0, 0, [&decodedTexture](uint8_t* rowData, uint32_t rowIndex) { WriteExpandedRow(decodedTexture, rowIndex, rowData); });
+			if (numMips > 1) GFX::Cmd::GenerateMips(context, texture);
 		}
-		FreeTexture(texData);
+		return texture;
+	}
+
+	std::vector<Texture*> LoadTextures(GraphicsContext& context, const std::vector<std::string>& paths, RCF creationFlags, DecodeChannels channels)
+	{
+		std::vector<DecodedTexture> decodedTextures = DecodeTextures(paths, channels);
+
+		std::vector<Texture*> textures(paths.size());
+		for (size_t i = 0; i < paths.size(); i++)
+		{
+			textures[i] = CreateTexture(context, decodedTextures[i], creationFlags);
+			FreeDecodedTexture(decodedTextures[i]);
+		}
+		return textures;
+	}
+
+	uint32_t GetNumMips(uint32_t width, uint32_t height)
+	{
+		uint32_t numMips = 1;
+		for (uint32_t maxWH = MAX(width, height); maxWH > 1; maxWH >>= 1) numMips++;
+		return numMips;
+	}
+
+	uint64_t GetMipByteSize(uint32_t width, uint32_t height, uint32_t mipIndex)
+	{
+		const uint64_t mipWidth = MAX(width >> mipIndex, 1u);
+		const uint64_t mipHeight = MAX(height >> mipIndex, 1u);
+		return mipWidth * mipHeight * MIP_CHAIN_BPP;
+	}
+
+	static uint64_t GetMipChainByteSize(uint32_t width, uint32_t height, uint32_t firstMip, uint32_t numMips)
+	{
+		uint64_t byteSize = 0;
+		for (uint32_t mipIndex = firstMip; mipIndex < firstMip + numMips; mipIndex++) byteSize += GetMipByteSize(width, height, mipIndex);
+		return byteSize;
+	}
+
+	static void DownsampleMip(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint8_t* dst)
+	{
+		const uint32_t dstWidth = MAX(srcWidth >> 1, 1u);
+		const uint32_t dstHeight = MAX(srcHeight >> 1, 1u);
+		for (uint32_t y = 0; y < dstHeight; y++)
+		{
+			// Odd sizes clamp to the last row and column
+			const uint32_t y0 = MIN(2 * y, srcHeight - 1);
+			const uint32_t y1 = MIN(2 * y + 1, srcHeight - 1);
+			for (uint32_t x = 0; x < dstWidth; x++)
+			{
+				const uint32_t x0 = MIN(2 * x, srcWidth - 1);
+				const uint32_t x1 = MIN(2 * x + 1, srcWidth - 1);
+				const uint8_t* p00 = src + (y0 * srcWidth + x0) * MIP_CHAIN_BPP;
+				const uint8_t* p01 = src + (y0 * srcWidth + x1) * MIP_CHAIN_BPP;
+				const uint8_t* p10 = src + (y1 * srcWidth + x0) * MIP_CHAIN_BPP;
+				const uint8_t* p11 = src + (y1 * srcWidth + x1) * MIP_CHAIN_BPP;
+
+				uint8_t* d = dst + (y * dstWidth + x) * MIP_CHAIN_BPP;
+				for (uint32_t c = 0; c < MIP_CHAIN_BPP; c++)
+					d[c] = (uint8_t) ((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+			}
+		}
+	}
+
+	MipChain BuildMipChain(const DecodedTexture& decodedTexture)
+	{
+		PROFILE_SECTION_CPU("TextureLoading::BuildMipChain");
+
+		ASSERT(decodedTexture.NumChannels == 4 && !decodedTexture.IsHDR, "[TextureLoading] Mip chains are built from R8G8B8A8 images");
+
+		MipChain mipChain{};
+		mipChain.Width = decodedTexture.Width;
+		mipChain.Height = decodedTexture.Height;
+		mipChain.NumMips = GetNumMips(mipChain.Width, mipChain.Height);
+		mipChain.Pixels.resize(GetMipChainByteSize(mipChain.Width, mipChain.Height, 0, mipChain.NumMips));
+		memcpy(mipChain.Pixels.data(), decodedTexture.Pixels, GetMipByteSize(mipChain.Width, mipChain.Height, 0));
+
+		uint64_t mipOffset = 0;
+		for (uint32_t mipIndex = 1; mipIndex < mipChain.NumMips; mipIndex++)
+		{
+			const uint64_t srcOffset = mipOffset;
+			mipOffset += GetMipByteSize(mipChain.Width, mipChain.Height, mipIndex - 1);
+
+			const uint32_t srcWidth = MAX(mipChain.Width >> (mipIndex - 1), 1u);
+			const uint32_t srcHeight = MAX(mipChain.Height >> (mipIndex - 1), 1u);
+			DownsampleMip(mipChain.Pixels.data() + srcOffset, srcWidth, srcHeight, mipChain.Pixels.data() + mipOffset);
+		}
+
+		return mipChain;
+	}
+
+	std::string GetCookedMipChainPath(const std::string& path)
+	{
+		// Extension is appended so images with the same name and different formats don't share the cooked file
+		return path + "." + COOKED_MIP_CHAIN_EXTENSION;
+	}
+
+	static bool ReadMipChainHeader(std::ifstream& file, MipChainFileHeader& header)
+	{
+		file.read(reinterpret_cast<char*>(&header), sizeof(MipChainFileHeader));
+		return file.good() && header.Magic == COOKED_MIP_CHAIN_MAGIC && header.Version == COOKED_MIP_CHAIN_VERSION &&
+			header.NumMips > 0 && header.NumMips <= GetNumMips(header.Width, header.Height);
+	}
+
+	bool IsCookedMipChainUpToDate(const std::string& cookedPath, const std::string& sourcePath)
+	{
+		std::error_code error;
+		if (!std::filesystem::exists(cookedPath, error)) return false;
+
+		const auto cookedTime = std::filesystem::last_write_time(cookedPath, error);
+		if (error) return false;
+
+		const auto sourceTime = std::filesystem::last_write_time(sourcePath, error);
+		if (error || cookedTime < sourceTime) return false;
+
+		const uint64_t fileSize = std::filesystem::file_size(cookedPath, error);
+		if (error) return false;
+
+		std::ifstream file(cookedPath, std::ios::binary);
+		MipChainFileHeader header{};
+		return ReadMipChainHeader(file, header) && fileSize == sizeof(MipChainFileHeader) + GetMipChainByteSize(header.Width, header.Height, 0, header.NumMips);
+	}
+
+	bool CookMipChain(const std::string& sourcePath, const std::string& cookedPath)
+	{
+		PROFILE_SECTION_CPU("TextureLoading::CookMipChain");
+
+		DecodedTexture decodedTexture = DecodeTexture(sourcePath);
+		const MipChain mipChain = BuildMipChain(decodedTexture);
+		FreeDecodedTexture(decodedTexture);
+
+		std::ofstream file(cookedPath, std::ios::binary);
+		if (!file.is_open())
+		{
+			std::cout << "[TextureLoading] Failed to write cooked mip chain " << cookedPath << std::endl;
+			return false;
+		}
+
+		MipChainFileHeader header{};
+		header.Width = mipChain.Width;
+		header.Height = mipChain.Height;
+		header.NumMips = mipChain.NumMips;
+		file.write(reinterpret_cast<const char*>(&header), sizeof(MipChainFileHeader));
+
+		for (uint32_t mipIndex = mipChain.NumMips; mipIndex-- > 0;)
+		{
+			const uint64_t mipOffset = GetMipChainByteSize(mipChain.Width, mipChain.Height, 0, mipIndex);
+			file.write(reinterpret_cast<const char*>(mipChain.Pixels.data() + mipOffset), GetMipByteSize(mipChain.Width, mipChain.Height, mipIndex));
+		}
+
+		return file.good();
+	}
+
+	bool ReadMipChainInfo(const std::string& cookedPath, uint32_t& width, uint32_t& height, uint32_t& numMips)
+	{
+		std::ifstream file(cookedPath, std::ios::binary);
+		MipChainFileHeader header{};
+		if (!ReadMipChainHeader(file, header)) return false;
+
+		width = header.Width;
+		height = header.Height;
+		numMips = header.NumMips;
+		return true;
+	}
+
+	bool ReadMipChain(const std::string& cookedPath, uint32_t firstMip, MipChain& mipChain)
+	{
+		PROFILE_SECTION_CPU("TextureLoading::ReadMipChain");
+
+		std::ifstream file(cookedPath, std::ios::binary);
+		MipChainFileHeader header{};
+		if (!ReadMipChainHeader(file, header) || firstMip >= header.NumMips)
+		{
+			std::cout << "[TextureLoading] Invalid cooked mip chain " << cookedPath << std::endl;
+			return false;
+		}
+
+		mipChain.Width = header.Width;
+		mipChain.Height = header.Height;
+		mipChain.FirstMip = firstMip;
+		mipChain.NumMips = header.NumMips - firstMip;
+		mipChain.Pixels.resize(GetMipChainByteSize(header.Width, header.Height, firstMip, mipChain.NumMips));
+
+		// File goes from the least detailed mip, reading stops at the first mip of the chain
+		for (uint32_t mipIndex = header.NumMips; mipIndex-- > firstMip;)
+		{
+			const uint64_t mipOffset = GetMipChainByteSize(header.Width, header.Height, firstMip, mipIndex - firstMip);
+			file.read(reinterpret_cast<char*>(mipChain.Pixels.data() + mipOffset), GetMipByteSize(header.Width, header.Height, mipIndex));
+		}
+
+		if (!file.good())
+		{
+			std::cout << "[TextureLoading] Cooked mip chain " << cookedPath << " is truncated" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	Texture* CreateTexture(GraphicsContext& context, const MipChain& mipChain, RCF creationFlags)
+	{
+		static constexpr DXGI_FORMAT TEXTURE_FORMAT = DXGI_FORMAT_R8G8B8A8_UNORM;
+
+		const uint32_t width = MAX(mipChain.Width >> mipChain.FirstMip, 1u);
+		const uint32_t height = MAX(mipChain.Height >> mipChain.FirstMip, 1u);
+		Texture* texture = GFX::CreateTexture(width, height, creationFlags, mipChain.NumMips, TEXTURE_FORMAT);
+
+		GFX::Cmd::UploadBatch uploads{ context };
+		uint64_t mipOffset = 0;
+		for (uint32_t mipIndex = 0; mipIndex < mipChain.NumMips; mipIndex++)
+		{
+			uploads.AddTexture(texture, mipChain.Pixels.data() + mipOffset, mipIndex);
+			mipOffset += GetMipByteSize(mipChain.Width, mipChain.Height, mipChain.FirstMip + mipIndex);
+		}
+		uploads.Submit();
+		return texture;
+	}
+
+	Texture* CreateTexture(GraphicsContext& context, const TextureCooking::CookedTexture& cookedTexture, RCF creationFlags)
+	{
+		const uint32_t width = cookedTexture.Width;
+		const uint32_t height = cookedTexture.Height;
+		const uint32_t numMips = cookedTexture.NumMips;
+		Texture* texture;
+		if (cookedTexture.ArraySize == 1 && !cookedTexture.Cubemap)
+			texture = GFX::CreateTexture(width, height, creationFlags, numMips, cookedTexture.Format);
+		else
+			texture = GFX::CreateTextureArray(width, height, cookedTexture.ArraySize, creationFlags | (cookedTexture.Cubemap ? RCF::Cubemap : RCF::None), numMips, cookedTexture.Format);
+
+		GFX::Cmd::UploadBatch uploads{ context };
+		uint64_t mipOffset = 0;
+		for (uint32_t arrayIndex = 0; arrayIndex < cookedTexture.ArraySize; arrayIndex++)
+		{
+			for (uint32_t mipIndex = 0; mipIndex < numMips; mipIndex++)
+			{
+				uploads.AddTexture(texture, cookedTexture.Data.data() + mipOffset, mipIndex, arrayIndex);
+				mipOffset += TextureCooking::GetMipByteSize(cookedTexture.Format, width, height, mipIndex);
+			}
+		}
+		uploads.Submit();
+		return texture;
+	}
+
+	Texture* LoadCookedTexture(GraphicsContext& context, const std::string& path, const TextureCooking::Settings& settings, RCF creationFlags)
+	{
+		PROFILE_SECTION_CPU("TextureLoading::LoadCookedTexture");
+
+		const std::string cookedPath = TextureCooking::GetCookedPath(path, settings.Usage);
+		if (!TextureCooking::IsCookedTextureUpToDate(cookedPath, path))
+			TextureCooking::CookTexture(path, cookedPath, settings);
+
+		TextureCooking::CookedTexture cookedTexture{};
+		if (!TextureCooking::ReadTexture(cookedPath, cookedTexture))
+		{
+			// Cooked file can't be written or read, fall back to the source image without compression
+			return settings.Usage == TextureCooking::TextureUsage::HDR ? LoadTextureHDR(context, path, creationFlags) : LoadTexture(context, path, creationFlags);
+		}
+		return CreateTexture(context, cookedTexture, creationFlags);
+	}
+
+	Texture* LoadTexture(GraphicsContext& context, const std::string& path, RCF creationFlags, uint32_t numMips, DecodeChannels channels)
+	{
+		DecodedTexture decodedTexture = DecodeTexture(path, channels);
+		Texture* texture = CreateTexture(context, decodedTexture, creationFlags, numMips);
+		FreeDecodedTexture(decodedTexture);
 		return texture;
 	}
 
@@ -97,7 +562,7 @@ namespace TextureLoading
 		// Load tex
 		static constexpr DXGI_FORMAT TEXTURE_FORMAT = DXGI_FORMAT_R8G8B8A8_UNORM;
 		int width, height, bpp;
-		void* texData = LoadTexture(path, width, height, bpp);
+		void* texData = LoadTexture(path, 4, width, height, bpp);
 
 		// Prepare init data
 		std::vector<ResourceInitData*> initData;
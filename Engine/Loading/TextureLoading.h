@@ -1,5 +1,8 @@
 #pragma once
 
+#include <vector>
+#include <dxgiformat.h>
+
 #include "Common.h"
 
 struct Texture;
@@ -7,9 +10,88 @@ struct GraphicsContext;
 
 enum class RCF : uint64_t;
 
+namespace TextureCooking
+{
+	struct CookedTexture;
+	struct Settings;
+}
+
 namespace TextureLoading
 {
+	// Channels kept by the decoder, fewer channels decode faster and take less memory until the upload
+	enum class DecodeChannels : uint32_t
+	{
+		RGBA,	// Decoder expands every image to R8G8B8A8, or R32G32B32A32_FLOAT for HDR
+		Expand,	// Channels of the image are kept and expanded to R8G8B8A8 (R16G16B16A16_FLOAT for HDR) while writing the upload, grey is broadcast to RGB
+		Narrow,	// Same as Expand but grey and grey alpha images become R8 and R8G8 textures, only for shaders that read .r or .rg
+	};
+
+	// Decoded image in CPU memory, tightly packed NumChannels per texel
+	struct DecodedTexture
+	{
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint32_t NumChannels = 4;
+		bool IsHDR = false;	// 32 bit float channels instead of 8 bit
+		DXGI_FORMAT Format = DXGI_FORMAT_R8G8B8A8_UNORM;	// Format of the texture created from it
+		void* Pixels = nullptr;
+	};
+
+	// Decoding is thread safe and doesn't need a graphics context, free it with FreeDecodedTexture
+	DecodedTexture DecodeTexture(const std::string& path, DecodeChannels channels = DecodeChannels::RGBA);
+	DecodedTexture DecodeTexture(const void* fileData, size_t fileByteSize, const std::string& debugName, DecodeChannels channels = DecodeChannels::RGBA);
+	DecodedTexture DecodeTextureHDR(const std::string& path, DecodeChannels channels = DecodeChannels::RGBA);
+
+	// Radiance HDR image, decode it with DecodeTextureHDR
+	bool IsHDRFile(const std::string& path);
+
+	// Decodes every image on the JobPool, HDR images are detected by their content. Results match the paths by index.
+	std::vector<DecodedTexture> DecodeTextures(const std::vector<std::string>& paths, DecodeChannels channels = DecodeChannels::Expand);
+
+	uint64_t GetDecodedByteSize(const DecodedTexture& decodedTexture);
+	void FreeDecodedTexture(DecodedTexture& decodedTexture);
+
+	// Images that aren't in the layout of their texture format are expanded straight into the upload staging memory
+	Texture* CreateTexture(GraphicsContext& context, const DecodedTexture& decodedTexture, RCF creationFlags, uint32_t numMips = 1);
+
+	// Decodes in parallel, textures are created and uploaded on the calling thread
+	std::vector<Texture*> LoadTextures(GraphicsContext& context, const std::vector<std::string>& paths, RCF creationFlags, DecodeChannels channels = DecodeChannels::Expand);
+
+	// R8G8B8A8 mips [FirstMip, FirstMip + NumMips) of a Width x Height texture, tightly packed from the most detailed one
+	struct MipChain
+	{
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint32_t FirstMip = 0;
+		uint32_t NumMips = 0;
+		std::vector<uint8_t> Pixels;
+	};
+
+	// Full chain down to 1x1
+	uint32_t GetNumMips(uint32_t width, uint32_t height);
+	uint64_t GetMipByteSize(uint32_t width, uint32_t height, uint32_t mipIndex);
+
+	// Box filter on the CPU, mip chains built here don't need GFX::Cmd::GenerateMips. Decoded texture has to be R8G8B8A8.
+	MipChain BuildMipChain(const DecodedTexture& decodedTexture);
+
+	// Cooked mip chain lives next to the source image, mips are stored from the least detailed one so any tail of the chain is a single read
+	std::string GetCookedMipChainPath(const std::string& path);
+	bool IsCookedMipChainUpToDate(const std::string& cookedPath, const std::string& sourcePath);
+	bool CookMipChain(const std::string& sourcePath, const std::string& cookedPath);
+	bool ReadMipChainInfo(const std::string& cookedPath, uint32_t& width, uint32_t& height, uint32_t& numMips);
+	bool ReadMipChain(const std::string& cookedPath, uint32_t firstMip, MipChain& mipChain);
+
+	// Texture has the size of the first mip of the chain
+	Texture* CreateTexture(GraphicsContext& context, const MipChain& mipChain, RCF creationFlags);
+
+	// Every mip and slice of the cooked texture is uploaded as it is, cubemaps are created with RCF::Cubemap
+	Texture* CreateTexture(GraphicsContext& context, const TextureCooking::CookedTexture& cookedTexture, RCF creationFlags);
+
+	// Cooks the texture next to the source when the cooked one is missing or older than the source
+	Texture* LoadCookedTexture(GraphicsContext& context, const std::string& path, const TextureCooking::Settings& settings, RCF creationFlags);
+
+	// R16G16B16A16_FLOAT
 	Texture* LoadTextureHDR(GraphicsContext& context, const std::string& path, RCF creationFlags);
-	Texture* LoadTexture(GraphicsContext& context, const std::string& path, RCF creationFlags, uint32_t numMips = 1);
+	Texture* LoadTexture(GraphicsContext& context, const std::string& path, RCF creationFlags, uint32_t numMips = 1, DecodeChannels channels = DecodeChannels::Expand);
 	Texture* LoadCubemap(GraphicsContext& context, const std::string& path, RCF creationFlags);
 }
\ No newline at end of file
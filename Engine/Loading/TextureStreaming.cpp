@@ -0,0 +1,551 @@
+#include "TextureStreaming.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+
+#include "Loading/TextureCache.h"
+#include "Loading/TextureLoading.h"
+#include "Render/Commands.h"
+#include "Render/RenderThread.h"
+#include "Render/Texture.h"
+
+namespace TextureStreaming
+{
+	static constexpr uint32_t REQUEST_LOG_MAGIC = 0x474C5152; // RQLG
+	static constexpr uint32_t REQUEST_LOG_VERSION = 1;
+
+	static uint32_t CalculateTailMip(uint32_t width, uint32_t height, uint32_t numMips, uint32_t tailSize)
+	{
+		uint32_t tailMip = 0;
+		while (tailMip + 1 < numMips && MAX(width >> tailMip, height >> tailMip) > tailSize) tailMip++;
+		return tailMip;
+	}
+
+	TextureID ResidencyManager::AddTexture(uint32_t width, uint32_t height, uint32_t numMips)
+	{
+		TextureState texture{};
+		texture.Width = width;
+		texture.Height = height;
+		texture.NumMips = numMips;
+		texture.TailMip = CalculateTailMip(width, height, numMips, m_Settings.TailSize);
+		texture.ResidentMip = texture.TailMip;
+		texture.WantedMip = texture.TailMip;
+
+		m_ResidentBytes += GetChainBytes(texture, texture.TailMip);
+		m_Stats.PeakResidentBytes = MAX(m_Stats.PeakResidentBytes, m_ResidentBytes);
+
+		m_Textures.push_back(texture);
+		return (TextureID) m_Textures.size() - 1;
+	}
+
+	void ResidencyManager::Request(TextureID texture, float screenSize)
+	{
+		TextureState& state = m_Textures[texture];
+		state.RequestedSize = MAX(state.RequestedSize, screenSize);
+	}
+
+	uint64_t ResidencyManager::GetResidentBytes(TextureID texture) const
+	{
+		const TextureState& state = m_Textures[texture];
+		return GetChainBytes(state, state.ResidentMip);
+	}
+
+	uint64_t ResidencyManager::GetChainBytes(const TextureState& texture, uint32_t firstMip) const
+	{
+		uint64_t byteSize = 0;
+		for (uint32_t mipIndex = firstMip; mipIndex < texture.NumMips; mipIndex++) byteSize += TextureLoading::GetMipByteSize(texture.Width, texture.Height, mipIndex);
+		return byteSize;
+	}
+
+	uint32_t ResidencyManager::GetWantedMip(const TextureState& texture) const
+	{
+		// One texel per pixel, mip is rounded down so the wanted mip is never smaller than the surface
+		const float textureSize = (float) MAX(texture.Width, texture.Height);
+		const float mip = std::log2(textureSize / MAX(texture.RequestedSize, 1.0f)) + m_Settings.MipBias;
+		if (mip <= 0.0f) return 0;
+		return MIN((uint32_t) mip, texture.TailMip);
+	}
+
+	void ResidencyManager::SetResidentMip(TextureID texture, uint32_t mip, std::vector<MipChange>& changes)
+	{
+		TextureState& state = m_Textures[texture];
+		const uint64_t oldBytes = GetChainBytes(state, state.ResidentMip);
+		const uint64_t newBytes = GetChainBytes(state, mip);
+
+		if (mip < state.ResidentMip)
+		{
+			m_Stats.NumPromotions++;
+			m_Stats.PromotedBytes += newBytes - oldBytes;
+		}
+		else
+		{
+			m_Stats.NumEvictions++;
+			m_Stats.EvictedBytes += oldBytes - newBytes;
+		}
+
+		changes.push_back(MipChange{ texture, state.ResidentMip, mip });
+		m_ResidentBytes = m_ResidentBytes - oldBytes + newBytes;
+		m_Stats.PeakResidentBytes = MAX(m_Stats.PeakResidentBytes, m_ResidentBytes);
+		state.ResidentMip = mip;
+	}
+
+	void ResidencyManager::Evict(uint64_t targetBytes, EvictionQueue& queue, std::vector<MipChange>& changes)
+	{
+		while (m_ResidentBytes > targetBytes && queue.Next < queue.Textures.size())
+		{
+			const TextureID texture = queue.Textures[queue.Next++];
+			const TextureState& state = m_Textures[texture];
+			queue.ReclaimableBytes -= GetChainBytes(state, state.ResidentMip) - GetChainBytes(state, state.WantedMip);
+			SetResidentMip(texture, state.WantedMip, changes);
+		}
+	}
+
+	bool ResidencyManager::MakeRoom(uint64_t bytes, EvictionQueue& queue, std::vector<MipChange>& changes)
+	{
+		if (m_ResidentBytes + bytes <= m_Settings.BudgetBytes) return true;
+		if (bytes > m_Settings.BudgetBytes || m_ResidentBytes + bytes > m_Settings.BudgetBytes + queue.ReclaimableBytes) return false;
+
+		Evict(m_Settings.BudgetBytes - bytes, queue, changes);
+		return true;
+	}
+
+	void ResidencyManager::Update(std::vector<MipChange>& changes)
+	{
+		PROFILE_SECTION_CPU("ResidencyManager::Update");
+
+		m_Frame++;
+
+		std::vector<TextureID> promotions;
+		EvictionQueue evictionQueue{};
+		for (TextureID textureID = 0; textureID < m_Textures.size(); textureID++)
+		{
+			TextureState& texture = m_Textures[textureID];
+			if (texture.RequestedSize > 0.0f)
+			{
+				texture.WantedMip = GetWantedMip(texture);
+				texture.LastRequestFrame = m_Frame;
+				texture.RequestedSize = 0.0f;
+
+				m_Stats.NumRequests++;
+				if (texture.ResidentMip > texture.WantedMip) m_Stats.NumMissedRequests++;
+			}
+			else
+			{
+				texture.WantedMip = texture.TailMip;
+			}
+
+			if (texture.WantedMip < texture.ResidentMip)
+			{
+				promotions.push_back(textureID);
+			}
+			else if (texture.WantedMip > texture.ResidentMip)
+			{
+				evictionQueue.Textures.push_back(textureID);
+				evictionQueue.ReclaimableBytes += GetChainBytes(texture, texture.ResidentMip) - GetChainBytes(texture, texture.WantedMip);
+			}
+		}
+
+		std::stable_sort(evictionQueue.Textures.begin(), evictionQueue.Textures.end(), [this](TextureID a, TextureID b)
+		{
+			return m_Textures[a].LastRequestFrame < m_Textures[b].LastRequestFrame;
+		});
+
+		// Textures missing the most mips go first
+		std::stable_sort(promotions.begin(), promotions.end(), [this](TextureID a, TextureID b)
+		{
+			return m_Textures[a].ResidentMip - m_Textures[a].WantedMip > m_Textures[b].ResidentMip - m_Textures[b].WantedMip;
+		});
+
+		// Budget could have been lowered since the last update
+		Evict(m_Settings.BudgetBytes, evictionQueue, changes);
+
+		uint32_t numPromotions = 0;
+		for (TextureID textureID : promotions)
+		{
+			if (numPromotions == m_Settings.MaxPromotionsPerUpdate) break;
+
+			// Promotes as far as the budget allows
+			const TextureState& texture = m_Textures[textureID];
+			const uint64_t residentBytes = GetChainBytes(texture, texture.ResidentMip);
+			for (uint32_t mip = texture.WantedMip; mip < texture.ResidentMip; mip++)
+			{
+				if (!MakeRoom(GetChainBytes(texture, mip) - residentBytes, evictionQueue, changes)) continue;
+
+				SetResidentMip(textureID, mip, changes);
+				numPromotions++;
+				break;
+			}
+		}
+
+		if (m_ResidentBytes > m_Settings.BudgetBytes) m_Stats.NumOverBudgetFrames++;
+	}
+
+	bool WriteRequestLog(const std::string& path, const RequestLog& log)
+	{
+		std::ofstream file(path, std::ios::binary);
+		if (!file.is_open())
+		{
+			std::cout << "[TextureStreaming] Failed to write request log " << path << std::endl;
+			return false;
+		}
+
+		const uint32_t header[] = { REQUEST_LOG_MAGIC, REQUEST_LOG_VERSION, log.NumFrames, (uint32_t) log.Textures.size(), (uint32_t) log.Requests.size() };
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(log.Textures.data()), log.Textures.size() * sizeof(RequestLog::TextureDesc));
+		file.write(reinterpret_cast<const char*>(log.Requests.data()), log.Requests.size() * sizeof(RequestLog::Request));
+		return file.good();
+	}
+
+	bool ReadRequestLog(const std::string& path, RequestLog& log)
+	{
+		std::ifstream file(path, std::ios::binary);
+		uint32_t header[5] = {};
+		file.read(reinterpret_cast<char*>(header), sizeof(header));
+		if (!file.good() || header[0] != REQUEST_LOG_MAGIC || header[1] != REQUEST_LOG_VERSION)
+		{
+			std::cout << "[TextureStreaming] Invalid request log " << path << std::endl;
+			return false;
+		}
+
+		log.NumFrames = header[2];
+		log.Textures.resize(header[3]);
+		log.Requests.resize(header[4]);
+		file.read(reinterpret_cast<char*>(log.Textures.data()), log.Textures.size() * sizeof(RequestLog::TextureDesc));
+		file.read(reinterpret_cast<char*>(log.Requests.data()), log.Requests.size() * sizeof(RequestLog::Request));
+		if (!file.good())
+		{
+			std::cout << "[TextureStreaming] Request log " << path << " is truncated" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	ReplayReport Replay(const RequestLog& log, const ResidencySettings& settings)
+	{
+		PROFILE_SECTION_CPU("TextureStreaming::Replay");
+
+		ReplayReport report{};
+		const auto reportError = [&report](uint32_t frame, const std::string& error)
+		{
+			std::cout << "[TextureStreaming] Replay frame " << frame << ": " << error << std::endl;
+			report.NumErrors++;
+		};
+
+		ResidencyManager residency{ settings };
+		std::vector<uint32_t> residentMips;
+		for (const RequestLog::TextureDesc& desc : log.Textures)
+		{
+			const TextureID texture = residency.AddTexture(desc.Width, desc.Height, desc.NumMips);
+			residentMips.push_back(residency.GetResidentMip(texture));
+		}
+
+		// Tails are never evicted, the budget can only be exceeded when they alone don't fit
+		const uint64_t tailBytes = residency.GetResidentBytes();
+
+		std::vector<MipChange> changes;
+		size_t requestIndex = 0;
+		for (uint32_t frame = 0; frame < log.NumFrames; frame++)
+		{
+			for (; requestIndex < log.Requests.size() && log.Requests[requestIndex].Frame <= frame; requestIndex++)
+			{
+				const RequestLog::Request& request = log.Requests[requestIndex];
+				if (request.Frame < frame) reportError(frame, "Requests are not sorted by frame");
+				else if (request.Texture >= log.Textures.size()) reportError(frame, "Request of unknown texture " + std::to_string(request.Texture));
+				else residency.Request(request.Texture, request.ScreenSize);
+			}
+
+			changes.clear();
+			residency.Update(changes);
+
+			for (const MipChange& change : changes)
+			{
+				if (change.OldMip != residentMips[change.Texture]) reportError(frame, "Change of texture " + std::to_string(change.Texture) + " doesn't start at its resident mip");
+				residentMips[change.Texture] = change.NewMip;
+			}
+
+			uint64_t residentBytes = 0;
+			for (TextureID texture = 0; texture < residentMips.size(); texture++)
+			{
+				if (residency.GetResidentMip(texture) != residentMips[texture]) reportError(frame, "Resident mip of texture " + std::to_string(texture) + " changed without a MipChange");
+				if (residency.GetResidentMip(texture) > residency.GetTailMip(texture)) reportError(frame, "Tail of texture " + std::to_string(texture) + " was evicted");
+				residentBytes += residency.GetResidentBytes(texture);
+			}
+
+			if (residentBytes != residency.GetResidentBytes()) reportError(frame, "Resident bytes don't match resident mips");
+			if (residentBytes > MAX(settings.BudgetBytes, tailBytes)) reportError(frame, "Budget exceeded by " + std::to_string(residentBytes - MAX(settings.BudgetBytes, tailBytes)) + " bytes");
+		}
+
+		report.Stats = residency.GetStats();
+		report.FinalResidentBytes = residency.GetResidentBytes();
+		return report;
+	}
+
+	struct MipUpload
+	{
+		std::string CookedPath;
+		uint32_t FirstMip = 0;
+		Texture* Result = nullptr;
+		std::atomic<bool> Done = false;
+		std::atomic<bool> Cancelled = false;
+	};
+
+	class MipUploadTask : public RenderTask
+	{
+	public:
+		MipUploadTask(const std::shared_ptr<MipUpload>& upload) :
+			m_Upload(upload)
+		{}
+
+		// Render threads delete tasks after their command list is submitted, or without running them when they shut down
+		~MipUploadTask()
+		{
+			m_Upload->Done = true;
+		}
+
+		void Run(GraphicsContext& context) override
+		{
+			if (m_Upload->Cancelled) return;
+
+			TextureLoading::MipChain mipChain{};
+			if (TextureLoading::ReadMipChain(m_Upload->CookedPath, m_Upload->FirstMip, mipChain))
+				m_Upload->Result = TextureLoading::CreateTexture(context, mipChain, RCF::None);
+		}
+
+	private:
+		std::shared_ptr<MipUpload> m_Upload;
+	};
+
+	// Descriptors move with the resource, so bindings made after the swap see the new mips
+	static void SwapTextureResources(Texture& a, Texture& b)
+	{
+		std::swap(a.Handle, b.Handle);
+		std::swap(a.Alloc, b.Alloc);
+		std::swap(a.CurrState, b.CurrState);
+		std::swap(a.CBV, b.CBV);
+		std::swap(a.SRV, b.SRV);
+		std::swap(a.UAV, b.UAV);
+		std::swap(a.RTV, b.RTV);
+		std::swap(a.DSV, b.DSV);
+		std::swap(a.Subresources, b.Subresources);
+		std::swap(a.Format, b.Format);
+		std::swap(a.Width, b.Width);
+		std::swap(a.Height, b.Height);
+		std::swap(a.DepthOrArraySize, b.DepthOrArraySize);
+		std::swap(a.NumMips, b.NumMips);
+		std::swap(a.RowPitch, b.RowPitch);
+		std::swap(a.SlicePitch, b.SlicePitch);
+	}
+
+	TextureStreamer::~TextureStreamer()
+	{
+		ASSERT(m_Textures.empty(), "[TextureStreaming] TextureStreamer::Free has to be called before the streamer is destroyed");
+	}
+
+	Texture* TextureStreamer::Load(GraphicsContext& context, const std::string& path)
+	{
+		PROFILE_SECTION_CPU("TextureStreamer::Load");
+
+		// Loads are serialized so the same path isn't cooked twice, Update doesn't wait on them
+		m_LoadMutex.Lock();
+
+		const std::string canonicalPath = TextureCache::GetCanonicalPath(path);
+		TextureCache* textureCache = TextureCache::Get();
+		if (Texture* cachedTexture = textureCache->FindByPath(canonicalPath, TextureCache::STREAMED_MIPS))
+		{
+			m_LoadMutex.Unlock();
+			return cachedTexture;
+		}
+
+		const std::string cookedPath = TextureLoading::GetCookedMipChainPath(canonicalPath);
+		if (!TextureLoading::IsCookedMipChainUpToDate(cookedPath, canonicalPath)) TextureLoading::CookMipChain(canonicalPath, cookedPath);
+
+		uint32_t width, height, numMips;
+		TextureLoading::MipChain tail{};
+		bool tailRead = TextureLoading::ReadMipChainInfo(cookedPath, width, height, numMips);
+		if (tailRead)
+		{
+			m_Mutex.Lock();
+			const uint32_t tailSize = m_Residency.GetSettings().TailSize;
+			m_Mutex.Unlock();
+
+			tailRead = TextureLoading::ReadMipChain(cookedPath, CalculateTailMip(width, height, numMips, tailSize), tail);
+		}
+
+		if (!tailRead)
+		{
+			// Texture isn't owned by the cache, ModelLoading::Free deletes it
+			std::cout << "[TextureStreaming] Failed to stream " << path << ", loading it without streaming" << std::endl;
+			m_LoadMutex.Unlock();
+			return TextureLoading::LoadTexture(context, path, RCF::None);
+		}
+
+		Texture* texture = TextureLoading::CreateTexture(context, tail, RCF::None);
+
+		// Streamed textures are only shared by path
+		textureCache->Add(canonicalPath, TextureCache::HashContent(canonicalPath.data(), canonicalPath.size()), TextureCache::STREAMED_MIPS, texture);
+		textureCache->AddReference(texture);
+
+		m_Mutex.Lock();
+		const TextureID textureID = m_Residency.AddTexture(width, height, numMips);
+
+		StreamedTexture streamedTexture{};
+		streamedTexture.Target = texture;
+		streamedTexture.Desc = RequestLog::TextureDesc{ width, height, numMips };
+		streamedTexture.CookedPath = cookedPath;
+		streamedTexture.GPUMip = tail.FirstMip;
+		m_Textures.push_back(streamedTexture);
+		m_TextureLookup[texture] = textureID;
+
+		if (m_Recording) m_RecordedLog.Textures.push_back(streamedTexture.Desc);
+		m_Mutex.Unlock();
+
+		m_LoadMutex.Unlock();
+		return texture;
+	}
+
+	void TextureStreamer::Request(const Texture* texture, float screenSize)
+	{
+		m_Mutex.Lock();
+		const auto it = m_TextureLookup.find(texture);
+		if (it != m_TextureLookup.end())
+		{
+			m_Residency.Request(it->second, screenSize);
+			if (m_Recording) m_RecordedLog.Requests.push_back(RequestLog::Request{ m_RecordedLog.NumFrames, it->second, screenSize });
+		}
+		m_Mutex.Unlock();
+	}
+
+	void TextureStreamer::StartUpload(StreamedTexture& streamedTexture, uint32_t firstMip)
+	{
+		std::shared_ptr<MipUpload> upload = std::make_shared<MipUpload>();
+		upload->CookedPath = streamedTexture.CookedPath;
+		upload->FirstMip = firstMip;
+		streamedTexture.Upload = upload;
+		m_UploadsInFlight++;
+
+		MipUploadTask* task = new MipUploadTask(upload);
+		task->SetPriority(RenderTaskPriority::Low);
+		RenderThreadPool::Get()->Submit(task);
+	}
+
+	void TextureStreamer::Update(GraphicsContext& context)
+	{
+		PROFILE_SECTION_CPU("TextureStreamer::Update");
+
+		m_Mutex.Lock();
+
+		// Upload is done once its command list is submitted, so everything submitted from now on sees the new mips
+		for (StreamedTexture& streamedTexture : m_Textures)
+		{
+			if (!streamedTexture.Upload || !streamedTexture.Upload->Done) continue;
+
+			MipUpload& upload = *streamedTexture.Upload;
+			if (upload.Result)
+			{
+				SwapTextureResources(*streamedTexture.Target, *upload.Result);
+				GFX::Cmd::Delete(context, upload.Result);
+				streamedTexture.GPUMip = upload.FirstMip;
+			}
+			else
+			{
+				streamedTexture.Failed = true;
+			}
+
+			streamedTexture.Upload = nullptr;
+			m_UploadsInFlight--;
+		}
+
+		m_Changes.clear();
+		m_Residency.Update(m_Changes);
+
+		// Textures with an upload in flight catch up with their residency once it's done
+		for (TextureID textureID = 0; textureID < m_Textures.size(); textureID++)
+		{
+			StreamedTexture& streamedTexture = m_Textures[textureID];
+			const uint32_t residentMip = m_Residency.GetResidentMip(textureID);
+			if (!streamedTexture.Upload && !streamedTexture.Failed && streamedTexture.GPUMip != residentMip) StartUpload(streamedTexture, residentMip);
+		}
+
+		if (m_Recording) m_RecordedLog.NumFrames++;
+
+		m_Mutex.Unlock();
+	}
+
+	void TextureStreamer::Free(GraphicsContext& context)
+	{
+		m_Mutex.Lock();
+
+		for (StreamedTexture& streamedTexture : m_Textures)
+		{
+			if (streamedTexture.Upload)
+			{
+				streamedTexture.Upload->Cancelled = true;
+				while (!streamedTexture.Upload->Done) MTR::ThreadSleepMS(1);
+				if (streamedTexture.Upload->Result) GFX::Cmd::Delete(context, streamedTexture.Upload->Result);
+			}
+			TextureCache::Get()->Release(context, streamedTexture.Target);
+		}
+
+		m_Textures.clear();
+		m_TextureLookup.clear();
+		m_Residency = ResidencyManager{ m_Residency.GetSettings() };
+		m_UploadsInFlight = 0;
+		m_RecordedLog = RequestLog{};
+
+		m_Mutex.Unlock();
+	}
+
+	void TextureStreamer::SetSettings(const ResidencySettings& settings)
+	{
+		m_Mutex.Lock();
+		m_Residency.SetSettings(settings);
+		m_Mutex.Unlock();
+	}
+
+	ResidencySettings TextureStreamer::GetSettings()
+	{
+		m_Mutex.Lock();
+		const ResidencySettings settings = m_Residency.GetSettings();
+		m_Mutex.Unlock();
+		return settings;
+	}
+
+	ResidencyStats TextureStreamer::GetStats()
+	{
+		m_Mutex.Lock();
+		const ResidencyStats stats = m_Residency.GetStats();
+		m_Mutex.Unlock();
+		return stats;
+	}
+
+	uint64_t TextureStreamer::GetResidentBytes()
+	{
+		m_Mutex.Lock();
+		const uint64_t residentBytes = m_Residency.GetResidentBytes();
+		m_Mutex.Unlock();
+		return residentBytes;
+	}
+
+	void TextureStreamer::SetRecording(bool recording)
+	{
+		m_Mutex.Lock();
+		if (recording && !m_Recording)
+		{
+			// Log starts with every texture that is already streamed so texture IDs match the residency manager
+			m_RecordedLog = RequestLog{};
+			for (const StreamedTexture& streamedTexture : m_Textures) m_RecordedLog.Textures.push_back(streamedTexture.Desc);
+		}
+		m_Recording = recording;
+		m_Mutex.Unlock();
+	}
+
+	RequestLog TextureStreamer::GetRecordedLog()
+	{
+		m_Mutex.Lock();
+		const RequestLog log = m_RecordedLog;
+		m_Mutex.Unlock();
+		return log;
+	}
+}
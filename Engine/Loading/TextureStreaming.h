@@ -0,0 +1,223 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Common.h"
+#include "Utility/Multithreading.h"
+
+struct Texture;
+struct GraphicsContext;
+
+namespace TextureStreaming
+{
+	using TextureID = uint32_t;
+
+	struct MipUpload;
+
+	struct ResidencySettings
+	{
+		// Mips above the tail are evicted to stay under the budget, tails are never evicted
+		uint64_t BudgetBytes = 256ull * 1024 * 1024;
+
+		// Mips of at most TailSize x TailSize are resident from the load
+		uint32_t TailSize = 64;
+
+		// Limits uploads started in one frame
+		uint32_t MaxPromotionsPerUpdate = 4;
+
+		// Added to the wanted mip, negative values keep sharper mips
+		float MipBias = 0.0f;
+	};
+
+	struct ResidencyStats
+	{
+		uint64_t NumRequests = 0;
+		uint64_t NumMissedRequests = 0;	// Wanted mip wasn't resident in the frame it was requested
+		uint64_t NumPromotions = 0;
+		uint64_t NumEvictions = 0;
+		uint64_t PromotedBytes = 0;
+		uint64_t EvictedBytes = 0;
+		uint64_t PeakResidentBytes = 0;
+		uint64_t NumOverBudgetFrames = 0;	// Nothing was left to evict
+	};
+
+	// Resident mip of a texture changed, every mip from NewMip to the last one is resident after the change
+	struct MipChange
+	{
+		TextureID Texture = 0;
+		uint32_t OldMip = 0;
+		uint32_t NewMip = 0;
+	};
+
+	// Decides which mips of R8G8B8A8 textures are resident, doesn't touch the GPU so it can be replayed without a graphics context.
+	// Textures are promoted to the mip that matches the largest screen space size requested in a frame.
+	// Mips that aren't wanted anymore stay resident until the budget is needed, least recently requested textures are evicted first.
+	class ResidencyManager
+	{
+	public:
+		ResidencyManager(const ResidencySettings& settings = {}) :
+			m_Settings(settings)
+		{}
+
+		// Texture starts with its tail resident
+		TextureID AddTexture(uint32_t width, uint32_t height, uint32_t numMips);
+
+		// Screen space size in pixels of the largest surface the texture is drawn on, the largest request of a frame is kept
+		void Request(TextureID texture, float screenSize);
+
+		// Ends the frame, evictions and promotions are appended to changes and are considered resident right away
+		void Update(std::vector<MipChange>& changes);
+
+		void SetSettings(const ResidencySettings& settings) { m_Settings = settings; }
+		const ResidencySettings& GetSettings() const { return m_Settings; }
+
+		uint32_t GetTextureCount() const { return (uint32_t) m_Textures.size(); }
+		uint32_t GetResidentMip(TextureID texture) const { return m_Textures[texture].ResidentMip; }
+		uint32_t GetTailMip(TextureID texture) const { return m_Textures[texture].TailMip; }
+		uint64_t GetResidentBytes() const { return m_ResidentBytes; }
+		uint64_t GetResidentBytes(TextureID texture) const;
+		const ResidencyStats& GetStats() const { return m_Stats; }
+		void ResetStats() { m_Stats = ResidencyStats{}; }
+
+	private:
+		struct TextureState
+		{
+			uint32_t Width = 0;
+			uint32_t Height = 0;
+			uint32_t NumMips = 0;
+			uint32_t TailMip = 0;
+			uint32_t ResidentMip = 0;
+			uint32_t WantedMip = 0;
+			float RequestedSize = 0.0f;
+			uint64_t LastRequestFrame = 0;
+		};
+
+		// Textures with resident mips they don't want, least recently requested first
+		struct EvictionQueue
+		{
+			std::vector<TextureID> Textures;
+			uint32_t Next = 0;
+			uint64_t ReclaimableBytes = 0;
+		};
+
+		uint64_t GetChainBytes(const TextureState& texture, uint32_t firstMip) const;
+		uint32_t GetWantedMip(const TextureState& texture) const;
+
+		// Evicts until bytes fit the budget, nothing is evicted when that isn't possible
+		bool MakeRoom(uint64_t bytes, EvictionQueue& queue, std::vector<MipChange>& changes);
+		void Evict(uint64_t targetBytes, EvictionQueue& queue, std::vector<MipChange>& changes);
+
+		void SetResidentMip(TextureID texture, uint32_t mip, std::vector<MipChange>& changes);
+
+	private:
+		ResidencySettings m_Settings;
+		std::vector<TextureState> m_Textures;
+		uint64_t m_ResidentBytes = 0;
+		uint64_t m_Frame = 0;
+		ResidencyStats m_Stats;
+	};
+
+	// Mip requests of every frame, recorded by TextureStreamer and replayed on the CPU to check and tune residency
+	struct RequestLog
+	{
+		struct TextureDesc
+		{
+			uint32_t Width = 0;
+			uint32_t Height = 0;
+			uint32_t NumMips = 0;
+		};
+
+		struct Request
+		{
+			uint32_t Frame = 0;
+			TextureID Texture = 0;
+			float ScreenSize = 0.0f;
+		};
+
+		std::vector<TextureDesc> Textures;
+		std::vector<Request> Requests;	// Sorted by frame
+		uint32_t NumFrames = 0;
+	};
+
+	bool WriteRequestLog(const std::string& path, const RequestLog& log);
+	bool ReadRequestLog(const std::string& path, RequestLog& log);
+
+	struct ReplayReport
+	{
+		ResidencyStats Stats;
+		uint64_t FinalResidentBytes = 0;
+
+		// Broken residency invariants, every error is logged
+		uint32_t NumErrors = 0;
+	};
+
+	// Runs a residency manager over the log and validates its state after every frame
+	ReplayReport Replay(const RequestLog& log, const ResidencySettings& settings);
+
+	// Streams textures from cooked mip chains (see TextureLoading::CookMipChain).
+	// Load uploads only the tail, higher mips are read and uploaded on the RenderThreadPool as ResidencyManager promotes them.
+	// Texture pointers stay valid for the lifetime of the streamer, the GPU resource behind them is swapped once an upload is submitted.
+	// Streamed textures are owned by the TextureCache, the streamer holds one reference to each of them.
+	class TextureStreamer
+	{
+	public:
+		TextureStreamer(const ResidencySettings& settings = {}) :
+			m_Residency(settings)
+		{}
+		~TextureStreamer();
+
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+		// Thread safe, cooks the mip chain when it's missing or older than the source, returned texture has a reference for the caller
+		Texture* Load(GraphicsContext& context, const std::string& path);
+
+		// Ignores textures that aren't streamed
+		void Request(const Texture* texture, float screenSize);
+
+		// Swaps in finished uploads and starts uploads for changed residency, called once per frame from the main thread
+		void Update(GraphicsContext& context);
+
+		// Waits for uploads in flight and releases the streamer references
+		void Free(GraphicsContext& context);
+
+		void SetSettings(const ResidencySettings& settings);
+		ResidencySettings GetSettings();
+		ResidencyStats GetStats();
+		uint64_t GetResidentBytes();
+		uint32_t GetUploadsInFlight() const { return m_UploadsInFlight; }
+
+		// Requests are recorded into the log while recording is on
+		void SetRecording(bool recording);
+		bool IsRecording() const { return m_Recording; }
+		RequestLog GetRecordedLog();
+
+	private:
+		struct StreamedTexture
+		{
+			Texture* Target = nullptr;
+			RequestLog::TextureDesc Desc;
+			std::string CookedPath;
+			uint32_t GPUMip = 0;	// First mip of the texture on the GPU
+			bool Failed = false;	// Cooked mip chain couldn't be read, texture stays at its current mips
+			std::shared_ptr<MipUpload> Upload;
+		};
+
+		void StartUpload(StreamedTexture& streamedTexture, uint32_t firstMip);
+
+	private:
+		MTR::Mutex m_Mutex;
+		MTR::Mutex m_LoadMutex;
+
+		ResidencyManager m_Residency;
+		std::vector<StreamedTexture> m_Textures;
+		std::unordered_map<const Texture*, TextureID> m_TextureLookup;
+		std::vector<MipChange> m_Changes;
+		uint32_t m_UploadsInFlight = 0;
+
+		bool m_Recording = false;
+		RequestLog m_RecordedLog;
+	};
+}
@@ -0,0 +1,256 @@
+#include "VertexQuantization.h"
+
+#include <DirectXPackedVector.h>
+
+namespace VertexQuantization
+{
+	static uint16_t PackSnorm16(float value)
+	{
+		const float clamped = std::clamp(value, -1.0f, 1.0f);
+		return static_cast<uint16_t>(static_cast<int16_t>(std::round(clamped * 32767.0f)));
+	}
+
+	static float UnpackSnorm16(uint16_t value)
+	{
+		return std::max(static_cast<int16_t>(value) / 32767.0f, -1.0f);
+	}
+
+	// Sign that never returns 0, has to match with the decode on GPU
+	static float SignNotZero(float value)
+	{
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	static Float3 NormalizeSafe(const Float3& value)
+	{
+		const float length = std::sqrt(value.x * value.x + value.y * value.y + value.z * value.z);
+		return length > 0.0f ? Float3{ value.x / length, value.y / length, value.z / length } : Float3{ 0.0f, 0.0f, 1.0f };
+	}
+
+	static float AngleDegrees(const Float3& a, const Float3& b)
+	{
+		const Float3 na = NormalizeSafe(a);
+		const Float3 nb = NormalizeSafe(b);
+		const float cosAngle = std::clamp(na.x * nb.x + na.y * nb.y + na.z * nb.z, -1.0f, 1.0f);
+		return std::acos(cosAngle) * 180.0f / DirectX::XM_PI;
+	}
+
+	uint32_t PackHalf2(const Float2& value)
+	{
+		const uint32_t x = DirectX::PackedVector::XMConvertFloatToHalf(value.x);
+		const uint32_t y = DirectX::PackedVector::XMConvertFloatToHalf(value.y);
+		return x | (y << 16);
+	}
+
+	Float2 UnpackHalf2(uint32_t packed)
+	{
+		const float x = DirectX::PackedVector::XMConvertHalfToFloat(static_cast<DirectX::PackedVector::HALF>(packed & 0xFFFF));
+		const float y = DirectX::PackedVector::XMConvertHalfToFloat(static_cast<DirectX::PackedVector::HALF>(packed >> 16));
+		return Float2{ x, y };
+	}
+
+	uint32_t PackOctahedral(const Float3& normal)
+	{
+		const float l1Norm = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+		if (l1Norm == 0.0f) return 0;
+
+		float u = normal.x / l1Norm;
+		float v = normal.y / l1Norm;
+
+		// Fold the lower hemisphere over the diagonals
+		if (normal.z < 0.0f)
+		{
+			const float foldedU = (1.0f - std::abs(v)) * SignNotZero(u);
+			const float foldedV = (1.0f - std::abs(u)) * SignNotZero(v);
+			u = foldedU;
+			v = foldedV;
+		}
+
+		return PackSnorm16(u) | (static_cast<uint32_t>(PackSnorm16(v)) << 16);
+	}
+
+	Float3 UnpackOctahedral(uint32_t packed)
+	{
+		const float u = UnpackSnorm16(static_cast<uint16_t>(packed & 0xFFFF));
+		const float v = UnpackSnorm16(static_cast<uint16_t>(packed >> 16));
+
+		Float3 normal{ u, v, 1.0f - std::abs(u) - std::abs(v) };
+		const float fold = std::max(-normal.z, 0.0f);
+		normal.x += u >= 0.0f ? -fold : fold;
+		normal.y += v >= 0.0f ? -fold : fold;
+		return NormalizeSafe(normal);
+	}
+
+	uint32_t PackTangent(const Float4& tangent)
+	{
+		const uint32_t packed = PackOctahedral(Float3{ tangent.x, tangent.y, tangent.z });
+		return (packed & ~1u) | (tangent.w < 0.0f ? 1u : 0u);
+	}
+
+	Float4 UnpackTangent(uint32_t packed)
+	{
+		const Float3 direction = UnpackOctahedral(packed);
+		return Float4{ direction.x, direction.y, direction.z, (packed & 1u) ? -1.0f : 1.0f };
+	}
+
+	uint32_t PackWeights(const Float4& weights)
+	{
+		const float source[4] = { weights.x, weights.y, weights.z, weights.w };
+		const float weightSum = source[0] + source[1] + source[2] + source[3];
+		if (weightSum <= 0.0f) return 0;
+
+		int quantized[4];
+		int quantizedSum = 0;
+		uint32_t largest = 0;
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			quantized[i] = static_cast<int>(std::round(std::max(source[i], 0.0f) / weightSum * 255.0f));
+			quantizedSum += quantized[i];
+			if (source[i] > source[largest]) largest = i;
+		}
+
+		// Rounding error goes to the most influential joint so skinned positions don't scale
+		quantized[largest] = std::clamp(quantized[largest] + 255 - quantizedSum, 0, 255);
+
+		uint32_t packed = 0;
+		for (uint32_t i = 0; i < 4; i++) packed |= static_cast<uint32_t>(quantized[i]) << (i * 8);
+		return packed;
+	}
+
+	Float4 UnpackWeights(uint32_t packed)
+	{
+		return Float4{
+			(packed & 0xFF) / 255.0f,
+			((packed >> 8) & 0xFF) / 255.0f,
+			((packed >> 16) & 0xFF) / 255.0f,
+			(packed >> 24) / 255.0f };
+	}
+
+	uint32_t PackJoints(const uint32_t* joints)
+	{
+		uint32_t packed = 0;
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			ASSERT(joints[i] <= 0xFF, "[VertexQuantization] Joint index doesn't fit in 8 bits");
+			packed |= (joints[i] & 0xFF) << (i * 8);
+		}
+		return packed;
+	}
+
+	void UnpackJoints(uint32_t packed, uint32_t* joints)
+	{
+		for (uint32_t i = 0; i < 4; i++) joints[i] = (packed >> (i * 8)) & 0xFF;
+	}
+
+	bool CanQuantize(const ModelLoading::MeshStreams& streams)
+	{
+		if (!streams.Positions) return false;
+		if (!IsSkinned(streams)) return true;
+
+		for (uint32_t i = 0; i < streams.NumVertices * 4; i++)
+		{
+			if (streams.Joints[i] > 0xFF) return false;
+		}
+		return true;
+	}
+
+	bool IsSkinned(const ModelLoading::MeshStreams& streams)
+	{
+		return streams.Joints && streams.Weights;
+	}
+
+	uint32_t GetVertexStride(const ModelLoading::MeshStreams& streams)
+	{
+		return IsSkinned(streams) ? sizeof(SkinnedVertex) : sizeof(Vertex);
+	}
+
+	template<typename VertexType>
+	static void FillVertex(const ModelLoading::MeshStreams& streams, uint32_t index, VertexType& vertex)
+	{
+		vertex.Position = streams.Positions[index];
+		vertex.Texcoord = streams.Texcoords ? PackHalf2(streams.Texcoords[index]) : 0;
+		vertex.Normal = streams.Normals ? PackOctahedral(streams.Normals[index]) : 0;
+		vertex.Tangent = streams.Tangents ? PackTangent(streams.Tangents[index]) : 0;
+	}
+
+	std::vector<uint8_t> Quantize(const ModelLoading::MeshStreams& streams)
+	{
+		ASSERT(CanQuantize(streams), "[VertexQuantization] Mesh can't be quantized");
+
+		const uint32_t stride = GetVertexStride(streams);
+		std::vector<uint8_t> vertices(static_cast<size_t>(stride) * streams.NumVertices);
+
+		if (IsSkinned(streams))
+		{
+			SkinnedVertex* skinnedVertices = reinterpret_cast<SkinnedVertex*>(vertices.data());
+			for (uint32_t i = 0; i < streams.NumVertices; i++)
+			{
+				SkinnedVertex& vertex = skinnedVertices[i];
+				FillVertex(streams, i, vertex);
+				vertex.Joints = PackJoints(streams.Joints + i * 4);
+				vertex.Weights = PackWeights(streams.Weights[i]);
+			}
+		}
+		else
+		{
+			Vertex* staticVertices = reinterpret_cast<Vertex*>(vertices.data());
+			for (uint32_t i = 0; i < streams.NumVertices; i++)
+			{
+				FillVertex(streams, i, staticVertices[i]);
+			}
+		}
+
+		return vertices;
+	}
+
+	QuantizationError MeasureError(const ModelLoading::MeshStreams& streams, const std::vector<uint8_t>& quantizedVertices)
+	{
+		QuantizationError error{};
+
+		const bool skinned = IsSkinned(streams);
+		const uint32_t stride = GetVertexStride(streams);
+		ASSERT(quantizedVertices.size() == static_cast<size_t>(stride) * streams.NumVertices, "[VertexQuantization] Quantized vertices don't match with the mesh");
+
+		for (uint32_t i = 0; i < streams.NumVertices; i++)
+		{
+			const Vertex& vertex = *reinterpret_cast<const Vertex*>(quantizedVertices.data() + static_cast<size_t>(i) * stride);
+
+			if (streams.Texcoords)
+			{
+				const Float2 texcoord = UnpackHalf2(vertex.Texcoord);
+				error.Texcoord = std::max(error.Texcoord, std::abs(texcoord.x - streams.Texcoords[i].x));
+				error.Texcoord = std::max(error.Texcoord, std::abs(texcoord.y - streams.Texcoords[i].y));
+			}
+
+			if (streams.Normals)
+			{
+				error.NormalDegrees = std::max(error.NormalDegrees, AngleDegrees(streams.Normals[i], UnpackOctahedral(vertex.Normal)));
+			}
+
+			if (streams.Tangents)
+			{
+				const Float4& source = streams.Tangents[i];
+				const Float4 tangent = UnpackTangent(vertex.Tangent);
+				error.TangentDegrees = std::max(error.TangentDegrees, AngleDegrees(Float3{ source.x, source.y, source.z }, Float3{ tangent.x, tangent.y, tangent.z }));
+				if ((source.w < 0.0f) != (tangent.w < 0.0f)) error.TangentSignMismatches++;
+			}
+
+			if (skinned)
+			{
+				const SkinnedVertex& skinnedVertex = static_cast<const SkinnedVertex&>(vertex);
+				const Float4& source = streams.Weights[i];
+				const float weightSum = source.x + source.y + source.z + source.w;
+				if (weightSum > 0.0f)
+				{
+					const Float4 weights = UnpackWeights(skinnedVertex.Weights);
+					error.Weight = std::max(error.Weight, std::abs(weights.x - source.x / weightSum));
+					error.Weight = std::max(error.Weight, std::abs(weights.y - source.y / weightSum));
+					error.Weight = std::max(error.Weight, std::abs(weights.z - source.z / weightSum));
+					error.Weight = std::max(error.Weight, std::abs(weights.w - source.w / weightSum));
+				}
+			}
+		}
+
+		return error;
+	}
+}
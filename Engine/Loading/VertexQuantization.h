@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Loading/ModelLoading.h"
+
+// Interleaved vertex layout with quantized attributes, used when LoaderSettings::QuantizeVertices is set.
+// Decoding on GPU side must match with Application/Common/quantized_vertex.h
+namespace VertexQuantization
+{
+	struct Vertex
+	{
+		Float3 Position;
+		uint32_t Texcoord;	// half2
+		uint32_t Normal;	// octahedral snorm16x2
+		uint32_t Tangent;	// octahedral snorm16x2, bitangent sign in the lowest bit of x
+	};
+
+	struct SkinnedVertex : Vertex
+	{
+		uint32_t Joints;	// uint8x4
+		uint32_t Weights;	// unorm8x4
+	};
+
+	static_assert(sizeof(Vertex) == 24);
+	static_assert(sizeof(SkinnedVertex) == 32);
+
+	// Byte size of a vertex in the separate float streams that are used when quantization is off
+	constexpr uint32_t UnquantizedVertexSize = sizeof(Float3) + sizeof(Float2) + sizeof(Float3) + sizeof(Float4) + sizeof(Float4) + sizeof(uint32_t) * 4;
+
+	uint32_t PackHalf2(const Float2& value);
+	Float2 UnpackHalf2(uint32_t packed);
+
+	uint32_t PackOctahedral(const Float3& normal);
+	Float3 UnpackOctahedral(uint32_t packed);
+
+	uint32_t PackTangent(const Float4& tangent);
+	Float4 UnpackTangent(uint32_t packed);
+
+	// Weights are normalized so the quantized ones always sum up to 255
+	uint32_t PackWeights(const Float4& weights);
+	Float4 UnpackWeights(uint32_t packed);
+
+	uint32_t PackJoints(const uint32_t* joints);
+	void UnpackJoints(uint32_t packed, uint32_t* joints);
+
+	// Meshes with joint indices that don't fit in 8 bits can't be quantized
+	bool CanQuantize(const ModelLoading::MeshStreams& streams);
+	bool IsSkinned(const ModelLoading::MeshStreams& streams);
+	uint32_t GetVertexStride(const ModelLoading::MeshStreams& streams);
+
+	std::vector<uint8_t> Quantize(const ModelLoading::MeshStreams& streams);
+
+	// Max difference between the source streams and the decoded quantized vertices
+	struct QuantizationError
+	{
+		float NormalDegrees = 0.0f;
+		float TangentDegrees = 0.0f;
+		float Texcoord = 0.0f;
+		float Weight = 0.0f;
+		uint32_t TangentSignMismatches = 0;
+	};
+
+	QuantizationError MeasureError(const ModelLoading::MeshStreams& streams, const std::vector<uint8_t>& quantizedVertices);
+}
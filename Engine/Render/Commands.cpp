@@ -125,6 +125,12 @@ namespace GFX::Cmd
 		
 		WaitToFinish(context);
 
+		const uint64_t completedFenceValue = context.CmdFence.Handle->GetCompletedValue();
+		context.UploadMemory.Reclaim(completedFenceValue);
+		context.TransientDescriptors.Reclaim(completedFenceValue);
+		context.TransientSamplers.Reclaim(completedFenceValue);
+		context.TableStats = {};
+
 		// Clear inframe resources
 		{
 			MemoryContext& mem = context.MemContext;
@@ -174,6 +180,12 @@ namespace GFX::Cmd
 		Fence& fence = context.CmdFence;
 		fence.Value++;
 		API_CALL(Device::Get()->GetCommandQueue()->Signal(fence.Handle.Get(), fence.Value));
+
+		context.UploadMemory.Retire(fence.Value);
+		context.TransientDescriptors.Retire(fence.Value);
+		context.TransientSamplers.Retire(fence.Value);
+		context.DescriptorTableCache.clear();
+		context.DescriptorTableSources.clear();
 	}
 
 	void SetPushConstants(uint32_t shaderStages, GraphicsContext& context, const PushConstantTable& values)
@@ -230,73 +242,126 @@ namespace GFX::Cmd
 
 		PROFILE_CMD();
 
-		// Create staging resource
-		Buffer* stagingResource = GFX::CreateBuffer(dataSize, 1, RCF::CPU_Access | RCF::NoSRV);
-		GFX::SetDebugName(stagingResource, "UpdateSubresource::StagingBuffer");
-
-		// Upload data to staging resource
-		GFX::Cmd::UploadToBufferImmediate(stagingResource, 0, data, srcOffset, dataSize);
-		
-		// Copy to buffer
-		const uint32_t copySize = dataSize;
-		TransitionResource(context, buffer, D3D12_RESOURCE_STATE_COPY_DEST);
-		context.CmdList->CopyBufferRegion(buffer->Handle.Get(), dstOffset, stagingResource->Handle.Get(), 0, copySize);
-		
-		GFX::Cmd::Delete(context, stagingResource);
+		UploadBatch batch{ context };
+		batch.AddBuffer(buffer, dstOffset, (const uint8_t*)data + srcOffset, dataSize);
+		batch.Submit();
 	}
 
 	void UploadToTexture(GraphicsContext& context, const void* data, Texture* texture, uint32_t mipIndex, uint32_t arrayIndex)
 	{
 		PROFILE_CMD();
 
-		Device* device = Device::Get();
+		UploadBatch batch{ context };
+		batch.AddTexture(texture, data, mipIndex, arrayIndex);
+		batch.Submit();
+	}
 
-		// Get memory footprints
-		uint32_t subresourceIndex = 0;
+	void UploadToTexture(GraphicsContext& context, Texture* texture, uint32_t mipIndex, uint32_t arrayIndex, const TextureRowWriter& writeRow)
+	{
+		PROFILE_CMD();
+
+		UploadBatch batch{ context };
+		batch.AddTexture(texture, mipIndex, arrayIndex, writeRow);
+		batch.Submit();
+	}
+
+	UploadBatch::~UploadBatch()
+	{
+		ASSERT(m_BufferCopies.empty() && m_TextureCopies.empty(), "[UploadBatch] Uploads were staged but never submitted");
+	}
+
+	void UploadBatch::AddBuffer(Buffer* buffer, uint32_t dstOffset, const void* data, uint32_t dataSize)
+	{
+		if (dataSize == 0) return;
+
+		ASSERT(dstOffset + dataSize <= buffer->ByteSize, "[UploadBatch] Upload is out of the buffer bounds");
+
+		const UploadAllocation staging = m_Context.UploadMemory.Upload(data, dataSize, 16);
+		m_BufferCopies.push_back({ buffer, dstOffset, staging, dataSize });
+	}
+
+	void UploadBatch::AddTexture(Texture* texture, const void* data, uint32_t mipIndex, uint32_t arrayIndex)
+	{
+		uint32_t numRows;
+		uint64_t rowByteSize;
+		uint8_t* stagingData = StageTexture(texture, mipIndex, arrayIndex, numRows, rowByteSize);
+		const D3D12_SUBRESOURCE_FOOTPRINT& footprint = m_TextureCopies.back().Layout.Footprint;
+
+		// Source data is tightly packed, pitch of the texture is only valid for the first mip
 		D3D12_SUBRESOURCE_DATA subresourceData{};
 		subresourceData.pData = data;
-		subresourceIndex = GFX::GetSubresourceIndex(texture, mipIndex, arrayIndex);
-		subresourceData.RowPitch = texture->RowPitch;
-		subresourceData.SlicePitch = texture->SlicePitch;
+		subresourceData.RowPitch = rowByteSize;
+		subresourceData.SlicePitch = rowByteSize * numRows;
+
+		D3D12_MEMCPY_DEST destData = { stagingData, footprint.RowPitch, (uint64_t)footprint.RowPitch * numRows };
+		MemcpySubresource(&destData, &subresourceData, (uint32_t)rowByteSize, numRows, footprint.Depth);
+	}
 
+	void UploadBatch::AddTexture(Texture* texture, uint32_t mipIndex, uint32_t arrayIndex, const TextureRowWriter& writeRow)
+	{
+		uint32_t numRows;
+		uint64_t rowByteSize;
+		uint8_t* stagingData = StageTexture(texture, mipIndex, arrayIndex, numRows, rowByteSize);
+		const D3D12_SUBRESOURCE_FOOTPRINT& footprint = m_TextureCopies.back().Layout.Footprint;
+
+		ASSERT(footprint.Depth == 1, "[UploadBatch] Row writer doesn't support 3D textures");
+		for (uint32_t row = 0; row < numRows; row++)
+		{
+			writeRow(stagingData + (uint64_t)row * footprint.RowPitch, row);
+		}
+	}
+
+	uint8_t* UploadBatch::StageTexture(Texture* texture, uint32_t mipIndex, uint32_t arrayIndex, uint32_t& numRows, uint64_t& rowByteSize)
+	{
+		TextureCopy copy{};
+		copy.Destination = texture;
+		copy.SubresourceIndex = GFX::GetSubresourceIndex(texture, mipIndex, arrayIndex);
+
+		// Get memory footprints
 		uint64_t resourceSize;
-		D3D12_PLACED_SUBRESOURCE_FOOTPRINT subresLayout;
-		uint32_t subresRowNumber;
-		uint64_t subresRowByteSizes;
-
-		ID3D12Resource* dxResource = texture->Handle.Get();
-		D3D12_RESOURCE_DESC resourceDesc = dxResource->GetDesc();
-		ID3D12Device* resourceDevice;
-		dxResource->GetDevice(__uuidof(*resourceDevice), reinterpret_cast<void**>(&resourceDevice));
-		resourceDevice->GetCopyableFootprints(&resourceDesc, subresourceIndex, 1, 0, &subresLayout, &subresRowNumber, &subresRowByteSizes, &resourceSize);
-		resourceDevice->Release();
-
-		// Create staging resource
-		Buffer* stagingResource = GFX::CreateBuffer((uint32_t)resourceSize, 1, RCF::CPU_Access | RCF::NoSRV);
-		GFX::SetDebugName(stagingResource, "UpdateSubresource::StagingBuffer");
-
-		// Upload data to staging resource
-		uint8_t* stagingDataPtr;
-		API_CALL(stagingResource->Handle->Map(0, NULL, reinterpret_cast<void**>(&stagingDataPtr)));
-		D3D12_MEMCPY_DEST DestData = { stagingDataPtr + subresLayout.Offset, subresLayout.Footprint.RowPitch, (uint64_t)subresLayout.Footprint.RowPitch * subresRowNumber };
-		MemcpySubresource(&DestData, &subresourceData, (uint32_t)subresRowByteSizes, subresRowNumber, subresLayout.Footprint.Depth);
-		stagingResource->Handle->Unmap(0, NULL);
-
-		// Copy to texture
-		D3D12_TEXTURE_COPY_LOCATION dst{};
-		dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-		dst.pResource = texture->Handle.Get();
-		dst.SubresourceIndex = subresourceIndex;
-
-		D3D12_TEXTURE_COPY_LOCATION src{};
-		src.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
-		src.pResource = stagingResource->Handle.Get();
-		src.PlacedFootprint = subresLayout;
-
-		TransitionResource(context, texture, D3D12_RESOURCE_STATE_COPY_DEST);
-		context.CmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
-
-		GFX::Cmd::Delete(context, stagingResource);
+		const D3D12_RESOURCE_DESC resourceDesc = texture->Handle->GetDesc();
+		Device::Get()->GetHandle()->GetCopyableFootprints(&resourceDesc, copy.SubresourceIndex, 1, 0, &copy.Layout, &numRows, &rowByteSize, &resourceSize);
+
+		// Footprint is placed at the allocation in the page it was sub-allocated from
+		copy.Source = m_Context.UploadMemory.Allocate(resourceSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+		uint8_t* stagingData = copy.Source.CPUAddress + copy.Layout.Offset;
+		copy.Layout.Offset += copy.Source.Offset;
+
+		m_TextureCopies.push_back(copy);
+		return stagingData;
+	}
+
+	void UploadBatch::Submit()
+	{
+		PROFILE_CMD();
+
+		std::vector<D3D12_RESOURCE_BARRIER> barriers;
+		for (const BufferCopy& copy : m_BufferCopies) AddResourceTransition(barriers, copy.Destination, D3D12_RESOURCE_STATE_COPY_DEST);
+		for (const TextureCopy& copy : m_TextureCopies) AddResourceTransition(barriers, copy.Destination, D3D12_RESOURCE_STATE_COPY_DEST);
+		if (!barriers.empty()) m_Context.CmdList->ResourceBarrier((UINT)barriers.size(), barriers.data());
+
+		for (const BufferCopy& copy : m_BufferCopies)
+		{
+			m_Context.CmdList->CopyBufferRegion(copy.Destination->Handle.Get(), copy.DstOffset, copy.Source.Resource->Handle.Get(), copy.Source.Offset, copy.ByteSize);
+		}
+
+		for (const TextureCopy& copy : m_TextureCopies)
+		{
+			D3D12_TEXTURE_COPY_LOCATION dst{};
+			dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+			dst.pResource = copy.Destination->Handle.Get();
+			dst.SubresourceIndex = copy.SubresourceIndex;
+
+			D3D12_TEXTURE_COPY_LOCATION src{};
+			src.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+			src.pResource = copy.Source.Resource->Handle.Get();
+			src.PlacedFootprint = copy.Layout;
+
+			m_Context.CmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+		}
+
+		m_BufferCopies.clear();
+		m_TextureCopies.clear();
 	}
 
 	void CopyToTexture(GraphicsContext& context, Texture* srcTexture, Texture* dstTexture, uint32_t mipIndex)
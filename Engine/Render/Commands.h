@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <vector>
 
 #include "Render/Device.h"
@@ -41,6 +42,50 @@ namespace GFX::Cmd
 	void UploadToBufferImmediate(Buffer* buffer, uint32_t dstOffset, const void* data, uint32_t srcOffset, uint32_t dataSize);
 	void UploadToBuffer(GraphicsContext& context, Buffer* buffer, uint32_t dstOffset, const void* data, uint32_t srcOffset, uint32_t dataSize);
 	void UploadToTexture(GraphicsContext& context, const void* data, Texture* texture, uint32_t mipIndex = 0, uint32_t arrayIndex = 0);
+
+	// Data is written straight into the staging buffer one row at a time (rows of blocks for block compressed formats), so it can be converted without an extra copy
+	using TextureRowWriter = std::function<void(uint8_t* rowData, uint32_t rowIndex)>;
+	void UploadToTexture(GraphicsContext& context, Texture* texture, uint32_t mipIndex, uint32_t arrayIndex, const TextureRowWriter& writeRow);
+
+	// Many uploads staged in the upload memory of the context, copies are recorded on Submit behind one batch of barriers.
+	// Staging memory is reused once the context fence passes the submit, so loaders don't create a staging buffer per upload.
+	class UploadBatch
+	{
+	public:
+		UploadBatch(GraphicsContext& context) : m_Context(context) {}
+		~UploadBatch();
+
+		void AddBuffer(Buffer* buffer, uint32_t dstOffset, const void* data, uint32_t dataSize);
+		void AddTexture(Texture* texture, const void* data, uint32_t mipIndex = 0, uint32_t arrayIndex = 0);
+		void AddTexture(Texture* texture, uint32_t mipIndex, uint32_t arrayIndex, const TextureRowWriter& writeRow);
+
+		void Submit();
+
+	private:
+		struct BufferCopy
+		{
+			Buffer* Destination;
+			uint32_t DstOffset;
+			UploadAllocation Source;
+			uint32_t ByteSize;
+		};
+
+		struct TextureCopy
+		{
+			Texture* Destination;
+			uint32_t SubresourceIndex;
+			UploadAllocation Source;
+			D3D12_PLACED_SUBRESOURCE_FOOTPRINT Layout;
+		};
+
+		uint8_t* StageTexture(Texture* texture, uint32_t mipIndex, uint32_t arrayIndex, uint32_t& numRows, uint64_t& rowByteSize);
+
+	private:
+		GraphicsContext& m_Context;
+		std::vector<BufferCopy> m_BufferCopies;
+		std::vector<TextureCopy> m_TextureCopies;
+	};
+
 	void CopyToTexture(GraphicsContext& context, Texture* srcTexture, Texture* dstTexture, uint32_t mipIndex = 0);
 	void CopyToBuffer(GraphicsContext& context, Buffer* srcBuffer, uint32_t srcOffset, Buffer* dstBuffer, uint32_t dstOffset, uint32_t size);
 
@@ -6,6 +6,7 @@
 #include "Render/Texture.h"
 #include "Render/Buffer.h"
 #include "Render/Shader.h"
+#include "Render/PipelineLibrary.h"
 #include "Utility/Hash.h"
 
 ContextManager* ContextManager::s_Instance = nullptr;
@@ -171,37 +172,133 @@ static D3D12_PRIMITIVE_TOPOLOGY ToPrimitiveTopology(const RenderPrimitiveType pr
 	return D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
 }
 
-static uint32_t CalcRootSignatureHash(const GraphicsState& state)
+// Ranges of the root signature only depend on which slots are bound, slots are packed into bit masks so the hasher gets a word per 64 slots
+template<typename T, size_t Size>
+static void HashBoundSlots(Hash::Hasher& hasher, const BindVector<T, Size>& bindings)
 {
-	uint32_t sigHash = Hash::Crc32(state.PushConstantCount);
-	sigHash = Hash::Crc32(sigHash, "CBV");
-	for (uint32_t i = 0; i < state.Table.CBVs.size(); i++) if(state.Table.CBVs[i]) sigHash = Hash::Crc32(sigHash, i);
-	sigHash = Hash::Crc32(sigHash, "SRV");
-	for (uint32_t i = 0; i < state.Table.SRVs.size(); i++) if (state.Table.SRVs[i]) sigHash = Hash::Crc32(sigHash, i);
-	sigHash = Hash::Crc32(sigHash, "UAV");
-	for (uint32_t i = 0; i < state.Table.UAVs.size(); i++) if (state.Table.UAVs[i]) sigHash = Hash::Crc32(sigHash, i);
-	sigHash = Hash::Crc32(sigHash, "SMP");
-	for (uint32_t i = 0; i < state.Table.SMPs.size(); i++) sigHash = Hash::Crc32(sigHash, i);
-	sigHash = Hash::Crc32(sigHash, "BTS");
+	hasher.Add((uint32_t) bindings.size());
+
+	uint64_t boundMask = 0;
+	for (uint32_t i = 0; i < bindings.size(); i++)
+	{
+		if (bindings[i]) boundMask |= 1ull << (i % 64);
+		if (i % 64 == 63)
+		{
+			hasher.Add(boundMask);
+			boundMask = 0;
+		}
+	}
+	hasher.Add(boundMask);
+}
+
+static PipelineLibrary::RootSignatureHash CalcRootSignatureHash(const GraphicsState& state)
+{
+	Hash::Hasher hasher;
+	hasher.Add(state.PushConstantCount);
+	hasher.Add(state.PushConstantBinding);
+	HashBoundSlots(hasher, state.RootCBVs);
+	HashBoundSlots(hasher, state.Table.CBVs);
+	HashBoundSlots(hasher, state.Table.SRVs);
+	HashBoundSlots(hasher, state.Table.UAVs);
+	hasher.Add((uint32_t) state.Table.SMPs.size());
+	hasher.Add((uint32_t) state.BindlessTables.size());
 	for (const BindlessTable& table : state.BindlessTables)
 	{
-		sigHash = Hash::Crc32(sigHash, "1");
-		sigHash = Hash::Crc32(sigHash, table.RegisterSpace);
-		sigHash = Hash::Crc32(sigHash, "2");
-		sigHash = Hash::Crc32(sigHash, table.DescriptorCount);
-		sigHash = Hash::Crc32(sigHash, "3");
-		sigHash = Hash::Crc32(sigHash, table.DescriptorTable);
+		hasher.Add(table.RegisterSpace);
+		hasher.Add(table.DescriptorCount);
 	}
-	return sigHash;
+	return hasher.Get();
 }
 
-static ID3D12RootSignature* GetOrCreateRootSignature(GraphicsContext& context, const GraphicsState& state)
+static uint32_t GetPipelineSampleCount(const GraphicsState& state)
 {
-	uint32_t rootSignatureHash = CalcRootSignatureHash(state);
-	if (context.RootSignatureCache.contains(rootSignatureHash)) 
-		return context.RootSignatureCache[rootSignatureHash].Get();
+	if (!state.RenderTargets.empty()) return GetSampleCount(state.RenderTargets[0]->CreationFlags);
+	return state.DepthStencil ? GetSampleCount(state.DepthStencil->CreationFlags) : 1;
+}
 
-	ID3D12RootSignature* rootSignature = nullptr;
+// Descs are hashed field by field, their padding isn't initialized so hashing them whole isn't stable between runs
+static void HashBlendState(Hash::Hasher& hasher, const D3D12_BLEND_DESC& blend)
+{
+	uint32_t fields[2 + 8 * 10];
+	uint32_t numFields = 0;
+	fields[numFields++] = blend.AlphaToCoverageEnable;
+	fields[numFields++] = blend.IndependentBlendEnable;
+	for (const D3D12_RENDER_TARGET_BLEND_DESC& rt : blend.RenderTarget)
+	{
+		fields[numFields++] = rt.BlendEnable;
+		fields[numFields++] = rt.LogicOpEnable;
+		fields[numFields++] = rt.SrcBlend;
+		fields[numFields++] = rt.DestBlend;
+		fields[numFields++] = rt.BlendOp;
+		fields[numFields++] = rt.SrcBlendAlpha;
+		fields[numFields++] = rt.DestBlendAlpha;
+		fields[numFields++] = rt.BlendOpAlpha;
+		fields[numFields++] = rt.LogicOp;
+		fields[numFields++] = rt.RenderTargetWriteMask;
+	}
+	hasher.Add(fields, numFields * sizeof(uint32_t));
+}
+
+static void HashDepthStencilState(Hash::Hasher& hasher, const D3D12_DEPTH_STENCIL_DESC& depthStencil)
+{
+	const uint32_t fields[] =
+	{
+		(uint32_t) depthStencil.DepthEnable,
+		(uint32_t) depthStencil.DepthWriteMask,
+		(uint32_t) depthStencil.DepthFunc,
+		(uint32_t) depthStencil.StencilEnable,
+		(uint32_t) depthStencil.StencilReadMask,
+		(uint32_t) depthStencil.StencilWriteMask,
+		(uint32_t) depthStencil.FrontFace.StencilFailOp,
+		(uint32_t) depthStencil.FrontFace.StencilDepthFailOp,
+		(uint32_t) depthStencil.FrontFace.StencilPassOp,
+		(uint32_t) depthStencil.FrontFace.StencilFunc,
+		(uint32_t) depthStencil.BackFace.StencilFailOp,
+		(uint32_t) depthStencil.BackFace.StencilDepthFailOp,
+		(uint32_t) depthStencil.BackFace.StencilPassOp,
+		(uint32_t) depthStencil.BackFace.StencilFunc,
+	};
+	hasher.Add(fields);
+}
+
+// Hash of everything the pipeline desc is built from, pointers are replaced by hashes of what they point to
+static PipelineLibrary::PipelineHash CalcPipelineHash(const GraphicsState& state, const CompiledShader& shader, PipelineLibrary::RootSignatureHash rootSignatureHash)
+{
+	Hash::Hasher hasher;
+	hasher.Add(shader.BytecodeHash);
+	if (!(state.ShaderStages & (CS | MS))) hasher.Add(state.VertexBuffers.size() > 1 ? shader.InputLayoutMultiInputHash : shader.InputLayoutHash);
+
+	hasher.Add(rootSignatureHash);
+	if (!(state.ShaderStages & CS))
+	{
+		HashBlendState(hasher, state.BlendState);
+		hasher.Add(state.RasterizerState);
+		HashDepthStencilState(hasher, state.DepthStencilState);
+		hasher.Add(ToPrimitiveTopologyType(state.PrimitiveType));
+		hasher.Add(state.DepthStencil ? state.DepthStencil->Format : DXGI_FORMAT_R24G8_TYPELESS);
+		hasher.Add((uint32_t) state.RenderTargets.size());
+		for (const Texture* renderTarget : state.RenderTargets) hasher.Add(renderTarget->Format);
+		hasher.Add(GetPipelineSampleCount(state));
+	}
+
+	return hasher.Get();
+}
+
+uint64_t GFX::GetPipelineHash(const GraphicsState& state)
+{
+	const CompiledShader& compShader = GFX::GetCompiledShader(state.Shader, state.ShaderConfig, state.ShaderStages);
+	return CalcPipelineHash(state, compShader, CalcRootSignatureHash(state));
+}
+
+static ID3D12RootSignature* GetOrCreateRootSignature(const GraphicsState& state, PipelineLibrary::RootSignatureHash& rootSignatureHash)
+{
+	PipelineLibrary* pipelineLibrary = PipelineLibrary::Get();
+
+	rootSignatureHash = CalcRootSignatureHash(state);
+	if (ID3D12RootSignature* cachedRootSignature = pipelineLibrary->FindRootSignature(rootSignatureHash))
+		return cachedRootSignature;
+
+	ComPtr<ID3D12RootSignature> rootSignature;
 
 	const BindTable& table = state.Table;
 	std::vector<D3D12_ROOT_PARAMETER> rootParameters;
@@ -235,6 +332,19 @@ static ID3D12RootSignature* GetOrCreateRootSignature(GraphicsContext& context, c
 		rootParameters.push_back(rootParamater);
 	}
 
+	for (uint32_t i = 0; i < state.RootCBVs.size(); i++)
+	{
+		if (!state.RootCBVs[i]) continue;
+		ASSERT(i >= table.CBVs.size() || !table.CBVs[i], "[GraphicsContext::SubmitState] CBV slot is bound both as a root CBV and in the table");
+
+		D3D12_ROOT_PARAMETER rootParamater;
+		rootParamater.ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+		rootParamater.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+		rootParamater.Descriptor.ShaderRegister = i;
+		rootParamater.Descriptor.RegisterSpace = 0;
+		rootParameters.push_back(rootParamater);
+	}
+
 	for (const auto& descriptors : descriptorRanges)
 	{
 		D3D12_ROOT_PARAMETER rootParamater;
@@ -269,18 +379,22 @@ static ID3D12RootSignature* GetOrCreateRootSignature(GraphicsContext& context, c
 
 	Device* device = Device::Get();
 
-	API_CALL(device->GetHandle()->CreateRootSignature(0, serializedRootSig->GetBufferPointer(), serializedRootSig->GetBufferSize(), IID_PPV_ARGS(&rootSignature)));
-
-	context.RootSignatureCache[rootSignatureHash] = rootSignature;
+	API_CALL(device->GetHandle()->CreateRootSignature(0, serializedRootSig->GetBufferPointer(), serializedRootSig->GetBufferSize(), IID_PPV_ARGS(rootSignature.GetAddressOf())));
 
-	return rootSignature;
+	return pipelineLibrary->AddRootSignature(rootSignatureHash, rootSignature);
 }
 
-static ID3D12PipelineState* GetOrCreatePSO(GraphicsContext& context, const GraphicsState& state, ID3D12RootSignature* rootSignature, uint32_t& psoHash)
+static ID3D12PipelineState* GetOrCreatePSO(const GraphicsState& state, ID3D12RootSignature* rootSignature, PipelineLibrary::RootSignatureHash rootSignatureHash, PipelineLibrary::PipelineHash& psoHash)
 {
-	ID3D12PipelineState* pipelineState = nullptr;
+	PipelineLibrary* pipelineLibrary = PipelineLibrary::Get();
 	const CompiledShader& compShader = GFX::GetCompiledShader(state.Shader, state.ShaderConfig, state.ShaderStages);
 
+	psoHash = CalcPipelineHash(state, compShader, rootSignatureHash);
+	if (ID3D12PipelineState* cachedPipelineState = pipelineLibrary->FindPipeline(psoHash))
+		return cachedPipelineState;
+
+	ID3D12PipelineState* pipelineState = nullptr;
+
 	if (state.ShaderStages & CS)
 	{
 		D3D12_COMPUTE_PIPELINE_STATE_DESC pipeline{};
@@ -290,16 +404,7 @@ static ID3D12PipelineState* GetOrCreatePSO(GraphicsContext& context, const Graph
 		pipeline.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
 		pipeline.NodeMask = 0;
 
-		psoHash = Hash::Crc32(pipeline);
-		if (context.PSOCache.contains(psoHash))
-		{
-			pipelineState = context.PSOCache[psoHash].Get();
-		}
-		else
-		{
-			API_CALL(Device::Get()->GetHandle()->CreateComputePipelineState(&pipeline, IID_PPV_ARGS(&pipelineState)));
-			context.PSOCache[psoHash] = pipelineState;
-		}
+		pipelineState = pipelineLibrary->CreateComputePipeline(psoHash, pipeline);
 	}
 	else if (state.ShaderStages & MS)
 	{
@@ -318,27 +423,16 @@ static ID3D12PipelineState* GetOrCreatePSO(GraphicsContext& context, const Graph
 		pipeline.DSVFormat = state.DepthStencil ? state.DepthStencil->Format : DXGI_FORMAT_R24G8_TYPELESS;
 		pipeline.NumRenderTargets = (UINT)state.RenderTargets.size();
 		for (uint32_t i = 0; i < 8; i++) pipeline.RTVFormats[i] = i < pipeline.NumRenderTargets ? state.RenderTargets[i]->Format : DXGI_FORMAT_UNKNOWN;
-		pipeline.SampleDesc.Count = state.RenderTargets.empty() ? (state.DepthStencil ? GetSampleCount(state.DepthStencil->CreationFlags) : 1) : GetSampleCount(state.RenderTargets[0]->CreationFlags);
+		pipeline.SampleDesc.Count = GetPipelineSampleCount(state);
 		pipeline.SampleDesc.Quality = 0;
 
+		auto psoStream = CD3DX12_PIPELINE_MESH_STATE_STREAM(pipeline);
 
+		D3D12_PIPELINE_STATE_STREAM_DESC streamDesc;
+		streamDesc.pPipelineStateSubobjectStream = &psoStream;
+		streamDesc.SizeInBytes = sizeof(psoStream);
 
-		psoHash = Hash::Crc32(pipeline);
-		if (context.PSOCache.contains(psoHash))
-		{
-			pipelineState = context.PSOCache[psoHash].Get();
-		}
-		else
-		{
-			auto psoStream = CD3DX12_PIPELINE_MESH_STATE_STREAM(pipeline);
-
-			D3D12_PIPELINE_STATE_STREAM_DESC streamDesc;
-			streamDesc.pPipelineStateSubobjectStream = &psoStream;
-			streamDesc.SizeInBytes = sizeof(psoStream);
-
-			API_CALL(Device::Get()->GetHandle()->CreatePipelineState(&streamDesc, IID_PPV_ARGS(&pipelineState)));
-			context.PSOCache[psoHash] = pipelineState;
-		}
+		pipelineState = pipelineLibrary->CreatePipeline(psoHash, streamDesc);
 	}
 	else
 	{
@@ -363,19 +457,10 @@ static ID3D12PipelineState* GetOrCreatePSO(GraphicsContext& context, const Graph
 		pipeline.DSVFormat = state.DepthStencil ? state.DepthStencil->Format : DXGI_FORMAT_R24G8_TYPELESS;
 		pipeline.NumRenderTargets = (UINT) state.RenderTargets.size();
 		for (uint32_t i = 0; i < 8; i++) pipeline.RTVFormats[i] = i < pipeline.NumRenderTargets ? state.RenderTargets[i]->Format : DXGI_FORMAT_UNKNOWN;
-		pipeline.SampleDesc.Count = state.RenderTargets.empty() ? (state.DepthStencil ? GetSampleCount(state.DepthStencil->CreationFlags) : 1) : GetSampleCount(state.RenderTargets[0]->CreationFlags);
+		pipeline.SampleDesc.Count = GetPipelineSampleCount(state);
 		pipeline.SampleDesc.Quality = 0;
 
-		psoHash = Hash::Crc32(pipeline);
-		if (context.PSOCache.contains(psoHash))
-		{
-			pipelineState = context.PSOCache[psoHash].Get();
-		}
-		else
-		{
-			API_CALL(Device::Get()->GetHandle()->CreateGraphicsPipelineState(&pipeline, IID_PPV_ARGS(&pipelineState)));
-			context.PSOCache[psoHash] = pipelineState;
-		}
+		pipelineState = pipelineLibrary->CreateGraphicsPipeline(psoHash, pipeline);
 	}
 	return pipelineState;
 }
@@ -397,7 +482,7 @@ static D3D12_CPU_DESCRIPTOR_HANDLE GetSamplerDescriptor(GraphicsContext& context
 	samplerDesc.MinLOD = 0;
 	samplerDesc.MipLODBias = 0;
 	
-	const uint32_t samplerHash = Hash::Crc32(samplerDesc);
+	const uint64_t samplerHash = Hash::Hash64(samplerDesc);
 	if (!context.SamplerCache.contains(samplerHash))
 	{
 		context.SamplerCache[samplerHash] = Device::Get()->GetMemory().SMPHeap->Allocate();
@@ -407,35 +492,80 @@ static D3D12_CPU_DESCRIPTOR_HANDLE GetSamplerDescriptor(GraphicsContext& context
 	return context.SamplerCache[samplerHash].GetCPUHandle();
 }
 
-static DescriptorAllocation CreateDescriptorTable(GraphicsContext& context, const BindVector<Resource*>& bindings, BindingType bindingType)
+static const DescriptorAllocation& GetResourceDescriptor(const Resource* resource, BindingType type)
 {
-	const auto getDescriptor = [](Resource* resource, BindingType type)
+	switch (type)
 	{
-		switch (type)
-		{
-		case BindingType::CBV: return resource->CBV;
-		case BindingType::SRV: return resource->SRV;
-		case BindingType::UAV: return resource->UAV;
-		default: NOT_IMPLEMENTED;
-		}
+	case BindingType::CBV: return resource->CBV;
+	case BindingType::SRV: return resource->SRV;
+	case BindingType::UAV: return resource->UAV;
+	default: NOT_IMPLEMENTED;
+	}
+	return resource->SRV;
+}
 
-		return DescriptorAllocation{};
-	};
+// Tables of the same descriptors are copied once per submit and reuse the GPU handle afterwards.
+// Views are never rewritten in place, a new view gets a new descriptor, so the source handles identify the content of a table.
+static D3D12_GPU_DESCRIPTOR_HANDLE GetDescriptorTable(GraphicsContext& context, const D3D12_CPU_DESCRIPTOR_HANDLE* sources, uint32_t numSources, D3D12_DESCRIPTOR_HEAP_TYPE heapType)
+{
+	DescriptorTableStats& stats = context.TableStats;
+	stats.NumTables++;
 
-	std::vector<Resource*> bindingsToUpload{};
-	for (Resource* binding : bindings)
+	const uint64_t key = Hash::Hash64(sources, numSources * sizeof(D3D12_CPU_DESCRIPTOR_HANDLE), heapType);
+	const auto it = context.DescriptorTableCache.find(key);
+	if (it != context.DescriptorTableCache.end())
 	{
-		if (binding) bindingsToUpload.push_back(binding);
+		const DescriptorTableEntry& entry = it->second;
+		const size_t sourcesSize = numSources * sizeof(D3D12_CPU_DESCRIPTOR_HANDLE);
+		if (entry.HeapType == heapType && entry.NumSources == numSources &&
+			(numSources == 0 || memcmp(context.DescriptorTableSources.data() + entry.FirstSource, sources, sourcesSize) == 0))
+		{
+			stats.NumHits++;
+			return entry.Table;
+		}
 	}
-	DescriptorAllocation alloc = Device::Get()->GetMemory().SRVHeapGPU->AllocateTransient(bindingsToUpload.size());
 
-	for (size_t i = 0; i < bindingsToUpload.size(); i++)
+	TransientDescriptorAllocator& allocator = heapType == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER ? context.TransientSamplers : context.TransientDescriptors;
+	const DescriptorAllocation table = allocator.Allocate(numSources);
+
+	if (numSources > 0)
 	{
-		const D3D12_CPU_DESCRIPTOR_HANDLE srcDescriptor = getDescriptor(bindingsToUpload[i], bindingType).GetCPUHandle();
-		const D3D12_CPU_DESCRIPTOR_HANDLE dstDescriptor = alloc.GetCPUHandle(i);
-		Device::Get()->GetHandle()->CopyDescriptorsSimple(1, dstDescriptor, srcDescriptor, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+		// Sources next to each other in their heap are copied as one range
+		const size_t descriptorSize = Device::Get()->GetHandle()->GetDescriptorHandleIncrementSize(heapType);
+		D3D12_CPU_DESCRIPTOR_HANDLE rangeStarts[GraphicsContext::MAX_TABLE_SIZE];
+		UINT rangeSizes[GraphicsContext::MAX_TABLE_SIZE];
+		UINT numRanges = 0;
+		for (uint32_t i = 0; i < numSources; i++)
+		{
+			if (numRanges > 0 && sources[i].ptr == rangeStarts[numRanges - 1].ptr + rangeSizes[numRanges - 1] * descriptorSize)
+			{
+				rangeSizes[numRanges - 1]++;
+			}
+			else
+			{
+				rangeStarts[numRanges] = sources[i];
+				rangeSizes[numRanges] = 1;
+				numRanges++;
+			}
+		}
+
+		const D3D12_CPU_DESCRIPTOR_HANDLE tableStart = table.GetCPUHandle();
+		const UINT tableSize = numSources;
+		Device::Get()->GetHandle()->CopyDescriptors(1, &tableStart, &tableSize, numRanges, rangeStarts, rangeSizes, heapType);
+
+		stats.NumCopiedDescriptors += numSources;
+		stats.NumCopyCalls++;
 	}
-	return alloc;
+
+	// A colliding table replaces the previous entry of the key
+	DescriptorTableEntry& entry = context.DescriptorTableCache[key];
+	entry.Table = table.GetGPUHandle();
+	entry.HeapType = heapType;
+	entry.FirstSource = (uint32_t) context.DescriptorTableSources.size();
+	entry.NumSources = numSources;
+	context.DescriptorTableSources.insert(context.DescriptorTableSources.end(), sources, sources + numSources);
+
+	return table.GetGPUHandle();
 }
 
 ID3D12CommandSignature* GraphicsContext::ApplyState(const GraphicsState& state)
@@ -451,11 +581,12 @@ ID3D12CommandSignature* GraphicsContext::ApplyState(const GraphicsState& state)
 	const bool useCompute = state.ShaderStages & CS;
 
 	// Root Signature
-	ID3D12RootSignature* rootSignature = GetOrCreateRootSignature(*this, state);
+	PipelineLibrary::RootSignatureHash rootSignatureHash = 0;
+	ID3D12RootSignature* rootSignature = GetOrCreateRootSignature(state, rootSignatureHash);
 	
 	// Pipeline state
-	uint32_t psoHash = 0;
-	ID3D12PipelineState* pipelineState = GetOrCreatePSO(*this, state, rootSignature, psoHash);
+	PipelineLibrary::PipelineHash psoHash = 0;
+	ID3D12PipelineState* pipelineState = GetOrCreatePSO(state, rootSignature, rootSignatureHash, psoHash);
 
 	const bool pipelineDirty = !BoundState.Valid || BoundState.PSOHash != psoHash;
 	BoundState.Valid = true;
@@ -554,42 +685,54 @@ ID3D12CommandSignature* GraphicsContext::ApplyState(const GraphicsState& state)
 
 	// Setup descriptor tables
 	{
-		std::vector<DescriptorAllocation> descriptorTables;
-		
-		if (!state.Table.CBVs.empty()) descriptorTables.push_back(CreateDescriptorTable(*this, state.Table.CBVs, BindingType::CBV));
-		if (!state.Table.SRVs.empty()) descriptorTables.push_back(CreateDescriptorTable(*this, state.Table.SRVs, BindingType::SRV));
-		if (!state.Table.UAVs.empty()) descriptorTables.push_back(CreateDescriptorTable(*this, state.Table.UAVs, BindingType::UAV));
+		// Add resource transitions
+		for (Resource* bind : state.Table.CBVs) GFX::Cmd::AddResourceTransition(barriers, bind, D3D12_RESOURCE_STATE_GENERIC_READ);
+		for (Resource* bind : state.Table.SRVs) GFX::Cmd::AddResourceTransition(barriers, bind, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		for (Resource* bind : state.Table.UAVs) GFX::Cmd::AddResourceTransition(barriers, bind, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
-		if (!state.Table.SMPs.empty())
+		// Bind to root table, root CBVs come before the tables in the same order as in the root signature
+		uint32_t nextSlot = state.PushConstantCount > 0 ? 1 : 0;
+		for (const D3D12_GPU_VIRTUAL_ADDRESS rootCBV : state.RootCBVs)
+		{
+			if (!rootCBV) continue;
+			if (useCompute) cmdList->SetComputeRootConstantBufferView(nextSlot++, rootCBV);
+			else cmdList->SetGraphicsRootConstantBufferView(nextSlot++, rootCBV);
+		}
+
+		const auto bindTable = [&](D3D12_GPU_DESCRIPTOR_HANDLE descriptorHandle)
+		{
+			if (useCompute) cmdList->SetComputeRootDescriptorTable(nextSlot++, descriptorHandle);
+			else cmdList->SetGraphicsRootDescriptorTable(nextSlot++, descriptorHandle);
+		};
+
+		D3D12_CPU_DESCRIPTOR_HANDLE sources[MAX_TABLE_SIZE];
+		const auto bindResourceTable = [&](const BindVector<Resource*>& bindings, BindingType bindingType)
 		{
-			const uint32_t samplerTableIndex = (uint32_t) descriptorTables.size();
-			descriptorTables.push_back(deviceMemory.SMPHeapGPU->AllocateTransient(state.Table.SMPs.size()));
+			if (bindings.empty()) return;
 
-			for (size_t i = 0; i < state.Table.SMPs.size(); i++)
+			ASSERT(bindings.size() <= MAX_TABLE_SIZE, "[ApplyState] Descriptor table is too big");
+			uint32_t numSources = 0;
+			for (const Resource* binding : bindings)
 			{
-				const D3D12_CPU_DESCRIPTOR_HANDLE srcDescriptor = GetSamplerDescriptor(*this, state.Table.SMPs[i]);
-				const D3D12_CPU_DESCRIPTOR_HANDLE dstDescriptor = descriptorTables[samplerTableIndex].GetCPUHandle(i);
-				Device::Get()->GetHandle()->CopyDescriptorsSimple(1, dstDescriptor, srcDescriptor, D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
+				if (binding) sources[numSources++] = GetResourceDescriptor(binding, bindingType).GetCPUHandle();
 			}
-		}
+			bindTable(GetDescriptorTable(*this, sources, numSources, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV));
+		};
 
-		for (const BindlessTable& table : state.BindlessTables)
+		bindResourceTable(state.Table.CBVs, BindingType::CBV);
+		bindResourceTable(state.Table.SRVs, BindingType::SRV);
+		bindResourceTable(state.Table.UAVs, BindingType::UAV);
+
+		if (!state.Table.SMPs.empty())
 		{
-			descriptorTables.push_back(table.DescriptorTable);
+			ASSERT(state.Table.SMPs.size() <= MAX_TABLE_SIZE, "[ApplyState] Descriptor table is too big");
+			for (size_t i = 0; i < state.Table.SMPs.size(); i++) sources[i] = GetSamplerDescriptor(*this, state.Table.SMPs[i]);
+			bindTable(GetDescriptorTable(*this, sources, (uint32_t) state.Table.SMPs.size(), D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER));
 		}
 
-		// Add resource transitions
-		for (Resource* bind : state.Table.CBVs) GFX::Cmd::AddResourceTransition(barriers, bind, D3D12_RESOURCE_STATE_GENERIC_READ);
-		for (Resource* bind : state.Table.SRVs) GFX::Cmd::AddResourceTransition(barriers, bind, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-		for (Resource* bind : state.Table.UAVs) GFX::Cmd::AddResourceTransition(barriers, bind, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-
-		// Bind to root table
-		uint32_t nextSlot = state.PushConstantCount > 0 ? 1 : 0;
-		for (const DescriptorAllocation& descriptorTable : descriptorTables)
+		for (const BindlessTable& table : state.BindlessTables)
 		{
-			const D3D12_GPU_DESCRIPTOR_HANDLE descriptorHandle = descriptorTable.GetGPUHandle();
-			if (useCompute) cmdList->SetComputeRootDescriptorTable(nextSlot++, descriptorHandle);
-			else cmdList->SetGraphicsRootDescriptorTable(nextSlot++, descriptorHandle);
+			bindTable(table.DescriptorTable.GetGPUHandle());
 		}
 	}
 
@@ -632,19 +775,20 @@ GraphicsContext::~GraphicsContext()
 	GFX::Cmd::WaitToFinish(*this);
 }
 
-static uint32_t GetHash(const StagingResourcesContext::StagingTextureRequest& request)
+static uint64_t GetHash(const StagingResourcesContext::StagingTextureRequest& request)
 {
-	uint32_t h = Hash::Crc32(request.Width);
-	h = Hash::Crc32(h, request.Height);
-	h = Hash::Crc32(h, request.NumMips);
-	h = Hash::Crc32(h, request.CreationFlags);
-	h = Hash::Crc32(h, request.Format);
-	return h;
+	Hash::Hasher hasher;
+	hasher.Add(request.Width);
+	hasher.Add(request.Height);
+	hasher.Add(request.NumMips);
+	hasher.Add(request.CreationFlags);
+	hasher.Add(request.Format);
+	return hasher.Get();
 }
 
 StagingResourcesContext::StagingTexture* StagingResourcesContext::GetTransientTexture(const StagingTextureRequest& request)
 {
-	const uint32_t hash = GetHash(request);
+	const uint64_t hash = GetHash(request);
 
 	if (!m_TransientStagingTextures.contains(hash))
 	{
@@ -6,6 +6,7 @@
 #include "Render/RenderAPI.h"
 #include "Render/DescriptorHeap.h"
 #include "Render/Shader.h"
+#include "Render/UploadAllocator.h"
 #include "Utility/MathUtility.h"
 #include "Utility/Multithreading.h"
 #include "System/ApplicationConfiguration.h"
@@ -121,6 +122,7 @@ struct GraphicsState
 	BindVector<Texture*, 8> RenderTargets;
 	Texture* DepthStencil = nullptr;
 	BindVector<BindlessTable> BindlessTables = {};
+	BindVector<D3D12_GPU_VIRTUAL_ADDRESS, 16> RootCBVs;	// Upload memory of the context bound at b<index>, the slot can't have a table CBV too
 	uint32_t PushConstantBinding = 128;
 	uint32_t PushConstantCount = 0;
 
@@ -148,6 +150,12 @@ struct GraphicsState
 	GraphicsState();
 };
 
+namespace GFX
+{
+	// Key of the pipeline the state is drawn with, same between runs. Compiles the shader if it wasn't yet.
+	uint64_t GetPipelineHash(const GraphicsState& state);
+}
+
 class StagingResourcesContext
 {
 public:
@@ -171,17 +179,36 @@ public:
 	void ClearTransientTextures(GraphicsContext& context);
 
 private:
-	std::unordered_map<uint32_t, StagingTexture*> m_TransientStagingTextures;
+	std::unordered_map<uint64_t, StagingTexture*> m_TransientStagingTextures;
 };
 
 struct BoundGraphicsState
 {
 	bool Valid = false;
-	uint32_t PSOHash = 0;
+	uint64_t PSOHash = 0;
+};
+
+struct DescriptorTableStats
+{
+	uint32_t NumTables = 0;
+	uint32_t NumHits = 0;				// Tables reused from the cache
+	uint32_t NumCopiedDescriptors = 0;
+	uint32_t NumCopyCalls = 0;
+};
+
+// Table copied in the current submit, its source handles are kept in GraphicsContext::DescriptorTableSources
+struct DescriptorTableEntry
+{
+	D3D12_GPU_DESCRIPTOR_HANDLE Table;
+	D3D12_DESCRIPTOR_HEAP_TYPE HeapType;
+	uint32_t FirstSource;
+	uint32_t NumSources;
 };
 
 struct GraphicsContext
 {
+	static constexpr uint32_t MAX_TABLE_SIZE = 128;
+
 	~GraphicsContext();
 	ID3D12CommandSignature* ApplyState(const GraphicsState& state);
 
@@ -193,10 +220,21 @@ struct GraphicsContext
 
 	std::vector<ReadbackBuffer*> PendingReadbacks;
 
-	// Cache
-	std::unordered_map<uint32_t, ComPtr<ID3D12RootSignature>> RootSignatureCache;
-	std::unordered_map<uint32_t, ComPtr<ID3D12PipelineState>> PSOCache;
-	std::unordered_map<uint32_t, DescriptorAllocation> SamplerCache;
+	// Per draw constants, reclaimed when the fence of the submit they were recorded for is reached
+	UploadAllocator UploadMemory;
+
+	// Descriptor tables, reclaimed the same way
+	TransientDescriptorAllocator TransientDescriptors{ D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV };
+	TransientDescriptorAllocator TransientSamplers{ D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER };
+
+	// Tables of the current submit by the hash of their source descriptors, cleared when their blocks are retired.
+	// Sources of every entry are compared on a hit, so a hash collision is a miss instead of a wrong table.
+	std::unordered_map<uint64_t, DescriptorTableEntry> DescriptorTableCache;
+	std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> DescriptorTableSources;
+	DescriptorTableStats TableStats;	// Since BeginRecording
+
+	// Cache, root signatures and pipelines are shared by every context in PipelineLibrary
+	std::unordered_map<uint64_t, DescriptorAllocation> SamplerCache;
 
 	StagingResourcesContext StagingResources;
 
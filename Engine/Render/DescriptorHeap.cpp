@@ -1,8 +1,14 @@
 #include "DescriptorHeap.h"
 
+#include <fstream>
+
 #include "Render/Device.h"
 #include "Render/Shader.h"
 #include "Render/Resource.h"
+#include "System/ApplicationConfiguration.h"
+
+static constexpr uint32_t DESCRIPTOR_TRACE_MAGIC = 0x43525444; // DTRC
+static constexpr uint32_t DESCRIPTOR_TRACE_VERSION = 2;
 
 static ID3D12DescriptorHeap* CreateDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE type, bool shaderVisible, size_t numDescriptors, size_t& incrementSize)
 {
@@ -32,14 +38,7 @@ void DescriptorAllocation::Init()
 void DescriptorAllocation::Release()
 {
 	ASSERT(m_Alloc.Start != INVALID_ALLOCATION, "Cannot release invalid allocation!");
-
-	MTR::Mutex& allocLock = m_Owner->GetAllocationLock();
-	allocLock.Lock();
-	if (m_Transient)
-		m_Owner->m_AllocStrategyTransient.Release(m_Alloc);
-	else
-		m_Owner->m_AllocStrategy.Release(m_Alloc);
-	allocLock.Unlock();
+	m_Owner->Release(*this);
 }
 
 D3D12_GPU_DESCRIPTOR_HANDLE DescriptorAllocation::GetGPUHandle(size_t rangeIndex) const
@@ -60,8 +59,13 @@ D3D12_CPU_DESCRIPTOR_HANDLE DescriptorAllocation::GetCPUHandle(size_t rangeIndex
 
 DescriptorHeap::DescriptorHeap(bool gpuVisible, D3D12_DESCRIPTOR_HEAP_TYPE type, size_t numDescriptors, size_t numTransientDescriptors):
 	m_GpuVisible(gpuVisible),
-	m_AllocStrategy(numDescriptors),
-	m_AllocStrategyTransient(numTransientDescriptors)
+	m_NumDescriptors(numDescriptors),
+	m_NumRangeDescriptors(gpuVisible ? numDescriptors : numDescriptors / 2),	// Shader visible heaps only get tables
+	m_TransientBlockSize(type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER ? TRANSIENT_SAMPLER_BLOCK_SIZE : TRANSIENT_BLOCK_SIZE),
+	m_AllocStrategy(m_NumRangeDescriptors),
+	m_SingleStrategy(numDescriptors - m_NumRangeDescriptors),
+	m_TransientBlocks(numTransientDescriptors / m_TransientBlockSize),
+	m_RecordTrace(AppConfig.Settings.contains("TRACEDESCRIPTORS"))
 {
 	m_Heap = CreateDescriptorHeap(type, gpuVisible, numDescriptors + numTransientDescriptors, m_ElementSize);
 
@@ -77,18 +81,190 @@ DescriptorHeap::DescriptorHeap(bool gpuVisible, D3D12_DESCRIPTOR_HEAP_TYPE type,
 
 DescriptorAllocation DescriptorHeap::Allocate(size_t numDescriptors)
 {
-	m_AllocationLock.Lock();
-	const RangeAllocation heapAlloc = m_AllocStrategy.Allocate(numDescriptors);
-	m_AllocationLock.Unlock();
+	RangeAllocation heapAlloc{};
+	if (numDescriptors == 1)
+	{
+		const size_t element = m_SingleStrategy.Allocate();
+		if (element != INVALID_ALLOCATION) heapAlloc = { m_NumRangeDescriptors + element, 1 };
+	}
+
+	// Single descriptors fall back to the ranges once their part of the heap is full
+	if (heapAlloc.Start == INVALID_ALLOCATION)
+	{
+		m_AllocationLock.Lock();
+		heapAlloc = m_AllocStrategy.Allocate(numDescriptors);
+		if (m_RecordTrace && heapAlloc.Start != INVALID_ALLOCATION) RecordTrace(heapAlloc, false);
+		m_AllocationLock.Unlock();
+	}
 	ASSERT(heapAlloc.Start != INVALID_ALLOCATION, "DescriptorHeapGPU memory overflow!");
+
 	return DescriptorAllocation{ false, heapAlloc , this };
 }
 
-DescriptorAllocation DescriptorHeap::AllocateTransient(size_t numDescriptors)
+void DescriptorHeap::Release(DescriptorAllocation& allocation)
+{
+	RangeAllocation& heapAlloc = allocation.m_Alloc;
+
+	// Transient descriptors go back with their block
+	if (!allocation.m_Transient)
+	{
+		if (heapAlloc.Start >= m_NumRangeDescriptors)
+		{
+			m_SingleStrategy.Release(heapAlloc.Start - m_NumRangeDescriptors);
+		}
+		else
+		{
+			m_AllocationLock.Lock();
+			if (m_RecordTrace) RecordTrace(heapAlloc, true);
+			m_AllocStrategy.Release(heapAlloc);
+			m_AllocationLock.Unlock();
+		}
+	}
+
+	heapAlloc.Start = INVALID_ALLOCATION;
+	heapAlloc.NumElements = INVALID_ALLOCATION;
+}
+
+std::vector<DescriptorTraceEvent> DescriptorHeap::GetAllocationTrace()
 {
 	m_AllocationLock.Lock();
-	const RangeAllocation heapAlloc = m_AllocStrategyTransient.Allocate(numDescriptors);
+	std::vector<DescriptorTraceEvent> trace = m_Trace;
 	m_AllocationLock.Unlock();
-	ASSERT(heapAlloc.Start != INVALID_ALLOCATION, "DescriptorHeapGPU transient memory overflow!");
-	return DescriptorAllocation{true, heapAlloc , this};
+	return trace;
+}
+
+void DescriptorHeap::RecordTrace(const RangeAllocation& alloc, bool release)
+{
+	m_Trace.push_back({ alloc.Start, alloc.NumElements, release });
+}
+
+bool WriteDescriptorTraces(const std::string& path, const std::vector<DescriptorHeapTrace>& traces)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cout << "[DescriptorHeap] Failed to write descriptor traces " << path << std::endl;
+		return false;
+	}
+
+	const uint32_t header[] = { DESCRIPTOR_TRACE_MAGIC, DESCRIPTOR_TRACE_VERSION, (uint32_t) traces.size() };
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+	for (const DescriptorHeapTrace& trace : traces)
+	{
+		const uint64_t traceHeader[] = { trace.Name.size(), trace.NumDescriptors, trace.Events.size() };
+		file.write(reinterpret_cast<const char*>(traceHeader), sizeof(traceHeader));
+		file.write(trace.Name.data(), trace.Name.size());
+
+		// Field by field, the struct has padding after Release
+		for (const DescriptorTraceEvent& event : trace.Events)
+		{
+			const uint64_t range[] = { event.Start, event.NumDescriptors };
+			const uint8_t release = event.Release ? 1 : 0;
+			file.write(reinterpret_cast<const char*>(range), sizeof(range));
+			file.write(reinterpret_cast<const char*>(&release), sizeof(release));
+		}
+	}
+	return file.good();
+}
+
+bool ReadDescriptorTraces(const std::string& path, std::vector<DescriptorHeapTrace>& traces)
+{
+	std::ifstream file(path, std::ios::binary);
+	uint32_t header[3] = {};
+	file.read(reinterpret_cast<char*>(header), sizeof(header));
+	if (!file.good() || header[0] != DESCRIPTOR_TRACE_MAGIC || header[1] != DESCRIPTOR_TRACE_VERSION)
+	{
+		std::cout << "[DescriptorHeap] Invalid descriptor traces " << path << std::endl;
+		return false;
+	}
+
+	traces.resize(header[2]);
+	for (DescriptorHeapTrace& trace : traces)
+	{
+		uint64_t traceHeader[3] = {};
+		file.read(reinterpret_cast<char*>(traceHeader), sizeof(traceHeader));
+		if (!file.good()) break;
+
+		trace.Name.resize(traceHeader[0]);
+		trace.NumDescriptors = traceHeader[1];
+		trace.Events.resize(traceHeader[2]);
+		file.read(trace.Name.data(), trace.Name.size());
+
+		for (DescriptorTraceEvent& event : trace.Events)
+		{
+			uint64_t range[2] = {};
+			uint8_t release = 0;
+			file.read(reinterpret_cast<char*>(range), sizeof(range));
+			file.read(reinterpret_cast<char*>(&release), sizeof(release));
+			event = { range[0], range[1], release != 0 };
+		}
+	}
+
+	if (!file.good())
+	{
+		std::cout << "[DescriptorHeap] Descriptor traces " << path << " are truncated" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+TransientDescriptorAllocator::TransientDescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE type, DescriptorHeap* heap) :
+	m_Type(type),
+	m_Heap(heap)
+{
+}
+
+TransientDescriptorAllocator::~TransientDescriptorAllocator()
+{
+	// Owner waits for the GPU before destroying the allocator
+	for (size_t block : m_UsedBlocks) GetHeap()->ReleaseTransientBlock(block);
+	for (const auto& [fenceValue, block] : m_RetiredBlocks) GetHeap()->ReleaseTransientBlock(block);
+}
+
+DescriptorAllocation TransientDescriptorAllocator::Allocate(size_t numDescriptors)
+{
+	DescriptorHeap* heap = GetHeap();
+	const size_t blockSize = heap->GetTransientBlockSize();
+	ASSERT(numDescriptors <= blockSize, "[TransientDescriptorAllocator] Table doesn't fit in a transient block");
+
+	if (m_CurrentBlock == INVALID_ALLOCATION || m_CurrentOffset + numDescriptors > blockSize)
+	{
+		m_CurrentBlock = heap->AcquireTransientBlock();
+		m_CurrentOffset = 0;
+		ASSERT(m_CurrentBlock != INVALID_ALLOCATION, "DescriptorHeapGPU transient memory overflow!");
+		m_UsedBlocks.push_back(m_CurrentBlock);
+	}
+
+	const RangeAllocation alloc = { m_CurrentBlock * blockSize + m_CurrentOffset, numDescriptors };
+	m_CurrentOffset += numDescriptors;
+	return DescriptorAllocation{ true, alloc, heap };
+}
+
+void TransientDescriptorAllocator::Retire(uint64_t fenceValue)
+{
+	for (size_t block : m_UsedBlocks) m_RetiredBlocks.push_back({ fenceValue, block });
+	m_UsedBlocks.clear();
+
+	m_CurrentBlock = INVALID_ALLOCATION;
+	m_CurrentOffset = 0;
+}
+
+void TransientDescriptorAllocator::Reclaim(uint64_t completedFenceValue)
+{
+	while (!m_RetiredBlocks.empty() && m_RetiredBlocks.front().first <= completedFenceValue)
+	{
+		GetHeap()->ReleaseTransientBlock(m_RetiredBlocks.front().second);
+		m_RetiredBlocks.pop_front();
+	}
+}
+
+DescriptorHeap* TransientDescriptorAllocator::GetHeap()
+{
+	// Contexts are created before the device memory
+	if (!m_Heap)
+	{
+		DeviceMemory& memory = Device::Get()->GetMemory();
+		m_Heap = m_Type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER ? memory.SMPHeapGPU.get() : memory.SRVHeapGPU.get();
+	}
+	return m_Heap;
 }
\ No newline at end of file
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <deque>
 #include <vector>
 #include <memory>
+#include <string>
 
 #include "Render/RenderAPI.h"
 #include "Utility/MemoryStrategies.h"
@@ -9,8 +11,31 @@
 
 class DescriptorHeap;
 
+// Calls to the persistent range allocator of a heap, recorded when the app runs with TRACEDESCRIPTORS so allocators can be compared on real workloads.
+// Lock free single descriptors aren't recorded, so a trace only covers the range part at the start of the heap.
+struct DescriptorTraceEvent
+{
+	size_t Start;
+	size_t NumDescriptors;
+	bool Release;
+};
+
+// Traces of the device heaps are written when the device is destroyed, Tests replay them on the range allocators
+static constexpr const char* DESCRIPTOR_TRACE_PATH = "descriptor_heaps.dtrace";
+
+struct DescriptorHeapTrace
+{
+	std::string Name;
+	size_t NumDescriptors;	// Of the range part
+	std::vector<DescriptorTraceEvent> Events;
+};
+
+bool WriteDescriptorTraces(const std::string& path, const std::vector<DescriptorHeapTrace>& traces);
+bool ReadDescriptorTraces(const std::string& path, std::vector<DescriptorHeapTrace>& traces);
+
 class DescriptorAllocation
 {
+	friend class DescriptorHeap;
 public:
 	DescriptorAllocation() = default;
 
@@ -63,25 +88,40 @@ class DescriptorHeap
 {
 	friend class DescriptorAllocation;
 public:
-	DescriptorHeap(bool gpuVisible, D3D12_DESCRIPTOR_HEAP_TYPE type, size_t numDescriptors, size_t numTransientDescriptors = 0);
+	// Shader visible heaps hand out their transient part in blocks of these sizes, samplers are limited to 2048 descriptors
+	static constexpr size_t TRANSIENT_BLOCK_SIZE = 1024;
+	static constexpr size_t TRANSIENT_SAMPLER_BLOCK_SIZE = 32;
 
-	void Initialize(size_t numDescriptors, size_t numTransientDescriptors = 0);
+	DescriptorHeap(bool gpuVisible, D3D12_DESCRIPTOR_HEAP_TYPE type, size_t numDescriptors, size_t numTransientDescriptors = 0);
 
+	// Single descriptors of CPU heaps are allocated lock free, ranges take the lock
 	DescriptorAllocation Allocate(size_t numDescriptors = 1);
-	DescriptorAllocation AllocateTransient(size_t numDescriptors = 1);
-	
 	void Release(DescriptorAllocation& allocation);
 
+	// Lock free, returns INVALID_ALLOCATION when every block is in use (see TransientDescriptorAllocator)
+	size_t AcquireTransientBlock() { return m_TransientBlocks.Allocate(); }
+	void ReleaseTransientBlock(size_t block) { m_TransientBlocks.Release(block); }
+	size_t GetTransientBlockSize() const { return m_TransientBlockSize; }
+
 	ID3D12DescriptorHeap* GetHeap() const { return m_Heap.Get(); }
-	
-	// Hack
-	MTR::Mutex& GetAllocationLock() { return m_AllocationLock; }
+	size_t GetNumDescriptors() const { return m_NumDescriptors; }
+	size_t GetNumRangeDescriptors() const { return m_NumRangeDescriptors; }
+
+	std::vector<DescriptorTraceEvent> GetAllocationTrace();
+
+private:
+	// Called with m_AllocationLock held
+	void RecordTrace(const RangeAllocation& alloc, bool release);
 
 private:
 	bool m_GpuVisible;
+	size_t m_NumDescriptors;
+	size_t m_NumRangeDescriptors;	// Single descriptors are allocated after the ranges
+	size_t m_TransientBlockSize;
 
 	RangeStrategy m_AllocStrategy;
-	RingRangeStrategy m_AllocStrategyTransient;
+	ElementStrategy m_SingleStrategy;
+	ElementStrategy m_TransientBlocks;
 	size_t m_ElementSize;
 
 	ComPtr<ID3D12DescriptorHeap> m_Heap;
@@ -93,4 +133,39 @@ private:
 	D3D12_GPU_DESCRIPTOR_HANDLE m_HeapStartGPUTransient;
 
 	MTR::Mutex m_AllocationLock;
+
+	bool m_RecordTrace;
+	std::vector<DescriptorTraceEvent> m_Trace;
+};
+
+// Descriptor tables that live until the GPU is done with the commands they were recorded for.
+// Each context bumps through its own blocks of the transient part of a shader visible heap, so contexts don't contend on the heap.
+// Blocks used between two submits are retired with the fence value of the submit and go back to the heap once the fence reaches it, as UploadAllocator pages.
+class TransientDescriptorAllocator
+{
+public:
+	// Null heap takes blocks from the shader visible heap of the type in the device memory
+	TransientDescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE type, DescriptorHeap* heap = nullptr);
+	~TransientDescriptorAllocator();
+
+	TransientDescriptorAllocator(const TransientDescriptorAllocator&) = delete;
+	TransientDescriptorAllocator& operator=(const TransientDescriptorAllocator&) = delete;
+
+	DescriptorAllocation Allocate(size_t numDescriptors);
+
+	void Retire(uint64_t fenceValue);
+	void Reclaim(uint64_t completedFenceValue);
+
+private:
+	DescriptorHeap* GetHeap();
+
+private:
+	D3D12_DESCRIPTOR_HEAP_TYPE m_Type;
+	DescriptorHeap* m_Heap;
+
+	size_t m_CurrentBlock = INVALID_ALLOCATION;
+	size_t m_CurrentOffset = 0;
+
+	std::vector<size_t> m_UsedBlocks;	// Since the last Retire, including the current block
+	std::deque<std::pair<uint64_t, size_t>> m_RetiredBlocks;	// Fence value and block, in the order of fence values
 };
\ No newline at end of file
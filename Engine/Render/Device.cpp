@@ -4,6 +4,7 @@
 #include "Render/Context.h"
 #include "Render/Buffer.h"
 #include "Render/Shader.h"
+#include "Render/StagingPool.h"
 #include "Render/DescriptorHeap.h"
 #include "Render/Resource.h"
 #include "Render/Texture.h"
@@ -79,12 +80,21 @@ void Device::InitDevice()
 	GFX::Cmd::BeginRecording(context);
 
 	// Memory
-	m_Memory.SRVHeap = ScopedRef<DescriptorHeap>(new DescriptorHeap{false,  D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 20 * 1024u });
-	m_Memory.RTVHeap = ScopedRef<DescriptorHeap>(new DescriptorHeap{false,  D3D12_DESCRIPTOR_HEAP_TYPE_RTV, 256u });
-	m_Memory.DSVHeap = ScopedRef<DescriptorHeap>(new DescriptorHeap{false,  D3D12_DESCRIPTOR_HEAP_TYPE_DSV, 64u });
-	m_Memory.SMPHeap = ScopedRef<DescriptorHeap>(new DescriptorHeap{false,  D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, 256u });
+	// Half of a CPU heap is for single descriptors, the ranges keep 20K, 256, 64 and 256 descriptors
+	m_Memory.SRVHeap = ScopedRef<DescriptorHeap>(new DescriptorHeap{false,  D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 40 * 1024u });
+	m_Memory.RTVHeap = ScopedRef<DescriptorHeap>(new DescriptorHeap{false,  D3D12_DESCRIPTOR_HEAP_TYPE_RTV, 512u });
+	m_Memory.DSVHeap = ScopedRef<DescriptorHeap>(new DescriptorHeap{false,  D3D12_DESCRIPTOR_HEAP_TYPE_DSV, 128u });
+	m_Memory.SMPHeap = ScopedRef<DescriptorHeap>(new DescriptorHeap{false,  D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, 512u });
 	m_Memory.SRVHeapGPU = ScopedRef<DescriptorHeap>(new DescriptorHeap{ true, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 64u * 1024, 256u * 1024u });
-	m_Memory.SMPHeapGPU = ScopedRef<DescriptorHeap>(new DescriptorHeap{ true, D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, 256u,  1024u });
+	m_Memory.SMPHeapGPU = ScopedRef<DescriptorHeap>(new DescriptorHeap{ true, D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, 256u,  1792u });
+	m_Memory.StagingMemory = ScopedRef<StagingPool>(new StagingPool{});
+
+	// Tests run without a window
+	if (!Window::Get())
+	{
+		GFX::Cmd::EndRecordingAndSubmit(context);
+		return;
+	}
 
 	// Create swapchain
 	DXGI_SWAP_CHAIN_DESC desc;
@@ -115,12 +125,25 @@ void Device::DeinitDevice()
 {
 	ContextManager::Get().Destroy();
 
+	// Heaps only record when the app runs with TRACEDESCRIPTORS
+	std::vector<DescriptorHeapTrace> traces;
+	const std::pair<const char*, DescriptorHeap*> heaps[] = { { "SRV", m_Memory.SRVHeap.get() }, { "RTV", m_Memory.RTVHeap.get() }, { "DSV", m_Memory.DSVHeap.get() },
+		{ "Sampler", m_Memory.SMPHeap.get() }, { "SRV GPU", m_Memory.SRVHeapGPU.get() }, { "Sampler GPU", m_Memory.SMPHeapGPU.get() } };
+	for (const auto& [name, heap] : heaps)
+	{
+		DescriptorHeapTrace trace{ name, heap->GetNumRangeDescriptors(), heap->GetAllocationTrace() };
+		if (!trace.Events.empty()) traces.push_back(std::move(trace));
+	}
+	if (!traces.empty() && WriteDescriptorTraces(DESCRIPTOR_TRACE_PATH, traces))
+		std::cout << "[Device] Saved descriptor heap traces to " << DESCRIPTOR_TRACE_PATH << std::endl;
+
 	for (uint32_t i = 0; i < SWAPCHAIN_BUFFER_COUNT; i++)
 		m_SwapchainBuffers[i] = nullptr;
 
 	m_SwapchainHandle = nullptr;
 
 	m_DXGIFactory = nullptr;
+	m_Memory.StagingMemory = nullptr;
 	m_Allocator = nullptr;
 	m_Handle = nullptr;
 }
@@ -7,6 +7,7 @@
 
 class RenderTask;
 class DescriptorHeap;
+class StagingPool;
 struct GraphicsContext;
 struct Texture;
 struct Shader;
@@ -27,6 +28,9 @@ struct DeviceMemory
 
 	ScopedRef<DescriptorHeap> SRVHeapGPU;
 	ScopedRef<DescriptorHeap> SMPHeapGPU;
+
+	// Upload memory of every context
+	ScopedRef<StagingPool> StagingMemory;
 };
 
 class DeferredTaskExecutor
@@ -0,0 +1,177 @@
+#include "PipelineLibrary.h"
+
+#include <fstream>
+
+#include "Render/Device.h"
+#include "Utility/Timer.h"
+
+PipelineLibrary* PipelineLibrary::s_Instance = nullptr;
+
+static std::wstring GetPipelineName(PipelineLibrary::PipelineHash hash)
+{
+	wchar_t name[17];
+	swprintf(name, 17, L"%016llx", (unsigned long long) hash);
+	return name;
+}
+
+PipelineLibrary::PipelineLibrary(const std::string& path) :
+	m_Path(path)
+{
+	Load();
+}
+
+PipelineLibrary::~PipelineLibrary()
+{
+	Save();
+
+	std::cout << "[PipelineLibrary] " << m_Stats.NumLoadedPipelines << " pipelines loaded from " << m_Path << ", " << m_Stats.NumCreatedPipelines << " created, " << m_Stats.CreateTimeMS << " ms total" << std::endl;
+}
+
+ID3D12RootSignature* PipelineLibrary::FindRootSignature(RootSignatureHash hash)
+{
+	m_Mutex.Lock();
+	const auto it = m_RootSignatures.find(hash);
+	ID3D12RootSignature* rootSignature = it != m_RootSignatures.end() ? it->second.Get() : nullptr;
+	m_Mutex.Unlock();
+	return rootSignature;
+}
+
+ID3D12RootSignature* PipelineLibrary::AddRootSignature(RootSignatureHash hash, ComPtr<ID3D12RootSignature> rootSignature)
+{
+	m_Mutex.Lock();
+	if (!m_RootSignatures.contains(hash))
+	{
+		m_RootSignatures[hash] = rootSignature;
+		m_Stats.NumRootSignatures++;
+	}
+	ID3D12RootSignature* libraryRootSignature = m_RootSignatures[hash].Get();
+	m_Mutex.Unlock();
+	return libraryRootSignature;
+}
+
+ID3D12PipelineState* PipelineLibrary::FindPipeline(PipelineHash hash)
+{
+	m_Mutex.Lock();
+	const auto it = m_Pipelines.find(hash);
+	ID3D12PipelineState* pipeline = it != m_Pipelines.end() ? it->second.Get() : nullptr;
+	m_Mutex.Unlock();
+	return pipeline;
+}
+
+ID3D12PipelineState* PipelineLibrary::CreateGraphicsPipeline(PipelineHash hash, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+	return LoadOrCreatePipeline(hash,
+		[&desc](ID3D12PipelineLibrary1* library, const wchar_t* name, ComPtr<ID3D12PipelineState>& pipeline) { return library->LoadGraphicsPipeline(name, &desc, IID_PPV_ARGS(pipeline.GetAddressOf())); },
+		[&desc](ComPtr<ID3D12PipelineState>& pipeline) { API_CALL(Device::Get()->GetHandle()->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(pipeline.GetAddressOf()))); });
+}
+
+ID3D12PipelineState* PipelineLibrary::CreateComputePipeline(PipelineHash hash, const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc)
+{
+	return LoadOrCreatePipeline(hash,
+		[&desc](ID3D12PipelineLibrary1* library, const wchar_t* name, ComPtr<ID3D12PipelineState>& pipeline) { return library->LoadComputePipeline(name, &desc, IID_PPV_ARGS(pipeline.GetAddressOf())); },
+		[&desc](ComPtr<ID3D12PipelineState>& pipeline) { API_CALL(Device::Get()->GetHandle()->CreateComputePipelineState(&desc, IID_PPV_ARGS(pipeline.GetAddressOf()))); });
+}
+
+ID3D12PipelineState* PipelineLibrary::CreatePipeline(PipelineHash hash, const D3D12_PIPELINE_STATE_STREAM_DESC& desc)
+{
+	return LoadOrCreatePipeline(hash,
+		[&desc](ID3D12PipelineLibrary1* library, const wchar_t* name, ComPtr<ID3D12PipelineState>& pipeline) { return library->LoadPipeline(name, &desc, IID_PPV_ARGS(pipeline.GetAddressOf())); },
+		[&desc](ComPtr<ID3D12PipelineState>& pipeline) { API_CALL(Device::Get()->GetHandle()->CreatePipelineState(&desc, IID_PPV_ARGS(pipeline.GetAddressOf()))); });
+}
+
+ID3D12PipelineState* PipelineLibrary::LoadOrCreatePipeline(PipelineHash hash, const LoadFunc& load, const CreateFunc& create)
+{
+	const std::wstring name = GetPipelineName(hash);
+	Timer timer;
+	timer.Start();
+
+	// Library fails the load when it doesn't have the name or when the description doesn't match the stored one
+	ComPtr<ID3D12PipelineState> pipeline;
+	m_LibraryMutex.Lock();
+	const bool loaded = m_Library && SUCCEEDED(load(m_Library.Get(), name.c_str(), pipeline));
+	m_LibraryMutex.Unlock();
+
+	if (!loaded) create(pipeline);
+
+	timer.Stop();
+
+	m_Mutex.Lock();
+	const bool addedByOtherThread = m_Pipelines.contains(hash);
+	if (!addedByOtherThread)
+	{
+		m_Pipelines[hash] = pipeline;
+		m_Stats.NumPipelines++;
+		if (loaded) m_Stats.NumLoadedPipelines++;
+		else m_Stats.NumCreatedPipelines++;
+	}
+	m_Stats.CreateTimeMS += timer.GetTimeMS();
+	ID3D12PipelineState* libraryPipeline = m_Pipelines[hash].Get();
+	m_Mutex.Unlock();
+
+	if (!loaded && !addedByOtherThread && m_Library)
+	{
+		m_LibraryMutex.Lock();
+		m_LibraryDirty = SUCCEEDED(m_Library->StorePipeline(name.c_str(), pipeline.Get())) || m_LibraryDirty;
+		m_LibraryMutex.Unlock();
+	}
+
+	return libraryPipeline;
+}
+
+PipelineLibrary::Stats PipelineLibrary::GetStats()
+{
+	m_Mutex.Lock();
+	const Stats stats = m_Stats;
+	m_Mutex.Unlock();
+	return stats;
+}
+
+void PipelineLibrary::Load()
+{
+	std::ifstream file(m_Path, std::ios::binary | std::ios::ate);
+	if (file.is_open())
+	{
+		const uint64_t fileSize = file.tellg();
+		file.seekg(0);
+		m_FileData.resize(fileSize);
+		file.read(reinterpret_cast<char*>(m_FileData.data()), fileSize);
+		if (!file.good()) m_FileData.clear();
+	}
+
+	ID3D12Device2* device = Device::Get()->GetHandle();
+	HRESULT hr = device->CreatePipelineLibrary(m_FileData.data(), m_FileData.size(), IID_PPV_ARGS(m_Library.GetAddressOf()));
+
+	// Driver or adapter changed since the file was written, pipelines are recreated and the file is written again
+	if (FAILED(hr) && !m_FileData.empty())
+	{
+		std::cout << "[PipelineLibrary] " << m_Path << " can't be used with this driver or adapter, pipelines will be recreated" << std::endl;
+		m_FileData.clear();
+		m_LibraryDirty = true;
+		hr = device->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(m_Library.GetAddressOf()));
+	}
+
+	if (FAILED(hr))
+	{
+		std::cout << "[PipelineLibrary] Pipeline libraries aren't supported, pipelines won't be saved" << std::endl;
+		m_Library = nullptr;
+	}
+}
+
+void PipelineLibrary::Save()
+{
+	if (!m_Library || !m_LibraryDirty) return;
+
+	std::vector<uint8_t> serializedLibrary(m_Library->GetSerializedSize());
+	API_CALL(m_Library->Serialize(serializedLibrary.data(), serializedLibrary.size()));
+
+	// Library references m_FileData until it is released
+	m_Library = nullptr;
+
+	std::ofstream file(m_Path, std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cout << "[PipelineLibrary] Failed to open " << m_Path << " for writing" << std::endl;
+		return;
+	}
+	file.write(reinterpret_cast<const char*>(serializedLibrary.data()), serializedLibrary.size());
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <functional>
+#include <unordered_map>
+
+#include "Common.h"
+#include "Render/RenderAPI.h"
+#include "Utility/Multithreading.h"
+
+// Root signatures and pipeline states shared by every context, keyed by stable hashes of their descriptions (see Context.cpp).
+// Pipelines are also stored in a D3D12 pipeline library that is loaded on init and serialized on destroy, so a restart doesn't recreate them from DXIL.
+// Entries of the file are never removed, delete it to trim pipelines of shaders that were changed since.
+class PipelineLibrary
+{
+public:
+	using PipelineHash = uint64_t;
+	using RootSignatureHash = uint64_t;
+
+	struct Stats
+	{
+		uint32_t NumRootSignatures = 0;
+		uint32_t NumPipelines = 0;
+		uint32_t NumLoadedPipelines = 0;	// Found in the file
+		uint32_t NumCreatedPipelines = 0;	// Created from DXIL
+		float CreateTimeMS = 0.0f;			// Spent loading and creating pipelines
+	};
+
+	static void Init(const std::string& path) { s_Instance = new PipelineLibrary(path); }
+	static PipelineLibrary* Get() { return s_Instance; }
+	static void Destroy() { SAFE_DELETE(s_Instance); }
+
+private:
+	static PipelineLibrary* s_Instance;
+
+	PipelineLibrary(const std::string& path);
+	~PipelineLibrary();
+
+public:
+	// Everything is thread safe, Find returns nullptr when the object wasn't added yet.
+	// Add and Create return the object that is in the library when another thread added the same hash first.
+
+	ID3D12RootSignature* FindRootSignature(RootSignatureHash hash);
+	ID3D12RootSignature* AddRootSignature(RootSignatureHash hash, ComPtr<ID3D12RootSignature> rootSignature);
+
+	ID3D12PipelineState* FindPipeline(PipelineHash hash);
+	ID3D12PipelineState* CreateGraphicsPipeline(PipelineHash hash, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+	ID3D12PipelineState* CreateComputePipeline(PipelineHash hash, const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc);
+	ID3D12PipelineState* CreatePipeline(PipelineHash hash, const D3D12_PIPELINE_STATE_STREAM_DESC& desc);
+
+	Stats GetStats();
+
+private:
+	using LoadFunc = std::function<HRESULT(ID3D12PipelineLibrary1* library, const wchar_t* name, ComPtr<ID3D12PipelineState>& pipeline)>;
+	using CreateFunc = std::function<void(ComPtr<ID3D12PipelineState>& pipeline)>;
+
+	ID3D12PipelineState* LoadOrCreatePipeline(PipelineHash hash, const LoadFunc& load, const CreateFunc& create);
+
+	void Load();
+	void Save();
+
+private:
+	std::string m_Path;
+
+	// Has to outlive the library, pipelines are read from it
+	std::vector<uint8_t> m_FileData;
+
+	// Load and store of the same name from different threads aren't synchronized by D3D12
+	MTR::Mutex m_LibraryMutex;
+	ComPtr<ID3D12PipelineLibrary1> m_Library;
+	bool m_LibraryDirty = false;
+
+	MTR::Mutex m_Mutex;
+	std::unordered_map<RootSignatureHash, ComPtr<ID3D12RootSignature>> m_RootSignatures;
+	std::unordered_map<PipelineHash, ComPtr<ID3D12PipelineState>> m_Pipelines;
+	Stats m_Stats;
+};
@@ -6,17 +6,36 @@
 
 #include <set>
 #include <fstream>
+#include <algorithm>
+#include <atomic>
 #include <d3d12shader.h>
 
 #include "Render/Device.h"
+#include "Render/ShaderCache.h"
+#include "System/JobPool.h"
 #include "Utility/StringUtility.h"
 #include "Utility/PathUtility.h"
 #include "Utility/Hash.h"
+#include "Utility/Timer.h"
 
 namespace GFX
 {
 	static uint32_t FailedShaderCount = 0;
 
+	struct ShaderCacheCounters
+	{
+		std::atomic<uint32_t> NumHits = 0;
+		std::atomic<uint32_t> NumMisses = 0;
+		std::atomic<uint64_t> KeyTimeUS = 0;
+		std::atomic<uint64_t> CompileTimeUS = 0;
+	};
+	static ShaderCacheCounters CacheCounters;
+
+	static uint64_t ToMicroseconds(const Timer& timer)
+	{
+		return static_cast<uint64_t>(timer.GetTimeMS() * 1000.0f);
+	}
+
 	namespace ShaderCompiler
 	{
 		struct DXCCompiler
@@ -26,7 +45,41 @@ namespace GFX
 			ComPtr<IDxcIncludeHandler> IncludeHandler;
 		};
 
-		DXCCompiler Compiler;
+		// DXC instances aren't thread safe, every thread compiling shaders creates its own on first use.
+		// Instances of JobPool threads are released when the threads exit.
+		static thread_local DXCCompiler ThreadCompiler;
+
+		DXCCompiler& GetCompiler()
+		{
+			if (!ThreadCompiler.Compiler)
+			{
+				API_CALL(DxcCreateInstance(CLSID_DxcLibrary, IID_PPV_ARGS(ThreadCompiler.Library.GetAddressOf())));
+				API_CALL(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(ThreadCompiler.Compiler.GetAddressOf())));
+				API_CALL(ThreadCompiler.Library->CreateIncludeHandler(&ThreadCompiler.IncludeHandler));
+			}
+			return ThreadCompiler;
+		}
+
+		static const std::wstring SHADER_VERSION = L"6_5";
+
+		struct StageEntryPoint
+		{
+			const wchar_t* Name;
+			const wchar_t* ProfilePrefix;
+		};
+
+		// Same order as CompiledShader::Data
+		static const StageEntryPoint STAGE_ENTRY_POINTS[SHADER_STAGE_COUNT] =
+		{
+			{ L"VS", L"vs_" },
+			{ L"GS", L"gs_" },
+			{ L"HS", L"hs_" },
+			{ L"DS", L"ds_" },
+			{ L"PS", L"ps_" },
+			{ L"CS", L"cs_" },
+			{ L"MS", L"ms_" },
+		};
+		static const uint32_t STAGE_FLAGS[SHADER_STAGE_COUNT] = { VS, GS, HS, DS, PS, CS, MS };
 
 		DXGI_FORMAT ToDXGIFormat(D3D12_SIGNATURE_PARAMETER_DESC paramDesc)
 		{
@@ -83,21 +136,23 @@ namespace GFX
 			return DXGI_FORMAT_UNKNOWN;
 		}
 
-		IDxcOperationResult* DXC_Compile(const std::wstring& path, const std::wstring& entryPoint, const std::wstring& targetProfile, const std::vector<DxcDefine>& defines, bool& compilationSuccess)
+		ComPtr<IDxcBlob> DXC_Compile(const std::wstring& path, const std::wstring& entryPoint, const std::wstring& targetProfile, const std::vector<DxcDefine>& defines, bool& compilationSuccess)
 		{
+			DXCCompiler& compiler = GetCompiler();
+
 			ComPtr<IDxcBlobEncoding> sourceBlob;
 			uint32_t codePage = CP_UTF8;
-			API_CALL(Compiler.Library->CreateBlobFromFile(path.c_str(), &codePage, sourceBlob.GetAddressOf()));
+			API_CALL(compiler.Library->CreateBlobFromFile(path.c_str(), &codePage, sourceBlob.GetAddressOf()));
 
-			IDxcOperationResult* result;
+			ComPtr<IDxcOperationResult> result;
 
-			HRESULT hr = Compiler.Compiler->Compile(
+			HRESULT hr = compiler.Compiler->Compile(
 				sourceBlob.Get(), path.c_str(),
 				entryPoint.c_str(), targetProfile.c_str(),
 				nullptr, 0,
 				defines.empty() ? nullptr : defines.data(), (UINT) defines.size(),
-				Compiler.IncludeHandler.Get(),
-				&result);
+				compiler.IncludeHandler.Get(),
+				result.GetAddressOf());
 
 			compilationSuccess = compilationSuccess && SUCCEEDED(hr);
 			result->GetStatus(&hr);
@@ -116,7 +171,48 @@ namespace GFX
 					}
 				}
 			}
-			return result;
+
+			ComPtr<IDxcBlob> shaderBlob;
+			if (result) API_CALL(result->GetResult(shaderBlob.GetAddressOf()));
+			return shaderBlob;
+		}
+
+		// Source with every include and define resolved, fails on the same errors as compilation
+		bool DXC_Preprocess(const std::wstring& path, const std::vector<DxcDefine>& defines, std::string& preprocessedSource)
+		{
+			DXCCompiler& compiler = GetCompiler();
+
+			ComPtr<IDxcBlobEncoding> sourceBlob;
+			uint32_t codePage = CP_UTF8;
+			if (FAILED(compiler.Library->CreateBlobFromFile(path.c_str(), &codePage, sourceBlob.GetAddressOf()))) return false;
+
+			ComPtr<IDxcOperationResult> result;
+			HRESULT hr = compiler.Compiler->Preprocess(
+				sourceBlob.Get(), path.c_str(),
+				nullptr, 0,
+				defines.empty() ? nullptr : defines.data(), (UINT) defines.size(),
+				compiler.IncludeHandler.Get(),
+				result.GetAddressOf());
+
+			if (SUCCEEDED(hr)) result->GetStatus(&hr);
+			if (FAILED(hr)) return false;
+
+			ComPtr<IDxcBlob> preprocessedBlob;
+			if (FAILED(result->GetResult(preprocessedBlob.GetAddressOf())) || !preprocessedBlob) return false;
+
+			preprocessedSource.assign(static_cast<const char*>(preprocessedBlob->GetBufferPointer()), preprocessedBlob->GetBufferSize());
+			return true;
+		}
+
+		uint64_t DXC_GetCompilerVersion()
+		{
+			ComPtr<IDxcVersionInfo> versionInfo;
+			if (FAILED(GetCompiler().Compiler.As(&versionInfo))) return 0;
+
+			UINT32 major = 0, minor = 0, flags = 0;
+			versionInfo->GetVersion(&major, &minor);
+			versionInfo->GetFlags(&flags);
+			return (static_cast<uint64_t>(major) << 48) | (static_cast<uint64_t>(minor) << 32) | flags;
 		}
 
 		std::vector<D3D12_INPUT_ELEMENT_DESC> DXC_CreateInputLayout(IDxcBlob* vsBlob, bool multiInput)
@@ -172,11 +268,61 @@ namespace GFX
 			return inputLayout;
 		}
 
-		// Returns true if compile success
-		bool CompileShader(const std::string path, const uint32_t creationFlags, const std::vector<std::string>& defines, CompiledShader& compiledShader)
+		// Key of the preprocessed source, defines are expected to be sorted
+		ShaderCache::CacheKey GetCacheKey(const std::string& preprocessedSource, const std::vector<std::string>& defines, uint32_t shaderStages)
+		{
+			Hash::Hasher hasher;
+			hasher.Add(shaderStages);
+			hasher.Add(SHADER_VERSION.c_str(), SHADER_VERSION.size() * sizeof(wchar_t));
+			hasher.Add((uint32_t) defines.size());
+			for (const std::string& define : defines) hasher.Add(define);
+			hasher.Add(preprocessedSource);
+			return hasher.Get();
+		}
+
+		uint64_t HashInputLayout(const std::vector<D3D12_INPUT_ELEMENT_DESC>& inputLayout)
+		{
+			Hash::Hasher hasher;
+			hasher.Add((uint32_t) inputLayout.size());
+			for (const D3D12_INPUT_ELEMENT_DESC& element : inputLayout)
+			{
+				hasher.Add(element.SemanticName, strlen(element.SemanticName));
+				hasher.Add(element.SemanticIndex);
+				hasher.Add(element.Format);
+				hasher.Add(element.InputSlot);
+				hasher.Add(element.AlignedByteOffset);
+				hasher.Add(element.InputSlotClass);
+				hasher.Add(element.InstanceDataStepRate);
+			}
+			return hasher.Get();
+		}
+
+		void SetBytecode(CompiledShader& compiledShader)
 		{
-			static const std::wstring SHADER_VERSION = L"6_5";
+			D3D12_SHADER_BYTECODE* bytecode[SHADER_STAGE_COUNT] = { &compiledShader.Vertex, &compiledShader.Geometry, &compiledShader.Hull, &compiledShader.Domain, &compiledShader.Pixel, &compiledShader.Compute, &compiledShader.Mesh };
+			for (uint32_t i = 0; i < SHADER_STAGE_COUNT; i++)
+			{
+				IDxcBlob* blob = compiledShader.Data[i].Get();
+				*bytecode[i] = blob ? D3D12_SHADER_BYTECODE{ blob->GetBufferPointer(), blob->GetBufferSize() } : D3D12_SHADER_BYTECODE{ nullptr, 0 };
+			}
+
+			if (compiledShader.Vertex.BytecodeLength)
+			{
+				compiledShader.InputLayout = DXC_CreateInputLayout(compiledShader.Data[0].Get(), false);
+				compiledShader.InputLayoutMultiInput = DXC_CreateInputLayout(compiledShader.Data[0].Get(), true);
+			}
+
+			Hash::Hasher bytecodeHasher;
+			bytecodeHasher.Add(compiledShader.ShaderStages);
+			for (uint32_t i = 0; i < SHADER_STAGE_COUNT; i++) bytecodeHasher.Add(bytecode[i]->pShaderBytecode, bytecode[i]->BytecodeLength);
+			compiledShader.BytecodeHash = bytecodeHasher.Get();
+			compiledShader.InputLayoutHash = HashInputLayout(compiledShader.InputLayout);
+			compiledShader.InputLayoutMultiInputHash = HashInputLayout(compiledShader.InputLayoutMultiInput);
+		}
 
+		// Returns true if compile success
+		bool CompileShader(const std::string path, const uint32_t creationFlags, const std::vector<std::string>& defines, ShaderHash implHash, bool useCache, CompiledShader& compiledShader)
+		{
 			std::vector<std::wstring> dxcDefinesW;
 			std::vector<DxcDefine> dxcDefines;
 			dxcDefines.resize(defines.size());
@@ -191,79 +337,145 @@ namespace GFX
 
 			const std::wstring wPath = StringUtility::ToWideString(path);
 
-			bool compilationSuccess = true;
+			compiledShader.Defines = defines;
+			compiledShader.ShaderStages = creationFlags;
+			compiledShader.Data.clear();
 			compiledShader.Data.resize(SHADER_STAGE_COUNT);
-			compiledShader.Data[0] = creationFlags & VS ? DXC_Compile(wPath, L"VS", L"vs_" + SHADER_VERSION, dxcDefines, compilationSuccess) : nullptr;
-			compiledShader.Data[1] = creationFlags & GS ? DXC_Compile(wPath, L"GS", L"gs_" + SHADER_VERSION, dxcDefines, compilationSuccess) : nullptr;
-			compiledShader.Data[2] = creationFlags & HS ? DXC_Compile(wPath, L"HS", L"hs_" + SHADER_VERSION, dxcDefines, compilationSuccess) : nullptr;
-			compiledShader.Data[3] = creationFlags & DS ? DXC_Compile(wPath, L"DS", L"ds_" + SHADER_VERSION, dxcDefines, compilationSuccess) : nullptr;
-			compiledShader.Data[4] = creationFlags & PS ? DXC_Compile(wPath, L"PS", L"ps_" + SHADER_VERSION, dxcDefines, compilationSuccess) : nullptr;
-			compiledShader.Data[5] = creationFlags & CS ? DXC_Compile(wPath, L"CS", L"cs_" + SHADER_VERSION, dxcDefines, compilationSuccess) : nullptr;
-			compiledShader.Data[6] = creationFlags & MS ? DXC_Compile(wPath, L"MS", L"ms_" + SHADER_VERSION, dxcDefines, compilationSuccess) : nullptr;
-
-			ComPtr<IDxcBlob> shaderBlobs[SHADER_STAGE_COUNT];
+
+			// Source that fails to preprocess is compiled anyway, so the errors are reported
+			ShaderCache* shaderCache = useCache ? ShaderCache::Get() : nullptr;
+			ShaderCache::CacheKey cacheKey = 0;
+			if (shaderCache)
+			{
+				Timer keyTimer;
+				keyTimer.Start();
+				std::string preprocessedSource;
+				const bool preprocessed = DXC_Preprocess(wPath, dxcDefines, preprocessedSource);
+				if (preprocessed) cacheKey = GetCacheKey(preprocessedSource, defines, creationFlags);
+				else shaderCache = nullptr;
+				keyTimer.Stop();
+				CacheCounters.KeyTimeUS += ToMicroseconds(keyTimer);
+			}
+
+			ShaderCache::CachedShader cachedShader;
+			if (shaderCache && shaderCache->Find(cacheKey, cachedShader))
+			{
+				CacheCounters.NumHits++;
+
+				for (uint32_t i = 0; i < SHADER_STAGE_COUNT; i++)
+				{
+					if (!cachedShader.ByteSize[i]) continue;
+
+					ComPtr<IDxcBlobEncoding> blob;
+					API_CALL(GetCompiler().Library->CreateBlobWithEncodingOnHeapCopy(cachedShader.Bytecode[i], cachedShader.ByteSize[i], CP_ACP, blob.GetAddressOf()));
+					compiledShader.Data[i] = blob;
+				}
+
+				SetBytecode(compiledShader);
+				return true;
+			}
+
+			uint32_t stages[SHADER_STAGE_COUNT];
+			uint32_t numStages = 0;
 			for (uint32_t i = 0; i < SHADER_STAGE_COUNT; i++)
 			{
-				if (compiledShader.Data[i]) API_CALL(compiledShader.Data[i]->GetResult(shaderBlobs[i].GetAddressOf()));
+				if (creationFlags & STAGE_FLAGS[i]) stages[numStages++] = i;
 			}
 
-			compiledShader.Vertex = shaderBlobs[0].Get() ? D3D12_SHADER_BYTECODE{ shaderBlobs[0]->GetBufferPointer(), shaderBlobs[0]->GetBufferSize()} : D3D12_SHADER_BYTECODE{nullptr, 0};
-			compiledShader.Geometry = shaderBlobs[1].Get() ? D3D12_SHADER_BYTECODE{ shaderBlobs[1]->GetBufferPointer(), shaderBlobs[1]->GetBufferSize() } : D3D12_SHADER_BYTECODE{ nullptr, 0 };
-			compiledShader.Hull = shaderBlobs[2].Get() ? D3D12_SHADER_BYTECODE{ shaderBlobs[2]->GetBufferPointer(), shaderBlobs[2]->GetBufferSize() } : D3D12_SHADER_BYTECODE{ nullptr, 0 };
-			compiledShader.Domain = shaderBlobs[3].Get() ? D3D12_SHADER_BYTECODE{ shaderBlobs[3]->GetBufferPointer(), shaderBlobs[3]->GetBufferSize() } : D3D12_SHADER_BYTECODE{ nullptr, 0 };
-			compiledShader.Pixel = shaderBlobs[4].Get() ? D3D12_SHADER_BYTECODE{ shaderBlobs[4]->GetBufferPointer(), shaderBlobs[4]->GetBufferSize() } : D3D12_SHADER_BYTECODE{ nullptr, 0 };
-			compiledShader.Compute = shaderBlobs[5].Get() ? D3D12_SHADER_BYTECODE{ shaderBlobs[5]->GetBufferPointer(), shaderBlobs[5]->GetBufferSize() } : D3D12_SHADER_BYTECODE{ nullptr, 0 };
-			compiledShader.Mesh = shaderBlobs[6].Get() ? D3D12_SHADER_BYTECODE{ shaderBlobs[6]->GetBufferPointer(), shaderBlobs[6]->GetBufferSize() } : D3D12_SHADER_BYTECODE{ nullptr, 0 };
+			// Stages are independent, each one is compiled on its own JobPool thread
+			Timer compileTimer;
+			compileTimer.Start();
+			bool stageSuccess[SHADER_STAGE_COUNT] = {};
+			const auto compileStage = [&](uint32_t index)
+			{
+				const uint32_t stage = stages[index];
+				bool success = true;
+				compiledShader.Data[stage] = DXC_Compile(wPath, STAGE_ENTRY_POINTS[stage].Name, STAGE_ENTRY_POINTS[stage].ProfilePrefix + SHADER_VERSION, dxcDefines, success);
+				stageSuccess[stage] = success;
+			};
 
-			if (compiledShader.Vertex.BytecodeLength)
+			if (numStages > 1 && JobPool::Get())
 			{
-				compiledShader.InputLayout = DXC_CreateInputLayout(shaderBlobs[0].Get(), false);
-				compiledShader.InputLayoutMultiInput = DXC_CreateInputLayout(shaderBlobs[0].Get(), true);
+				JobPool::Get()->ParallelFor(numStages, compileStage);
+			}
+			else
+			{
+				for (uint32_t i = 0; i < numStages; i++) compileStage(i);
+			}
+
+			compileTimer.Stop();
+
+			bool compilationSuccess = true;
+			for (uint32_t i = 0; i < numStages; i++) compilationSuccess = compilationSuccess && stageSuccess[stages[i]];
+
+			if (shaderCache)
+			{
+				CacheCounters.NumMisses++;
+				CacheCounters.CompileTimeUS += ToMicroseconds(compileTimer);
+			}
+
+			SetBytecode(compiledShader);
+
+			if (shaderCache && compilationSuccess)
+			{
+				for (uint32_t i = 0; i < SHADER_STAGE_COUNT; i++)
+				{
+					IDxcBlob* blob = compiledShader.Data[i].Get();
+					cachedShader.Bytecode[i] = blob ? static_cast<const uint8_t*>(blob->GetBufferPointer()) : nullptr;
+					cachedShader.ByteSize[i] = blob ? static_cast<uint32_t>(blob->GetBufferSize()) : 0;
+				}
+				shaderCache->Store(cacheKey, path, implHash, cachedShader);
 			}
 
 			return compilationSuccess;
 		}
 	}
 
-	void InitShaderCompiler()
+	void InitShaderCompiler(const std::string& cachePath)
 	{
 		using namespace ShaderCompiler;
 
-		API_CALL(DxcCreateInstance(CLSID_DxcLibrary, IID_PPV_ARGS(Compiler.Library.GetAddressOf())));
-		API_CALL(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(Compiler.Compiler.GetAddressOf())));
-		API_CALL(Compiler.Library->CreateIncludeHandler(&Compiler.IncludeHandler));
+		ShaderCache::Init(cachePath, DXC_GetCompilerVersion());
 	}
 
 	void DestroyShaderCompiler()
 	{
 		using namespace ShaderCompiler;
 
-		Compiler.Library = nullptr;
-		Compiler.Compiler = nullptr;
-		Compiler.IncludeHandler = nullptr;
+		const ShaderCacheStats stats = GetShaderCacheStats();
+		std::cout << "[ShaderCache] " << stats.NumHits << " hits, " << stats.NumMisses << " misses, " << stats.KeyTimeMS << " ms hashing sources, " << stats.CompileTimeMS << " ms compiling misses" << std::endl;
+		ShaderCache::Destroy();
+
+		ThreadCompiler.Library = nullptr;
+		ThreadCompiler.Compiler = nullptr;
+		ThreadCompiler.IncludeHandler = nullptr;
 	}
 
+	// Defines are expected to be sorted so the same set in a different order isn't a new implementation
 	static ShaderHash GetImlementationHash(const std::vector<std::string>& defines, uint32_t shaderStages)
 	{
-		// TODO: Sort defines so we don't make duplicates
-		std::string defAll = " ";
-		for (const std::string& def : defines) defAll += def;
-		if (shaderStages & VS) defAll += "VS";
-		if (shaderStages & HS) defAll += "HS";
-		if (shaderStages & DS) defAll += "DS";
-		if (shaderStages & GS) defAll += "GS";
-		if (shaderStages & PS) defAll += "PS";
-		if (shaderStages & CS) defAll += "CS";
-		if (shaderStages & MS) defAll += "MS";
-		return Hash::Crc32(defAll);
+		Hash::Hasher hasher;
+		hasher.Add(shaderStages);
+		for (const std::string& def : defines) hasher.Add(def);
+		return hasher.Get();
 	}
 
-	const CompiledShader& GetCompiledShader(Shader* shader, const std::vector<std::string>& defines, uint32_t shaderStages)
+	const CompiledShader& GetCompiledShader(Shader* shader, const std::vector<std::string>& unsortedDefines, uint32_t shaderStages)
 	{
-		const uint32_t implHash = GetImlementationHash(defines, shaderStages);
+		// Configs are usually built in the same order, copy only when they aren't
+		std::vector<std::string> sortedDefinesCopy;
+		const bool sorted = std::is_sorted(unsortedDefines.begin(), unsortedDefines.end());
+		if (!sorted)
+		{
+			sortedDefinesCopy = unsortedDefines;
+			std::sort(sortedDefinesCopy.begin(), sortedDefinesCopy.end());
+		}
+		const std::vector<std::string>& defines = sorted ? unsortedDefines : sortedDefinesCopy;
+
+		const ShaderHash implHash = GetImlementationHash(defines, shaderStages);
 		if (!shader->Implementations.contains(implHash))
 		{
-			bool success = ShaderCompiler::CompileShader(shader->Path, shaderStages, defines, shader->Implementations[implHash]);
+			bool success = ShaderCompiler::CompileShader(shader->Path, shaderStages, defines, implHash, true, shader->Implementations[implHash]);
 			ASSERT(success, "Shader compilation failed!");
 		}
 
@@ -273,7 +485,7 @@ namespace GFX
 			compiledShader.NeedsRecompilation = false;
 
 			CompiledShader recompiledShader;
-			bool success = ShaderCompiler::CompileShader(shader->Path, shaderStages, defines, recompiledShader);
+			bool success = ShaderCompiler::CompileShader(shader->Path, shaderStages, defines, implHash, true, recompiledShader);
 			if (success)
 			{
 				compiledShader = recompiledShader;
@@ -287,6 +499,65 @@ namespace GFX
 		return compiledShader;
 	}
 
+	void WarmUpShaders(const std::vector<Shader*>& shaders)
+	{
+		struct WarmUpItem
+		{
+			Shader* Owner = nullptr;
+			const ShaderPermutation* Permutation = nullptr;
+			ShaderHash ImplHash = 0;
+			CompiledShader Compiled;
+			bool Success = false;
+		};
+
+		std::vector<WarmUpItem> items;
+		std::set<std::pair<Shader*, ShaderHash>> queuedImplementations;
+		for (Shader* shader : shaders)
+		{
+			for (const ShaderPermutation& permutation : shader->Permutations)
+			{
+				const ShaderHash implHash = GetImlementationHash(permutation.Defines, permutation.ShaderStages);
+				if (shader->Implementations.contains(implHash) || queuedImplementations.contains({ shader, implHash })) continue;
+
+				queuedImplementations.insert({ shader, implHash });
+				WarmUpItem& item = items.emplace_back();
+				item.Owner = shader;
+				item.Permutation = &permutation;
+				item.ImplHash = implHash;
+			}
+		}
+
+		if (items.empty()) return;
+
+		// Every item compiles its stages with a nested ParallelFor, so permutations and stages share the pool
+		Timer timer;
+		timer.Start();
+		JobPool::Get()->ParallelFor((uint32_t) items.size(), [&items](uint32_t index)
+		{
+			WarmUpItem& item = items[index];
+			item.Success = ShaderCompiler::CompileShader(item.Owner->Path, item.Permutation->ShaderStages, item.Permutation->Defines, item.ImplHash, true, item.Compiled);
+		});
+		timer.Stop();
+
+		uint32_t numFailed = 0;
+		for (WarmUpItem& item : items)
+		{
+			if (item.Success)
+			{
+				item.Owner->Implementations[item.ImplHash] = std::move(item.Compiled);
+			}
+			else
+			{
+				// Left out so the first draw compiles it again and reports the error
+				std::cout << "[ShaderCompiler] Failed to warm up " << item.Owner->Path << std::endl;
+				numFailed++;
+			}
+		}
+		FailedShaderCount += numFailed;
+
+		std::cout << "[ShaderCompiler] Warmed up " << items.size() - numFailed << " permutations of " << shaders.size() << " shaders in " << timer.GetTimeMS() << " ms" << std::endl;
+	}
+
 	void ReloadAllShaders()
 	{
 		FailedShaderCount = 0;
@@ -304,6 +575,48 @@ namespace GFX
 	{
 		return FailedShaderCount;
 	}
+
+	ShaderCacheStats GetShaderCacheStats()
+	{
+		ShaderCacheStats stats;
+		stats.NumHits = CacheCounters.NumHits;
+		stats.NumMisses = CacheCounters.NumMisses;
+		stats.NumLoadedEntries = ShaderCache::Get() ? ShaderCache::Get()->GetNumLoadedEntries() : 0;
+		stats.KeyTimeMS = CacheCounters.KeyTimeUS / 1000.0f;
+		stats.CompileTimeMS = CacheCounters.CompileTimeUS / 1000.0f;
+		return stats;
+	}
+
+	bool CompileShaderImplementation(const Shader* shader, const std::vector<std::string>& defines, uint32_t shaderStages, bool useCache, CompiledShader& compiledShader)
+	{
+		return ShaderCompiler::CompileShader(shader->Path, shaderStages, defines, GetImlementationHash(defines, shaderStages), useCache, compiledShader);
+	}
+}
+
+void Shader::AddPermutations(const std::vector<std::vector<std::string>>& defineGroups, uint32_t shaderStages)
+{
+	std::vector<std::vector<std::string>> combinations = { {} };
+	for (const std::vector<std::string>& group : defineGroups)
+	{
+		if (group.empty()) continue;
+
+		std::vector<std::vector<std::string>> groupCombinations;
+		for (const std::vector<std::string>& combination : combinations)
+		{
+			for (const std::string& define : group)
+			{
+				std::vector<std::string>& groupCombination = groupCombinations.emplace_back(combination);
+				if (!define.empty()) groupCombination.push_back(define);
+			}
+		}
+		combinations = std::move(groupCombinations);
+	}
+
+	for (std::vector<std::string>& defines : combinations)
+	{
+		std::sort(defines.begin(), defines.end());
+		Permutations.push_back(ShaderPermutation{ std::move(defines), shaderStages });
+	}
 }
 
 std::set<Shader*> Shader::AllShaders;
@@ -22,7 +22,7 @@ enum ShaderStage : uint8_t
 	SHADER_STAGE_COUNT = 7
 };
 
-using ShaderHash = uint32_t;
+using ShaderHash = uint64_t;
 
 struct CompiledShader
 {
@@ -38,7 +38,24 @@ struct CompiledShader
 	std::vector<D3D12_INPUT_ELEMENT_DESC> InputLayout;
 	std::vector<D3D12_INPUT_ELEMENT_DESC> InputLayoutMultiInput;
 
-	std::vector<ComPtr<IDxcOperationResult>> Data;
+	// Content hashes that stay the same between runs, pipelines are keyed by them instead of the pointers above
+	uint64_t BytecodeHash = 0;
+	uint64_t InputLayoutHash = 0;
+	uint64_t InputLayoutMultiInputHash = 0;
+
+	// Bytecode per stage, either compiled or copied from the shader cache
+	std::vector<ComPtr<IDxcBlob>> Data;
+
+	// What the implementation was requested with, so it can be compiled again outside of GetCompiledShader
+	std::vector<std::string> Defines;
+	uint32_t ShaderStages = 0;
+};
+
+// Implementation a shader is drawn with, listed up front so it can be compiled before the first draw
+struct ShaderPermutation
+{
+	std::vector<std::string> Defines;	// Sorted
+	uint32_t ShaderStages = VS | PS;
 };
 
 struct Shader
@@ -55,17 +72,42 @@ struct Shader
 		AllShaders.erase(this);
 	}
 
+	// Adds every combination of the define groups. Defines in a group exclude each other, empty string stands for none of them.
+	// e.g. {{"", "A"}, {"B", "C"}} adds {B}, {C}, {A, B} and {A, C}
+	void AddPermutations(const std::vector<std::vector<std::string>>& defineGroups, uint32_t shaderStages = VS | PS);
+
 	std::string Path;
 	std::unordered_map<ShaderHash, CompiledShader> Implementations;
+	std::vector<ShaderPermutation> Permutations;
+};
+
+struct ShaderCacheStats
+{
+	uint32_t NumHits = 0;
+	uint32_t NumMisses = 0;
+	uint32_t NumLoadedEntries = 0;	// Entries found in the cache file on init
+	float KeyTimeMS = 0.0f;			// Preprocessing and hashing of every lookup
+	float CompileTimeMS = 0.0f;		// Compilation on misses
 };
 
 namespace GFX
 {
-	void InitShaderCompiler();
+	// Compiled bytecode is kept in a disk cache at cachePath, see ShaderCache.h
+	void InitShaderCompiler(const std::string& cachePath);
 	void DestroyShaderCompiler();
 
 	const CompiledShader& GetCompiledShader(Shader* shaderID, const std::vector<std::string>& defines, uint32_t shaderStages);
 	void ReloadAllShaders();
 
+	// Compiles every listed permutation of the shaders that isn't compiled yet, so first draws don't stall on the compiler.
+	// Permutations and their stages are compiled in parallel on the JobPool. Call when no context is recording with these shaders.
+	void WarmUpShaders(const std::vector<Shader*>& shaders);
+
 	uint32_t GetFailedShaderCount();
+
+	ShaderCacheStats GetShaderCacheStats();
+
+	// Compiles an implementation without storing it in the shader, e.g. to compare against what the cache returns. Defines are expected to be sorted.
+	// Without the cache it's always compiled from source and isn't counted in the cache stats.
+	bool CompileShaderImplementation(const Shader* shader, const std::vector<std::string>& defines, uint32_t shaderStages, bool useCache, CompiledShader& compiledShader);
 }
\ No newline at end of file
@@ -0,0 +1,212 @@
+#include "ShaderCache.h"
+
+#include <filesystem>
+#include <fstream>
+#include <set>
+
+ShaderCache* ShaderCache::s_Instance = nullptr;
+
+namespace
+{
+	static constexpr uint32_t SHADER_CACHE_MAGIC = 0x43444853; // "SHDC"
+	// 2: keys and implementation hashes are Hash64 instead of CRC32
+	static constexpr uint32_t SHADER_CACHE_VERSION = 2;
+
+	struct FileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint64_t CompilerVersion;
+		uint32_t NumEntries;
+		uint32_t Padding;
+	};
+
+	// Followed by the shader path and the bytecode of every stage
+	struct EntryHeader
+	{
+		uint64_t Key;
+		uint64_t ImplementationHash;
+		uint32_t PathLength;
+		uint32_t ByteSize[SHADER_STAGE_COUNT];
+	};
+}
+
+ShaderCache::ShaderCache(const std::string& path, uint64_t compilerVersion) :
+	m_Path(path),
+	m_CompilerVersion(compilerVersion)
+{
+	Load();
+}
+
+ShaderCache::~ShaderCache()
+{
+	Save();
+}
+
+bool ShaderCache::Find(CacheKey key, CachedShader& cachedShader)
+{
+	const auto loadedIt = m_LoadedEntries.find(key);
+	if (loadedIt != m_LoadedEntries.end())
+	{
+		cachedShader = loadedIt->second.Shader;
+		return true;
+	}
+
+	// Stored entries are never replaced, their bytecode stays in place after the lock is released
+	m_Mutex.Lock();
+	const auto storedIt = m_StoredEntries.find(key);
+	const bool found = storedIt != m_StoredEntries.end();
+	if (found) cachedShader = storedIt->second.Entry.Shader;
+	m_Mutex.Unlock();
+
+	return found;
+}
+
+void ShaderCache::Store(CacheKey key, const std::string& shaderPath, ShaderHash implementationHash, const CachedShader& cachedShader)
+{
+	m_Mutex.Lock();
+
+	if (!m_StoredEntries.contains(key))
+	{
+		StoredEntry& storedEntry = m_StoredEntries[key];
+		storedEntry.Entry.ShaderPath = shaderPath;
+		storedEntry.Entry.ImplementationHash = implementationHash;
+
+		uint64_t byteSize = 0;
+		for (uint32_t i = 0; i < SHADER_STAGE_COUNT; i++) byteSize += cachedShader.ByteSize[i];
+		storedEntry.Bytecode.resize(byteSize);
+
+		uint8_t* bytecode = storedEntry.Bytecode.data();
+		for (uint32_t i = 0; i < SHADER_STAGE_COUNT; i++)
+		{
+			const uint32_t stageSize = cachedShader.ByteSize[i];
+			if (stageSize) memcpy(bytecode, cachedShader.Bytecode[i], stageSize);
+			storedEntry.Entry.Shader.Bytecode[i] = stageSize ? bytecode : nullptr;
+			storedEntry.Entry.Shader.ByteSize[i] = stageSize;
+			bytecode += stageSize;
+		}
+	}
+
+	m_Mutex.Unlock();
+}
+
+void ShaderCache::Load()
+{
+	std::ifstream file(m_Path, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) return;
+
+	const uint64_t fileSize = file.tellg();
+	file.seekg(0);
+
+	m_FileData.resize(fileSize);
+	file.read(reinterpret_cast<char*>(m_FileData.data()), fileSize);
+	if (!file.good() || fileSize < sizeof(FileHeader))
+	{
+		std::cout << "[ShaderCache] Failed to read " << m_Path << std::endl;
+		m_FileData.clear();
+		return;
+	}
+
+	FileHeader header;
+	memcpy(&header, m_FileData.data(), sizeof(FileHeader));
+	if (header.Magic != SHADER_CACHE_MAGIC || header.Version != SHADER_CACHE_VERSION || header.CompilerVersion != m_CompilerVersion)
+	{
+		std::cout << "[ShaderCache] " << m_Path << " was written by a different cache or compiler version, every shader will be recompiled" << std::endl;
+		m_FileData.clear();
+		return;
+	}
+
+	uint64_t offset = sizeof(FileHeader);
+	for (uint32_t i = 0; i < header.NumEntries; i++)
+	{
+		EntryHeader entryHeader;
+		if (offset + sizeof(EntryHeader) > fileSize) break;
+		memcpy(&entryHeader, m_FileData.data() + offset, sizeof(EntryHeader));
+		offset += sizeof(EntryHeader);
+
+		uint64_t entrySize = entryHeader.PathLength;
+		for (uint32_t stage = 0; stage < SHADER_STAGE_COUNT; stage++) entrySize += entryHeader.ByteSize[stage];
+		if (offset + entrySize > fileSize) break;
+
+		Entry entry;
+		entry.ShaderPath.assign(reinterpret_cast<const char*>(m_FileData.data() + offset), entryHeader.PathLength);
+		entry.ImplementationHash = entryHeader.ImplementationHash;
+		offset += entryHeader.PathLength;
+
+		for (uint32_t stage = 0; stage < SHADER_STAGE_COUNT; stage++)
+		{
+			const uint32_t stageSize = entryHeader.ByteSize[stage];
+			entry.Shader.Bytecode[stage] = stageSize ? m_FileData.data() + offset : nullptr;
+			entry.Shader.ByteSize[stage] = stageSize;
+			offset += stageSize;
+		}
+
+		m_LoadedEntries[entryHeader.Key] = std::move(entry);
+	}
+
+	if (m_LoadedEntries.size() != header.NumEntries)
+	{
+		std::cout << "[ShaderCache] " << m_Path << " is truncated, loaded " << m_LoadedEntries.size() << " of " << header.NumEntries << " entries" << std::endl;
+	}
+}
+
+void ShaderCache::Save()
+{
+	// Implementation that got a new key this session was edited, its old entry is never going to be found again
+	std::set<std::pair<std::string, ShaderHash>> recompiledImplementations;
+	for (const auto& [key, storedEntry] : m_StoredEntries)
+	{
+		recompiledImplementations.insert({ storedEntry.Entry.ShaderPath, storedEntry.Entry.ImplementationHash });
+	}
+
+	std::vector<std::pair<CacheKey, const Entry*>> entries;
+	entries.reserve(m_LoadedEntries.size() + m_StoredEntries.size());
+
+	uint32_t numStaleEntries = 0;
+	for (const auto& [key, entry] : m_LoadedEntries)
+	{
+		const bool stale = recompiledImplementations.contains({ entry.ShaderPath, entry.ImplementationHash }) || !std::filesystem::exists(entry.ShaderPath);
+		if (stale) numStaleEntries++;
+		else entries.push_back({ key, &entry });
+	}
+
+	for (const auto& [key, storedEntry] : m_StoredEntries)
+	{
+		entries.push_back({ key, &storedEntry.Entry });
+	}
+
+	// Nothing changed since the cache was loaded
+	if (m_StoredEntries.empty() && numStaleEntries == 0) return;
+
+	std::ofstream file(m_Path, std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cout << "[ShaderCache] Failed to open " << m_Path << " for writing" << std::endl;
+		return;
+	}
+
+	FileHeader header{};
+	header.Magic = SHADER_CACHE_MAGIC;
+	header.Version = SHADER_CACHE_VERSION;
+	header.CompilerVersion = m_CompilerVersion;
+	header.NumEntries = (uint32_t) entries.size();
+	file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+
+	for (const auto& [key, entry] : entries)
+	{
+		EntryHeader entryHeader{};
+		entryHeader.Key = key;
+		entryHeader.ImplementationHash = entry->ImplementationHash;
+		entryHeader.PathLength = (uint32_t) entry->ShaderPath.size();
+		for (uint32_t stage = 0; stage < SHADER_STAGE_COUNT; stage++) entryHeader.ByteSize[stage] = entry->Shader.ByteSize[stage];
+
+		file.write(reinterpret_cast<const char*>(&entryHeader), sizeof(EntryHeader));
+		file.write(entry->ShaderPath.c_str(), entry->ShaderPath.size());
+		for (uint32_t stage = 0; stage < SHADER_STAGE_COUNT; stage++)
+		{
+			file.write(reinterpret_cast<const char*>(entry->Shader.Bytecode[stage]), entry->Shader.ByteSize[stage]);
+		}
+	}
+
+	std::cout << "[ShaderCache] Saved " << entries.size() << " shader implementations, " << m_StoredEntries.size() << " new and " << numStaleEntries << " stale dropped" << std::endl;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "Common.h"
+#include "Render/Shader.h"
+#include "Utility/Multithreading.h"
+
+// Persistent DXIL of compiled shader implementations, loaded once on init and written back on destroy.
+// Entries are keyed by the preprocessed source (includes resolved), sorted defines, stages and compiler version, so edited shaders just miss.
+// Entry of a shader implementation that was compiled again with a different key is stale and isn't written back, neither are entries of deleted shader files.
+class ShaderCache
+{
+public:
+	using CacheKey = uint64_t;
+
+	static void Init(const std::string& path, uint64_t compilerVersion) { s_Instance = new ShaderCache(path, compilerVersion); }
+	static ShaderCache* Get() { return s_Instance; }
+	static void Destroy() { SAFE_DELETE(s_Instance); }
+
+private:
+	static ShaderCache* s_Instance;
+
+	ShaderCache(const std::string& path, uint64_t compilerVersion);
+	~ShaderCache();
+
+public:
+	// Bytecode of every stage, empty stages have zero size. Points into memory owned by the cache.
+	struct CachedShader
+	{
+		const uint8_t* Bytecode[SHADER_STAGE_COUNT] = {};
+		uint32_t ByteSize[SHADER_STAGE_COUNT] = {};
+	};
+
+	// Entries loaded from disk don't change until the cache is destroyed, so finding them is lock free. Entries stored this session are behind a mutex.
+	bool Find(CacheKey key, CachedShader& cachedShader);
+
+	// Thread safe
+	void Store(CacheKey key, const std::string& shaderPath, ShaderHash implementationHash, const CachedShader& cachedShader);
+
+	uint64_t GetCompilerVersion() const { return m_CompilerVersion; }
+	uint32_t GetNumLoadedEntries() const { return (uint32_t) m_LoadedEntries.size(); }
+
+private:
+	struct Entry
+	{
+		std::string ShaderPath;
+		ShaderHash ImplementationHash = 0;
+		CachedShader Shader;
+	};
+
+	struct StoredEntry
+	{
+		Entry Entry;
+		std::vector<uint8_t> Bytecode;	// Every stage one after another
+	};
+
+	void Load();
+	void Save();
+
+private:
+	std::string m_Path;
+	uint64_t m_CompilerVersion = 0;
+
+	std::vector<uint8_t> m_FileData;
+	std::unordered_map<CacheKey, Entry> m_LoadedEntries;
+
+	MTR::Mutex m_Mutex;
+	std::unordered_map<CacheKey, StoredEntry> m_StoredEntries;
+};
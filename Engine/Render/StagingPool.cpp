@@ -0,0 +1,125 @@
+#include "StagingPool.h"
+
+#include "Render/Buffer.h"
+
+StagingPool::StagingPool(bool cpuOnly, uint64_t budget) :
+	m_CPUOnly(cpuOnly),
+	m_Budget(budget)
+{
+}
+
+StagingPool::~StagingPool()
+{
+	ASSERT(m_Stats.NumChunks == m_Stats.NumFreeChunks, "[StagingPool] Chunks are still in use");
+
+	for (std::vector<Chunk*>& freeChunks : m_FreeChunks)
+	{
+		for (Chunk* chunk : freeChunks) DeleteChunk(chunk);
+	}
+}
+
+uint32_t StagingPool::GetSizeClass(uint64_t byteSize)
+{
+	uint32_t sizeClass = 0;
+	while (sizeClass < NUM_SIZE_CLASSES && GetClassSize(sizeClass) < byteSize) sizeClass++;
+	return sizeClass;
+}
+
+StagingPool::Chunk* StagingPool::Acquire(uint64_t byteSize)
+{
+	const uint32_t sizeClass = GetSizeClass(byteSize);
+
+	m_Mutex.Lock();
+	m_Stats.NumAcquires++;
+
+	Chunk* chunk = nullptr;
+	if (sizeClass < NUM_SIZE_CLASSES && !m_FreeChunks[sizeClass].empty())
+	{
+		chunk = m_FreeChunks[sizeClass].back();
+		m_FreeChunks[sizeClass].pop_back();
+
+		m_Stats.NumReuses++;
+		m_Stats.NumFreeChunks--;
+		m_Stats.FreeBytes -= chunk->ByteSize;
+	}
+	m_Mutex.Unlock();
+
+	// Creation is slow, other threads can take chunks in the meantime
+	if (!chunk)
+	{
+		chunk = CreateChunk(sizeClass < NUM_SIZE_CLASSES ? GetClassSize(sizeClass) : byteSize, sizeClass);
+
+		m_Mutex.Lock();
+		m_Stats.NumChunks++;
+		m_Stats.ChunkBytes += chunk->ByteSize;
+		m_Mutex.Unlock();
+	}
+
+	return chunk;
+}
+
+void StagingPool::Release(Chunk* chunk)
+{
+	m_Mutex.Lock();
+	const bool keep = chunk->SizeClass < NUM_SIZE_CLASSES && m_Stats.FreeBytes + chunk->ByteSize <= m_Budget;
+	if (keep)
+	{
+		m_FreeChunks[chunk->SizeClass].push_back(chunk);
+		m_Stats.NumFreeChunks++;
+		m_Stats.FreeBytes += chunk->ByteSize;
+	}
+	else
+	{
+		m_Stats.NumChunks--;
+		m_Stats.ChunkBytes -= chunk->ByteSize;
+	}
+	m_Mutex.Unlock();
+
+	if (!keep) DeleteChunk(chunk);
+}
+
+StagingPool::Stats StagingPool::GetStats()
+{
+	m_Mutex.Lock();
+	const Stats stats = m_Stats;
+	m_Mutex.Unlock();
+	return stats;
+}
+
+StagingPool::Chunk* StagingPool::CreateChunk(uint64_t byteSize, uint32_t sizeClass)
+{
+	Chunk* chunk = new Chunk{};
+	chunk->ByteSize = (byteSize + CHUNK_ALIGNMENT - 1) & ~(CHUNK_ALIGNMENT - 1);
+	chunk->SizeClass = sizeClass;
+
+	if (m_CPUOnly)
+	{
+		chunk->CPUMemory.resize(chunk->ByteSize + CHUNK_ALIGNMENT);
+		const uintptr_t address = reinterpret_cast<uintptr_t>(chunk->CPUMemory.data());
+		chunk->CPUAddress = reinterpret_cast<uint8_t*>((address + CHUNK_ALIGNMENT - 1) & ~(CHUNK_ALIGNMENT - 1));
+		chunk->GPUAddress = reinterpret_cast<uintptr_t>(chunk->CPUAddress);
+	}
+	else
+	{
+		ASSERT(chunk->ByteSize <= UINT32_MAX, "[StagingPool] Buffers are limited to 4GB");
+		chunk->Resource = GFX::CreateBuffer((uint32_t) chunk->ByteSize, 1, RCF::CPU_Access | RCF::NoSRV);
+		GFX::SetDebugName(chunk->Resource, "StagingPool::Chunk");
+		chunk->GPUAddress = chunk->Resource->GPUAddress;
+
+		// Upload heap memory stays mapped for the lifetime of the chunk, CPU never reads it
+		const D3D12_RANGE readRange{ 0, 0 };
+		API_CALL(chunk->Resource->Handle->Map(0, &readRange, reinterpret_cast<void**>(&chunk->CPUAddress)));
+	}
+
+	return chunk;
+}
+
+void StagingPool::DeleteChunk(Chunk* chunk)
+{
+	if (chunk->Resource)
+	{
+		chunk->Resource->Handle->Unmap(0, nullptr);
+		delete chunk->Resource;
+	}
+	delete chunk;
+}
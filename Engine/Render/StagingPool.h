@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+
+#include "Render/RenderAPI.h"
+#include "Utility/Multithreading.h"
+
+struct Buffer;
+
+// Persistently mapped upload buffers shared by every context, pooled by power of two size classes so uploads don't create a buffer each.
+// The pool doesn't know about fences, users release a chunk only once the GPU is done with it (see UploadAllocator).
+class StagingPool
+{
+public:
+	static constexpr uint64_t MIN_CHUNK_SIZE = 64 * 1024;
+	static constexpr uint32_t NUM_SIZE_CLASSES = 13;		// 64KB to 256MB, bigger chunks are created for one use
+	static constexpr uint64_t DEFAULT_BUDGET = 256 * 1024 * 1024;
+	static constexpr uint64_t CHUNK_ALIGNMENT = D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT;
+
+	struct Chunk
+	{
+		Buffer* Resource = nullptr;		// Null in CPU only pools
+		std::vector<uint8_t> CPUMemory;
+		uint8_t* CPUAddress = nullptr;
+		D3D12_GPU_VIRTUAL_ADDRESS GPUAddress = 0;
+		uint64_t ByteSize = 0;
+		uint32_t SizeClass = 0;
+	};
+
+	struct Stats
+	{
+		uint32_t NumChunks = 0;
+		uint32_t NumFreeChunks = 0;
+		uint64_t ChunkBytes = 0;
+		uint64_t FreeBytes = 0;
+		uint64_t NumAcquires = 0;
+		uint64_t NumReuses = 0;		// Acquires served by a free chunk
+	};
+
+	// CPU only chunks are plain memory with fake GPU addresses, so the accounting can run without a device.
+	// Free chunks over the budget are deleted when they are released.
+	StagingPool(bool cpuOnly = false, uint64_t budget = DEFAULT_BUDGET);
+	~StagingPool();
+
+	StagingPool(const StagingPool&) = delete;
+	StagingPool& operator=(const StagingPool&) = delete;
+
+	// Thread safe, the chunk is at least byteSize big
+	Chunk* Acquire(uint64_t byteSize);
+	void Release(Chunk* chunk);
+
+	Stats GetStats();
+
+	static uint32_t GetSizeClass(uint64_t byteSize);
+	static uint64_t GetClassSize(uint32_t sizeClass) { return MIN_CHUNK_SIZE << sizeClass; }
+
+private:
+	Chunk* CreateChunk(uint64_t byteSize, uint32_t sizeClass);
+	void DeleteChunk(Chunk* chunk);
+
+private:
+	bool m_CPUOnly;
+	uint64_t m_Budget;
+
+	MTR::Mutex m_Mutex;
+	std::vector<Chunk*> m_FreeChunks[NUM_SIZE_CLASSES];
+	Stats m_Stats;
+};
@@ -27,6 +27,38 @@ namespace GFX
 		return 0;
 	}
 
+	static unsigned int ToBlockByteSize(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_BC1_UNORM: return 8;
+		case DXGI_FORMAT_BC1_UNORM_SRGB: return 8;
+		case DXGI_FORMAT_BC4_UNORM: return 8;
+		case DXGI_FORMAT_BC3_UNORM: return 16;
+		case DXGI_FORMAT_BC3_UNORM_SRGB: return 16;
+		case DXGI_FORMAT_BC5_UNORM: return 16;
+		case DXGI_FORMAT_BC6H_UF16: return 16;
+		case DXGI_FORMAT_BC7_UNORM: return 16;
+		case DXGI_FORMAT_BC7_UNORM_SRGB: return 16;
+		default: return 0;
+		}
+	}
+
+	// Pitch of the first mip, block compressed formats are pitched by rows of 4x4 blocks
+	static void SetPitch(Texture* tex, DXGI_FORMAT format)
+	{
+		const unsigned int blockByteSize = ToBlockByteSize(format);
+		if (blockByteSize)
+		{
+			tex->RowPitch = MAX((tex->Width + 3) / 4, 1u) * blockByteSize;
+			tex->SlicePitch = tex->RowPitch * MAX((tex->Height + 3) / 4, 1u);
+			return;
+		}
+
+		tex->RowPitch = tex->Width * ToBPP(format);
+		tex->SlicePitch = tex->RowPitch * tex->Height;
+	}
+
 	// Depth format hack
 	constexpr DXGI_FORMAT DepthFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
 	constexpr DXGI_FORMAT DepthViewFormat = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
@@ -219,8 +251,7 @@ namespace GFX
 		tex->Height = height;
 		tex->NumMips = numMips;
 		tex->DepthOrArraySize = 1;
-		tex->RowPitch = tex->Width * ToBPP(format);
-		tex->SlicePitch = tex->RowPitch * height;
+		SetPitch(tex, format);
 		tex->CurrState = D3D12_RESOURCE_STATE_COMMON;
 		CreateTextureResources(tex, initData);
 		return tex;
@@ -238,8 +269,7 @@ namespace GFX
 		tex->Height = height;
 		tex->NumMips = numMips;
 		tex->DepthOrArraySize = numElements;
-		tex->RowPitch = width * ToBPP(format);
-		tex->SlicePitch = tex->RowPitch * height;
+		SetPitch(tex, format);
 		tex->CurrState = D3D12_RESOURCE_STATE_COMMON;
 		CreateTextureResources(tex, nullptr);
 
@@ -0,0 +1,102 @@
+#include "UploadAllocator.h"
+
+#include "Render/Device.h"
+
+UploadAllocator::UploadAllocator(StagingPool* pool, uint64_t pageSize) :
+	m_Pool(pool),
+	m_PageSize(StagingPool::GetClassSize(StagingPool::GetSizeClass(pageSize)))
+{
+}
+
+UploadAllocator::~UploadAllocator()
+{
+	// Owner waits for the GPU before destroying the allocator
+	for (Page* page : m_UsedPages) GetPool()->Release(page);
+	for (const auto& [fenceValue, page] : m_RetiredPages) GetPool()->Release(page);
+}
+
+UploadAllocation UploadAllocator::Allocate(uint64_t byteSize, uint64_t alignment)
+{
+	ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0, "[UploadAllocator] Alignment must be a power of two");
+	ASSERT(alignment <= MAX_ALIGNMENT, "[UploadAllocator] Pages are only aligned to MAX_ALIGNMENT");
+
+	uint64_t offset = (m_CurrentOffset + alignment - 1) & ~(alignment - 1);
+	Page* page = m_CurrentPage;
+
+	if (byteSize > m_PageSize)
+	{
+		// Dedicated page, the current page keeps being filled by the following allocations
+		page = NextPage(byteSize);
+		offset = 0;
+		m_AllocatedBytes += byteSize;
+	}
+	else
+	{
+		if (!page || offset + byteSize > page->ByteSize)
+		{
+			page = NextPage(byteSize);
+			m_CurrentPage = page;
+			m_CurrentOffset = 0;
+			offset = 0;
+		}
+
+		m_AllocatedBytes += offset + byteSize - m_CurrentOffset;
+		m_CurrentOffset = offset + byteSize;
+	}
+
+	UploadAllocation allocation;
+	allocation.CPUAddress = page->CPUAddress + offset;
+	allocation.GPUAddress = page->GPUAddress + offset;
+	allocation.Resource = page->Resource;
+	allocation.Offset = offset;
+	return allocation;
+}
+
+UploadAllocation UploadAllocator::Upload(const void* data, uint64_t byteSize, uint64_t alignment)
+{
+	const UploadAllocation allocation = Allocate(byteSize, alignment);
+	memcpy(allocation.CPUAddress, data, byteSize);
+	return allocation;
+}
+
+void UploadAllocator::Retire(uint64_t fenceValue)
+{
+	for (Page* page : m_UsedPages) m_RetiredPages.push_back({ fenceValue, page });
+	m_UsedPages.clear();
+
+	m_CurrentPage = nullptr;
+	m_CurrentOffset = 0;
+	m_AllocatedBytes = 0;
+}
+
+void UploadAllocator::Reclaim(uint64_t completedFenceValue)
+{
+	while (!m_RetiredPages.empty() && m_RetiredPages.front().first <= completedFenceValue)
+	{
+		GetPool()->Release(m_RetiredPages.front().second);
+		m_RetiredPages.pop_front();
+	}
+}
+
+UploadAllocator::Stats UploadAllocator::GetStats() const
+{
+	Stats stats;
+	stats.NumPages = (uint32_t) (m_UsedPages.size() + m_RetiredPages.size());
+	stats.NumRetiredPages = (uint32_t) m_RetiredPages.size();
+	stats.AllocatedBytes = m_AllocatedBytes;
+	return stats;
+}
+
+StagingPool* UploadAllocator::GetPool()
+{
+	// Contexts are created before the device memory
+	if (!m_Pool) m_Pool = Device::Get()->GetMemory().StagingMemory.get();
+	return m_Pool;
+}
+
+UploadAllocator::Page* UploadAllocator::NextPage(uint64_t byteSize)
+{
+	Page* page = GetPool()->Acquire(byteSize > m_PageSize ? byteSize : m_PageSize);
+	m_UsedPages.push_back(page);
+	return page;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include "Render/RenderAPI.h"
+#include "Render/StagingPool.h"
+
+struct Buffer;
+
+struct UploadAllocation
+{
+	uint8_t* CPUAddress = nullptr;
+	D3D12_GPU_VIRTUAL_ADDRESS GPUAddress = 0;
+
+	// Source of copies out of the upload memory, null for CPU only pools
+	Buffer* Resource = nullptr;
+	uint64_t Offset = 0;
+};
+
+// Linear allocator of upload memory that lives until the GPU is done with the commands it was recorded for (constants, staging of uploads).
+// Pages are chunks of a StagingPool, an allocation is a pointer bump inside the current page.
+// Pages used between two submits are retired with the fence value of the submit and go back to the pool once the fence reaches it.
+class UploadAllocator
+{
+public:
+	static constexpr uint64_t DEFAULT_PAGE_SIZE = 2 * 1024 * 1024;
+	static constexpr uint64_t CONSTANT_ALIGNMENT = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+	static constexpr uint64_t MAX_ALIGNMENT = StagingPool::CHUNK_ALIGNMENT;
+
+	struct Stats
+	{
+		uint32_t NumPages = 0;			// In use or retired
+		uint32_t NumRetiredPages = 0;	// Waiting for their fence
+		uint64_t AllocatedBytes = 0;	// Since the last Retire, including alignment
+	};
+
+	// Null pool takes pages from the pool of the device
+	UploadAllocator(StagingPool* pool = nullptr, uint64_t pageSize = DEFAULT_PAGE_SIZE);
+	~UploadAllocator();
+
+	UploadAllocator(const UploadAllocator&) = delete;
+	UploadAllocator& operator=(const UploadAllocator&) = delete;
+
+	// Allocations bigger than the page size get a chunk of their own
+	UploadAllocation Allocate(uint64_t byteSize, uint64_t alignment = CONSTANT_ALIGNMENT);
+	UploadAllocation Upload(const void* data, uint64_t byteSize, uint64_t alignment = CONSTANT_ALIGNMENT);
+
+	// Every page used since the last Retire stays untouched until the fence reaches fenceValue
+	void Retire(uint64_t fenceValue);
+
+	// Pages retired with a value up to completedFenceValue go back to the pool
+	void Reclaim(uint64_t completedFenceValue);
+
+	Stats GetStats() const;
+
+private:
+	using Page = StagingPool::Chunk;
+
+	StagingPool* GetPool();
+	Page* NextPage(uint64_t byteSize);
+
+private:
+	StagingPool* m_Pool;
+	uint64_t m_PageSize;
+
+	Page* m_CurrentPage = nullptr;
+	uint64_t m_CurrentOffset = 0;
+
+	std::vector<Page*> m_UsedPages;		// Since the last Retire, including the current page
+	std::deque<std::pair<uint64_t, Page*>> m_RetiredPages;	// Fence value and page, in the order of fence values
+
+	uint64_t m_AllocatedBytes = 0;
+};
@@ -0,0 +1,37 @@
+#include "JobPool.h"
+
+JobPool* JobPool::s_Instance = nullptr;
+
+JobPool::JobPool(uint32_t numThreads)
+{
+	if (numThreads == 0)
+	{
+		const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		numThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	m_Threads.reserve(numThreads);
+	for (uint32_t i = 0; i < numThreads; i++)
+	{
+		m_Threads.emplace_back([this]() { WorkerLoop(); });
+	}
+}
+
+JobPool::~JobPool()
+{
+	// Empty job is a signal for the worker to exit
+	for (size_t i = 0; i < m_Threads.size(); i++) m_Jobs.Push(Job{});
+	for (std::thread& thread : m_Threads) thread.join();
+}
+
+void JobPool::WorkerLoop()
+{
+	OPTICK_THREAD("JobPool Worker");
+
+	while (true)
+	{
+		Job job = m_Jobs.Pop();
+		if (!job) break;
+		job();
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+
+#include "Common.h"
+#include "Utility/Multithreading.h"
+
+// Pool of CPU worker threads for short jobs that don't need a graphics context
+class JobPool
+{
+public:
+	// numThreads = 0 uses one thread less than the number of hardware threads
+	static void Init(uint32_t numThreads = 0) { s_Instance = new JobPool(numThreads); }
+	static JobPool* Get() { return s_Instance; }
+	static void Destroy() { SAFE_DELETE(s_Instance); }
+
+private:
+	static JobPool* s_Instance;
+
+	JobPool(uint32_t numThreads);
+	~JobPool();
+
+public:
+	// Calls func(index) for every index in [0, count) and returns once all of them are done.
+	// Calling thread takes jobs too so it's safe to call from inside of a job.
+	template<typename F>
+	void ParallelFor(uint32_t count, F&& func);
+
+	uint32_t GetThreadCount() const { return (uint32_t) m_Threads.size(); }
+
+private:
+	using Job = std::function<void()>;
+
+	void WorkerLoop();
+
+private:
+	std::vector<std::thread> m_Threads;
+	MTR::BlockingQueue<Job> m_Jobs;
+};
+
+template<typename F>
+void JobPool::ParallelFor(uint32_t count, F&& func)
+{
+	if (count == 0) return;
+
+	// Shared with the helper jobs, helpers that start late won't find any index left and won't touch func
+	struct ParallelForState
+	{
+		uint32_t Count = 0;
+		std::function<void(uint32_t)> Func;
+		std::atomic<uint32_t> NextIndex = 0;
+		std::atomic<uint32_t> DoneCount = 0;
+		std::mutex Mutex;
+		std::condition_variable Finished;
+	};
+
+	const Ref<ParallelForState> state = std::make_shared<ParallelForState>();
+	state->Count = count;
+	state->Func = [&func](uint32_t index) { func(index); };
+
+	const auto runJobs = [](ParallelForState& state)
+	{
+		for (uint32_t index = state.NextIndex++; index < state.Count; index = state.NextIndex++)
+		{
+			state.Func(index);
+			if (++state.DoneCount == state.Count)
+			{
+				std::lock_guard<std::mutex> lock{ state.Mutex };
+				state.Finished.notify_all();
+			}
+		}
+	};
+
+	const uint32_t helperCount = MIN(count - 1, GetThreadCount());
+	for (uint32_t i = 0; i < helperCount; i++)
+	{
+		m_Jobs.Push([state, runJobs]() { runJobs(*state); });
+	}
+
+	runJobs(*state);
+
+	std::unique_lock<std::mutex> lock{ state->Mutex };
+	state->Finished.wait(lock, [&state]() { return state->DoneCount == state->Count; });
+}
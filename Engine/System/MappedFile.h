@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Common.h"
+
+// Read only view of a whole file mapped into the address space
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile() { Close(); }
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::string& path);
+	void Close();
+
+	bool IsOpen() const { return m_Data != nullptr; }
+	const uint8_t* GetData() const { return m_Data; }
+	size_t GetSize() const { return m_Size; }
+
+private:
+	void* m_FileHandle = nullptr;
+	void* m_MappingHandle = nullptr;
+	const uint8_t* m_Data = nullptr;
+	size_t m_Size = 0;
+};
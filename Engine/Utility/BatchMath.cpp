@@ -0,0 +1,535 @@
+#include "BatchMath.h"
+
+#include <atomic>
+#include <cfloat>
+#include <intrin.h>
+#include <immintrin.h>
+
+#include "Common.h"
+
+namespace BatchMath
+{
+	// Each lane type wraps one instruction set so the kernels below are written once.
+	// Kernels process Width elements per call, the remainder always goes through ScalarLanes.
+	struct ScalarLanes
+	{
+		using Vector = float;
+		using Mask = bool;
+		static constexpr uint32_t Width = 1;
+
+		static Vector Load(const float* data) { return *data; }
+		static void Store(float* data, Vector value) { *data = value; }
+		static Vector Set(float value) { return value; }
+
+		static Vector Add(Vector a, Vector b) { return a + b; }
+		static Vector Sub(Vector a, Vector b) { return a - b; }
+		static Vector Mul(Vector a, Vector b) { return a * b; }
+		static Vector Div(Vector a, Vector b) { return a / b; }
+		static Vector MulAdd(Vector a, Vector b, Vector c) { return a * b + c; }
+		static Vector Min(Vector a, Vector b) { return a < b ? a : b; }
+		static Vector Sqrt(Vector a) { return std::sqrt(a); }
+
+		static Mask Less(Vector a, Vector b) { return a < b; }
+		static Mask GreaterEqual(Vector a, Vector b) { return a >= b; }
+		static Vector Select(Mask mask, Vector ifTrue, Vector ifFalse) { return mask ? ifTrue : ifFalse; }
+		static uint32_t MaskBits(Mask mask) { return mask ? 1 : 0; }
+
+		// Components are in row major order
+		static void StoreMatrices(float* matrices, const Vector(&components)[16])
+		{
+			for (uint32_t i = 0; i < 16; i++) matrices[i] = components[i];
+		}
+	};
+
+	struct SSELanes
+	{
+		using Vector = __m128;
+		using Mask = __m128;
+		static constexpr uint32_t Width = 4;
+
+		static Vector Load(const float* data) { return _mm_loadu_ps(data); }
+		static void Store(float* data, Vector value) { _mm_storeu_ps(data, value); }
+		static Vector Set(float value) { return _mm_set1_ps(value); }
+
+		static Vector Add(Vector a, Vector b) { return _mm_add_ps(a, b); }
+		static Vector Sub(Vector a, Vector b) { return _mm_sub_ps(a, b); }
+		static Vector Mul(Vector a, Vector b) { return _mm_mul_ps(a, b); }
+		static Vector Div(Vector a, Vector b) { return _mm_div_ps(a, b); }
+		static Vector MulAdd(Vector a, Vector b, Vector c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+		static Vector Min(Vector a, Vector b) { return _mm_min_ps(a, b); }
+		static Vector Sqrt(Vector a) { return _mm_sqrt_ps(a); }
+
+		static Mask Less(Vector a, Vector b) { return _mm_cmplt_ps(a, b); }
+		static Mask GreaterEqual(Vector a, Vector b) { return _mm_cmpge_ps(a, b); }
+		static Vector Select(Mask mask, Vector ifTrue, Vector ifFalse) { return _mm_or_ps(_mm_and_ps(mask, ifTrue), _mm_andnot_ps(mask, ifFalse)); }
+		static uint32_t MaskBits(Mask mask) { return static_cast<uint32_t>(_mm_movemask_ps(mask)); }
+
+		static void StoreMatrices(float* matrices, const Vector(&components)[16])
+		{
+			for (uint32_t row = 0; row < 4; row++)
+			{
+				Vector c0 = components[row * 4 + 0];
+				Vector c1 = components[row * 4 + 1];
+				Vector c2 = components[row * 4 + 2];
+				Vector c3 = components[row * 4 + 3];
+				_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+				_mm_storeu_ps(matrices + 0 * 16 + row * 4, c0);
+				_mm_storeu_ps(matrices + 1 * 16 + row * 4, c1);
+				_mm_storeu_ps(matrices + 2 * 16 + row * 4, c2);
+				_mm_storeu_ps(matrices + 3 * 16 + row * 4, c3);
+			}
+		}
+	};
+
+	// Uses only 256 bit instructions so there are no transitions between VEX and legacy SSE encoding inside the loops
+	struct AVX2Lanes
+	{
+		using Vector = __m256;
+		using Mask = __m256;
+		static constexpr uint32_t Width = 8;
+
+		static Vector Load(const float* data) { return _mm256_loadu_ps(data); }
+		static void Store(float* data, Vector value) { _mm256_storeu_ps(data, value); }
+		static Vector Set(float value) { return _mm256_set1_ps(value); }
+
+		static Vector Add(Vector a, Vector b) { return _mm256_add_ps(a, b); }
+		static Vector Sub(Vector a, Vector b) { return _mm256_sub_ps(a, b); }
+		static Vector Mul(Vector a, Vector b) { return _mm256_mul_ps(a, b); }
+		static Vector Div(Vector a, Vector b) { return _mm256_div_ps(a, b); }
+		static Vector MulAdd(Vector a, Vector b, Vector c) { return _mm256_fmadd_ps(a, b, c); }
+		static Vector Min(Vector a, Vector b) { return _mm256_min_ps(a, b); }
+		static Vector Sqrt(Vector a) { return _mm256_sqrt_ps(a); }
+
+		static Mask Less(Vector a, Vector b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+		static Mask GreaterEqual(Vector a, Vector b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+		static Vector Select(Mask mask, Vector ifTrue, Vector ifFalse) { return _mm256_blendv_ps(ifFalse, ifTrue, mask); }
+		static uint32_t MaskBits(Mask mask) { return static_cast<uint32_t>(_mm256_movemask_ps(mask)); }
+
+		static void StoreMatrices(float* matrices, const Vector(&components)[16])
+		{
+			// Transposing each row gives rows of matrix i in the low half and of matrix i + 4 in the high half
+			Vector rows[4][4];
+			for (uint32_t row = 0; row < 4; row++)
+			{
+				const Vector t0 = _mm256_unpacklo_ps(components[row * 4 + 0], components[row * 4 + 1]);
+				const Vector t1 = _mm256_unpacklo_ps(components[row * 4 + 2], components[row * 4 + 3]);
+				const Vector t2 = _mm256_unpackhi_ps(components[row * 4 + 0], components[row * 4 + 1]);
+				const Vector t3 = _mm256_unpackhi_ps(components[row * 4 + 2], components[row * 4 + 3]);
+				rows[row][0] = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+				rows[row][1] = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+				rows[row][2] = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+				rows[row][3] = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+			}
+
+			for (uint32_t i = 0; i < 4; i++)
+			{
+				_mm256_storeu_ps(matrices + i * 16 + 0, _mm256_permute2f128_ps(rows[0][i], rows[1][i], 0x20));
+				_mm256_storeu_ps(matrices + i * 16 + 8, _mm256_permute2f128_ps(rows[2][i], rows[3][i], 0x20));
+				_mm256_storeu_ps(matrices + (i + 4) * 16 + 0, _mm256_permute2f128_ps(rows[0][i], rows[1][i], 0x31));
+				_mm256_storeu_ps(matrices + (i + 4) * 16 + 8, _mm256_permute2f128_ps(rows[2][i], rows[3][i], 0x31));
+			}
+		}
+	};
+
+	InstructionSet GetSupportedInstructionSet()
+	{
+		static const InstructionSet supported = []()
+		{
+			int info[4];
+			__cpuid(info, 0);
+			const int maxLeaf = info[0];
+
+			__cpuid(info, 1);
+			const bool hasSSE2 = (info[3] & (1 << 26)) != 0;
+			const bool hasFMA = (info[2] & (1 << 12)) != 0;
+			const bool hasOSXSAVE = (info[2] & (1 << 27)) != 0;
+			const bool hasAVX = (info[2] & (1 << 28)) != 0;
+
+			// OS has to save the ymm registers on context switch
+			const bool osSupportsAVX = hasOSXSAVE && hasAVX && (_xgetbv(0) & 0x6) == 0x6;
+
+			bool hasAVX2 = false;
+			if (maxLeaf >= 7)
+			{
+				__cpuidex(info, 7, 0);
+				hasAVX2 = (info[1] & (1 << 5)) != 0;
+			}
+
+			if (osSupportsAVX && hasAVX2 && hasFMA) return InstructionSet::AVX2;
+			if (hasSSE2) return InstructionSet::SSE;
+			return InstructionSet::Scalar;
+		}();
+		return supported;
+	}
+
+	static std::atomic<InstructionSet> s_InstructionSet = GetSupportedInstructionSet();
+
+	InstructionSet GetInstructionSet()
+	{
+		return s_InstructionSet.load(std::memory_order_relaxed);
+	}
+
+	void SetInstructionSet(InstructionSet instructionSet)
+	{
+		const InstructionSet supported = GetSupportedInstructionSet();
+		s_InstructionSet.store(instructionSet < supported ? instructionSet : supported, std::memory_order_relaxed);
+	}
+
+	const char* ToString(InstructionSet instructionSet)
+	{
+		switch (instructionSet)
+		{
+		case InstructionSet::Scalar: return "Scalar";
+		case InstructionSet::SSE: return "SSE";
+		case InstructionSet::AVX2: return "AVX2";
+		default: NOT_IMPLEMENTED;
+		}
+		return "Unknown";
+	}
+
+	template<typename Kernel, typename... Args>
+	static void Dispatch(uint32_t count, const Args&... args)
+	{
+		uint32_t i = 0;
+		switch (GetInstructionSet())
+		{
+		case InstructionSet::AVX2:
+			for (; i + AVX2Lanes::Width <= count; i += AVX2Lanes::Width) Kernel::template Run<AVX2Lanes>(i, args...);
+			_mm256_zeroupper();
+			break;
+		case InstructionSet::SSE:
+			for (; i + SSELanes::Width <= count; i += SSELanes::Width) Kernel::template Run<SSELanes>(i, args...);
+			break;
+		default:
+			break;
+		}
+
+		for (; i < count; i++) Kernel::template Run<ScalarLanes>(i, args...);
+	}
+
+	template<typename Lanes>
+	struct LoadedQuaternions
+	{
+		typename Lanes::Vector X, Y, Z, W;
+
+		LoadedQuaternions(const QuaternionStreams& streams, uint32_t i) :
+			X(Lanes::Load(streams.X + i)),
+			Y(Lanes::Load(streams.Y + i)),
+			Z(Lanes::Load(streams.Z + i)),
+			W(Lanes::Load(streams.W + i))
+		{}
+
+		typename Lanes::Vector Dot(const LoadedQuaternions& other) const
+		{
+			return Lanes::MulAdd(X, other.X, Lanes::MulAdd(Y, other.Y, Lanes::MulAdd(Z, other.Z, Lanes::Mul(W, other.W))));
+		}
+	};
+
+	// factorA * a + factorB * b
+	template<typename Lanes, typename Vector = typename Lanes::Vector>
+	static void StoreBlend(const LoadedQuaternions<Lanes>& a, const LoadedQuaternions<Lanes>& b, Vector factorA, Vector factorB, bool normalize, const QuaternionStreams& result, uint32_t i)
+	{
+		Vector x = Lanes::MulAdd(factorA, a.X, Lanes::Mul(factorB, b.X));
+		Vector y = Lanes::MulAdd(factorA, a.Y, Lanes::Mul(factorB, b.Y));
+		Vector z = Lanes::MulAdd(factorA, a.Z, Lanes::Mul(factorB, b.Z));
+		Vector w = Lanes::MulAdd(factorA, a.W, Lanes::Mul(factorB, b.W));
+
+		if (normalize)
+		{
+			const Vector lengthSq = Lanes::MulAdd(x, x, Lanes::MulAdd(y, y, Lanes::MulAdd(z, z, Lanes::Mul(w, w))));
+			const Vector invLength = Lanes::Div(Lanes::Set(1.0f), Lanes::Sqrt(lengthSq));
+			x = Lanes::Mul(x, invLength);
+			y = Lanes::Mul(y, invLength);
+			z = Lanes::Mul(z, invLength);
+			w = Lanes::Mul(w, invLength);
+		}
+
+		Lanes::Store(result.X + i, x);
+		Lanes::Store(result.Y + i, y);
+		Lanes::Store(result.Z + i, z);
+		Lanes::Store(result.W + i, w);
+	}
+
+	// Abramowitz and Stegun 4.4.46, valid for [0, 1] with error below 2e-8
+	template<typename Lanes, typename Vector = typename Lanes::Vector>
+	static Vector ACosPositive(Vector x)
+	{
+		Vector poly = Lanes::Set(-0.0012624911f);
+		poly = Lanes::MulAdd(poly, x, Lanes::Set(0.0066700901f));
+		poly = Lanes::MulAdd(poly, x, Lanes::Set(-0.0170881256f));
+		poly = Lanes::MulAdd(poly, x, Lanes::Set(0.0308918810f));
+		poly = Lanes::MulAdd(poly, x, Lanes::Set(-0.0501743046f));
+		poly = Lanes::MulAdd(poly, x, Lanes::Set(0.0889789874f));
+		poly = Lanes::MulAdd(poly, x, Lanes::Set(-0.2145988016f));
+		poly = Lanes::MulAdd(poly, x, Lanes::Set(1.5707963050f));
+		return Lanes::Mul(poly, Lanes::Sqrt(Lanes::Sub(Lanes::Set(1.0f), x)));
+	}
+
+	// Taylor series up to x^11, valid for [0, pi/2] with error below 1e-7
+	template<typename Lanes, typename Vector = typename Lanes::Vector>
+	static Vector SinHalfPi(Vector x)
+	{
+		const Vector x2 = Lanes::Mul(x, x);
+		Vector poly = Lanes::Set(-1.0f / 39916800.0f);
+		poly = Lanes::MulAdd(poly, x2, Lanes::Set(1.0f / 362880.0f));
+		poly = Lanes::MulAdd(poly, x2, Lanes::Set(-1.0f / 5040.0f));
+		poly = Lanes::MulAdd(poly, x2, Lanes::Set(1.0f / 120.0f));
+		poly = Lanes::MulAdd(poly, x2, Lanes::Set(-1.0f / 6.0f));
+		poly = Lanes::MulAdd(poly, x2, Lanes::Set(1.0f));
+		return Lanes::Mul(poly, x);
+	}
+
+	struct NLerpKernel
+	{
+		template<typename Lanes>
+		static void Run(uint32_t i, const QuaternionStreams& a, const QuaternionStreams& b, const float* t, const QuaternionStreams& result)
+		{
+			using Vector = typename Lanes::Vector;
+
+			const LoadedQuaternions<Lanes> qa{ a, i };
+			const LoadedQuaternions<Lanes> qb{ b, i };
+			const Vector factor = Lanes::Load(t + i);
+
+			const Vector sign = Lanes::Select(Lanes::Less(qa.Dot(qb), Lanes::Set(0.0f)), Lanes::Set(-1.0f), Lanes::Set(1.0f));
+			StoreBlend<Lanes>(qa, qb, Lanes::Sub(Lanes::Set(1.0f), factor), Lanes::Mul(factor, sign), true, result, i);
+		}
+	};
+
+	struct SlerpKernel
+	{
+		template<typename Lanes>
+		static void Run(uint32_t i, const QuaternionStreams& a, const QuaternionStreams& b, const float* t, const QuaternionStreams& result)
+		{
+			using Vector = typename Lanes::Vector;
+
+			const LoadedQuaternions<Lanes> qa{ a, i };
+			const LoadedQuaternions<Lanes> qb{ b, i };
+			const Vector factor = Lanes::Load(t + i);
+			const Vector one = Lanes::Set(1.0f);
+
+			Vector cosTheta = qa.Dot(qb);
+			const Vector sign = Lanes::Select(Lanes::Less(cosTheta, Lanes::Set(0.0f)), Lanes::Set(-1.0f), one);
+			cosTheta = Lanes::Min(Lanes::Mul(cosTheta, sign), one);
+
+			const Vector theta = ACosPositive<Lanes>(cosTheta);
+			const Vector sigma = Lanes::Mul(factor, theta);
+			const Vector invSinTheta = Lanes::Div(one, SinHalfPi<Lanes>(theta));
+			const Vector sinSigma = SinHalfPi<Lanes>(sigma);
+			const Vector cosSigma = SinHalfPi<Lanes>(Lanes::Sub(Lanes::Set(DirectX::XM_PIDIV2), sigma));
+
+			Vector factorA = Lanes::Sub(cosSigma, Lanes::Mul(Lanes::Mul(cosTheta, sinSigma), invSinTheta));
+			Vector factorB = Lanes::Mul(sinSigma, invSinTheta);
+
+			// Same epsilon as MathUtility::Lerp<Quaternion>, close rotations fall back to linear interpolation
+			constexpr float Epsilon = 0.0005f;
+			const auto useLinear = Lanes::Less(Lanes::Set(1.0f - Epsilon), cosTheta);
+			factorA = Lanes::Select(useLinear, Lanes::Sub(one, factor), factorA);
+			factorB = Lanes::Select(useLinear, factor, factorB);
+
+			StoreBlend<Lanes>(qa, qb, factorA, Lanes::Mul(factorB, sign), false, result, i);
+		}
+	};
+
+	struct ComposeTransformsKernel
+	{
+		template<typename Lanes>
+		static void Run(uint32_t i, const Float3Streams& translation, const QuaternionStreams& rotation, const Float3Streams& scale, DirectX::XMFLOAT4X4* matrices)
+		{
+			using Vector = typename Lanes::Vector;
+
+			const LoadedQuaternions<Lanes> q{ rotation, i };
+			const Vector sx = Lanes::Load(scale.X + i);
+			const Vector sy = Lanes::Load(scale.Y + i);
+			const Vector sz = Lanes::Load(scale.Z + i);
+
+			const Vector two = Lanes::Set(2.0f);
+			const Vector x2 = Lanes::Mul(q.X, two);
+			const Vector y2 = Lanes::Mul(q.Y, two);
+			const Vector z2 = Lanes::Mul(q.Z, two);
+			const Vector xx = Lanes::Mul(q.X, x2);
+			const Vector yy = Lanes::Mul(q.Y, y2);
+			const Vector zz = Lanes::Mul(q.Z, z2);
+			const Vector xy = Lanes::Mul(q.X, y2);
+			const Vector xz = Lanes::Mul(q.X, z2);
+			const Vector yz = Lanes::Mul(q.Y, z2);
+			const Vector wx = Lanes::Mul(q.W, x2);
+			const Vector wy = Lanes::Mul(q.W, y2);
+			const Vector wz = Lanes::Mul(q.W, z2);
+
+			const Vector one = Lanes::Set(1.0f);
+			const Vector zero = Lanes::Set(0.0f);
+
+			// Rotation rows scaled by the scale of the matching axis, translation in the last row
+			const Vector components[16] = {
+				Lanes::Mul(sx, Lanes::Sub(one, Lanes::Add(yy, zz))), Lanes::Mul(sx, Lanes::Add(xy, wz)), Lanes::Mul(sx, Lanes::Sub(xz, wy)), zero,
+				Lanes::Mul(sy, Lanes::Sub(xy, wz)), Lanes::Mul(sy, Lanes::Sub(one, Lanes::Add(xx, zz))), Lanes::Mul(sy, Lanes::Add(yz, wx)), zero,
+				Lanes::Mul(sz, Lanes::Add(xz, wy)), Lanes::Mul(sz, Lanes::Sub(yz, wx)), Lanes::Mul(sz, Lanes::Sub(one, Lanes::Add(xx, yy))), zero,
+				Lanes::Load(translation.X + i), Lanes::Load(translation.Y + i), Lanes::Load(translation.Z + i), one,
+			};
+
+			Lanes::StoreMatrices(&matrices[i].m[0][0], components);
+		}
+	};
+
+	struct SpheresInFrustumKernel
+	{
+		template<typename Lanes>
+		static void Run(uint32_t i, const SphereStreams& spheres, const Float4* planes, uint32_t numPlanes, uint8_t* visible)
+		{
+			using Vector = typename Lanes::Vector;
+
+			const Vector x = Lanes::Load(spheres.X + i);
+			const Vector y = Lanes::Load(spheres.Y + i);
+			const Vector z = Lanes::Load(spheres.Z + i);
+			const Vector radius = Lanes::Load(spheres.Radius + i);
+
+			// Sphere is outside if it is completely behind any of the planes
+			Vector minDistance = Lanes::Set(FLT_MAX);
+			for (uint32_t p = 0; p < numPlanes; p++)
+			{
+				const Float4& plane = planes[p];
+				const Vector distance = Lanes::MulAdd(x, Lanes::Set(plane.x), Lanes::MulAdd(y, Lanes::Set(plane.y), Lanes::MulAdd(z, Lanes::Set(plane.z), Lanes::Set(plane.w))));
+				minDistance = Lanes::Min(minDistance, Lanes::Add(distance, radius));
+			}
+
+			const uint32_t bits = Lanes::MaskBits(Lanes::GreaterEqual(minDistance, Lanes::Set(0.0f)));
+			for (uint32_t j = 0; j < Lanes::Width; j++) visible[i + j] = (bits >> j) & 1;
+		}
+	};
+
+	void NLerp(const QuaternionStreams& a, const QuaternionStreams& b, const float* t, const QuaternionStreams& result, uint32_t count)
+	{
+		Dispatch<NLerpKernel>(count, a, b, t, result);
+	}
+
+	void Slerp(const QuaternionStreams& a, const QuaternionStreams& b, const float* t, const QuaternionStreams& result, uint32_t count)
+	{
+		Dispatch<SlerpKernel>(count, a, b, t, result);
+	}
+
+	void ComposeTransforms(const Float3Streams& translation, const QuaternionStreams& rotation, const Float3Streams& scale, DirectX::XMFLOAT4X4* matrices, uint32_t count)
+	{
+		Dispatch<ComposeTransformsKernel>(count, translation, rotation, scale, matrices);
+	}
+
+	void TestSpheresInFrustum(const SphereStreams& spheres, const Float4* planes, uint32_t numPlanes, uint8_t* visible, uint32_t count)
+	{
+		Dispatch<SpheresInFrustumKernel>(count, spheres, planes, numPlanes, visible);
+	}
+
+	// Matrices are stored as arrays of structures, so the matrix kernels vectorize over the rows instead of over the elements
+
+	static void MultiplyMatrixScalar(const DirectX::XMFLOAT4X4& a, const DirectX::XMFLOAT4X4& b, DirectX::XMFLOAT4X4& result)
+	{
+		DirectX::XMFLOAT4X4 product;
+		for (uint32_t row = 0; row < 4; row++)
+		{
+			for (uint32_t column = 0; column < 4; column++)
+			{
+				product.m[row][column] = a.m[row][0] * b.m[0][column] + a.m[row][1] * b.m[1][column] + a.m[row][2] * b.m[2][column] + a.m[row][3] * b.m[3][column];
+			}
+		}
+		result = product;
+	}
+
+	static void MultiplyMatrixSSE(const DirectX::XMFLOAT4X4& a, const DirectX::XMFLOAT4X4& b, DirectX::XMFLOAT4X4& result)
+	{
+		const __m128 b0 = _mm_loadu_ps(b.m[0]);
+		const __m128 b1 = _mm_loadu_ps(b.m[1]);
+		const __m128 b2 = _mm_loadu_ps(b.m[2]);
+		const __m128 b3 = _mm_loadu_ps(b.m[3]);
+
+		__m128 rows[4];
+		for (uint32_t row = 0; row < 4; row++)
+		{
+			const __m128 ar = _mm_loadu_ps(a.m[row]);
+			__m128 product = _mm_mul_ps(_mm_shuffle_ps(ar, ar, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+			product = _mm_add_ps(product, _mm_mul_ps(_mm_shuffle_ps(ar, ar, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+			product = _mm_add_ps(product, _mm_mul_ps(_mm_shuffle_ps(ar, ar, _MM_SHUFFLE(2, 2, 2, 2)), b2));
+			product = _mm_add_ps(product, _mm_mul_ps(_mm_shuffle_ps(ar, ar, _MM_SHUFFLE(3, 3, 3, 3)), b3));
+			rows[row] = product;
+		}
+
+		for (uint32_t row = 0; row < 4; row++) _mm_storeu_ps(result.m[row], rows[row]);
+	}
+
+	// Two rows of a per register, rows of b are repeated in both halves
+	static void MultiplyMatrixAVX2(const DirectX::XMFLOAT4X4& a, const DirectX::XMFLOAT4X4& b, DirectX::XMFLOAT4X4& result)
+	{
+		const __m256 b0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b.m[0]));
+		const __m256 b1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b.m[1]));
+		const __m256 b2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b.m[2]));
+		const __m256 b3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b.m[3]));
+
+		__m256 rows[2];
+		for (uint32_t pair = 0; pair < 2; pair++)
+		{
+			const __m256 ar = _mm256_loadu_ps(a.m[pair * 2]);
+			__m256 product = _mm256_mul_ps(_mm256_shuffle_ps(ar, ar, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+			product = _mm256_fmadd_ps(_mm256_shuffle_ps(ar, ar, _MM_SHUFFLE(1, 1, 1, 1)), b1, product);
+			product = _mm256_fmadd_ps(_mm256_shuffle_ps(ar, ar, _MM_SHUFFLE(2, 2, 2, 2)), b2, product);
+			product = _mm256_fmadd_ps(_mm256_shuffle_ps(ar, ar, _MM_SHUFFLE(3, 3, 3, 3)), b3, product);
+			rows[pair] = product;
+		}
+
+		_mm256_storeu_ps(result.m[0], rows[0]);
+		_mm256_storeu_ps(result.m[2], rows[1]);
+	}
+
+	template<void(*Multiply)(const DirectX::XMFLOAT4X4&, const DirectX::XMFLOAT4X4&, DirectX::XMFLOAT4X4&)>
+	static void MultiplyEach(const DirectX::XMFLOAT4X4* a, const DirectX::XMFLOAT4X4* b, DirectX::XMFLOAT4X4* result, uint32_t count)
+	{
+		for (uint32_t i = 0; i < count; i++) Multiply(a[i], b[i], result[i]);
+	}
+
+	template<void(*Multiply)(const DirectX::XMFLOAT4X4&, const DirectX::XMFLOAT4X4&, DirectX::XMFLOAT4X4&)>
+	static void MultiplyChains(const DirectX::XMFLOAT4X4* local, const uint32_t* parents, DirectX::XMFLOAT4X4* result, uint32_t count)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const uint32_t parent = parents[i];
+			if (parent == INVALID_PARENT)
+			{
+				result[i] = local[i];
+				continue;
+			}
+
+			ASSERT(parent < i, "[BatchMath] Parent has to come before its children");
+			Multiply(local[i], result[parent], result[i]);
+		}
+	}
+
+	void MultiplyMatrices(const DirectX::XMFLOAT4X4* a, const DirectX::XMFLOAT4X4* b, DirectX::XMFLOAT4X4* result, uint32_t count)
+	{
+		switch (GetInstructionSet())
+		{
+		case InstructionSet::AVX2:
+			MultiplyEach<MultiplyMatrixAVX2>(a, b, result, count);
+			_mm256_zeroupper();
+			break;
+		case InstructionSet::SSE:
+			MultiplyEach<MultiplyMatrixSSE>(a, b, result, count);
+			break;
+		default:
+			MultiplyEach<MultiplyMatrixScalar>(a, b, result, count);
+			break;
+		}
+	}
+
+	void MultiplyMatrixChains(const DirectX::XMFLOAT4X4* local, const uint32_t* parents, DirectX::XMFLOAT4X4* result, uint32_t count)
+	{
+		switch (GetInstructionSet())
+		{
+		case InstructionSet::AVX2:
+			MultiplyChains<MultiplyMatrixAVX2>(local, parents, result, count);
+			_mm256_zeroupper();
+			break;
+		case InstructionSet::SSE:
+			MultiplyChains<MultiplyMatrixSSE>(local, parents, result, count);
+			break;
+		default:
+			MultiplyChains<MultiplyMatrixScalar>(local, parents, result, count);
+			break;
+		}
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Utility/DataTypes.h"
+
+// Math kernels that process many elements per call on SoA arrays.
+// Every kernel has SSE and AVX2 paths picked at runtime and a scalar fallback, all paths give the same results up to float rounding.
+namespace BatchMath
+{
+	enum class InstructionSet : uint8_t
+	{
+		Scalar,
+		SSE,
+		AVX2,
+	};
+
+	InstructionSet GetSupportedInstructionSet();
+
+	// Instruction set used by the kernels, can be lowered to compare the paths. It is clamped to the supported one.
+	InstructionSet GetInstructionSet();
+	void SetInstructionSet(InstructionSet instructionSet);
+
+	const char* ToString(InstructionSet instructionSet);
+
+	// Output streams can alias the input streams
+	struct Float3Streams
+	{
+		float* X = nullptr;
+		float* Y = nullptr;
+		float* Z = nullptr;
+	};
+
+	struct QuaternionStreams
+	{
+		float* X = nullptr;
+		float* Y = nullptr;
+		float* Z = nullptr;
+		float* W = nullptr;
+	};
+
+	struct SphereStreams
+	{
+		const float* X = nullptr;
+		const float* Y = nullptr;
+		const float* Z = nullptr;
+		const float* Radius = nullptr;
+	};
+
+	// Shortest path normalized lerp
+	void NLerp(const QuaternionStreams& a, const QuaternionStreams& b, const float* t, const QuaternionStreams& result, uint32_t count);
+
+	// Same as MathUtility::Lerp<Quaternion> with acos and sin replaced by polynomials, max angle error is around 1e-6 radians
+	void Slerp(const QuaternionStreams& a, const QuaternionStreams& b, const float* t, const QuaternionStreams& result, uint32_t count);
+
+	// Scale * Rotation * Translation in row vector convention, the same as AnimationOperations::GetPoseTransformation
+	void ComposeTransforms(const Float3Streams& translation, const QuaternionStreams& rotation, const Float3Streams& scale, DirectX::XMFLOAT4X4* matrices, uint32_t count);
+
+	// result[i] = a[i] * b[i], result can alias a or b
+	void MultiplyMatrices(const DirectX::XMFLOAT4X4* a, const DirectX::XMFLOAT4X4* b, DirectX::XMFLOAT4X4* result, uint32_t count);
+
+	// result[i] = local[i] * result[parents[i]] walking down the hierarchy, parents must come before their children.
+	// Elements with INVALID_PARENT take the local matrix as it is.
+	static constexpr uint32_t INVALID_PARENT = static_cast<uint32_t>(-1);
+	void MultiplyMatrixChains(const DirectX::XMFLOAT4X4* local, const uint32_t* parents, DirectX::XMFLOAT4X4* result, uint32_t count);
+
+	// Planes point inside the frustum like ViewFrustum::Planes, visible[i] is 1 if the sphere touches the frustum and 0 otherwise
+	void TestSpheresInFrustum(const SphereStreams& spheres, const Float4* planes, uint32_t numPlanes, uint8_t* visible, uint32_t count);
+}
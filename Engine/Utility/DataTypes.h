@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <stdint.h>
+#include <cmath>
 #include <DirectXMath.h>
 
 struct Float2
@@ -48,10 +49,10 @@ struct Float2
 	DirectX::XMFLOAT2 ToXMF() const { return DirectX::XMFLOAT2{ x,y }; }
 	DirectX::XMFLOAT2A ToXMFA() const { return DirectX::XMFLOAT2A{ x,y }; }
 
-	float Length() const { return Float2(DirectX::XMVector2Length(ToXM())).x; }
+	float Length() const { return std::sqrt(LengthSq()); }
 	float LengthFast() const { return Float2(DirectX::XMVector2LengthEst(ToXM())).x; }
-	float LengthSq() const { return Float2(DirectX::XMVector2LengthSq(ToXM())).x; }
-	float Dot(const Float2& other) const { return Float2(DirectX::XMVector2Dot(ToXM(), other.ToXM())).x; }
+	float LengthSq() const { return Dot(*this); }
+	float Dot(const Float2& other) const { return x * other.x + y * other.y; }
 	Float2 Normalize() const { return Float2(DirectX::XMVector2Normalize(ToXM())); }
 	Float2 NormalizeFast() const { return Float2(DirectX::XMVector2NormalizeEst(ToXM())); }
 	Float2 Abs() const { return Float2{ std::abs(x), std::abs(y) }; }
@@ -108,13 +109,13 @@ struct Float3
 	DirectX::XMFLOAT3 ToXMF() const { return DirectX::XMFLOAT3{ x,y,z }; }
 	DirectX::XMFLOAT3A ToXMFA() const { return DirectX::XMFLOAT3A{ x,y,z }; }
 
-	float Length() const { return Float3(DirectX::XMVector3Length(ToXM())).x; }
+	float Length() const { return std::sqrt(LengthSq()); }
 	float LengthFast() const { return Float3(DirectX::XMVector3LengthEst(ToXM())).x; }
-	float LengthSq() const { return Float3(DirectX::XMVector3LengthSq(ToXM())).x; }
-	float Dot(const Float3& other) const { return Float3(DirectX::XMVector3Dot(ToXM(), other.ToXM())).x; }
+	float LengthSq() const { return Dot(*this); }
+	float Dot(const Float3& other) const { return x * other.x + y * other.y + z * other.z; }
 	Float3 Normalize() const { return Float3(DirectX::XMVector3Normalize(ToXM())); }
 	Float3 NormalizeFast() const { return Float3(DirectX::XMVector3NormalizeEst(ToXM())); }
-	Float3 Cross(const Float3& other) const { return Float3(DirectX::XMVector3Cross(ToXM(), other.ToXM())); }
+	Float3 Cross(const Float3& other) const { return Float3{ y * other.z - z * other.y, z * other.x - x * other.z, x * other.y - y * other.x }; }
 	Float3 Abs() const { return Float3{ std::abs(x), std::abs(y), std::abs(z) }; }
 
 	float SumElements() const { return x + y + z; }
@@ -173,10 +174,10 @@ struct Float4
 	DirectX::XMFLOAT4 ToXMF() const { return DirectX::XMFLOAT4{ x,y,z,w }; }
 	DirectX::XMFLOAT4A ToXMFA() const { return DirectX::XMFLOAT4A{ x,y,z,w }; }
 
-	float Length() const { return Float4(DirectX::XMVector4Length(ToXM())).x; }
+	float Length() const { return std::sqrt(LengthSq()); }
 	float LengthFast() const { return Float4(DirectX::XMVector4LengthEst(ToXM())).x; }
-	float LengthSq() const { return Float4(DirectX::XMVector4LengthSq(ToXM())).x; }
-	float Dot(const Float4& other) const { return Float4(DirectX::XMVector4Dot(ToXM(), other.ToXM())).x; }
+	float LengthSq() const { return Dot(*this); }
+	float Dot(const Float4& other) const { return x * other.x + y * other.y + z * other.z + w * other.w; }
 	Float4 Normalize() const { return Float4(DirectX::XMVector4Normalize(ToXM())); }
 	Float4 NormalizeFast() const { return Float4(DirectX::XMVector4NormalizeEst(ToXM())); }
 	Float4 Abs() const { return Float4{ std::abs(x), std::abs(y), std::abs(z), std::abs(w) }; }
@@ -256,11 +257,14 @@ struct Quaternion
 		return *this;
 	}
 
+	// (r.xyz * l.w + l.xyz * r.w + cross(l.xyz, r.xyz), l.w * r.w - dot(l.xyz, r.xyz)) written out without temporaries
 	friend Quaternion operator*(const Quaternion& l, const Quaternion& r)
 	{
-		const Float3 l3{ l.x, l.y, l.z };
-		const Float3 r3{ r.x, r.y, r.z };
-		return Quaternion{ r3 * l.w + l3 * r.w + l3.Cross(r3), l.w * r.w - l3.Dot(r3) };
+		return Quaternion{
+			r.x * l.w + l.x * r.w + l.y * r.z - l.z * r.y,
+			r.y * l.w + l.y * r.w + l.z * r.x - l.x * r.z,
+			r.z * l.w + l.z * r.w + l.x * r.y - l.y * r.x,
+			l.w * r.w - l.x * r.x - l.y * r.y - l.z * r.z };
 	}
 };
 
@@ -0,0 +1,69 @@
+#include "Hash.h"
+
+#include <intrin.h>
+#include <nmmintrin.h>
+
+namespace Hash
+{
+	namespace
+	{
+		struct Crc32CTable
+		{
+			uint32_t Values[256];
+
+			constexpr Crc32CTable() : Values()
+			{
+				for (uint32_t i = 0; i < 256; i++)
+				{
+					uint32_t crc = i;
+					for (uint32_t bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ ((crc & 1) ? 0x82F63B78 : 0);
+					Values[i] = crc;
+				}
+			}
+		};
+
+		static constexpr Crc32CTable CRC32C_TABLE;
+
+		uint32_t Crc32CSoftware(uint32_t crc, const uint8_t* bytes, size_t byteSize)
+		{
+			for (size_t i = 0; i < byteSize; i++)
+			{
+				crc = (crc >> 8) ^ CRC32C_TABLE.Values[(crc & 0xff) ^ bytes[i]];
+			}
+			return crc;
+		}
+
+		uint32_t Crc32CHardware(uint32_t crc, const uint8_t* bytes, size_t byteSize)
+		{
+			uint64_t crc64 = crc;
+			for (; byteSize >= 8; byteSize -= 8, bytes += 8) crc64 = _mm_crc32_u64(crc64, Private::Read8(bytes));
+
+			crc = static_cast<uint32_t>(crc64);
+			for (; byteSize > 0; byteSize--, bytes++) crc = _mm_crc32_u8(crc, *bytes);
+			return crc;
+		}
+	}
+
+	bool HasHardwareCrc32C()
+	{
+		static const bool hasSSE42 = []()
+		{
+			int info[4];
+			__cpuid(info, 1);
+			return (info[2] & (1 << 20)) != 0;
+		}();
+		return hasSSE42;
+	}
+
+	uint32_t Crc32C(uint32_t crc32c, const void* data, size_t byteSize)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		const uint32_t crc = ~crc32c;
+		return ~(HasHardwareCrc32C() ? Crc32CHardware(crc, bytes, byteSize) : Crc32CSoftware(crc, bytes, byteSize));
+	}
+
+	uint32_t Crc32C(const void* data, size_t byteSize)
+	{
+		return Crc32C(0, data, byteSize);
+	}
+}
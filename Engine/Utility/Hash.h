@@ -1,6 +1,13 @@
 #pragma once
 
 #include <inttypes.h>
+#include <string.h>
+#include <string>
+#include <type_traits>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 namespace Hash
 {
@@ -82,16 +89,165 @@ namespace Hash
 	}
 
 	template<>
-	uint32_t Crc32<std::string>(const std::string& data)
+	inline uint32_t Crc32<std::string>(const std::string& data)
 	{
 		static_assert(sizeof(uint8_t) == sizeof(char));
 		return Crc32(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
 	}
 
 	template<>
-	uint32_t Crc32<std::string>(uint32_t crc32, const std::string& data)
+	inline uint32_t Crc32<std::string>(uint32_t crc32, const std::string& data)
 	{
 		static_assert(sizeof(uint8_t) == sizeof(char));
 		return Crc32(crc32, reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
 	}
+
+	// CRC32C (Castagnoli), uses the SSE 4.2 crc32 instruction when the CPU has it.
+	// Not the same values as Crc32, use it for checksums of data, Hash64 is faster for cache keys.
+	uint32_t Crc32C(uint32_t crc32c, const void* data, size_t byteSize);
+	uint32_t Crc32C(const void* data, size_t byteSize);
+	bool HasHardwareCrc32C();
+
+	namespace Private
+	{
+		static constexpr uint64_t WY_SECRET[4] = { 0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull };
+
+		// 64x64 -> 128 bit multiply, low half goes to a and high half to b
+		inline void Multiply(uint64_t& a, uint64_t& b)
+		{
+#if defined(_MSC_VER) && defined(_M_X64)
+			a = _umul128(a, b, &b);
+#else
+			const unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+			a = static_cast<uint64_t>(product);
+			b = static_cast<uint64_t>(product >> 64);
+#endif
+		}
+
+		inline uint64_t Mix(uint64_t a, uint64_t b)
+		{
+			Multiply(a, b);
+			return a ^ b;
+		}
+
+		inline uint64_t Read8(const uint8_t* bytes) { uint64_t value; memcpy(&value, bytes, sizeof(value)); return value; }
+		inline uint64_t Read4(const uint8_t* bytes) { uint32_t value; memcpy(&value, bytes, sizeof(value)); return value; }
+		inline uint64_t Read3(const uint8_t* bytes, size_t byteSize) { return (static_cast<uint64_t>(bytes[0]) << 16) | (static_cast<uint64_t>(bytes[byteSize >> 1]) << 8) | bytes[byteSize - 1]; }
+	}
+
+	// 64 bit hash for in memory and on disk cache keys (wyhash v4), same result on every run and machine.
+	// Works on 16 bytes per step, a pipeline desc takes a few nanoseconds instead of a table lookup per byte with Crc32.
+	inline uint64_t Hash64(const void* data, size_t byteSize, uint64_t seed = 0)
+	{
+		using namespace Private;
+
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		seed ^= Mix(seed ^ WY_SECRET[0], WY_SECRET[1]);
+
+		uint64_t a, b;
+		if (byteSize <= 16)
+		{
+			if (byteSize >= 4)
+			{
+				const size_t offset = (byteSize >> 3) << 2;
+				a = (Read4(bytes) << 32) | Read4(bytes + offset);
+				b = (Read4(bytes + byteSize - 4) << 32) | Read4(bytes + byteSize - 4 - offset);
+			}
+			else if (byteSize > 0)
+			{
+				a = Read3(bytes, byteSize);
+				b = 0;
+			}
+			else
+			{
+				a = b = 0;
+			}
+		}
+		else
+		{
+			size_t remaining = byteSize;
+			if (remaining >= 48)
+			{
+				uint64_t seed1 = seed;
+				uint64_t seed2 = seed;
+				do
+				{
+					seed = Mix(Read8(bytes) ^ WY_SECRET[1], Read8(bytes + 8) ^ seed);
+					seed1 = Mix(Read8(bytes + 16) ^ WY_SECRET[2], Read8(bytes + 24) ^ seed1);
+					seed2 = Mix(Read8(bytes + 32) ^ WY_SECRET[3], Read8(bytes + 40) ^ seed2);
+					bytes += 48;
+					remaining -= 48;
+				} while (remaining >= 48);
+				seed ^= seed1 ^ seed2;
+			}
+			while (remaining > 16)
+			{
+				seed = Mix(Read8(bytes) ^ WY_SECRET[1], Read8(bytes + 8) ^ seed);
+				bytes += 16;
+				remaining -= 16;
+			}
+			a = Read8(bytes + remaining - 16);
+			b = Read8(bytes + remaining - 8);
+		}
+
+		a ^= WY_SECRET[1];
+		b ^= seed;
+		Multiply(a, b);
+		return Mix(a ^ WY_SECRET[0] ^ byteSize, b ^ WY_SECRET[1]);
+	}
+
+	// Pointers go to the overload above, hashing their value by accident would only show up as cache misses
+	template<typename T> requires (!std::is_pointer_v<T>)
+	uint64_t Hash64(const T& data, uint64_t seed = 0)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Hash64 reads the bytes of the object, hash the fields of types that own memory");
+		return Hash64(&data, sizeof(T), seed);
+	}
+
+	inline uint64_t Hash64(const std::string& data, uint64_t seed = 0)
+	{
+		return Hash64(data.data(), data.size(), seed);
+	}
+
+	// Incremental Hash64 for keys built from many small fields, values up to 8 bytes are mixed in without going through the byte loop.
+	// Hash depends on the order of Add calls, it isn't the same as Hash64 of the fields laid out in memory.
+	class Hasher
+	{
+	public:
+		explicit Hasher(uint64_t seed = 0) : m_State(seed ^ Private::WY_SECRET[0]) {}
+
+		void Add(const void* data, size_t byteSize)
+		{
+			m_State = Hash64(data, byteSize, m_State);
+		}
+
+		template<typename T>
+		void Add(const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "Hasher reads the bytes of the value, add the fields of types that own memory");
+			if constexpr (sizeof(T) <= sizeof(uint64_t))
+			{
+				uint64_t bits = 0;
+				memcpy(&bits, &value, sizeof(T));
+				m_State = Private::Mix(bits ^ Private::WY_SECRET[1], m_State ^ Private::WY_SECRET[2] ^ sizeof(T));
+			}
+			else
+			{
+				Add(&value, sizeof(T));
+			}
+		}
+
+		void Add(const std::string& value)
+		{
+			Add(value.data(), value.size());
+		}
+
+		uint64_t Get() const
+		{
+			return Private::Mix(m_State ^ Private::WY_SECRET[3], Private::WY_SECRET[0]);
+		}
+
+	private:
+		uint64_t m_State;
+	};
 }
\ No newline at end of file
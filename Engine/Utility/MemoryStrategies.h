@@ -1,8 +1,10 @@
 #pragma once
 
-#include <stack>
-#include <list>
-#include <mutex>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <vector>
 
 static constexpr size_t INVALID_ALLOCATION = static_cast<size_t>(-1);
 
@@ -18,51 +20,82 @@ struct RangeAllocation
 	size_t NumElements = INVALID_ALLOCATION;
 };
 
+// Lock free allocator of single elements, new elements are bumped atomically and released ones go on a stack linked through m_NextFree.
+// The head of the stack is tagged with a counter so a pop can't succeed on a head that was popped and pushed back in the meantime (ABA).
 class ElementStrategy
 {
 public:
 	ElementStrategy(size_t numElements) :
-		m_NumElements(numElements) {}
+		m_NumElements(numElements),
+		m_NextFree(numElements)
+	{
+		ASSERT(numElements < INVALID_INDEX, "[ElementStrategy] Elements are limited to 32 bit indices");
+	}
 
 	size_t Allocate()
 	{
-		size_t allocationIndex = INVALID_ALLOCATION;
-
-		if (!m_FreeAllocations.empty())
+		uint64_t head = m_FreeHead.load(std::memory_order_acquire);
+		while (GetIndex(head) != INVALID_INDEX)
 		{
-			allocationIndex = m_FreeAllocations.top();
-			m_FreeAllocations.pop();
+			const uint32_t index = GetIndex(head);
+			const uint64_t next = MakeHead(m_NextFree[index].load(std::memory_order_relaxed), GetTag(head) + 1);
+			if (m_FreeHead.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire))
+			{
+				m_NumFree.fetch_sub(1, std::memory_order_relaxed);
+				return index;
+			}
 		}
-		else if (m_NextAllocation < m_NumElements)
+
+		size_t nextAllocation = m_NextAllocation.load(std::memory_order_relaxed);
+		while (nextAllocation < m_NumElements)
 		{
-			allocationIndex = m_NextAllocation;
-			m_NextAllocation++;
+			if (m_NextAllocation.compare_exchange_weak(nextAllocation, nextAllocation + 1, std::memory_order_relaxed)) return nextAllocation;
 		}
-		return allocationIndex;
+		return INVALID_ALLOCATION;
 	}
 
+	// Approximate while other threads allocate or release, released elements are counted before they can be popped
 	bool CanAllocate(size_t numElements)
 	{
-		bool canAlloocate = m_FreeAllocations.size() + (m_NumElements - m_NextAllocation) > numElements;
-		return canAlloocate;
+		return m_NumFree.load(std::memory_order_relaxed) + (m_NumElements - m_NextAllocation.load(std::memory_order_relaxed)) >= numElements;
 	}
 
 	void Release(size_t alloc)
 	{
-		m_FreeAllocations.push(alloc);
+		ASSERT(alloc < m_NextAllocation.load(std::memory_order_relaxed), "[ElementStrategy] Released element was not allocated");
+
+		// Counted before the element is published, a pop of it can't decrement the counter below zero
+		m_NumFree.fetch_add(1, std::memory_order_relaxed);
+
+		uint64_t head = m_FreeHead.load(std::memory_order_relaxed);
+		do
+		{
+			m_NextFree[alloc].store(GetIndex(head), std::memory_order_relaxed);
+		} while (!m_FreeHead.compare_exchange_weak(head, MakeHead((uint32_t) alloc, GetTag(head) + 1), std::memory_order_release, std::memory_order_relaxed));
 	}
 
+	// Not thread safe
 	void Clear()
 	{
-		while (!m_FreeAllocations.empty()) m_FreeAllocations.pop();
-		m_NextAllocation = 0;
+		m_FreeHead.store(MakeHead(INVALID_INDEX, 0));
+		m_NumFree.store(0);
+		m_NextAllocation.store(0);
 	}
 
+private:
+	static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+	static uint64_t MakeHead(uint32_t index, uint32_t tag) { return ((uint64_t) tag << 32) | index; }
+	static uint32_t GetIndex(uint64_t head) { return (uint32_t) head; }
+	static uint32_t GetTag(uint64_t head) { return (uint32_t) (head >> 32); }
+
 private:
 	size_t m_NumElements = 0;
 
-	size_t m_NextAllocation = 0;
-	std::stack<size_t> m_FreeAllocations;
+	std::atomic<size_t> m_NextAllocation = 0;
+	std::atomic<uint64_t> m_FreeHead = MakeHead(INVALID_INDEX, 0);
+	std::atomic<size_t> m_NumFree = 0;
+	std::vector<std::atomic<uint32_t>> m_NextFree;
 };
 
 class PageStrategy
@@ -111,97 +144,219 @@ private:
 	size_t m_NumElementsPerPage = 0;
 };
 
+// Two level segregated fit allocator of element ranges (TLSF), Allocate and Release are O(1).
+// Free ranges are listed by size class: the first level is the power of two of the size, the second one splits it in SL_COUNT linear steps.
+// Released ranges are merged with their free neighbours right away, so the free elements stay in as few ranges as possible.
 class RangeStrategy
 {
 public:
-	RangeStrategy(size_t numElements):
-		m_NumElements(numElements) {}
+	RangeStrategy(size_t numElements) :
+		m_NumElements(numElements)
+	{
+		ASSERT(numElements < INVALID_BLOCK, "[RangeStrategy] Ranges are limited to 32 bit indices");
+		m_Blocks.resize(numElements);
+		Clear();
+	}
 
 	RangeAllocation Allocate(size_t numElements)
 	{
 		if (numElements == 0) return { 0,0 };
-		
-		RangeAllocation alloc{};
-		for (auto it = m_FreeRanges.begin(); it != m_FreeRanges.end(); it++)
-		{
-			RangeAllocation& candidate = *it;
-			if (candidate.NumElements == numElements)
-			{
-				alloc = candidate;
-				m_FreeRanges.erase(it);
-				break;
-			}
-			else if (candidate.NumElements > numElements)
-			{
-				alloc.Start = candidate.Start;
-				alloc.NumElements = numElements;
+		if (numElements > m_FreeElements) return {};
 
-				candidate.Start += numElements;
-				candidate.NumElements -= numElements;
-				break;
-			}
+		const uint32_t size = (uint32_t) numElements;
+
+		// Searching from the next class up makes any range found big enough
+		uint32_t block = INVALID_BLOCK;
+		const uint64_t searchSize = size < SL_COUNT ? size : (uint64_t) size + (1ull << (std::bit_width(size) - 1 - SL_LOG2)) - 1;
+		if (searchSize < INVALID_BLOCK) block = FindFreeBlock((uint32_t) searchSize);
+
+		// Ranges in the class of the request can still fit it, only an almost full heap gets here
+		if (block == INVALID_BLOCK)
+		{
+			uint32_t fl, sl;
+			GetListIndices(size, fl, sl);
+			for (block = m_FreeLists[fl][sl]; block != INVALID_BLOCK && m_Blocks[block].Size < size; block = m_Blocks[block].NextFree);
+			if (block == INVALID_BLOCK) return {};
 		}
 
-		if (alloc.NumElements == INVALID_ALLOCATION && m_NextAllocation + numElements < m_NumElements)
+		RemoveFree(block);
+
+		Block& allocated = m_Blocks[block];
+		if (allocated.Size > size)
 		{
-			alloc.Start = m_NextAllocation;
-			alloc.NumElements = numElements;
-			m_NextAllocation += numElements;
+			const uint32_t remainder = block + size;
+			m_Blocks[remainder].Size = allocated.Size - size;
+			m_Blocks[remainder].PrevPhysical = block;
+			allocated.Size = size;
+
+			const uint32_t next = remainder + m_Blocks[remainder].Size;
+			if (next < m_NumElements) m_Blocks[next].PrevPhysical = remainder;
+			InsertFree(remainder);
 		}
 
-		return alloc;
+		m_FreeElements -= size;
+		return { block, numElements };
 	}
 
 	void Release(RangeAllocation& alloc)
 	{
 		if (alloc.NumElements != 0 && alloc.NumElements != INVALID_ALLOCATION)
-			m_FreeRanges.push_back(alloc);
-		
+		{
+			uint32_t block = (uint32_t) alloc.Start;
+			ASSERT(!m_Blocks[block].Free && m_Blocks[block].Size == alloc.NumElements, "[RangeStrategy] Released range was not allocated");
+			m_FreeElements += alloc.NumElements;
+
+			const uint32_t next = block + m_Blocks[block].Size;
+			if (next < m_NumElements && m_Blocks[next].Free)
+			{
+				RemoveFree(next);
+				m_Blocks[block].Size += m_Blocks[next].Size;
+			}
+
+			const uint32_t prev = m_Blocks[block].PrevPhysical;
+			if (prev != INVALID_BLOCK && m_Blocks[prev].Free)
+			{
+				RemoveFree(prev);
+				m_Blocks[prev].Size += m_Blocks[block].Size;
+				block = prev;
+			}
+
+			const uint32_t merged = block + m_Blocks[block].Size;
+			if (merged < m_NumElements) m_Blocks[merged].PrevPhysical = block;
+			InsertFree(block);
+		}
+
 		alloc.Start = INVALID_ALLOCATION;
 		alloc.NumElements = INVALID_ALLOCATION;
 	}
 
 	void Clear()
 	{
-		m_FreeRanges.clear();
-		m_NextAllocation = 0;
+		m_FirstLevelMap = 0;
+		for (uint32_t fl = 0; fl < FL_COUNT; fl++)
+		{
+			m_SecondLevelMap[fl] = 0;
+			for (uint32_t sl = 0; sl < SL_COUNT; sl++) m_FreeLists[fl][sl] = INVALID_BLOCK;
+		}
+
+		m_FreeElements = m_NumElements;
+		if (m_NumElements == 0) return;
+
+		m_Blocks[0] = Block{};
+		m_Blocks[0].Size = (uint32_t) m_NumElements;
+		InsertFree(0);
+	}
+
+	size_t GetFreeElements() const { return m_FreeElements; }
+
+	size_t GetLargestFreeRange() const
+	{
+		if (m_FirstLevelMap == 0) return 0;
+
+		const uint32_t fl = std::bit_width(m_FirstLevelMap) - 1;
+		const uint32_t sl = std::bit_width(m_SecondLevelMap[fl]) - 1;
+		uint32_t largest = 0;
+		for (uint32_t block = m_FreeLists[fl][sl]; block != INVALID_BLOCK; block = m_Blocks[block].NextFree) largest = std::max(largest, m_Blocks[block].Size);
+		return largest;
 	}
-private:
-	size_t m_NumElements = 0;
-	size_t m_NextAllocation = 0;
-	std::list<RangeAllocation> m_FreeRanges = {};
-};
 
-class RingRangeStrategy
-{
-public:
-	RingRangeStrategy(size_t numElements) :
-		m_NumElements(numElements) {}
+	// 0 when the free elements are one range, goes to 1 as they are scattered in small ranges
+	float GetFragmentation() const
+	{
+		return m_FreeElements ? 1.0f - (float) GetLargestFreeRange() / m_FreeElements : 0.0f;
+	}
 
-	RangeAllocation Allocate(size_t numElements)
+private:
+	static constexpr uint32_t SL_LOG2 = 4;
+	static constexpr uint32_t SL_COUNT = 1 << SL_LOG2;
+	static constexpr uint32_t FL_COUNT = 32 - SL_LOG2 + 1;
+	static constexpr uint32_t INVALID_BLOCK = UINT32_MAX;
+
+	// Indexed by the first element of a range, entries inside of ranges are stale
+	struct Block
+	{
+		uint32_t Size = 0;
+		uint32_t PrevPhysical = INVALID_BLOCK;
+		uint32_t PrevFree = INVALID_BLOCK;
+		uint32_t NextFree = INVALID_BLOCK;
+		bool Free = false;
+	};
+
+	// Sizes below SL_COUNT are all in the first level, one per class
+	static void GetListIndices(uint32_t size, uint32_t& fl, uint32_t& sl)
 	{
-		if (m_NextAllocation + numElements > m_NumElements)
-			m_NextAllocation = 0;
+		if (size < SL_COUNT)
+		{
+			fl = 0;
+			sl = size;
+			return;
+		}
 
-		RangeAllocation alloc{};
-		alloc.Start = m_NextAllocation;
-		alloc.NumElements = numElements;
+		const uint32_t msb = std::bit_width(size) - 1;
+		fl = msb - SL_LOG2 + 1;
+		sl = (size >> (msb - SL_LOG2)) - SL_COUNT;
+	}
 
-		m_NextAllocation += numElements;
+	uint32_t FindFreeBlock(uint32_t size) const
+	{
+		uint32_t fl, sl;
+		GetListIndices(size, fl, sl);
 
-		return alloc;
+		uint32_t slMap = m_SecondLevelMap[fl] & (~0u << sl);
+		if (slMap == 0)
+		{
+			const uint32_t flMap = m_FirstLevelMap & (~0u << (fl + 1));
+			if (flMap == 0) return INVALID_BLOCK;
+
+			fl = std::countr_zero(flMap);
+			slMap = m_SecondLevelMap[fl];
+		}
+		return m_FreeLists[fl][std::countr_zero(slMap)];
 	}
 
-	void Release(RangeAllocation& alloc)
+	void InsertFree(uint32_t block)
 	{
-		ASSERT(0, "Do not use Release on transient descriptors!");
+		uint32_t fl, sl;
+		GetListIndices(m_Blocks[block].Size, fl, sl);
+
+		const uint32_t head = m_FreeLists[fl][sl];
+		m_Blocks[block].Free = true;
+		m_Blocks[block].PrevFree = INVALID_BLOCK;
+		m_Blocks[block].NextFree = head;
+		if (head != INVALID_BLOCK) m_Blocks[head].PrevFree = block;
+
+		m_FreeLists[fl][sl] = block;
+		m_FirstLevelMap |= 1u << fl;
+		m_SecondLevelMap[fl] |= 1u << sl;
 	}
 
-	void Clear()
+	void RemoveFree(uint32_t block)
 	{
-		m_NextAllocation = 0;
+		uint32_t fl, sl;
+		GetListIndices(m_Blocks[block].Size, fl, sl);
+
+		Block& removed = m_Blocks[block];
+		if (removed.PrevFree != INVALID_BLOCK) m_Blocks[removed.PrevFree].NextFree = removed.NextFree;
+		if (removed.NextFree != INVALID_BLOCK) m_Blocks[removed.NextFree].PrevFree = removed.PrevFree;
+		removed.Free = false;
+
+		if (m_FreeLists[fl][sl] == block)
+		{
+			m_FreeLists[fl][sl] = removed.NextFree;
+			if (removed.NextFree == INVALID_BLOCK)
+			{
+				m_SecondLevelMap[fl] &= ~(1u << sl);
+				if (m_SecondLevelMap[fl] == 0) m_FirstLevelMap &= ~(1u << fl);
+			}
+		}
 	}
+
 private:
 	size_t m_NumElements = 0;
-	size_t m_NextAllocation = 0;
+	size_t m_FreeElements = 0;
+
+	std::vector<Block> m_Blocks;
+	uint32_t m_FirstLevelMap = 0;
+	uint32_t m_SecondLevelMap[FL_COUNT] = {};
+	uint32_t m_FreeLists[FL_COUNT][SL_COUNT];
 };
\ No newline at end of file
@@ -0,0 +1,532 @@
+#include <cfloat>
+
+#include <Engine/Loading/AnimationOperations.h>
+#include <Engine/Loading/AnimationCompression.h>
+#include <Engine/Loading/AnimationSystem.h>
+#include <Engine/System/JobPool.h>
+#include <Engine/Utility/Random.h>
+#include <Engine/Utility/Timer.h>
+
+#include "Test.h"
+
+namespace
+{
+	// Keyframes are on multiples of 1/8 s and sample times are never closer than 2 ms to them,
+	// so the entry search and the cursor search can't pick different sides of a keyframe
+	constexpr float UniformTimes[] = { 0.0f, 0.125f, 0.25f, 0.375f, 0.5f, 0.625f, 0.75f, 0.875f, 1.0f };
+	constexpr float UnevenTimes[] = { 0.0f, 0.125f, 0.5f, 0.625f, 0.875f, 1.25f };
+	constexpr uint32_t NumSampleTimes = 300;
+
+	float GetSampleTime(uint32_t index) { return index * 0.01f + 0.003f; }
+
+	ModelLoading::AnimationEntry MakeEntry(ModelLoading::AnimTarget target, ModelLoading::AnimInterpolation interpolation, bool uniform)
+	{
+		const float* times = uniform ? UniformTimes : UnevenTimes;
+		const uint32_t numKeyFrames = uniform ? STATIC_ARRAY_SIZE(UniformTimes) : STATIC_ARRAY_SIZE(UnevenTimes);
+
+		ModelLoading::AnimationEntry entry{};
+		entry.Target = target;
+		entry.Interpolation = interpolation;
+		entry.Duration = times[numKeyFrames - 1];
+		entry.KeyFrames.resize(numKeyFrames);
+		for (uint32_t i = 0; i < numKeyFrames; i++)
+		{
+			ModelLoading::AnimKeyFrame& keyFrame = entry.KeyFrames[i];
+			keyFrame.Time = times[i];
+			switch (target)
+			{
+			case ModelLoading::AnimTarget::Translation: keyFrame.Translation = Random::F3(-2.0f, 2.0f); break;
+			case ModelLoading::AnimTarget::Rotation: keyFrame.Rotation = Quaternion{ Float4{ Random::SNorm(), Random::SNorm(), Random::SNorm(), Random::SNorm() + 2.0f }.Normalize() }; break;
+			case ModelLoading::AnimTarget::Scale: keyFrame.Scale = Random::F3(0.5f, 1.5f); break;
+			default: NOT_IMPLEMENTED;
+			}
+		}
+		return entry;
+	}
+
+	// Binary tree of joints, every joint animates all channels with a mix of step and linear entries on even and uneven keyframes.
+	// Entries are in scale, rotation, translation order so their product is the pose transformation.
+	std::vector<ModelLoading::SkeletonJoint> MakeSkeleton(uint32_t numJoints)
+	{
+		using namespace DirectX;
+
+		std::vector<ModelLoading::SkeletonJoint> skeleton(numJoints);
+		for (uint32_t i = 0; i < numJoints; i++)
+		{
+			ModelLoading::SkeletonJoint& joint = skeleton[i];
+			joint.ParentIndex = i == 0 ? ModelLoading::SkeletonJoint::INVALID_PARENT : (i - 1) / 2;
+			XMStoreFloat4x4(&joint.ParentTransform, XMMatrixIdentity());
+			XMStoreFloat4x4(&joint.ModelToJoint, XMMatrixTranslation(0.0f, -0.1f * i, 0.0f));
+
+			const ModelLoading::AnimInterpolation interpolation = i % 3 == 0 ? ModelLoading::AnimInterpolation::Step : ModelLoading::AnimInterpolation::Lerp;
+			joint.Animations.push_back(MakeEntry(ModelLoading::AnimTarget::Scale, interpolation, i % 2 == 0));
+			joint.Animations.push_back(MakeEntry(ModelLoading::AnimTarget::Rotation, ModelLoading::AnimInterpolation::Lerp, i % 2 == 1));
+			joint.Animations.push_back(MakeEntry(ModelLoading::AnimTarget::Translation, interpolation, i % 4 < 2));
+		}
+		return skeleton;
+	}
+
+	// Cubic entry of a sine wave with its exact derivatives as tangents
+	ModelLoading::AnimationEntry MakeCubicEntry(ModelLoading::AnimTarget target)
+	{
+		constexpr float TwoPi = 2.0f * DirectX::XM_PI;
+
+		ModelLoading::AnimationEntry entry{};
+		entry.Target = target;
+		entry.Interpolation = ModelLoading::AnimInterpolation::Cubic;
+		entry.Duration = UnevenTimes[STATIC_ARRAY_SIZE(UnevenTimes) - 1];
+		entry.KeyFrames.resize(STATIC_ARRAY_SIZE(UnevenTimes));
+		entry.InTangents.resize(entry.KeyFrames.size());
+		entry.OutTangents.resize(entry.KeyFrames.size());
+		for (uint32_t i = 0; i < entry.KeyFrames.size(); i++)
+		{
+			const float t = UnevenTimes[i];
+			entry.KeyFrames[i].Time = t;
+			entry.InTangents[i].Time = t;
+			entry.OutTangents[i].Time = t;
+			if (target == ModelLoading::AnimTarget::Translation)
+			{
+				entry.KeyFrames[i].Translation = Float3{ std::sin(TwoPi * t), std::cos(TwoPi * t), 0.5f * std::sin(2.0f * TwoPi * t) };
+				entry.InTangents[i].Translation = Float3{ TwoPi * std::cos(TwoPi * t), -TwoPi * std::sin(TwoPi * t), TwoPi * std::cos(2.0f * TwoPi * t) };
+				entry.OutTangents[i].Translation = entry.InTangents[i].Translation;
+			}
+			else
+			{
+				// Swinging around a fixed axis by sin(2 pi t) radians
+				const Float3 axis = Float3{ 1.0f, 2.0f, 2.0f } / 3.0f;
+				const float halfAngle = 0.5f * std::sin(TwoPi * t);
+				const float halfAngleSpeed = 0.5f * TwoPi * std::cos(TwoPi * t);
+				entry.KeyFrames[i].Rotation = Quaternion{ std::sin(halfAngle) * axis, std::cos(halfAngle) };
+				entry.InTangents[i].Rotation = Quaternion{ (halfAngleSpeed * std::cos(halfAngle)) * axis, -halfAngleSpeed * std::sin(halfAngle) };
+				entry.OutTangents[i].Rotation = entry.InTangents[i].Rotation;
+			}
+		}
+		return entry;
+	}
+
+	// glTF cubic spline written out, tangents are per second
+	Float4 EvaluateHermite(const Float4& valueA, const Float4& outTangentA, const Float4& inTangentB, const Float4& valueB, float s, float interval)
+	{
+		const float s2 = s * s;
+		const float s3 = s2 * s;
+		return (2.0f * s3 - 3.0f * s2 + 1.0f) * valueA + ((s3 - 2.0f * s2 + s) * interval) * outTangentA + (-2.0f * s3 + 3.0f * s2) * valueB + ((s3 - s2) * interval) * inTangentB;
+	}
+
+	Float4 ToFloat4(const ModelLoading::AnimKeyFrame& keyFrame, ModelLoading::AnimTarget target)
+	{
+		if (target == ModelLoading::AnimTarget::Translation) return Float4{ keyFrame.Translation.x, keyFrame.Translation.y, keyFrame.Translation.z, 0.0f };
+		return Float4{ keyFrame.Rotation.x, keyFrame.Rotation.y, keyFrame.Rotation.z, keyFrame.Rotation.w };
+	}
+
+	float GetMaxDifference(const Float4& a, const float* b, uint32_t valueSize)
+	{
+		const float values[] = { a.x, a.y, a.z, a.w };
+		float maxDifference = 0.0f;
+		for (uint32_t c = 0; c < valueSize; c++) maxDifference = MAX(maxDifference, std::abs(values[c] - b[c]));
+		return maxDifference;
+	}
+
+	float GetMaxDifference(const DirectX::XMFLOAT4X4& a, const DirectX::XMFLOAT4X4& b)
+	{
+		float maxDifference = 0.0f;
+		for (uint32_t row = 0; row < 4; row++)
+		{
+			for (uint32_t column = 0; column < 4; column++) maxDifference = MAX(maxDifference, std::abs(a.m[row][column] - b.m[row][column]));
+		}
+		return maxDifference;
+	}
+
+	// Angle between the rotations, q and -q are the same rotation.
+	// Doubles and explicit lengths since float quaternions are only unit to about 1e-7, which alone shows up as hundredths of a degree.
+	float GetRotationErrorDegrees(const Quaternion& a, const Quaternion& b)
+	{
+		const double dot = (double) a.x * b.x + (double) a.y * b.y + (double) a.z * b.z + (double) a.w * b.w;
+		const double lengthSqA = (double) a.x * a.x + (double) a.y * a.y + (double) a.z * a.z + (double) a.w * a.w;
+		const double lengthSqB = (double) b.x * b.x + (double) b.y * b.y + (double) b.z * b.z + (double) b.w * b.w;
+		const double cosHalfAngle = std::abs(dot) / MAX(std::sqrt(lengthSqA * lengthSqB), (double) FLT_MIN);
+		return (float) (2.0 * std::acos(MIN(cosHalfAngle, 1.0)) * 180.0 / DirectX::XM_PI);
+	}
+}
+
+// Compiled clip gives the transformations of the animation entries when playing forward, jumping back and from a new cursor, for every play type
+TEST(AnimationClipSampling)
+{
+	using namespace AnimationOperations;
+
+	constexpr uint32_t NumJoints = 24;
+	constexpr float Tolerance = 1e-4f;
+
+	const std::vector<ModelLoading::SkeletonJoint> skeleton = MakeSkeleton(NumJoints);
+	const AnimationClip clip = CompileClip(skeleton);
+	TEST_CHECK(clip.NumNodes == NumJoints && clip.Tracks.size() == NumJoints * 3, clip.Tracks.size() << " tracks compiled for " << NumJoints << " joints");
+
+	// Playing forward through a few loops, then random times that move the cursor back
+	std::vector<float> times;
+	for (uint32_t i = 0; i < NumSampleTimes; i++) times.push_back(GetSampleTime(i));
+	for (uint32_t i = 0; i < NumSampleTimes; i++) times.push_back(GetSampleTime(Random::UInt(0, NumSampleTimes - 1)));
+
+	for (const AnimationType animationType : { AnimationType::Once, AnimationType::Repeat, AnimationType::PingPong })
+	{
+		AnimationCursor cursor{};
+		std::vector<NodePose> poses(NumJoints);
+		std::vector<NodePose> freshPoses(NumJoints);
+
+		float maxDifference = 0.0f;
+		float maxFreshDifference = 0.0f;
+		for (const float t : times)
+		{
+			SampleClip(clip, t, animationType, cursor, poses.data());
+
+			AnimationCursor freshCursor{};
+			SampleClip(clip, t, animationType, freshCursor, freshPoses.data());
+
+			for (uint32_t i = 0; i < NumJoints; i++)
+			{
+				const DirectX::XMFLOAT4X4 expected = GetAnimationTransformation(skeleton[i].Animations, t, animationType);
+				maxDifference = MAX(maxDifference, GetMaxDifference(XMUtility::ToXMFloat4x4(GetPoseTransformation(poses[i])), expected));
+				maxFreshDifference = MAX(maxFreshDifference, GetMaxDifference(XMUtility::ToXMFloat4x4(GetPoseTransformation(freshPoses[i])), expected));
+			}
+		}
+
+		TEST_CHECK(maxDifference < Tolerance, "play type " << (uint32_t) animationType << ": clip differs from the animation entries by " << maxDifference);
+		TEST_CHECK(maxFreshDifference < Tolerance, "play type " << (uint32_t) animationType << ": clip with a new cursor differs from the animation entries by " << maxFreshDifference);
+	}
+}
+
+// Cubic tracks pass through their keyframes, follow the glTF spline between them and agree with cubic animation entries.
+// Linear tracks resampled from them get closer with every higher frame rate and also get bigger.
+TEST(AnimationCubicSpline)
+{
+	using namespace AnimationOperations;
+
+	constexpr float Tolerance = 1e-5f;
+	constexpr float FrameRates[] = { 15.0f, 30.0f, 60.0f, 120.0f };
+	constexpr float MaxErrorAt120Hz = 1e-3f;
+
+	for (const ModelLoading::AnimTarget target : { ModelLoading::AnimTarget::Translation, ModelLoading::AnimTarget::Rotation })
+	{
+		const char* targetName = target == ModelLoading::AnimTarget::Translation ? "translation" : "rotation";
+		const ModelLoading::AnimationEntry entry = MakeCubicEntry(target);
+		const AnimationClip clip = CompileClip(std::vector<ModelLoading::AnimationEntry>{ entry });
+		const AnimationTrack& track = clip.Tracks[0];
+		const uint32_t valueSize = GetTrackValueSize(target);
+		TEST_CHECK(track.Interpolation == ModelLoading::AnimInterpolation::Cubic && track.Tangents.size() == entry.KeyFrames.size() * valueSize * 2, targetName << ": tangents weren't compiled");
+
+		float keyFrameDifference = 0.0f;
+		float midpointDifference = 0.0f;
+		float entryDifference = 0.0f;
+		uint32_t cursor = 0;
+		float value[4];
+		for (uint32_t i = 0; i < entry.KeyFrames.size(); i++)
+		{
+			SampleTrack(track, entry.KeyFrames[i].Time, AnimationType::Once, cursor, value);
+			keyFrameDifference = MAX(keyFrameDifference, GetMaxDifference(ToFloat4(entry.KeyFrames[i], target), value, valueSize));
+
+			if (i + 1 == entry.KeyFrames.size()) continue;
+
+			// Quarter points weigh the two tangents differently, a swapped or unscaled tangent shows up there
+			for (const float s : { 0.25f, 0.5f, 0.75f })
+			{
+				const float interval = entry.KeyFrames[i + 1].Time - entry.KeyFrames[i].Time;
+				const float t = entry.KeyFrames[i].Time + s * interval;
+				Float4 expected = EvaluateHermite(ToFloat4(entry.KeyFrames[i], target), ToFloat4(entry.OutTangents[i], target), ToFloat4(entry.InTangents[i + 1], target), ToFloat4(entry.KeyFrames[i + 1], target), s, interval);
+				if (target == ModelLoading::AnimTarget::Rotation) expected = expected.Normalize();
+
+				SampleTrack(track, t, AnimationType::Once, cursor, value);
+				midpointDifference = MAX(midpointDifference, GetMaxDifference(expected, value, valueSize));
+
+				NodePose pose{};
+				AnimationCursor clipCursor{};
+				SampleClip(clip, t, AnimationType::Once, clipCursor, &pose);
+				entryDifference = MAX(entryDifference, GetMaxDifference(XMUtility::ToXMFloat4x4(GetPoseTransformation(pose)), GetAnimationTransformation({ entry }, t, AnimationType::Once)));
+			}
+		}
+		TEST_CHECK(keyFrameDifference < Tolerance, targetName << ": cubic track misses its keyframes by " << keyFrameDifference);
+		TEST_CHECK(midpointDifference < Tolerance, targetName << ": cubic track differs from the spline by " << midpointDifference);
+		TEST_CHECK(entryDifference < Tolerance, targetName << ": cubic track differs from the cubic animation entry by " << entryDifference);
+
+		// Dense linear tracks against the cubic one, sampled every millisecond
+		float previousError = FLT_MAX;
+		size_t previousByteSize = GetTrackByteSize(track);
+		for (const float frameRate : FrameRates)
+		{
+			const AnimationTrack denseTrack = ResampleTrack(track, frameRate);
+			const size_t byteSize = GetTrackByteSize(denseTrack);
+
+			float maxError = 0.0f;
+			uint32_t referenceCursor = 0;
+			uint32_t denseCursor = 0;
+			float reference[4];
+			for (float t = 0.0f; t <= entry.Duration; t += 0.001f)
+			{
+				SampleTrack(track, t, AnimationType::Once, referenceCursor, reference);
+				SampleTrack(denseTrack, t, AnimationType::Once, denseCursor, value);
+				for (uint32_t c = 0; c < valueSize; c++) maxError = MAX(maxError, std::abs(reference[c] - value[c]));
+			}
+
+			TEST_CHECK(maxError < previousError, targetName << " at " << frameRate << " Hz: error of " << maxError << " isn't below " << previousError << " of the lower frame rate");
+			TEST_CHECK(byteSize > previousByteSize, targetName << " at " << frameRate << " Hz: " << byteSize << " bytes, no more than " << previousByteSize << " of the lower frame rate or the cubic track");
+			if (frameRate == FrameRates[STATIC_ARRAY_SIZE(FrameRates) - 1])
+				TEST_CHECK(maxError < MaxErrorAt120Hz, targetName << " at " << frameRate << " Hz: error of " << maxError);
+
+			previousError = maxError;
+			previousByteSize = byteSize;
+		}
+	}
+}
+
+// Smallest three rotations stay within the 15 bit bound for q, -q and a negative largest component.
+// Constant tracks keep only their first and last keys and a compressed clip samples within the tolerances of the uncompressed one.
+TEST(AnimationCompression)
+{
+	using namespace AnimationOperations;
+
+	// Stored components are off by at most half a 15 bit step and the rebuilt largest one by at most three half steps, which bounds the angle by 2 * sqrt(12) half steps
+	constexpr float HalfStep = 0.70710678f / ((1 << 15) - 1);
+	const float maxRotationErrorDegrees = 2.0f * std::sqrt(12.0f) * HalfStep * 180.0f / DirectX::XM_PI;
+	constexpr uint32_t NumRotations = 10000;
+
+	float maxRotationError = 0.0f;
+	uint32_t numSignMismatches = 0;
+	for (uint32_t i = 0; i < NumRotations; i++)
+	{
+		const Quaternion rotation{ Float4{ Random::SNorm(), Random::SNorm(), Random::SNorm(), Random::SNorm() }.Normalize() };
+		const Quaternion negated{ -rotation.x, -rotation.y, -rotation.z, -rotation.w };
+
+		uint16_t packed[3];
+		uint16_t packedNegated[3];
+		AnimationCompression::PackRotation(rotation, packed);
+		AnimationCompression::PackRotation(negated, packedNegated);
+		numSignMismatches += memcmp(packed, packedNegated, sizeof(packed)) != 0;
+
+		maxRotationError = MAX(maxRotationError, GetRotationErrorDegrees(rotation, AnimationCompression::UnpackRotation(packed)));
+	}
+	TEST_CHECK(maxRotationError <= maxRotationErrorDegrees, "rotation round trip is off by " << maxRotationError << " degrees, bound is " << maxRotationErrorDegrees);
+	TEST_CHECK(numSignMismatches == 0, numSignMismatches << " of " << NumRotations << " rotations pack differently from their negation");
+
+	// Largest component negative, unpacking gives the negated quaternion
+	{
+		const Quaternion rotation{ Float4{ 0.1f, -0.2f, 0.3f, -0.9f }.Normalize() };
+		uint16_t packed[3];
+		AnimationCompression::PackRotation(rotation, packed);
+		const Quaternion unpacked = AnimationCompression::UnpackRotation(packed);
+		const float error = GetRotationErrorDegrees(rotation, unpacked);
+		TEST_CHECK(error <= maxRotationErrorDegrees && unpacked.w > 0.0f, "negative largest component unpacked to " << unpacked.x << " " << unpacked.y << " " << unpacked.z << " " << unpacked.w << ", off by " << error << " degrees");
+	}
+
+	const AnimationCompression::Settings settings{};
+
+	// Constant tracks collapse to their first and last keys
+	for (const ModelLoading::AnimTarget target : { ModelLoading::AnimTarget::Translation, ModelLoading::AnimTarget::Rotation, ModelLoading::AnimTarget::Scale })
+	{
+		ModelLoading::AnimationEntry entry = MakeEntry(target, ModelLoading::AnimInterpolation::Lerp, true);
+		for (ModelLoading::AnimKeyFrame& keyFrame : entry.KeyFrames) keyFrame.Rotation = entry.KeyFrames[0].Rotation;
+
+		AnimationClip clip = CompileClip(std::vector<ModelLoading::AnimationEntry>{ entry });
+		AnimationCompression::CompressClip(clip, settings);
+
+		const AnimationTrack& track = clip.Tracks[0];
+		TEST_CHECK(track.Compressed && track.Times.size() == 2 && track.Times.front() == UniformTimes[0] && track.Times.back() == entry.Duration,
+			"constant track of target " << (uint32_t) target << " kept " << track.Times.size() << " keys");
+	}
+
+	// Skeleton clip against its uncompressed copy
+	constexpr uint32_t NumJoints = 24;
+	constexpr float PoseTolerance = 1e-3f;
+
+	const std::vector<ModelLoading::SkeletonJoint> skeleton = MakeSkeleton(NumJoints);
+	const AnimationClip clip = CompileClip(skeleton);
+	AnimationClip compressedClip = clip;
+	const AnimationCompression::Report report = AnimationCompression::CompressClip(compressedClip, settings);
+
+	TEST_CHECK(report.NumCompressedTracks == report.NumTracks && report.NumTracks == clip.Tracks.size(), report.NumCompressedTracks << " of " << report.NumTracks << " tracks compressed");
+	TEST_CHECK(report.CompressedBytes < report.SourceBytes, report.CompressedBytes << " compressed bytes, " << report.SourceBytes << " before");
+	TEST_CHECK(report.MaxTranslationError <= settings.TranslationTolerance, "translation error " << report.MaxTranslationError);
+	TEST_CHECK(report.MaxRotationErrorDegrees <= settings.RotationToleranceDegrees, "rotation error " << report.MaxRotationErrorDegrees << " degrees");
+	TEST_CHECK(report.MaxScaleError <= settings.ScaleTolerance, "scale error " << report.MaxScaleError);
+
+	AnimationCursor cursor{};
+	AnimationCursor compressedCursor{};
+	std::vector<NodePose> poses(NumJoints);
+	std::vector<NodePose> compressedPoses(NumJoints);
+	float maxDifference = 0.0f;
+	for (uint32_t i = 0; i < NumSampleTimes; i++)
+	{
+		SampleClip(clip, GetSampleTime(i), AnimationType::Repeat, cursor, poses.data());
+		SampleClip(compressedClip, GetSampleTime(i), AnimationType::Repeat, compressedCursor, compressedPoses.data());
+		for (uint32_t joint = 0; joint < NumJoints; joint++)
+		{
+			maxDifference = MAX(maxDifference, GetMaxDifference(XMUtility::ToXMFloat4x4(GetPoseTransformation(poses[joint])), XMUtility::ToXMFloat4x4(GetPoseTransformation(compressedPoses[joint]))));
+		}
+	}
+	TEST_CHECK(maxDifference < PoseTolerance, "compressed clip differs from the uncompressed one by " << maxDifference);
+}
+
+// Palette doesn't depend on how the instances are split between jobs
+TEST(AnimationUpdateJobs)
+{
+	constexpr uint32_t NumInstances = 301;
+	constexpr uint32_t NumFrames = 30;
+	constexpr float FrameTime = 1.0f / 60.0f;
+	constexpr uint32_t JobCounts[] = { 2, 3, 8, 0 };
+
+	const std::vector<ModelLoading::SkeletonJoint> skeleton = MakeSkeleton(16);
+
+	// Same instances in every system, a system updated with a single job is the reference
+	const auto addInstances = [&skeleton](AnimationSystem& animationSystem)
+	{
+		const AnimationSystem::SkeletonHandle skeletonHandle = animationSystem.AddSkeleton(skeleton);
+		for (uint32_t i = 0; i < NumInstances; i++)
+		{
+			const AnimationSystem::InstanceHandle instance = animationSystem.AddInstance(skeletonHandle, i * 0.137f, 0.5f + (i % 5) * 0.25f, i % 7 == 0 ? 0.5f : 1.0f);
+			animationSystem.GetInstance(instance).PlayType = (AnimationOperations::AnimationType) (i % 3);
+		}
+	};
+
+	for (const uint32_t numJobs : JobCounts)
+	{
+		AnimationSystem animationSystem;
+		addInstances(animationSystem);
+
+		AnimationSystem serial;
+		addInstances(serial);
+		TEST_CHECK(serial.GetPalette().size() == NumInstances * skeleton.size(), serial.GetPalette().size() << " skin matrices for " << NumInstances << " instances");
+
+		uint32_t numDifferentFrames = 0;
+		for (uint32_t frame = 0; frame < NumFrames; frame++)
+		{
+			serial.Update(FrameTime, 1);
+			animationSystem.Update(FrameTime, numJobs);
+
+			const std::vector<AnimationOperations::SkinMatrix>& expected = serial.GetPalette();
+			const std::vector<AnimationOperations::SkinMatrix>& palette = animationSystem.GetPalette();
+			numDifferentFrames += memcmp(expected.data(), palette.data(), expected.size() * sizeof(AnimationOperations::SkinMatrix)) != 0;
+		}
+		TEST_CHECK(numDifferentFrames == 0, numJobs << " jobs: palette differs from a single job in " << numDifferentFrames << " of " << NumFrames << " frames");
+
+		const float expectedPlayhead = serial.GetInstance(NumInstances - 1).Playhead;
+		TEST_CHECK(animationSystem.GetInstance(NumInstances - 1).Playhead == expectedPlayhead, numJobs << " jobs: last instance wasn't updated");
+	}
+}
+
+// Per frame cost of sampling a 128 joint skeleton through the animation entries and through the compiled clip
+BENCHMARK(AnimationSampling)
+{
+	using namespace AnimationOperations;
+
+	constexpr uint32_t NumJoints = 128;
+	constexpr uint32_t NumFrames = 1000;
+	constexpr float FrameTime = 1.0f / 60.0f;
+
+	const std::vector<ModelLoading::SkeletonJoint> skeleton = MakeSkeleton(NumJoints);
+	std::vector<DirectX::XMFLOAT4X4> transformations(NumJoints);
+
+	Timer entriesTimer;
+	entriesTimer.Start();
+	for (uint32_t frame = 0; frame < NumFrames; frame++)
+	{
+		for (uint32_t i = 0; i < NumJoints; i++) transformations[i] = GetAnimationTransformation(skeleton[i].Animations, frame * FrameTime, AnimationType::Repeat);
+	}
+	entriesTimer.Stop();
+
+	const AnimationClip clip = CompileClip(skeleton);
+	AnimationCursor cursor{};
+	std::vector<NodePose> poses(NumJoints);
+
+	Timer clipTimer;
+	clipTimer.Start();
+	for (uint32_t frame = 0; frame < NumFrames; frame++)
+	{
+		SampleClip(clip, frame * FrameTime, AnimationType::Repeat, cursor, poses.data());
+		GetPoseTransformations(poses.data(), NumJoints, transformations.data());
+	}
+	clipTimer.Stop();
+
+	const float entriesTime = entriesTimer.GetTimeMS() * 1000.0f / NumFrames;
+	const float clipTime = clipTimer.GetTimeMS() * 1000.0f / NumFrames;
+	std::cout << "[Tests]   " << NumJoints << " joints (" << clip.Tracks.size() << " tracks): animation entries " << entriesTime << " us, compiled clip " << clipTime
+		<< " us per frame (" << entriesTime / MAX(clipTime, 0.001f) << "x)" << std::endl;
+}
+
+// Update time of 10k instances of a 64 joint skeleton with different number of jobs, the palette is never uploaded
+BENCHMARK(AnimationUpdateScaling)
+{
+	constexpr uint32_t NumJoints = 64;
+	constexpr uint32_t NumInstances = 10000;
+	constexpr uint32_t NumFrames = 20;
+	constexpr float FrameTime = 1.0f / 60.0f;
+	constexpr uint32_t JobCounts[] = { 1, 2, 4, 8, 16 };
+
+	AnimationSystem animationSystem;
+	const AnimationSystem::SkeletonHandle skeleton = animationSystem.AddSkeleton(MakeSkeleton(NumJoints));
+	for (uint32_t i = 0; i < NumInstances; i++) animationSystem.AddInstance(skeleton, i * 0.137f);
+	animationSystem.Update(0.0f);
+
+	std::cout << "[Tests]   " << NumInstances << " instances with " << NumJoints << " joints, job pool has " << JobPool::Get()->GetThreadCount() + 1 << " threads" << std::endl;
+
+	float singleJobTime = 0.0f;
+	for (const uint32_t numJobs : JobCounts)
+	{
+		Timer timer;
+		timer.Start();
+		for (uint32_t frame = 0; frame < NumFrames; frame++) animationSystem.Update(FrameTime, numJobs);
+		timer.Stop();
+
+		const float updateTime = timer.GetTimeMS() / NumFrames;
+		if (numJobs == 1) singleJobTime = updateTime;
+		std::cout << "[Tests]   " << numJobs << " jobs: " << updateTime << " ms per update (" << singleJobTime / MAX(updateTime, 0.001f) << "x)" << std::endl;
+	}
+}
+
+// Memory and per frame sampling time of sparse cubic tracks and of linear tracks resampled from them at fixed frame rates
+BENCHMARK(AnimationCubicResampling)
+{
+	using namespace AnimationOperations;
+
+	constexpr uint32_t NumTrackPairs = 128;
+	constexpr uint32_t NumFrames = 1000;
+	constexpr float FrameTime = 1.0f / 60.0f;
+	constexpr float FrameRates[] = { 15.0f, 30.0f, 60.0f, 120.0f };
+
+	// Translation and rotation track of a joint, repeated as in a skeleton
+	std::vector<AnimationTrack> cubicTracks;
+	for (const ModelLoading::AnimTarget target : { ModelLoading::AnimTarget::Translation, ModelLoading::AnimTarget::Rotation })
+	{
+		const AnimationClip clip = CompileClip(std::vector<ModelLoading::AnimationEntry>{ MakeCubicEntry(target) });
+		cubicTracks.insert(cubicTracks.end(), NumTrackPairs, clip.Tracks[0]);
+	}
+
+	// Every track is sampled once per frame with its own cursor, like a clip playing forward
+	const auto measure = [](const std::vector<AnimationTrack>& tracks, size_t& byteSize)
+	{
+		byteSize = 0;
+		for (const AnimationTrack& track : tracks) byteSize += GetTrackByteSize(track);
+
+		std::vector<uint32_t> cursors(tracks.size(), 0);
+		float value[4];
+
+		Timer timer;
+		timer.Start();
+		for (uint32_t frame = 0; frame < NumFrames; frame++)
+		{
+			for (size_t i = 0; i < tracks.size(); i++) SampleTrack(tracks[i], frame * FrameTime, AnimationType::Repeat, cursors[i], value);
+		}
+		timer.Stop();
+		return timer.GetTimeMS() * 1000.0f / NumFrames;
+	};
+
+	size_t cubicBytes = 0;
+	const float cubicTime = measure(cubicTracks, cubicBytes);
+	std::cout << "[Tests]   " << cubicTracks.size() << " cubic tracks: " << cubicBytes / 1024.0f << " KB, " << cubicTime << " us per frame" << std::endl;
+
+	for (const float frameRate : FrameRates)
+	{
+		std::vector<AnimationTrack> denseTracks;
+		for (const AnimationTrack& cubicTrack : cubicTracks) denseTracks.push_back(ResampleTrack(cubicTrack, frameRate));
+
+		size_t denseBytes = 0;
+		const float denseTime = measure(denseTracks, denseBytes);
+		std::cout << "[Tests]   Dense linear at " << frameRate << " Hz: " << denseBytes / 1024.0f << " KB (" << (float) denseBytes / MAX(cubicBytes, (size_t) 1)
+			<< "x of cubic), " << denseTime << " us per frame (" << cubicTime / MAX(denseTime, 0.001f) << "x of cubic)" << std::endl;
+	}
+}
@@ -0,0 +1,313 @@
+#include <cfloat>
+
+#include <Engine/Loading/AnimationOperations.h>
+#include <Engine/Utility/BatchMath.h>
+#include <Engine/Utility/MathUtility.h>
+#include <Engine/Utility/Random.h>
+#include <Engine/Utility/Timer.h>
+
+#include "Test.h"
+
+namespace
+{
+	// Not a multiple of any lane width so the remainder goes through the scalar path
+	constexpr uint32_t NumElements = 1003;
+
+	// Box from -5 to 5 on every axis with planes pointing inside like ViewFrustum::Planes, spheres are in [-10, 10] so about half of them are visible
+	const Float4 FrustumPlanes[] = {
+		{ 1.0f, 0.0f, 0.0f, 5.0f }, { -1.0f, 0.0f, 0.0f, 5.0f },
+		{ 0.0f, 1.0f, 0.0f, 5.0f }, { 0.0f, -1.0f, 0.0f, 5.0f },
+		{ 0.0f, 0.0f, 1.0f, 5.0f }, { 0.0f, 0.0f, -1.0f, 5.0f },
+	};
+
+	// Same data per element and in SoA streams, the per element data is what the kernels are checked and timed against
+	struct BatchData
+	{
+		BatchData(uint32_t count = NumElements)
+		{
+			StreamData.resize(count * 19);
+			for (uint32_t i = 0; i < 19; i++) Streams[i] = StreamData.data() + i * count;
+
+			QuaternionsA = { Streams[0], Streams[1], Streams[2], Streams[3] };
+			QuaternionsB = { Streams[4], Streams[5], Streams[6], Streams[7] };
+			Translations = { Streams[8], Streams[9], Streams[10] };
+			Scales = { Streams[11], Streams[12], Streams[13] };
+			Spheres = { Streams[8], Streams[9], Streams[10], Streams[14] };
+			Factors = Streams[15];
+
+			for (uint32_t i = 0; i < count; i++)
+			{
+				const Quaternion a{ Float4{ Random::SNorm(), Random::SNorm(), Random::SNorm(), Random::SNorm() }.Normalize() };
+				const Quaternion b{ Float4{ Random::SNorm(), Random::SNorm(), Random::SNorm(), Random::SNorm() }.Normalize() };
+				const Float3 translation = Random::F3(-10.0f, 10.0f);
+				const Float3 scale = Random::F3(0.5f, 2.0f);
+
+				Poses.push_back(AnimationOperations::NodePose{ translation, a, scale });
+				OtherRotations.push_back(b);
+				QuaternionsA.X[i] = a.x; QuaternionsA.Y[i] = a.y; QuaternionsA.Z[i] = a.z; QuaternionsA.W[i] = a.w;
+				QuaternionsB.X[i] = b.x; QuaternionsB.Y[i] = b.y; QuaternionsB.Z[i] = b.z; QuaternionsB.W[i] = b.w;
+				Translations.X[i] = translation.x; Translations.Y[i] = translation.y; Translations.Z[i] = translation.z;
+				Scales.X[i] = scale.x; Scales.Y[i] = scale.y; Scales.Z[i] = scale.z;
+				Streams[14][i] = scale.x;
+				Factors[i] = Random::UNorm();
+			}
+		}
+
+		std::vector<AnimationOperations::NodePose> Poses;
+		std::vector<Quaternion> OtherRotations;
+
+		// Streams of a group are next to each other
+		std::vector<float> StreamData;
+		float* Streams[19];
+		BatchMath::QuaternionStreams QuaternionsA;
+		BatchMath::QuaternionStreams QuaternionsB;
+		BatchMath::Float3Streams Translations;
+		BatchMath::Float3Streams Scales;
+		BatchMath::SphereStreams Spheres;
+		float* Factors;
+	};
+
+	float GetMaxDifference(const BatchMath::QuaternionStreams& streams, uint32_t index, const Quaternion& expected)
+	{
+		return MAX(MAX(std::abs(streams.X[index] - expected.x), std::abs(streams.Y[index] - expected.y)), MAX(std::abs(streams.Z[index] - expected.z), std::abs(streams.W[index] - expected.w)));
+	}
+
+	float GetMaxDifference(const DirectX::XMFLOAT4X4& a, const DirectX::XMFLOAT4X4& b)
+	{
+		float maxDifference = 0.0f;
+		for (uint32_t row = 0; row < 4; row++)
+		{
+			for (uint32_t column = 0; column < 4; column++) maxDifference = MAX(maxDifference, std::abs(a.m[row][column] - b.m[row][column]));
+		}
+		return maxDifference;
+	}
+
+	// Kernels are checked once per instruction set the CPU has, the selected one is restored afterwards
+	template<typename CheckFunc>
+	void ForEachInstructionSet(const CheckFunc& check)
+	{
+		const BatchMath::InstructionSet previousInstructionSet = BatchMath::GetInstructionSet();
+		for (uint32_t i = 0; i <= EnumToInt(BatchMath::GetSupportedInstructionSet()); i++)
+		{
+			const BatchMath::InstructionSet instructionSet = IntToEnum<BatchMath::InstructionSet>(i);
+			BatchMath::SetInstructionSet(instructionSet);
+			check(BatchMath::ToString(instructionSet));
+		}
+		BatchMath::SetInstructionSet(previousInstructionSet);
+	}
+}
+
+// Slerp matches MathUtility::Lerp and NLerp matches the normalized shortest path lerp on every instruction set, also when writing over the inputs
+TEST(BatchMathQuaternions)
+{
+	constexpr float Tolerance = 1e-5f;
+
+	const BatchData data;
+	std::vector<float> resultData(NumElements * 4);
+	const BatchMath::QuaternionStreams result{ resultData.data(), resultData.data() + NumElements, resultData.data() + NumElements * 2, resultData.data() + NumElements * 3 };
+
+	std::vector<Quaternion> expectedSlerp(NumElements);
+	std::vector<Quaternion> expectedNLerp(NumElements);
+	for (uint32_t i = 0; i < NumElements; i++)
+	{
+		const Quaternion& qa = data.Poses[i].Rotation;
+		const Quaternion& qb = data.OtherRotations[i];
+		expectedSlerp[i] = MathUtility::Lerp(qa, qb, data.Factors[i]);
+
+		const Float4 a{ qa.x, qa.y, qa.z, qa.w };
+		Float4 b{ qb.x, qb.y, qb.z, qb.w };
+		if (a.Dot(b) < 0.0f) b *= -1.0f;
+		expectedNLerp[i] = Quaternion{ MathUtility::Lerp(a, b, data.Factors[i]).Normalize() };
+	}
+
+	ForEachInstructionSet([&](const char* instructionSetName)
+	{
+		float maxSlerpDifference = 0.0f;
+		BatchMath::Slerp(data.QuaternionsA, data.QuaternionsB, data.Factors, result, NumElements);
+		for (uint32_t i = 0; i < NumElements; i++) maxSlerpDifference = MAX(maxSlerpDifference, GetMaxDifference(result, i, expectedSlerp[i]));
+		TEST_CHECK(maxSlerpDifference < Tolerance, instructionSetName << ": Slerp differs from MathUtility::Lerp by " << maxSlerpDifference);
+
+		float maxNLerpDifference = 0.0f;
+		BatchMath::NLerp(data.QuaternionsA, data.QuaternionsB, data.Factors, result, NumElements);
+		for (uint32_t i = 0; i < NumElements; i++) maxNLerpDifference = MAX(maxNLerpDifference, GetMaxDifference(result, i, expectedNLerp[i]));
+		TEST_CHECK(maxNLerpDifference < Tolerance, instructionSetName << ": NLerp differs from the per element lerp by " << maxNLerpDifference);
+
+		// Result written over the first input, the four streams of QuaternionsA are next to each other
+		std::vector<float> aliasedData(data.QuaternionsA.X, data.QuaternionsA.X + NumElements * 4);
+		const BatchMath::QuaternionStreams aliased{ aliasedData.data(), aliasedData.data() + NumElements, aliasedData.data() + NumElements * 2, aliasedData.data() + NumElements * 3 };
+		BatchMath::NLerp(aliased, data.QuaternionsB, data.Factors, aliased, NumElements);
+		TEST_CHECK(memcmp(aliasedData.data(), resultData.data(), resultData.size() * sizeof(float)) == 0, instructionSetName << ": NLerp gives other results when the output aliases the input");
+	});
+}
+
+// ComposeTransforms matches GetPoseTransformation, MultiplyMatrices and MultiplyMatrixChains match XMMatrixMultiply on every instruction set
+TEST(BatchMathMatrices)
+{
+	using namespace DirectX;
+
+	constexpr float Tolerance = 1e-4f;
+
+	const BatchData data;
+	std::vector<XMFLOAT4X4> poseMatrices(NumElements);
+	for (uint32_t i = 0; i < NumElements; i++) XMStoreFloat4x4(&poseMatrices[i], AnimationOperations::GetPoseTransformation(data.Poses[i]));
+
+	std::vector<XMFLOAT4X4> expectedProducts(NumElements);
+	for (uint32_t i = 0; i < NumElements; i++)
+		XMStoreFloat4x4(&expectedProducts[i], XMMatrixMultiply(XMLoadFloat4x4(&poseMatrices[i]), XMLoadFloat4x4(&poseMatrices[(i + 1) % NumElements])));
+
+	// Chains of rigid transforms so the products stay in range, every fourth element is a root
+	std::vector<uint32_t> parents(NumElements);
+	std::vector<XMFLOAT4X4> localMatrices(NumElements);
+	std::vector<XMFLOAT4X4> expectedChains(NumElements);
+	for (uint32_t i = 0; i < NumElements; i++)
+	{
+		parents[i] = i % 4 == 0 ? BatchMath::INVALID_PARENT : Random::UInt(0, i - 1);
+		const AnimationOperations::NodePose pose{ Random::F3(-1.0f, 1.0f), data.Poses[i].Rotation, Float3{ 1.0f, 1.0f, 1.0f } };
+		XMStoreFloat4x4(&localMatrices[i], AnimationOperations::GetPoseTransformation(pose));
+
+		const XMMATRIX local = XMLoadFloat4x4(&localMatrices[i]);
+		XMStoreFloat4x4(&expectedChains[i], parents[i] == BatchMath::INVALID_PARENT ? local : XMMatrixMultiply(local, XMLoadFloat4x4(&expectedChains[parents[i]])));
+	}
+
+	std::vector<XMFLOAT4X4> result(NumElements);
+	ForEachInstructionSet([&](const char* instructionSetName)
+	{
+		float maxComposeDifference = 0.0f;
+		BatchMath::ComposeTransforms(data.Translations, data.QuaternionsA, data.Scales, result.data(), NumElements);
+		for (uint32_t i = 0; i < NumElements; i++) maxComposeDifference = MAX(maxComposeDifference, GetMaxDifference(result[i], poseMatrices[i]));
+		TEST_CHECK(maxComposeDifference < Tolerance, instructionSetName << ": ComposeTransforms differs from GetPoseTransformation by " << maxComposeDifference);
+
+		// Result written over the first input
+		float maxProductDifference = 0.0f;
+		std::vector<XMFLOAT4X4> nextMatrices(poseMatrices.begin() + 1, poseMatrices.end());
+		nextMatrices.push_back(poseMatrices[0]);
+		result = poseMatrices;
+		BatchMath::MultiplyMatrices(result.data(), nextMatrices.data(), result.data(), NumElements);
+		for (uint32_t i = 0; i < NumElements; i++) maxProductDifference = MAX(maxProductDifference, GetMaxDifference(result[i], expectedProducts[i]));
+		TEST_CHECK(maxProductDifference < Tolerance, instructionSetName << ": MultiplyMatrices differs from XMMatrixMultiply by " << maxProductDifference);
+
+		float maxChainDifference = 0.0f;
+		BatchMath::MultiplyMatrixChains(localMatrices.data(), parents.data(), result.data(), NumElements);
+		for (uint32_t i = 0; i < NumElements; i++) maxChainDifference = MAX(maxChainDifference, GetMaxDifference(result[i], expectedChains[i]));
+		TEST_CHECK(maxChainDifference < Tolerance, instructionSetName << ": MultiplyMatrixChains differs from XMMatrixMultiply by " << maxChainDifference);
+	});
+}
+
+// TestSpheresInFrustum agrees with the plane distances of each sphere on every instruction set, spheres that only touch a plane are skipped
+TEST(BatchMathFrustum)
+{
+	constexpr float TouchDistance = 1e-3f;
+
+	const BatchData data;
+	std::vector<uint8_t> expected(NumElements);
+	std::vector<bool> touching(NumElements);
+	uint32_t numVisible = 0;
+	for (uint32_t i = 0; i < NumElements; i++)
+	{
+		double minDistance = DBL_MAX;
+		for (const Float4& plane : FrustumPlanes)
+			minDistance = MIN(minDistance, (double) plane.x * data.Spheres.X[i] + (double) plane.y * data.Spheres.Y[i] + (double) plane.z * data.Spheres.Z[i] + plane.w + data.Spheres.Radius[i]);
+
+		expected[i] = minDistance >= 0.0 ? 1 : 0;
+		touching[i] = std::abs(minDistance) < TouchDistance;
+		numVisible += expected[i];
+	}
+	TEST_CHECK(numVisible > 0 && numVisible < NumElements, numVisible << " of " << NumElements << " spheres visible, the check below proves nothing");
+
+	std::vector<uint8_t> visible(NumElements);
+	ForEachInstructionSet([&](const char* instructionSetName)
+	{
+		memset(visible.data(), 0xFF, visible.size());
+		BatchMath::TestSpheresInFrustum(data.Spheres, FrustumPlanes, STATIC_ARRAY_SIZE(FrustumPlanes), visible.data(), NumElements);
+
+		uint32_t numWrong = 0;
+		for (uint32_t i = 0; i < NumElements; i++) numWrong += !touching[i] && visible[i] != expected[i];
+		TEST_CHECK(numWrong == 0, instructionSetName << ": " << numWrong << " of " << NumElements << " spheres tested wrong");
+	});
+}
+
+// Kernels on every supported instruction set against the per element math they replace, timings are logged
+BENCHMARK(BatchMath)
+{
+	using namespace DirectX;
+
+	constexpr uint32_t NumBenchmarkElements = 1 << 16;
+	constexpr uint32_t NumRepeats = 20;
+
+	const BatchData data(NumBenchmarkElements);
+	std::vector<float> resultData(NumBenchmarkElements * 4);
+	const BatchMath::QuaternionStreams streamsResult{ resultData.data(), resultData.data() + NumBenchmarkElements, resultData.data() + NumBenchmarkElements * 2, resultData.data() + NumBenchmarkElements * 3 };
+
+	std::vector<Quaternion> quaternionsResult(NumBenchmarkElements);
+	std::vector<XMFLOAT4X4> matricesA(NumBenchmarkElements);
+	std::vector<XMFLOAT4X4> matricesB(NumBenchmarkElements);
+	std::vector<XMFLOAT4X4> matricesResult(NumBenchmarkElements);
+	std::vector<uint8_t> visible(NumBenchmarkElements);
+	for (uint32_t i = 0; i < NumBenchmarkElements; i++)
+	{
+		XMStoreFloat4x4(&matricesA[i], AnimationOperations::GetPoseTransformation(data.Poses[i]));
+		XMStoreFloat4x4(&matricesB[i], AnimationOperations::GetPoseTransformation(data.Poses[(i + 1) % NumBenchmarkElements]));
+	}
+
+	const auto measure = [](const auto& func)
+	{
+		Timer timer;
+		timer.Start();
+		for (uint32_t repeat = 0; repeat < NumRepeats; repeat++) func();
+		timer.Stop();
+		return timer.GetTimeMS() / NumRepeats;
+	};
+
+	const auto report = [&](const char* name, const auto& elementFunc, const auto& batchFunc)
+	{
+		const float elementTime = measure(elementFunc);
+		std::cout << "[Tests]   " << name << ": per element " << elementTime << " ms";
+		ForEachInstructionSet([&](const char* instructionSetName)
+		{
+			const float batchTime = measure(batchFunc);
+			std::cout << ", " << instructionSetName << " " << batchTime << " ms (" << elementTime / MAX(batchTime, 0.0001f) << "x)";
+		});
+		std::cout << std::endl;
+	};
+
+	std::cout << "[Tests]   " << NumBenchmarkElements << " elements, " << BatchMath::ToString(BatchMath::GetSupportedInstructionSet()) << " is supported" << std::endl;
+
+	report("Slerp",
+		[&]() { for (uint32_t i = 0; i < NumBenchmarkElements; i++) quaternionsResult[i] = MathUtility::Lerp(data.Poses[i].Rotation, data.OtherRotations[i], data.Factors[i]); },
+		[&]() { BatchMath::Slerp(data.QuaternionsA, data.QuaternionsB, data.Factors, streamsResult, NumBenchmarkElements); });
+
+	report("NLerp",
+		[&]() {
+			for (uint32_t i = 0; i < NumBenchmarkElements; i++)
+			{
+				const Quaternion& qa = data.Poses[i].Rotation;
+				const Quaternion& qb = data.OtherRotations[i];
+				const Float4 a{ qa.x, qa.y, qa.z, qa.w };
+				Float4 b{ qb.x, qb.y, qb.z, qb.w };
+				if (a.Dot(b) < 0.0f) b *= -1.0f;
+				quaternionsResult[i] = Quaternion{ MathUtility::Lerp(a, b, data.Factors[i]).Normalize() };
+			}
+		},
+		[&]() { BatchMath::NLerp(data.QuaternionsA, data.QuaternionsB, data.Factors, streamsResult, NumBenchmarkElements); });
+
+	report("TRS to matrix",
+		[&]() { for (uint32_t i = 0; i < NumBenchmarkElements; i++) XMStoreFloat4x4(&matricesResult[i], AnimationOperations::GetPoseTransformation(data.Poses[i])); },
+		[&]() { BatchMath::ComposeTransforms(data.Translations, data.QuaternionsA, data.Scales, matricesResult.data(), NumBenchmarkElements); });
+
+	report("Matrix multiply",
+		[&]() { for (uint32_t i = 0; i < NumBenchmarkElements; i++) XMStoreFloat4x4(&matricesResult[i], XMMatrixMultiply(XMLoadFloat4x4(&matricesA[i]), XMLoadFloat4x4(&matricesB[i]))); },
+		[&]() { BatchMath::MultiplyMatrices(matricesA.data(), matricesB.data(), matricesResult.data(), NumBenchmarkElements); });
+
+	report("Sphere vs frustum",
+		[&]() {
+			for (uint32_t i = 0; i < NumBenchmarkElements; i++)
+			{
+				const Float3 center{ data.Spheres.X[i], data.Spheres.Y[i], data.Spheres.Z[i] };
+				bool inside = true;
+				for (uint32_t p = 0; p < STATIC_ARRAY_SIZE(FrustumPlanes) && inside; p++)
+					inside = center.x * FrustumPlanes[p].x + center.y * FrustumPlanes[p].y + center.z * FrustumPlanes[p].z + FrustumPlanes[p].w >= -data.Spheres.Radius[i];
+				visible[i] = inside ? 1 : 0;
+			}
+		},
+		[&]() { BatchMath::TestSpheresInFrustum(data.Spheres, FrustumPlanes, STATIC_ARRAY_SIZE(FrustumPlanes), visible.data(), NumBenchmarkElements); });
+}
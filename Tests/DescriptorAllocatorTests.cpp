@@ -0,0 +1,171 @@
+#include <atomic>
+
+#include <Engine/Render/Device.h>
+#include <Engine/Render/DescriptorHeap.h>
+#include <Engine/System/JobPool.h>
+#include <Engine/Utility/MemoryStrategies.h>
+#include <Engine/Utility/Multithreading.h>
+#include <Engine/Utility/Random.h>
+#include <Engine/Utility/Timer.h>
+
+#include "Test.h"
+
+namespace
+{
+	constexpr size_t NumPersistentElements = 4096;
+	constexpr uint32_t NumPersistentOps = 1000000;
+
+	struct PersistentResult
+	{
+		uint32_t NumReused = 0;
+		uint32_t NumFailed = 0;
+		float NSPerOp = 0.0f;
+	};
+
+	// Random allocations and releases of single elements from every job pool thread, every live element has to be owned by exactly one thread
+	template<typename Allocate, typename Release>
+	PersistentResult RunPersistentOps(Allocate allocate, Release release)
+	{
+		const uint32_t numThreads = JobPool::Get()->GetThreadCount() + 1;
+
+		std::vector<std::atomic<uint32_t>> owners(NumPersistentElements);
+		std::atomic<uint32_t> numReused = 0;
+		std::atomic<uint32_t> numFailed = 0;
+
+		Timer timer;
+		timer.Start();
+		JobPool::Get()->ParallelFor(numThreads, [&](uint32_t threadIndex)
+		{
+			std::vector<size_t> live;
+			for (uint32_t op = 0; op < NumPersistentOps / numThreads; op++)
+			{
+				if (live.empty() || (live.size() < 256 && Random::UInt(0, 1)))
+				{
+					const size_t element = allocate();
+					if (element == INVALID_ALLOCATION)
+					{
+						numFailed++;
+						continue;
+					}
+					numReused += owners[element].exchange(threadIndex + 1) != 0;
+					live.push_back(element);
+				}
+				else
+				{
+					const uint32_t index = Random::UInt(0, (uint32_t) live.size() - 1);
+					const size_t element = live[index];
+					live[index] = live.back();
+					live.pop_back();
+
+					owners[element].store(0);
+					release(element);
+				}
+			}
+			for (size_t element : live)
+			{
+				owners[element].store(0);
+				release(element);
+			}
+		});
+		timer.Stop();
+
+		return { numReused.load(), numFailed.load(), timer.GetTimeMS() * 1000000.0f / NumPersistentOps };
+	}
+}
+
+// Persistent single descriptors on the lock free element allocator
+TEST(ElementStrategyThreads)
+{
+	ElementStrategy strategy(NumPersistentElements);
+	const PersistentResult result = RunPersistentOps([&strategy]() { return strategy.Allocate(); }, [&strategy](size_t element) { strategy.Release(element); });
+
+	TEST_CHECK(result.NumReused == 0, result.NumReused << " live descriptors handed out again");
+	TEST_CHECK(result.NumFailed == 0, result.NumFailed << " failed allocations");
+	TEST_CHECK(strategy.CanAllocate(NumPersistentElements), "not every descriptor is free at the end");
+}
+
+// Lock free single descriptors against the previous path of DescriptorHeap::Allocate, a range allocator behind the heap lock
+BENCHMARK(ElementStrategyAgainstLockedRanges)
+{
+	ElementStrategy lockFree(NumPersistentElements);
+	const PersistentResult lockFreeResult = RunPersistentOps([&lockFree]() { return lockFree.Allocate(); }, [&lockFree](size_t element) { lockFree.Release(element); });
+
+	MTR::Mutex mutex;
+	RangeStrategy locked(NumPersistentElements);
+	const PersistentResult lockedResult = RunPersistentOps(
+		[&]() { mutex.Lock(); const size_t start = locked.Allocate(1).Start; mutex.Unlock(); return start; },
+		[&](size_t element) { RangeAllocation alloc{ element, 1 }; mutex.Lock(); locked.Release(alloc); mutex.Unlock(); });
+
+	std::cout << "[Tests]   Lock free " << lockFreeResult.NSPerOp << " ns per operation, range allocator behind a lock " << lockedResult.NSPerOp << " ns" << std::endl;
+}
+
+// Transient tables: contexts on different threads with different fence latencies share the blocks of one heap
+DEVICE_TEST(TransientDescriptorsFramesInFlight)
+{
+	constexpr uint32_t NumFrames = 2000;
+	constexpr size_t NumTransientDescriptors = 128 * 1024;
+	constexpr uint64_t FenceMask = (1ull << 40) - 1;
+
+	const uint32_t numThreads = JobPool::Get()->GetThreadCount() + 1;
+	DescriptorHeap heap(true, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 0, NumTransientDescriptors);
+	const size_t heapStart = heap.GetHeap()->GetCPUDescriptorHandleForHeapStart().ptr;
+	const size_t descriptorSize = Device::Get()->GetHandle()->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+	// Thread and submit that last wrote each descriptor
+	std::vector<std::atomic<uint64_t>> writers(NumTransientDescriptors);
+	std::vector<std::atomic<uint64_t>> completedFences(numThreads);
+	std::atomic<uint32_t> numOverwritten = 0;
+	std::atomic<uint32_t> numTables = 0;
+
+	Timer timer;
+	timer.Start();
+	JobPool::Get()->ParallelFor(numThreads, [&](uint32_t threadIndex)
+	{
+		TransientDescriptorAllocator allocator(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, &heap);
+		const uint64_t latency = threadIndex % 3 + 1;
+		uint64_t submittedFence = 0;
+
+		for (uint32_t frame = 0; frame < NumFrames; frame++)
+		{
+			const uint64_t completedFence = submittedFence >= latency ? submittedFence - latency : 0;
+			completedFences[threadIndex].store(completedFence);
+			allocator.Reclaim(completedFence);
+
+			const uint32_t frameTables = Random::UInt(1, 32);
+			for (uint32_t table = 0; table < frameTables; table++)
+			{
+				const DescriptorAllocation alloc = allocator.Allocate(Random::UInt(1, 16));
+				const size_t first = (alloc.GetCPUHandle().ptr - heapStart) / descriptorSize;
+				for (size_t i = first; i < first + alloc.GetDescriptorCount(); i++)
+				{
+					const uint64_t writer = writers[i].exchange(((uint64_t) (threadIndex + 1) << 40) | (submittedFence + 1));
+					if (writer == 0) continue;
+
+					// Descriptors of a submit can be written again once the fence of its context passed it
+					const uint32_t writerThread = (uint32_t) (writer >> 40) - 1;
+					numOverwritten += (writer & FenceMask) > completedFences[writerThread].load();
+				}
+			}
+			numTables += frameTables;
+
+			submittedFence++;
+			allocator.Retire(submittedFence);
+		}
+
+		// Context waits for the GPU before its allocator gives the blocks back
+		completedFences[threadIndex].store(submittedFence);
+		allocator.Reclaim(submittedFence);
+	});
+	timer.Stop();
+
+	// Allocators gave every block back
+	std::vector<size_t> blocks;
+	for (size_t block = heap.AcquireTransientBlock(); block != INVALID_ALLOCATION; block = heap.AcquireTransientBlock()) blocks.push_back(block);
+	for (size_t block : blocks) heap.ReleaseTransientBlock(block);
+	const size_t numBlocks = NumTransientDescriptors / heap.GetTransientBlockSize();
+
+	TEST_CHECK(numOverwritten == 0, numOverwritten << " descriptors of submits in flight overwritten");
+	TEST_CHECK(blocks.size() == numBlocks, blocks.size() << " of " << numBlocks << " blocks free at the end");
+
+	std::cout << "[Tests]   " << timer.GetTimeMS() * 1000000.0f / numTables << " ns per table over " << numTables << " tables on " << numThreads << " threads" << std::endl;
+}
@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <bit>
+
+#include <Engine/Utility/Hash.h>
+#include <Engine/Utility/Random.h>
+#include <Engine/Utility/Timer.h>
+
+#include "Test.h"
+
+namespace
+{
+	// Bit by bit reflected CRC, what the table and the crc32 instruction have to match
+	uint32_t ReferenceCrc(uint32_t polynomial, const uint8_t* bytes, size_t byteSize)
+	{
+		uint32_t crc = 0xFFFFFFFF;
+		for (size_t i = 0; i < byteSize; i++)
+		{
+			crc ^= bytes[i];
+			for (uint32_t bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ ((crc & 1) ? polynomial : 0);
+		}
+		return ~crc;
+	}
+
+	std::vector<uint8_t> MakeRandomData(size_t byteSize)
+	{
+		std::vector<uint8_t> data(byteSize);
+		for (uint8_t& byte : data) byte = (uint8_t) Random::UInt(0, 255);
+		return data;
+	}
+
+	// Keys shaped like staging texture requests, every field is a small number as in real caches
+	void MakeRequestKeys(std::vector<uint64_t>& hasherKeys, std::vector<uint64_t>& crcKeys)
+	{
+		for (uint32_t width = 1; width <= 128; width++)
+		{
+			for (uint32_t height = 1; height <= 128; height++)
+			{
+				for (uint32_t numMips = 1; numMips <= 8; numMips++)
+				{
+					for (uint32_t format = 1; format <= 8; format++)
+					{
+						Hash::Hasher hasher;
+						hasher.Add(width);
+						hasher.Add(height);
+						hasher.Add(numMips);
+						hasher.Add(format);
+						hasherKeys.push_back(hasher.Get());
+
+						uint32_t crc = Hash::Crc32(width);
+						crc = Hash::Crc32(crc, height);
+						crc = Hash::Crc32(crc, numMips);
+						crc = Hash::Crc32(crc, format);
+						crcKeys.push_back(crc);
+					}
+				}
+			}
+		}
+	}
+
+	size_t CountCollisions(std::vector<uint64_t> keys, uint64_t mask)
+	{
+		for (uint64_t& key : keys) key &= mask;
+		std::sort(keys.begin(), keys.end());
+		return keys.size() - (std::unique(keys.begin(), keys.end()) - keys.begin());
+	}
+}
+
+// Check values of both CRCs, and both against the bitwise definition for every length and alignment the word loop and the tail handle
+TEST(HashCrc)
+{
+	const std::string check = "123456789";
+	TEST_CHECK(Hash::Crc32(check) == 0xCBF43926, "Crc32 check value is " << std::hex << Hash::Crc32(check));
+	TEST_CHECK(Hash::Crc32C(check.data(), check.size()) == 0xE3069283, "Crc32C check value is " << std::hex << Hash::Crc32C(check.data(), check.size()));
+	TEST_CHECK(Hash::Crc32C(nullptr, 0) == 0, "Crc32C of nothing is " << std::hex << Hash::Crc32C(nullptr, 0));
+
+	// iSCSI test patterns (RFC 3720)
+	uint8_t zeros[32] = {};
+	uint8_t ones[32];
+	uint8_t ascending[32];
+	memset(ones, 0xFF, sizeof(ones));
+	for (uint32_t i = 0; i < 32; i++) ascending[i] = (uint8_t) i;
+	TEST_CHECK(Hash::Crc32C(zeros, sizeof(zeros)) == 0x8A9136AA, "Crc32C of zeros is " << std::hex << Hash::Crc32C(zeros, sizeof(zeros)));
+	TEST_CHECK(Hash::Crc32C(ones, sizeof(ones)) == 0x62A8AB43, "Crc32C of ones is " << std::hex << Hash::Crc32C(ones, sizeof(ones)));
+	TEST_CHECK(Hash::Crc32C(ascending, sizeof(ascending)) == 0x46DD794E, "Crc32C of ascending bytes is " << std::hex << Hash::Crc32C(ascending, sizeof(ascending)));
+
+	const std::vector<uint8_t> data = MakeRandomData(256);
+	uint32_t numWrongCrc32 = 0;
+	uint32_t numWrongCrc32C = 0;
+	uint32_t numWrongChained = 0;
+	for (size_t offset = 0; offset < 8; offset++)
+	{
+		for (size_t byteSize = 0; byteSize + offset <= 200; byteSize++)
+		{
+			const uint8_t* bytes = data.data() + offset;
+			numWrongCrc32 += Hash::Crc32(bytes, byteSize) != ReferenceCrc(0xEDB88320, bytes, byteSize);
+			numWrongCrc32C += Hash::Crc32C(bytes, byteSize) != ReferenceCrc(0x82F63B78, bytes, byteSize);
+
+			// Crc32C of a part continues into the next one
+			const size_t split = byteSize / 3;
+			numWrongChained += Hash::Crc32C(Hash::Crc32C(bytes, split), bytes + split, byteSize - split) != Hash::Crc32C(bytes, byteSize);
+		}
+	}
+	TEST_CHECK(numWrongCrc32 == 0, numWrongCrc32 << " lengths and offsets with a wrong Crc32");
+	TEST_CHECK(numWrongCrc32C == 0, numWrongCrc32C << " lengths and offsets with a wrong Crc32C" << (Hash::HasHardwareCrc32C() ? " on SSE 4.2" : " from the table"));
+	TEST_CHECK(numWrongChained == 0, numWrongChained << " chained Crc32C differ from the whole");
+}
+
+// Hash64 and Hasher are keys of caches on disk, every input bit has to reach the result and the overloads have to agree
+TEST(HashKeys)
+{
+	const std::vector<uint8_t> data = MakeRandomData(1024);
+
+	// Every length of the same bytes is a different key, lengths cover the short paths, the 16 byte loop and the 48 byte loop
+	std::vector<uint64_t> prefixHashes;
+	for (size_t byteSize = 0; byteSize <= 300; byteSize++) prefixHashes.push_back(Hash::Hash64(data.data(), byteSize));
+	TEST_CHECK(CountCollisions(prefixHashes, ~0ull) == 0, "prefixes of the same data collide");
+
+	// Flipping any input bit flips about half of the output bits
+	uint32_t numUnchanged = 0;
+	uint64_t numFlippedBits = 0;
+	uint64_t numFlips = 0;
+	for (const size_t byteSize : { (size_t) 3, (size_t) 8, (size_t) 16, (size_t) 56, (size_t) 328 })
+	{
+		std::vector<uint8_t> flipped(data.begin(), data.begin() + byteSize);
+		const uint64_t hash = Hash::Hash64(flipped.data(), byteSize);
+		for (size_t bit = 0; bit < byteSize * 8; bit++)
+		{
+			flipped[bit / 8] ^= 1 << (bit % 8);
+			const uint64_t flippedHash = Hash::Hash64(flipped.data(), byteSize);
+			flipped[bit / 8] ^= 1 << (bit % 8);
+
+			numUnchanged += flippedHash == hash;
+			numFlippedBits += std::popcount(flippedHash ^ hash);
+			numFlips++;
+		}
+	}
+	const double averageFlippedBits = (double) numFlippedBits / numFlips;
+	TEST_CHECK(numUnchanged == 0, numUnchanged << " input bits don't change the hash");
+	TEST_CHECK(averageFlippedBits > 30.0 && averageFlippedBits < 34.0, "one input bit flips " << averageFlippedBits << " output bits on average");
+
+	// Same bytes give the same key wherever they are and whichever overload hashes them
+	const uint64_t value = 0x0123456789ABCDEFull;
+	std::vector<uint8_t> unaligned(sizeof(value) + 1);
+	memcpy(unaligned.data() + 1, &value, sizeof(value));
+	const std::string text = "Application/Animation/geometry.hlsl";
+	TEST_CHECK(Hash::Hash64(value) == Hash::Hash64(&value, sizeof(value)), "typed Hash64 differs from the bytes");
+	TEST_CHECK(Hash::Hash64(unaligned.data() + 1, sizeof(value)) == Hash::Hash64(value), "unaligned Hash64 differs");
+	TEST_CHECK(Hash::Hash64(text) == Hash::Hash64(text.data(), text.size()), "string Hash64 differs from the bytes");
+	TEST_CHECK(Hash::Hash64(value, 1) != Hash::Hash64(value), "seed doesn't change Hash64");
+
+	// Hasher depends on the order and the size of the fields
+	Hash::Hasher ab, ba, narrow, wide;
+	ab.Add(1u);
+	ab.Add(2u);
+	ba.Add(2u);
+	ba.Add(1u);
+	narrow.Add((uint32_t) 7);
+	wide.Add((uint64_t) 7);
+	TEST_CHECK(ab.Get() != ba.Get(), "Hasher doesn't depend on the order of fields");
+	TEST_CHECK(narrow.Get() != wide.Get(), "Hasher doesn't depend on the size of fields");
+	TEST_CHECK(Hash::Hasher(1).Get() != Hash::Hasher(2).Get(), "seed doesn't change the Hasher");
+
+	// Small fields like the ones of real cache keys don't collide in 64 bits
+	std::vector<uint64_t> hasherKeys;
+	std::vector<uint64_t> crcKeys;
+	MakeRequestKeys(hasherKeys, crcKeys);
+	const size_t numCollisions = CountCollisions(hasherKeys, ~0ull);
+	TEST_CHECK(numCollisions == 0, numCollisions << " collisions of " << hasherKeys.size() << " request keys");
+}
+
+// Throughput of the hashes at sizes of pipeline keys and uploads, collisions of 32 bit keys are logged
+BENCHMARK(Hashing)
+{
+	// Depth stencil fields, blend fields of a pipeline key, a sampler desc and a bulk upload
+	const uint32_t byteSizes[] = { 8, 56, 52, 328, 64 * 1024, 4 * 1024 * 1024 };
+	std::vector<uint8_t> data = MakeRandomData(4 * 1024 * 1024);
+
+	std::cout << "[Tests]   CRC32C " << (Hash::HasHardwareCrc32C() ? "uses SSE 4.2" : "falls back to a table") << std::endl;
+	for (const uint32_t byteSize : byteSizes)
+	{
+		const uint32_t numRepeats = std::max(16u, (64u * 1024 * 1024) / byteSize);
+
+		// Each result is written into the data of the next call so the loops can't be dropped
+		uint64_t sink = 0;
+		const auto measure = [&](const auto& hash)
+		{
+			Timer timer;
+			timer.Start();
+			for (uint32_t i = 0; i < numRepeats; i++)
+			{
+				data[0] = (uint8_t) sink;
+				sink += hash();
+			}
+			timer.Stop();
+			return timer.GetTimeMS() * 1000000.0f / numRepeats;
+		};
+
+		const float crc32NS = measure([&]() { return Hash::Crc32(data.data(), byteSize); });
+		const float crc32cNS = measure([&]() { return Hash::Crc32C(data.data(), byteSize); });
+		const float hash64NS = measure([&]() { return Hash::Hash64(data.data(), byteSize); });
+
+		const auto toGBs = [byteSize](float ns) { return byteSize / std::max(ns, 0.001f); };
+		std::cout << "[Tests]   " << byteSize << " bytes: Crc32 " << crc32NS << " ns (" << toGBs(crc32NS) << " GB/s), Crc32C " << crc32cNS << " ns (" << toGBs(crc32cNS)
+			<< " GB/s), Hash64 " << hash64NS << " ns (" << toGBs(hash64NS) << " GB/s)" << std::endl;
+	}
+
+	std::vector<uint64_t> hasherKeys;
+	std::vector<uint64_t> crcKeys;
+	MakeRequestKeys(hasherKeys, crcKeys);
+
+	// Collisions of n uniformly random 32 bit values, n^2 / 2^33
+	const double numKeys = (double) hasherKeys.size();
+	const double expected32 = numKeys * numKeys / 8589934592.0;
+
+	std::cout << "[Tests]   Collisions of " << hasherKeys.size() << " request keys in 32 bits: Hasher " << CountCollisions(hasherKeys, 0xFFFFFFFFull) << ", Crc32 "
+		<< CountCollisions(crcKeys, 0xFFFFFFFFull) << ", random values would have " << expected32 << std::endl;
+}
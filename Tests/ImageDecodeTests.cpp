@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb/stb_image_write.h>
+
+#include <Engine/Loading/TextureLoading.h>
+#include <Engine/System/JobPool.h>
+#include <Engine/Utility/Timer.h>
+
+#include "Test.h"
+
+namespace
+{
+	constexpr uint32_t ImageWidth = 13;
+	constexpr uint32_t ImageHeight = 7;
+
+	std::vector<uint8_t> MakeImage(uint32_t numChannels)
+	{
+		std::vector<uint8_t> pixels((size_t) ImageWidth * ImageHeight * numChannels);
+		for (size_t i = 0; i < pixels.size(); i++) pixels[i] = (uint8_t) (i * 37 + numChannels * 11);
+		return pixels;
+	}
+
+	void AppendToVector(void* context, void* data, int size)
+	{
+		std::vector<uint8_t>& file = *static_cast<std::vector<uint8_t>*>(context);
+		file.insert(file.end(), static_cast<uint8_t*>(data), static_cast<uint8_t*>(data) + size);
+	}
+
+	std::vector<uint8_t> EncodePNG(const std::vector<uint8_t>& pixels, uint32_t numChannels)
+	{
+		std::vector<uint8_t> file;
+		stbi_write_png_to_func(AppendToVector, &file, ImageWidth, ImageHeight, numChannels, pixels.data(), ImageWidth * numChannels);
+		return file;
+	}
+}
+
+// Every channel layout decoded as RGBA, Expand and Narrow against the pixels it was encoded from
+TEST(ImageDecodeChannels)
+{
+	for (uint32_t numChannels = 1; numChannels <= 4; numChannels++)
+	{
+		const std::vector<uint8_t> pixels = MakeImage(numChannels);
+		const std::vector<uint8_t> file = EncodePNG(pixels, numChannels);
+		const std::string name = std::to_string(numChannels) + " channel png";
+
+		// Decoder expands to R8G8B8A8, grey is broadcast to RGB and missing alpha is opaque
+		TextureLoading::DecodedTexture rgba = TextureLoading::DecodeTexture(file.data(), file.size(), name, TextureLoading::DecodeChannels::RGBA);
+		TEST_CHECK(rgba.Width == ImageWidth && rgba.Height == ImageHeight, name << " decoded to " << rgba.Width << "x" << rgba.Height);
+		TEST_CHECK(rgba.NumChannels == 4 && rgba.Format == DXGI_FORMAT_R8G8B8A8_UNORM && !rgba.IsHDR, name << " decoded to " << rgba.NumChannels << " channels, format " << rgba.Format);
+		if (rgba.NumChannels == 4 && rgba.Width == ImageWidth && rgba.Height == ImageHeight)
+		{
+			uint32_t numWrongTexels = 0;
+			const uint8_t* decoded = static_cast<const uint8_t*>(rgba.Pixels);
+			for (uint32_t texel = 0; texel < ImageWidth * ImageHeight; texel++)
+			{
+				const uint8_t* source = &pixels[texel * numChannels];
+				const bool grey = numChannels < 3;
+				const uint8_t expected[] = { source[0], grey ? source[0] : source[1], grey ? source[0] : source[2], numChannels == 2 ? source[1] : numChannels == 4 ? source[3] : (uint8_t) 255 };
+				numWrongTexels += memcmp(expected, &decoded[texel * 4], 4) != 0;
+			}
+			TEST_CHECK(numWrongTexels == 0, name << " has " << numWrongTexels << " wrong texels expanded to RGBA");
+		}
+		TextureLoading::FreeDecodedTexture(rgba);
+
+		// Channels of the image are kept, expansion happens while writing the upload
+		TextureLoading::DecodedTexture expand = TextureLoading::DecodeTexture(file.data(), file.size(), name, TextureLoading::DecodeChannels::Expand);
+		TEST_CHECK(expand.NumChannels == numChannels && expand.Format == DXGI_FORMAT_R8G8B8A8_UNORM, name << " kept " << expand.NumChannels << " channels, format " << expand.Format);
+		TEST_CHECK(TextureLoading::GetDecodedByteSize(expand) == pixels.size(), name << " decoded to " << TextureLoading::GetDecodedByteSize(expand) << " bytes instead of " << pixels.size());
+		if (TextureLoading::GetDecodedByteSize(expand) == pixels.size())
+			TEST_CHECK(memcmp(expand.Pixels, pixels.data(), pixels.size()) == 0, name << " pixels changed");
+		TextureLoading::FreeDecodedTexture(expand);
+
+		// Grey and grey alpha become R8 and R8G8 textures
+		TextureLoading::DecodedTexture narrow = TextureLoading::DecodeTexture(file.data(), file.size(), name, TextureLoading::DecodeChannels::Narrow);
+		const DXGI_FORMAT narrowFormat = numChannels == 1 ? DXGI_FORMAT_R8_UNORM : numChannels == 2 ? DXGI_FORMAT_R8G8_UNORM : DXGI_FORMAT_R8G8B8A8_UNORM;
+		TEST_CHECK(narrow.NumChannels == numChannels && narrow.Format == narrowFormat, name << " narrowed to " << narrow.NumChannels << " channels, format " << narrow.Format);
+		TextureLoading::FreeDecodedTexture(narrow);
+	}
+}
+
+// HDR files are detected by their content, decoded as floats and create half float textures unless RGBA asks for 32 bit floats.
+// Decoding on the JobPool gives the same results as decoding serially.
+TEST(ImageDecodeFiles)
+{
+	const std::filesystem::path folder = std::filesystem::temp_directory_path();
+	const std::string pngPath = (folder / "image_decode_test.png").string();
+	const std::string hdrPath = (folder / "image_decode_test.hdr").string();
+
+	const std::vector<uint8_t> pixels = MakeImage(3);
+	std::vector<float> hdrPixels(pixels.size());
+	for (size_t i = 0; i < pixels.size(); i++) hdrPixels[i] = 0.1f + pixels[i] / 64.0f;
+
+	const bool written = stbi_write_png(pngPath.c_str(), ImageWidth, ImageHeight, 3, pixels.data(), ImageWidth * 3) && stbi_write_hdr(hdrPath.c_str(), ImageWidth, ImageHeight, 3, hdrPixels.data());
+	TEST_CHECK(written, "failed to write test images to " << folder.string());
+	if (!written) return;
+
+	TEST_CHECK(TextureLoading::IsHDRFile(hdrPath), hdrPath << " not detected as HDR");
+	TEST_CHECK(!TextureLoading::IsHDRFile(pngPath), pngPath << " detected as HDR");
+
+	TextureLoading::DecodedTexture expand = TextureLoading::DecodeTextureHDR(hdrPath, TextureLoading::DecodeChannels::Expand);
+	TEST_CHECK(expand.IsHDR && expand.NumChannels == 3 && expand.Format == DXGI_FORMAT_R16G16B16A16_FLOAT, "HDR decoded to " << expand.NumChannels << " channels, format " << expand.Format);
+	if (TextureLoading::GetDecodedByteSize(expand) == hdrPixels.size() * sizeof(float))
+	{
+		// Radiance files keep 8 bits of mantissa per channel with an exponent shared by the texel
+		float maxError = 0.0f;
+		const float* decoded = static_cast<const float*>(expand.Pixels);
+		for (size_t i = 0; i < hdrPixels.size(); i++)
+		{
+			const size_t texel = i - i % 3;
+			const float texelMax = std::max({ hdrPixels[texel], hdrPixels[texel + 1], hdrPixels[texel + 2] });
+			maxError = std::max(maxError, std::abs(decoded[i] - hdrPixels[i]) / texelMax);
+		}
+		TEST_CHECK(maxError < 0.01f, "HDR values off by " << maxError * 100.0f << "%");
+	}
+	TextureLoading::FreeDecodedTexture(expand);
+
+	TextureLoading::DecodedTexture rgba = TextureLoading::DecodeTextureHDR(hdrPath, TextureLoading::DecodeChannels::RGBA);
+	TEST_CHECK(rgba.IsHDR && rgba.NumChannels == 4 && rgba.Format == DXGI_FORMAT_R32G32B32A32_FLOAT, "HDR decoded as RGBA to " << rgba.NumChannels << " channels, format " << rgba.Format);
+	TextureLoading::FreeDecodedTexture(rgba);
+
+	const std::vector<std::string> paths = { pngPath, hdrPath, pngPath, hdrPath };
+	std::vector<TextureLoading::DecodedTexture> parallel = TextureLoading::DecodeTextures(paths, TextureLoading::DecodeChannels::Expand);
+	TEST_CHECK(parallel.size() == paths.size(), parallel.size() << " decoded images for " << paths.size() << " paths");
+	for (size_t i = 0; i < parallel.size(); i++)
+	{
+		TextureLoading::DecodedTexture serial = TextureLoading::IsHDRFile(paths[i]) ? TextureLoading::DecodeTextureHDR(paths[i], TextureLoading::DecodeChannels::Expand) : TextureLoading::DecodeTexture(paths[i], TextureLoading::DecodeChannels::Expand);
+		const uint64_t byteSize = TextureLoading::GetDecodedByteSize(serial);
+		TEST_CHECK(parallel[i].Format == serial.Format && TextureLoading::GetDecodedByteSize(parallel[i]) == byteSize && memcmp(parallel[i].Pixels, serial.Pixels, byteSize) == 0,
+			paths[i] << " decoded on the JobPool doesn't match the serial decode");
+		TextureLoading::FreeDecodedTexture(serial);
+		TextureLoading::FreeDecodedTexture(parallel[i]);
+	}
+
+	std::filesystem::remove(pngPath);
+	std::filesystem::remove(hdrPath);
+}
+
+// Decodes the PNG, JPG and HDR images of the repo serially and on the JobPool, decoded MB/s are logged
+BENCHMARK(ImageDecode)
+{
+	constexpr const char* ImageFolders[] = { "Application", "Images" };
+	constexpr const char* ImageExtensions[] = { ".png", ".jpg", ".jpeg", ".hdr" };
+
+	std::vector<std::string> paths;
+	uint64_t fileBytes = 0;
+	uint32_t numFilesPerExtension[STATIC_ARRAY_SIZE(ImageExtensions)] = {};
+	for (const char* folder : ImageFolders)
+	{
+		std::error_code error;
+		for (const auto& entry : std::filesystem::recursive_directory_iterator(folder, error))
+		{
+			if (!entry.is_regular_file()) continue;
+
+			std::string extension = entry.path().extension().string();
+			std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char) std::tolower(c); });
+			for (uint32_t i = 0; i < STATIC_ARRAY_SIZE(ImageExtensions); i++)
+			{
+				if (extension != ImageExtensions[i]) continue;
+
+				paths.push_back(entry.path().string());
+				fileBytes += entry.file_size();
+				numFilesPerExtension[i]++;
+			}
+		}
+	}
+
+	if (paths.empty())
+	{
+		std::cout << "[Tests]   No images found, run from the solution folder" << std::endl;
+		return;
+	}
+
+	std::cout << "[Tests]   Decoding " << paths.size() << " images (" << numFilesPerExtension[0] << " png, " << numFilesPerExtension[1] + numFilesPerExtension[2] << " jpg, "
+		<< numFilesPerExtension[3] << " hdr), " << fileBytes / (1024.0f * 1024.0f) << " MB of files" << std::endl;
+
+	const auto decodeSerial = [&paths](TextureLoading::DecodeChannels channels)
+	{
+		std::vector<TextureLoading::DecodedTexture> decodedTextures;
+		for (const std::string& path : paths)
+			decodedTextures.push_back(TextureLoading::IsHDRFile(path) ? TextureLoading::DecodeTextureHDR(path, channels) : TextureLoading::DecodeTexture(path, channels));
+		return decodedTextures;
+	};
+
+	const auto report = [&](const char* name, std::vector<TextureLoading::DecodedTexture>& decodedTextures, float timeMS)
+	{
+		uint64_t decodedBytes = 0;
+		for (TextureLoading::DecodedTexture& decodedTexture : decodedTextures)
+		{
+			decodedBytes += TextureLoading::GetDecodedByteSize(decodedTexture);
+			TextureLoading::FreeDecodedTexture(decodedTexture);
+		}
+
+		const float decodedMB = decodedBytes / (1024.0f * 1024.0f);
+		std::cout << "[Tests]   " << name << ": " << timeMS << " ms, " << decodedMB << " MB decoded, " << decodedMB * 1000.0f / MAX(timeMS, 0.001f) << " MB/s decoded, "
+			<< fileBytes / (1024.0f * 1024.0f) * 1000.0f / MAX(timeMS, 0.001f) << " MB/s of files" << std::endl;
+	};
+
+	// Warms up the file cache so every pass measures only decoding
+	std::vector<TextureLoading::DecodedTexture> decodedTextures = decodeSerial(TextureLoading::DecodeChannels::Expand);
+	for (TextureLoading::DecodedTexture& decodedTexture : decodedTextures) TextureLoading::FreeDecodedTexture(decodedTexture);
+
+	Timer timer;
+	timer.Start();
+	decodedTextures = decodeSerial(TextureLoading::DecodeChannels::RGBA);
+	timer.Stop();
+	report("Serial, expanded to RGBA by the decoder", decodedTextures, timer.GetTimeMS());
+
+	timer.Start();
+	decodedTextures = decodeSerial(TextureLoading::DecodeChannels::Expand);
+	timer.Stop();
+	report("Serial, image channels", decodedTextures, timer.GetTimeMS());
+
+	timer.Start();
+	decodedTextures = TextureLoading::DecodeTextures(paths, TextureLoading::DecodeChannels::Expand);
+	timer.Stop();
+	report(("JobPool with " + std::to_string(JobPool::Get()->GetThreadCount() + 1) + " threads, image channels").c_str(), decodedTextures, timer.GetTimeMS());
+}
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <functional>
+
+#include <Engine/Render/Context.h>
+#include <Engine/Render/Shader.h>
+#include <Engine/Render/Texture.h>
+#include <Engine/Utility/Timer.h>
+
+#include "Test.h"
+
+namespace
+{
+	// Only formats and creation flags of the targets go into the hash, so they don't need GPU resources
+	struct PipelineTargets
+	{
+		PipelineTargets()
+		{
+			Color.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+			OtherColor.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+			ColorHDR.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+			ColorMSAA.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+			ColorMSAA.CreationFlags = RCF::MSAA_X4;
+			Depth.Format = DXGI_FORMAT_D32_FLOAT;
+		}
+
+		Texture Color{};
+		Texture OtherColor{};
+		Texture ColorHDR{};
+		Texture ColorMSAA{};
+		Texture Depth{};
+	};
+
+	void SetupState(GraphicsState& state, Shader* shader, PipelineTargets& targets)
+	{
+		state.Shader = shader;
+		state.ShaderConfig = { "APPLY_SKIN", "QUANTIZED_VERTICES" };
+		state.RenderTargets[0] = &targets.Color;
+		state.DepthStencil = &targets.Depth;
+		state.DepthStencilState.DepthEnable = true;
+	}
+}
+
+// Hash doesn't depend on the uninitialized padding of the D3D12 descs, changes to anything the pipeline is built from give a new hash and the rest of the state doesn't
+TEST(PipelineHashStable)
+{
+	Shader shader("Application/Animation/geometry.hlsl");
+	PipelineTargets targets;
+
+	// Same state built on memory filled with different bytes, padding of the D3D12 descs keeps whatever was there
+	alignas(GraphicsState) uint8_t zeroedMemory[sizeof(GraphicsState)];
+	alignas(GraphicsState) uint8_t filledMemory[sizeof(GraphicsState)];
+	memset(zeroedMemory, 0x00, sizeof(GraphicsState));
+	memset(filledMemory, 0xCD, sizeof(GraphicsState));
+
+	GraphicsState* states[] = { new (zeroedMemory) GraphicsState{}, new (filledMemory) GraphicsState{} };
+	for (GraphicsState* state : states) SetupState(*state, &shader, targets);
+
+	const bool paddingDiffers = memcmp(&states[0]->BlendState, &states[1]->BlendState, sizeof(D3D12_BLEND_DESC)) != 0 ||
+		memcmp(&states[0]->DepthStencilState, &states[1]->DepthStencilState, sizeof(D3D12_DEPTH_STENCIL_DESC)) != 0;
+	const uint64_t paddingHashes[] = { GFX::GetPipelineHash(*states[0]), GFX::GetPipelineHash(*states[1]) };
+	for (GraphicsState* state : states) state->~GraphicsState();
+
+	TEST_CHECK(paddingDiffers, "descs have no padding, the check below proves nothing");
+	TEST_CHECK(paddingHashes[0] == paddingHashes[1], "hash differs between states that only differ in padding bytes");
+
+	struct Variation
+	{
+		const char* Name;
+		std::function<void(GraphicsState&)> Change;
+		bool ChangesPipeline;
+	};
+	const Variation variations[] = {
+		{ "Depth test off", [](GraphicsState& state) { state.DepthStencilState.DepthEnable = false; }, true },
+		{ "Blending", [](GraphicsState& state) { state.BlendState.RenderTarget[0].BlendEnable = true; }, true },
+		{ "Cull mode", [](GraphicsState& state) { state.RasterizerState.CullMode = D3D12_CULL_MODE_BACK; }, true },
+		{ "Line list", [](GraphicsState& state) { state.PrimitiveType = RenderPrimitiveType::LineList; }, true },
+		{ "Render target format", [&targets](GraphicsState& state) { state.RenderTargets[0] = &targets.ColorHDR; }, true },
+		{ "Second render target", [&targets](GraphicsState& state) { state.RenderTargets[1] = &targets.Color; }, true },
+		{ "MSAA", [&targets](GraphicsState& state) { state.RenderTargets[0] = &targets.ColorMSAA; }, true },
+		{ "No depth target", [](GraphicsState& state) { state.DepthStencil = nullptr; }, true },
+		{ "Shader defines", [](GraphicsState& state) { state.ShaderConfig = { "QUANTIZED_VERTICES" }; }, true },
+		{ "Push constants", [](GraphicsState& state) { state.PushConstantCount = 4; }, true },
+		{ "Other render target with the same format", [&targets](GraphicsState& state) { state.RenderTargets[0] = &targets.OtherColor; }, false },
+		{ "Stencil reference", [](GraphicsState& state) { state.StencilRef = 7; }, false },
+		{ "Custom viewport", [](GraphicsState& state) { state.UseCustomViewport = true; state.CustomViewport = { 0.0f, 0.0f, 64.0f, 64.0f, 0.0f, 1.0f }; }, false },
+		{ "Unsorted defines", [](GraphicsState& state) { state.ShaderConfig = { "QUANTIZED_VERTICES", "APPLY_SKIN" }; }, false },
+	};
+
+	GraphicsState baseState;
+	SetupState(baseState, &shader, targets);
+	const uint64_t baseHash = GFX::GetPipelineHash(baseState);
+	TEST_CHECK(baseHash == GFX::GetPipelineHash(baseState), "hash of the same state changed");
+
+	std::vector<uint64_t> pipelineHashes = { baseHash };
+	for (const Variation& variation : variations)
+	{
+		GraphicsState state;
+		SetupState(state, &shader, targets);
+		variation.Change(state);
+
+		const uint64_t hash = GFX::GetPipelineHash(state);
+		if (variation.ChangesPipeline)
+		{
+			TEST_CHECK(std::find(pipelineHashes.begin(), pipelineHashes.end(), hash) == pipelineHashes.end(), variation.Name << " has the hash of another pipeline");
+			pipelineHashes.push_back(hash);
+		}
+		else
+		{
+			TEST_CHECK(hash == baseHash, variation.Name << " changed the hash");
+		}
+	}
+}
+
+// Per draw cost of the pipeline key, the shader is compiled before timing
+BENCHMARK(PipelineHash)
+{
+	constexpr uint32_t NumHashes = 100000;
+
+	Shader shader("Application/Animation/geometry.hlsl");
+	PipelineTargets targets;
+	GraphicsState state;
+	SetupState(state, &shader, targets);
+	GFX::GetPipelineHash(state);
+
+	Timer timer;
+	timer.Start();
+	for (uint32_t i = 0; i < NumHashes; i++) GFX::GetPipelineHash(state);
+	timer.Stop();
+
+	std::cout << "[Tests]   " << timer.GetTimeMS() * 1000000.0f / NumHashes << " ns per hash" << std::endl;
+}
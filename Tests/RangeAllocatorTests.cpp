@@ -0,0 +1,292 @@
+#include <filesystem>
+#include <list>
+#include <unordered_map>
+
+#include <Engine/Render/DescriptorHeap.h>
+#include <Engine/Utility/MemoryStrategies.h>
+#include <Engine/Utility/Random.h>
+#include <Engine/Utility/Timer.h>
+
+#include "Test.h"
+
+// Previous RangeStrategy: first fit over a list of released ranges that are never merged.
+// Only here to compare RangeStrategy against in the replays.
+class FirstFitRangeStrategy
+{
+public:
+	FirstFitRangeStrategy(size_t numElements):
+		m_NumElements(numElements) {}
+
+	RangeAllocation Allocate(size_t numElements)
+	{
+		if (numElements == 0) return { 0,0 };
+		
+		RangeAllocation alloc{};
+		for (auto it = m_FreeRanges.begin(); it != m_FreeRanges.end(); it++)
+		{
+			RangeAllocation& candidate = *it;
+			if (candidate.NumElements == numElements)
+			{
+				alloc = candidate;
+				m_FreeRanges.erase(it);
+				break;
+			}
+			else if (candidate.NumElements > numElements)
+			{
+				alloc.Start = candidate.Start;
+				alloc.NumElements = numElements;
+
+				candidate.Start += numElements;
+				candidate.NumElements -= numElements;
+				break;
+			}
+		}
+
+		if (alloc.NumElements == INVALID_ALLOCATION && m_NextAllocation + numElements <= m_NumElements)
+		{
+			alloc.Start = m_NextAllocation;
+			alloc.NumElements = numElements;
+			m_NextAllocation += numElements;
+		}
+
+		return alloc;
+	}
+
+	void Release(RangeAllocation& alloc)
+	{
+		if (alloc.NumElements != 0 && alloc.NumElements != INVALID_ALLOCATION)
+			m_FreeRanges.push_back(alloc);
+		
+		alloc.Start = INVALID_ALLOCATION;
+		alloc.NumElements = INVALID_ALLOCATION;
+	}
+
+	void Clear()
+	{
+		m_FreeRanges.clear();
+		m_NextAllocation = 0;
+	}
+
+	float GetFragmentation() const
+	{
+		size_t freeElements = m_NumElements - m_NextAllocation;
+		size_t largest = freeElements;
+		for (const RangeAllocation& range : m_FreeRanges)
+		{
+			freeElements += range.NumElements;
+			largest = std::max(largest, range.NumElements);
+		}
+		return freeElements ? 1.0f - (float) largest / freeElements : 0.0f;
+	}
+
+private:
+	size_t m_NumElements = 0;
+	size_t m_NextAllocation = 0;
+	std::list<RangeAllocation> m_FreeRanges = {};
+};
+
+// Randomized check of RangeStrategy against a map of used elements
+TEST(RangeStrategyRandomOperations)
+{
+	constexpr size_t NumElements = 4096;
+	constexpr uint32_t NumOps = 1000000;
+
+	RangeStrategy strategy(NumElements);
+	std::vector<uint8_t> used(NumElements, 0);
+	std::vector<RangeAllocation> live;
+
+	const auto hasFreeRun = [&used](size_t numElements)
+	{
+		size_t run = 0;
+		for (uint8_t element : used)
+		{
+			run = element ? 0 : run + 1;
+			if (run >= numElements) return true;
+		}
+		return false;
+	};
+
+	uint32_t numOverlaps = 0;
+	uint32_t numWrongFailures = 0;
+	uint32_t numWrongCounts = 0;
+	size_t usedElements = 0;
+	for (uint32_t op = 0; op < NumOps; op++)
+	{
+		if (live.empty() || Random::UInt(0, 99) < 52)
+		{
+			const size_t numElements = Random::UInt(0, 9) ? Random::UInt(1, 8) : Random::UInt(9, 512);
+			RangeAllocation alloc = strategy.Allocate(numElements);
+			if (alloc.Start == INVALID_ALLOCATION)
+			{
+				// Failing is only fine when no free range is big enough
+				numWrongFailures += hasFreeRun(numElements);
+				continue;
+			}
+
+			numOverlaps += alloc.Start + alloc.NumElements > NumElements;
+			for (size_t i = alloc.Start; i < std::min(alloc.Start + alloc.NumElements, NumElements); i++)
+			{
+				numOverlaps += used[i];
+				used[i] = 1;
+			}
+			usedElements += alloc.NumElements;
+			live.push_back(alloc);
+		}
+		else
+		{
+			const uint32_t index = Random::UInt(0, (uint32_t) live.size() - 1);
+			RangeAllocation alloc = live[index];
+			live[index] = live.back();
+			live.pop_back();
+
+			for (size_t i = alloc.Start; i < alloc.Start + alloc.NumElements; i++) used[i] = 0;
+			usedElements -= alloc.NumElements;
+			strategy.Release(alloc);
+		}
+		numWrongCounts += strategy.GetFreeElements() != NumElements - usedElements;
+	}
+
+	TEST_CHECK(numOverlaps == 0, numOverlaps << " overlapping ranges");
+	TEST_CHECK(numWrongFailures == 0, numWrongFailures << " failures with a free range big enough");
+	TEST_CHECK(numWrongCounts == 0, numWrongCounts << " wrong free counts");
+
+	// Every range is merged back into one
+	for (RangeAllocation& alloc : live) strategy.Release(alloc);
+	TEST_CHECK(strategy.GetFreeElements() == NumElements, strategy.GetFreeElements() << " free elements at the end");
+	TEST_CHECK(strategy.GetLargestFreeRange() == NumElements, "largest free range of " << strategy.GetLargestFreeRange() << " at the end");
+	TEST_CHECK(strategy.GetFragmentation() == 0.0f, "fragmentation of " << strategy.GetFragmentation() << " at the end");
+}
+
+// Replays heap traces on TLSF and on the previous first fit list, timings and fragmentation are logged.
+// Traces of the device heaps are replayed when the app ran with TRACEDESCRIPTORS, a synthetic one always.
+BENCHMARK(RangeAllocatorReplays)
+{
+	// Replays reference allocations by index so the timings don't include looking up starts
+	struct TraceOp
+	{
+		uint32_t Allocation;
+		uint32_t NumElements;
+		bool Release;
+	};
+
+	struct Trace
+	{
+		std::string Name;
+		size_t NumElements;
+		uint32_t NumAllocations = 0;
+		std::vector<TraceOp> Ops;
+	};
+
+	std::vector<Trace> traces;
+
+	std::vector<DescriptorHeapTrace> heapTraces;
+	if (std::filesystem::exists(DESCRIPTOR_TRACE_PATH) && ReadDescriptorTraces(DESCRIPTOR_TRACE_PATH, heapTraces))
+	{
+		for (const DescriptorHeapTrace& heapTrace : heapTraces)
+		{
+			if (heapTrace.Events.empty()) continue;
+
+			Trace trace{ heapTrace.Name, heapTrace.NumDescriptors };
+			std::unordered_map<size_t, uint32_t> liveAllocations;
+			for (const DescriptorTraceEvent& event : heapTrace.Events)
+			{
+				if (!event.Release)
+				{
+					liveAllocations[event.Start] = trace.NumAllocations;
+					trace.Ops.push_back({ trace.NumAllocations++, (uint32_t) event.NumDescriptors, false });
+				}
+				else if (liveAllocations.contains(event.Start))
+				{
+					trace.Ops.push_back({ liveAllocations[event.Start], (uint32_t) event.NumDescriptors, true });
+					liveAllocations.erase(event.Start);
+				}
+			}
+			traces.push_back(std::move(trace));
+		}
+	}
+	else
+	{
+		std::cout << "[Tests]   No descriptor heap traces, run the app with TRACEDESCRIPTORS to replay them" << std::endl;
+	}
+
+	// Streaming-like churn on a heap the size of the SRV heap: mostly single descriptors, some tables and a few big bindless ranges, kept around 75% full
+	{
+		Trace trace{ "Synthetic", 20 * 1024 };
+		std::vector<std::pair<uint32_t, uint32_t>> live;
+		size_t liveElements = 0;
+		for (uint32_t op = 0; op < 200000; op++)
+		{
+			const uint32_t roll = Random::UInt(0, 99);
+			const uint32_t numElements = roll < 70 ? 1 : roll < 90 ? Random::UInt(2, 8) : roll < 98 ? Random::UInt(9, 64) : Random::UInt(65, 1024);
+			if (live.empty() || (Random::UInt(0, 1) && liveElements + numElements <= trace.NumElements * 3 / 4))
+			{
+				live.push_back({ trace.NumAllocations, numElements });
+				liveElements += numElements;
+				trace.Ops.push_back({ trace.NumAllocations++, numElements, false });
+			}
+			else
+			{
+				const uint32_t index = Random::UInt(0, (uint32_t) live.size() - 1);
+				trace.Ops.push_back({ live[index].first, live[index].second, true });
+				liveElements -= live[index].second;
+				live[index] = live.back();
+				live.pop_back();
+			}
+		}
+		traces.push_back(std::move(trace));
+	}
+
+	for (const Trace& trace : traces)
+	{
+		const auto replay = [&trace](auto& strategy, bool measureFragmentation, float& worstFragmentation, uint32_t& numFailed)
+		{
+			std::vector<RangeAllocation> allocations(trace.NumAllocations);
+			for (uint32_t op = 0; op < trace.Ops.size(); op++)
+			{
+				const TraceOp& traceOp = trace.Ops[op];
+				RangeAllocation& alloc = allocations[traceOp.Allocation];
+				if (!traceOp.Release)
+				{
+					alloc = strategy.Allocate(traceOp.NumElements);
+					numFailed += alloc.Start == INVALID_ALLOCATION;
+				}
+				else if (alloc.Start != INVALID_ALLOCATION)
+				{
+					strategy.Release(alloc);
+				}
+
+				// Every 16 operations, the first fit fragmentation walks the whole list
+				if (measureFragmentation && op % 16 == 0) worstFragmentation = std::max(worstFragmentation, strategy.GetFragmentation());
+			}
+		};
+
+		const auto measure = [&](auto& strategy, float& nsPerOp, float& worstFragmentation, uint32_t& numFailed)
+		{
+			replay(strategy, true, worstFragmentation, numFailed);
+
+			const uint32_t numRepeats = std::max(1u, 2000000u / (uint32_t) trace.Ops.size());
+			float unusedFragmentation = 0.0f;
+			uint32_t unusedFailed = 0;
+			Timer timer;
+			timer.Start();
+			for (uint32_t i = 0; i < numRepeats; i++)
+			{
+				strategy.Clear();
+				replay(strategy, false, unusedFragmentation, unusedFailed);
+			}
+			timer.Stop();
+			nsPerOp = timer.GetTimeMS() * 1000000.0f / (numRepeats * trace.Ops.size());
+		};
+
+		RangeStrategy tlsf(trace.NumElements);
+		FirstFitRangeStrategy firstFit(trace.NumElements);
+		float tlsfNS, firstFitNS;
+		float tlsfFragmentation = 0.0f, firstFitFragmentation = 0.0f;
+		uint32_t tlsfFailed = 0, firstFitFailed = 0;
+		measure(tlsf, tlsfNS, tlsfFragmentation, tlsfFailed);
+		measure(firstFit, firstFitNS, firstFitFragmentation, firstFitFailed);
+
+		std::cout << "[Tests]   " << trace.Name << " (" << trace.Ops.size() << " operations on " << trace.NumElements << " descriptors): TLSF " << tlsfNS << " ns per operation, worst fragmentation "
+			<< tlsfFragmentation << ", " << tlsfFailed << " failed allocations; first fit " << firstFitNS << " ns, worst fragmentation " << firstFitFragmentation << ", " << firstFitFailed << " failed" << std::endl;
+	}
+}
@@ -0,0 +1,75 @@
+#include <Engine/Render/Device.h>
+#include <Engine/Render/Context.h>
+#include <Engine/Render/Commands.h>
+#include <Engine/Loading/ModelLoading.h>
+#include <Engine/Loading/SceneCooking.h>
+#include <Engine/Loading/TextureCache.h>
+#include <Engine/System/ApplicationConfiguration.h>
+#include <Engine/Utility/Timer.h>
+
+#include <psapi.h>
+
+#include "Test.h"
+
+namespace
+{
+	float GetPeakWorkingSetMB()
+	{
+		PROCESS_MEMORY_COUNTERS memoryCounters{};
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters))) return 0.0f;
+		return static_cast<float>(memoryCounters.PeakWorkingSetSize) / (1024.0f * 1024.0f);
+	}
+
+	// Load including the upload, the scene is freed afterwards so the next load starts without cached textures
+	void MeasureLoad(const std::string& path, const char* label)
+	{
+		GraphicsContext& context = ContextManager::Get().GetCreationContext();
+		const float peakBefore = GetPeakWorkingSetMB();
+
+		Timer timer;
+		timer.Start();
+		GFX::Cmd::BeginRecording(context);
+		ModelLoading::Loader loader{ context };
+		ModelLoading::Scene scene = loader.Load(path);
+		GFX::Cmd::EndRecordingAndSubmit(context);
+		GFX::Cmd::WaitToFinish(context);
+		timer.Stop();
+
+		const float peakAfter = GetPeakWorkingSetMB();
+		std::cout << "[Tests]   " << label << " " << path << ": " << scene.Objects.size() << " objects in " << timer.GetTimeMS() << " ms, peak working set " << peakAfter
+			<< " MB (+" << peakAfter - peakBefore << " MB)" << std::endl;
+
+		ModelLoading::Free(scene);
+		ContextManager::Get().Flush();
+	}
+}
+
+// Sample scenes loaded by parsing the glTF and from the cooked scene.
+// Peak working set only grows during the process, so the cooked scene is loaded first and the growth is logged next to the peak.
+DEVICE_BENCHMARK(SceneLoading)
+{
+	const char* scenePaths[] = {
+		"Application/Meshlets/Resources/Dragon/DragonAttenuation.gltf",
+		"Application/Animation/Resources/scene.gltf",
+	};
+
+	TextureCache::Init();
+
+	for (const char* scenePath : scenePaths)
+	{
+		const std::string cookedPath = SceneCooking::GetCookedPath(scenePath);
+		if (!SceneCooking::IsCookedSceneUpToDate(cookedPath, scenePath))
+		{
+			ModelLoading::Loader loader{ ContextManager::Get().GetCreationContext() };
+			TEST_CHECK(loader.Cook(scenePath, cookedPath), "failed to cook " << scenePath);
+		}
+
+		MeasureLoad(cookedPath, "Cooked");
+
+		AppConfig.Settings.insert("NOCOOKEDSCENES");
+		MeasureLoad(scenePath, "glTF");
+		AppConfig.Settings.erase("NOCOOKEDSCENES");
+	}
+
+	TextureCache::Destroy();
+}
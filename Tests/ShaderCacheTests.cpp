@@ -0,0 +1,138 @@
+#include <filesystem>
+
+#include <Engine/Render/Shader.h>
+#include <Engine/Utility/Timer.h>
+
+#include "Test.h"
+
+namespace
+{
+	const std::string CachePath = (std::filesystem::temp_directory_path() / "shader_cache_test.dxcache").string();
+
+	bool SameBytecode(const CompiledShader& a, const CompiledShader& b)
+	{
+		return a.BytecodeHash == b.BytecodeHash && a.InputLayoutHash == b.InputLayoutHash;
+	}
+}
+
+// Misses are stored, the same implementation hits afterwards and gets the bytecode of a compile from source, also after the cache file is read back
+TEST(ShaderCacheHits)
+{
+	std::filesystem::remove(CachePath);
+	GFX::InitShaderCompiler(CachePath);
+
+	Shader shader("Engine/Render/copy.hlsl");
+	const std::vector<std::string> defines = {};
+	const std::vector<std::string> otherDefines = { "SHADER_CACHE_TEST" };
+
+	ShaderCacheStats before = GFX::GetShaderCacheStats();
+	TEST_CHECK(before.NumLoadedEntries == 0, before.NumLoadedEntries << " entries loaded from a new cache");
+
+	CompiledShader fromSource;
+	TEST_CHECK(GFX::CompileShaderImplementation(&shader, defines, VS | PS, false, fromSource), shader.Path << " failed to compile");
+	ShaderCacheStats after = GFX::GetShaderCacheStats();
+	TEST_CHECK(after.NumHits == before.NumHits && after.NumMisses == before.NumMisses, "compile without the cache counted as a lookup");
+
+	CompiledShader miss;
+	GFX::CompileShaderImplementation(&shader, defines, VS | PS, true, miss);
+	after = GFX::GetShaderCacheStats();
+	TEST_CHECK(after.NumMisses == before.NumMisses + 1 && after.NumHits == before.NumHits, "first lookup: " << after.NumHits - before.NumHits << " hits, " << after.NumMisses - before.NumMisses << " misses");
+	TEST_CHECK(SameBytecode(miss, fromSource), "bytecode of a miss differs from the compile from source");
+
+	CompiledShader hit;
+	before = GFX::GetShaderCacheStats();
+	GFX::CompileShaderImplementation(&shader, defines, VS | PS, true, hit);
+	after = GFX::GetShaderCacheStats();
+	TEST_CHECK(after.NumHits == before.NumHits + 1 && after.NumMisses == before.NumMisses, "second lookup: " << after.NumHits - before.NumHits << " hits, " << after.NumMisses - before.NumMisses << " misses");
+	TEST_CHECK(SameBytecode(hit, fromSource), "bytecode of a hit differs from the compile from source");
+	TEST_CHECK(hit.Vertex.BytecodeLength && hit.Pixel.BytecodeLength && !hit.Compute.BytecodeLength, "stages of a hit don't match the requested ones");
+
+	// Defines are part of the key, even ones the source doesn't use
+	CompiledShader otherImplementation;
+	before = GFX::GetShaderCacheStats();
+	GFX::CompileShaderImplementation(&shader, otherDefines, VS | PS, true, otherImplementation);
+	after = GFX::GetShaderCacheStats();
+	TEST_CHECK(after.NumMisses == before.NumMisses + 1, "implementation with other defines hit the cache");
+
+	// Cache file written on destroy is loaded on the next init
+	GFX::DestroyShaderCompiler();
+	GFX::InitShaderCompiler(CachePath);
+
+	before = GFX::GetShaderCacheStats();
+	TEST_CHECK(before.NumLoadedEntries == 2, before.NumLoadedEntries << " entries loaded instead of 2");
+
+	CompiledShader loaded;
+	GFX::CompileShaderImplementation(&shader, defines, VS | PS, true, loaded);
+	after = GFX::GetShaderCacheStats();
+	TEST_CHECK(after.NumHits == before.NumHits + 1, "entry loaded from " << CachePath << " wasn't hit");
+	TEST_CHECK(SameBytecode(loaded, fromSource), "bytecode loaded from the cache file differs from the compile from source");
+
+	GFX::DestroyShaderCompiler();
+	std::filesystem::remove(CachePath);
+}
+
+// Permutations the samples list, compiled from source and then through a cache that has all of them, timings are logged
+BENCHMARK(ShaderCache)
+{
+	struct ShaderCase
+	{
+		const char* Path;
+		std::vector<std::vector<std::string>> DefineGroups;
+		uint32_t ShaderStages;
+	};
+	const ShaderCase cases[] = {
+		{ "Engine/Render/copy.hlsl", {}, VS | PS },
+		{ "Application/Animation/geometry.hlsl", { { "", "QUANTIZED_VERTICES" }, { "", "APPLY_MORPHS" }, { "", "APPLY_SKIN" } }, VS | PS },
+		{ "Application/Animation/background.hlsl", {}, VS | PS },
+		{ "Application/Animation/morph_blend.hlsl", { { "", "CLEAR" } }, CS },
+		{ "Application/PBR/Shaders/pbr.hlsl", { { "", "BRDF_Lambert" }, { "", "Illumination_Directional", "Illumination_Point" }, { "", "Fresnel_Shlick" } }, VS | PS },
+	};
+
+	std::vector<ScopedRef<Shader>> shaders;
+	for (const ShaderCase& shaderCase : cases)
+	{
+		Shader* shader = shaders.emplace_back(new Shader(shaderCase.Path)).get();
+		shader->AddPermutations(shaderCase.DefineGroups, shaderCase.ShaderStages);
+	}
+
+	std::filesystem::remove(CachePath);
+	GFX::InitShaderCompiler(CachePath);
+
+	const auto compileAll = [&shaders](bool useCache, Timer& timer)
+	{
+		uint32_t numFailed = 0;
+		timer.Start();
+		for (const ScopedRef<Shader>& shader : shaders)
+		{
+			for (const ShaderPermutation& permutation : shader->Permutations)
+			{
+				CompiledShader compiledShader;
+				numFailed += GFX::CompileShaderImplementation(shader.get(), permutation.Defines, permutation.ShaderStages, useCache, compiledShader) ? 0 : 1;
+			}
+		}
+		timer.Stop();
+		return numFailed;
+	};
+
+	uint32_t numImplementations = 0;
+	for (const ScopedRef<Shader>& shader : shaders) numImplementations += (uint32_t) shader->Permutations.size();
+
+	// Cold compiles from source, the first pass through the cache fills it and the second one only hits
+	Timer coldTimer;
+	Timer fillTimer;
+	Timer warmTimer;
+	const uint32_t numFailed = compileAll(false, coldTimer);
+	compileAll(true, fillTimer);
+	const ShaderCacheStats before = GFX::GetShaderCacheStats();
+	compileAll(true, warmTimer);
+	const ShaderCacheStats after = GFX::GetShaderCacheStats();
+
+	std::cout << "[Tests]   " << numImplementations << " implementations" << (numFailed ? " (some failed to compile)" : "") << std::endl;
+	std::cout << "[Tests]   Cold compile: " << coldTimer.GetTimeMS() << " ms" << std::endl;
+	std::cout << "[Tests]   Filling the cache: " << fillTimer.GetTimeMS() << " ms" << std::endl;
+	std::cout << "[Tests]   Warm cache: " << warmTimer.GetTimeMS() << " ms, " << after.NumHits - before.NumHits << " hits, " << after.KeyTimeMS - before.KeyTimeMS << " ms hashing sources" << std::endl;
+	std::cout << "[Tests]   Speedup: " << coldTimer.GetTimeMS() / MAX(warmTimer.GetTimeMS(), 0.001f) << "x" << std::endl;
+
+	GFX::DestroyShaderCompiler();
+	std::filesystem::remove(CachePath);
+}
@@ -0,0 +1,84 @@
+#include <Engine/Render/StagingPool.h>
+#include <Engine/System/JobPool.h>
+
+#include "Test.h"
+
+// Size classes, reuse of free chunks, the free budget and chunks bigger than the biggest class
+TEST(StagingPoolAccounting)
+{
+	constexpr uint64_t Budget = 4 * StagingPool::MIN_CHUNK_SIZE;
+	StagingPool pool(true, Budget);
+
+	const uint64_t maxClassSize = StagingPool::GetClassSize(StagingPool::NUM_SIZE_CLASSES - 1);
+	TEST_CHECK(StagingPool::GetSizeClass(1) == 0, "1 byte is in class " << StagingPool::GetSizeClass(1));
+	TEST_CHECK(StagingPool::GetSizeClass(StagingPool::MIN_CHUNK_SIZE) == 0, "64KB is in class " << StagingPool::GetSizeClass(StagingPool::MIN_CHUNK_SIZE));
+	TEST_CHECK(StagingPool::GetSizeClass(StagingPool::MIN_CHUNK_SIZE + 1) == 1, "64KB + 1 is in class " << StagingPool::GetSizeClass(StagingPool::MIN_CHUNK_SIZE + 1));
+	TEST_CHECK(StagingPool::GetSizeClass(maxClassSize + 1) == StagingPool::NUM_SIZE_CLASSES, "256MB + 1 is in class " << StagingPool::GetSizeClass(maxClassSize + 1));
+
+	// Chunks fit the request and keep the placement alignment of texture copies
+	StagingPool::Chunk* small = pool.Acquire(100);
+	StagingPool::Chunk* medium = pool.Acquire(StagingPool::MIN_CHUNK_SIZE + 1);
+	TEST_CHECK(small->ByteSize == StagingPool::MIN_CHUNK_SIZE, small->ByteSize << " bytes");
+	TEST_CHECK(medium->ByteSize == 2 * StagingPool::MIN_CHUNK_SIZE, medium->ByteSize << " bytes");
+	TEST_CHECK(reinterpret_cast<uintptr_t>(small->CPUAddress) % StagingPool::CHUNK_ALIGNMENT == 0, "misaligned CPU address");
+	TEST_CHECK(small->GPUAddress % StagingPool::CHUNK_ALIGNMENT == 0, "misaligned GPU address");
+
+	StagingPool::Stats stats = pool.GetStats();
+	TEST_CHECK(stats.NumChunks == 2 && stats.NumFreeChunks == 0 && stats.NumReuses == 0, stats.NumChunks << " chunks, " << stats.NumFreeChunks << " free, " << stats.NumReuses << " reuses");
+	TEST_CHECK(stats.ChunkBytes == 3 * StagingPool::MIN_CHUNK_SIZE, stats.ChunkBytes << " bytes");
+
+	// Released chunks are handed out again for requests of their class only
+	pool.Release(small);
+	pool.Release(medium);
+	StagingPool::Chunk* reusedSmall = pool.Acquire(StagingPool::MIN_CHUNK_SIZE);
+	StagingPool::Chunk* reusedMedium = pool.Acquire(StagingPool::MIN_CHUNK_SIZE + 1000);
+	TEST_CHECK(reusedSmall == small, "small chunk not reused");
+	TEST_CHECK(reusedMedium == medium, "medium chunk not reused");
+
+	stats = pool.GetStats();
+	TEST_CHECK(stats.NumChunks == 2 && stats.NumReuses == 2 && stats.NumAcquires == 4, stats.NumChunks << " chunks, " << stats.NumReuses << " reuses of " << stats.NumAcquires << " acquires");
+
+	// Free chunks over the budget are deleted
+	StagingPool::Chunk* large = pool.Acquire(4 * StagingPool::MIN_CHUNK_SIZE);
+	pool.Release(reusedSmall);
+	pool.Release(reusedMedium);
+	pool.Release(large);
+	stats = pool.GetStats();
+	TEST_CHECK(stats.FreeBytes <= Budget, stats.FreeBytes << " free bytes over a budget of " << Budget);
+	TEST_CHECK(stats.NumChunks == 2 && stats.NumFreeChunks == 2, stats.NumChunks << " chunks, " << stats.NumFreeChunks << " free");
+
+	// Chunks bigger than the biggest class are created for one use
+	StagingPool bigPool(true, UINT64_MAX);
+	StagingPool::Chunk* huge = bigPool.Acquire(maxClassSize + 1);
+	TEST_CHECK(huge->ByteSize > maxClassSize, huge->ByteSize << " bytes");
+	bigPool.Release(huge);
+	stats = bigPool.GetStats();
+	TEST_CHECK(stats.NumChunks == 0 && stats.ChunkBytes == 0, stats.NumChunks << " chunks of " << stats.ChunkBytes << " bytes kept");
+}
+
+// Acquire and release from the job pool threads, the stats have to add up once everything is back
+TEST(StagingPoolThreads)
+{
+	constexpr uint32_t NumJobs = 256;
+	constexpr uint32_t NumAcquiresPerJob = 1000;
+
+	StagingPool pool(true);
+	JobPool::Get()->ParallelFor(NumJobs, [&pool](uint32_t job)
+	{
+		StagingPool::Chunk* held[4] = {};
+		for (uint32_t i = 0; i < NumAcquiresPerJob; i++)
+		{
+			StagingPool::Chunk*& chunk = held[i % STATIC_ARRAY_SIZE(held)];
+			if (chunk) pool.Release(chunk);
+			chunk = pool.Acquire(StagingPool::MIN_CHUNK_SIZE << ((job + i) % 3));
+			chunk->CPUAddress[0] = (uint8_t) i;
+		}
+		for (StagingPool::Chunk* chunk : held) pool.Release(chunk);
+	});
+
+	const StagingPool::Stats stats = pool.GetStats();
+	TEST_CHECK(stats.NumChunks == stats.NumFreeChunks, stats.NumChunks - stats.NumFreeChunks << " chunks not returned");
+	TEST_CHECK(stats.ChunkBytes == stats.FreeBytes, stats.ChunkBytes - stats.FreeBytes << " bytes not returned");
+	TEST_CHECK(stats.NumAcquires == NumJobs * NumAcquiresPerJob, stats.NumAcquires << " acquires");
+	TEST_CHECK(stats.NumAcquires - stats.NumReuses == stats.NumChunks, stats.NumAcquires - stats.NumReuses << " chunks created but " << stats.NumChunks << " in the pool");
+}
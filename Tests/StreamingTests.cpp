@@ -0,0 +1,130 @@
+#include <filesystem>
+
+#include <Engine/Loading/TextureLoading.h>
+#include <Engine/Loading/TextureStreaming.h>
+#include <Engine/Utility/Timer.h>
+
+#include "Test.h"
+
+namespace
+{
+	// Recorded by the Animation sample with "Record requests"
+	constexpr const char* RecordedLogPath = "Application/Animation/Resources/texture_requests.rqlog";
+
+	// Groups of textures come into view and leave it again, sizes on screen change every frame like with a moving camera
+	TextureStreaming::RequestLog MakeSyntheticLog()
+	{
+		constexpr uint32_t NumTextures = 64;
+		constexpr uint32_t NumGroups = 4;
+		constexpr uint32_t FramesPerGroup = 50;
+
+		TextureStreaming::RequestLog log{};
+		log.NumFrames = 800;
+		for (uint32_t texture = 0; texture < NumTextures; texture++)
+		{
+			const uint32_t size = 256u << (texture % 4);
+			log.Textures.push_back({ size, size / (1 + texture % 2), TextureLoading::GetNumMips(size, size / (1 + texture % 2)) });
+		}
+
+		for (uint32_t frame = 0; frame < log.NumFrames; frame++)
+		{
+			const uint32_t visibleGroup = (frame / FramesPerGroup) % NumGroups;
+			for (TextureStreaming::TextureID texture = 0; texture < NumTextures; texture++)
+			{
+				if (texture % NumGroups != visibleGroup) continue;
+
+				const float screenSize = (float) (32 + (frame * 7 + texture * 131) % 2048);
+				log.Requests.push_back({ frame, texture, screenSize });
+			}
+		}
+		return log;
+	}
+
+	uint64_t GetFullChainBytes(const TextureStreaming::RequestLog& log)
+	{
+		uint64_t byteSize = 0;
+		for (const TextureStreaming::RequestLog::TextureDesc& desc : log.Textures)
+		{
+			for (uint32_t mipIndex = 0; mipIndex < desc.NumMips; mipIndex++) byteSize += TextureLoading::GetMipByteSize(desc.Width, desc.Height, mipIndex);
+		}
+		return byteSize;
+	}
+}
+
+// Residency invariants hold at every budget, small budgets evict and a budget that fits everything never does. Logs survive the file round trip.
+TEST(StreamingReplay)
+{
+	const TextureStreaming::RequestLog log = MakeSyntheticLog();
+	const uint64_t fullChainBytes = GetFullChainBytes(log);
+
+	// Tails are resident from the start
+	TextureStreaming::ResidencyManager tails;
+	for (const TextureStreaming::RequestLog::TextureDesc& desc : log.Textures) tails.AddTexture(desc.Width, desc.Height, desc.NumMips);
+	const uint64_t tailBytes = tails.GetResidentBytes();
+
+	for (const float budgetScale : { 0.05f, 0.25f, 0.5f, 1.0f })
+	{
+		TextureStreaming::ResidencySettings settings{};
+		settings.BudgetBytes = (uint64_t) (fullChainBytes * budgetScale);
+		const TextureStreaming::ReplayReport report = TextureStreaming::Replay(log, settings);
+
+		const TextureStreaming::ResidencyStats& stats = report.Stats;
+		TEST_CHECK(report.NumErrors == 0, report.NumErrors << " errors with a budget of " << budgetScale << " of every mip");
+		TEST_CHECK(stats.NumRequests == log.Requests.size(), stats.NumRequests << " requests counted of " << log.Requests.size());
+		TEST_CHECK(stats.NumPromotions > 0 && stats.NumMissedRequests < stats.NumRequests, "budget of " << budgetScale << " of every mip: " << stats.NumPromotions << " promotions, "
+			<< stats.NumMissedRequests << " of " << stats.NumRequests << " requests missed");
+		TEST_CHECK(tailBytes + stats.PromotedBytes - stats.EvictedBytes == report.FinalResidentBytes, "promoted and evicted bytes don't add up to the " << report.FinalResidentBytes << " resident bytes");
+		if (budgetScale < 1.0f)
+		{
+			TEST_CHECK(stats.NumEvictions > 0, "nothing evicted with a budget of " << budgetScale << " of every mip");
+			TEST_CHECK(stats.PeakResidentBytes <= settings.BudgetBytes || stats.NumOverBudgetFrames > 0, "peak of " << stats.PeakResidentBytes << " bytes over a budget of " << settings.BudgetBytes);
+		}
+		else
+		{
+			TEST_CHECK(stats.NumEvictions == 0 && stats.NumOverBudgetFrames == 0, stats.NumEvictions << " evictions and " << stats.NumOverBudgetFrames << " frames over budget when everything fits");
+		}
+	}
+
+	const std::string path = (std::filesystem::temp_directory_path() / "streaming_test.rqlog").string();
+	TextureStreaming::RequestLog readLog{};
+	const bool written = TextureStreaming::WriteRequestLog(path, log);
+	const bool read = written && TextureStreaming::ReadRequestLog(path, readLog);
+	std::filesystem::remove(path);
+
+	TEST_CHECK(written && read, "request log round trip through " << path << " failed");
+	TEST_CHECK(readLog.NumFrames == log.NumFrames && readLog.Textures.size() == log.Textures.size() && readLog.Requests.size() == log.Requests.size(), "request log changed in the round trip");
+	if (readLog.Requests.size() == log.Requests.size())
+		TEST_CHECK(memcmp(readLog.Requests.data(), log.Requests.data(), log.Requests.size() * sizeof(TextureStreaming::RequestLog::Request)) == 0, "requests changed in the round trip");
+}
+
+// Replays the log recorded by the Animation sample at fractions of the default budget, skipped when nothing was recorded
+BENCHMARK(StreamingRecordedReplay)
+{
+	if (!std::filesystem::exists(RecordedLogPath))
+	{
+		std::cout << "[Tests]   No request log at " << RecordedLogPath << ", record one in the Animation sample" << std::endl;
+		return;
+	}
+
+	TextureStreaming::RequestLog log{};
+	if (!TextureStreaming::ReadRequestLog(RecordedLogPath, log)) return;
+
+	const TextureStreaming::ResidencySettings defaultSettings{};
+	std::cout << "[Tests]   Replaying " << log.NumFrames << " frames, " << log.Textures.size() << " textures and " << log.Requests.size() << " requests" << std::endl;
+	for (const float budgetScale : { 0.25f, 0.5f, 1.0f, 2.0f })
+	{
+		TextureStreaming::ResidencySettings settings = defaultSettings;
+		settings.BudgetBytes = (uint64_t) (defaultSettings.BudgetBytes * budgetScale);
+
+		Timer replayTimer;
+		replayTimer.Start();
+		const TextureStreaming::ReplayReport report = TextureStreaming::Replay(log, settings);
+		replayTimer.Stop();
+
+		const TextureStreaming::ResidencyStats& stats = report.Stats;
+		std::cout << "[Tests]   Budget " << settings.BudgetBytes / (1024 * 1024) << " MB: missed " << 100.0f * stats.NumMissedRequests / MAX(stats.NumRequests, (uint64_t) 1)
+			<< "% of requests, " << stats.NumPromotions << " promotions (" << stats.PromotedBytes / (1024 * 1024) << " MB), " << stats.NumEvictions << " evictions, peak "
+			<< stats.PeakResidentBytes / (1024 * 1024) << " MB, " << stats.NumOverBudgetFrames << " frames over budget, " << report.NumErrors << " errors, "
+			<< replayTimer.GetTimeMS() << " ms" << std::endl;
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <sstream>
+#include <vector>
+
+#include <Engine/Common.h>
+
+// Tests check invariants and fail the run, benchmarks only log timings and run when asked for (see main.cpp).
+// Device tests get a device without a window, created once before the first of them.
+// Cases register themselves during static initialization:
+//
+//   TEST(RangeStrategyRandomOperations)
+//   {
+//       TEST_CHECK(numOverlaps == 0, numOverlaps << " overlapping ranges");
+//   }
+namespace Tests
+{
+	enum class TestKind
+	{
+		Test,
+		Benchmark,
+	};
+
+	struct TestCase
+	{
+		const char* Name;
+		TestKind Kind;
+		bool NeedsDevice;
+		void (*Func)();
+	};
+
+	std::vector<TestCase>& GetTestCases();
+	bool RegisterTest(const TestCase& testCase);
+
+	// Marks the running case as failed and logs the message, the case keeps running
+	void Fail(const char* file, int line, const std::string& message);
+}
+
+// Case functions get a suffix so case names can match namespaces, like AnimationCompression
+#define TEST_CASE_IMPL(NAME, KIND, NEEDS_DEVICE)																			\
+static void MACRO_CONCAT(NAME, _Case)();																				\
+static const bool MACRO_CONCAT(NAME, _Registered) = Tests::RegisterTest({ #NAME, KIND, NEEDS_DEVICE, &MACRO_CONCAT(NAME, _Case) });	\
+static void MACRO_CONCAT(NAME, _Case)()
+
+#define TEST(NAME) TEST_CASE_IMPL(NAME, Tests::TestKind::Test, false)
+#define BENCHMARK(NAME) TEST_CASE_IMPL(NAME, Tests::TestKind::Benchmark, false)
+#define DEVICE_TEST(NAME) TEST_CASE_IMPL(NAME, Tests::TestKind::Test, true)
+#define DEVICE_BENCHMARK(NAME) TEST_CASE_IMPL(NAME, Tests::TestKind::Benchmark, true)
+
+#define TEST_CHECK(X, msg) if(!(X)) { std::stringstream _testMessage; _testMessage << #X << ": " << msg; Tests::Fail(__FILE__, __LINE__, _testMessage.str()); }
\ No newline at end of file
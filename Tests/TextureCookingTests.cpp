@@ -0,0 +1,206 @@
+#include <cmath>
+#include <filesystem>
+
+#include <Engine/Loading/TextureCooking.h>
+#include <Engine/System/JobPool.h>
+#include <Engine/Utility/Random.h>
+
+#include "Test.h"
+
+namespace
+{
+	std::vector<uint8_t> MakeFlatImage(uint32_t width, uint32_t height, uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+	{
+		std::vector<uint8_t> pixels((size_t) width * height * 4);
+		for (size_t i = 0; i < pixels.size(); i += 4)
+		{
+			pixels[i + 0] = r;
+			pixels[i + 1] = g;
+			pixels[i + 2] = b;
+			pixels[i + 3] = a;
+		}
+		return pixels;
+	}
+
+	uint64_t GetTextureByteSize(const TextureCooking::CookedTexture& texture)
+	{
+		uint64_t byteSize = 0;
+		for (uint32_t mipIndex = 0; mipIndex < texture.NumMips; mipIndex++) byteSize += TextureCooking::GetMipByteSize(texture.Format, texture.Width, texture.Height, mipIndex);
+		return byteSize * texture.ArraySize;
+	}
+
+	// 5 bit or 6 bit channel of a BC1 endpoint back to 8 bits
+	int ExpandChannel(uint32_t value, uint32_t numBits)
+	{
+		return (int) ((value << (8 - numBits)) | (value >> (2 * numBits - 8)));
+	}
+
+	// Color of the first texel of a BC1 block
+	void DecodeBC1Texel(const uint8_t* block, int rgb[3])
+	{
+		const uint16_t colors[] = { (uint16_t) (block[0] | (block[1] << 8)), (uint16_t) (block[2] | (block[3] << 8)) };
+		int endpoints[2][3];
+		for (uint32_t i = 0; i < 2; i++)
+		{
+			endpoints[i][0] = ExpandChannel(colors[i] >> 11, 5);
+			endpoints[i][1] = ExpandChannel((colors[i] >> 5) & 0x3F, 6);
+			endpoints[i][2] = ExpandChannel(colors[i] & 0x1F, 5);
+		}
+
+		const uint32_t index = block[4] & 3;
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			const int e0 = endpoints[0][c];
+			const int e1 = endpoints[1][c];
+			const int fourColors[] = { e0, e1, (2 * e0 + e1) / 3, (e0 + 2 * e1) / 3 };
+			const int threeColors[] = { e0, e1, (e0 + e1) / 2, 0 };
+			rgb[c] = colors[0] > colors[1] ? fourColors[index] : threeColors[index];
+		}
+	}
+
+	// Value of the first texel of a BC4 block (each half of BC5)
+	int DecodeBC4Texel(const uint8_t* block)
+	{
+		const int e0 = block[0];
+		const int e1 = block[1];
+		const uint32_t index = block[2] & 7;
+		if (index < 2) return index == 0 ? e0 : e1;
+		if (e0 > e1) return ((8 - index) * e0 + (index - 1) * e1) / 7;
+		if (index >= 6) return index == 6 ? 0 : 255;
+		return ((6 - index) * e0 + (index - 1) * e1) / 5;
+	}
+}
+
+// Format picked for each usage, mip chain and data size, endpoints of flat blocks and the DDS round trip
+TEST(TextureCookingFormats)
+{
+	struct FormatCase
+	{
+		const char* Name;
+		TextureCooking::TextureUsage Usage;
+		uint32_t Size;
+		uint8_t Alpha;
+		DXGI_FORMAT Format;
+		uint32_t NumMips;
+	};
+	const FormatCase cases[] = {
+		{ "Opaque albedo", TextureCooking::TextureUsage::Albedo, 64, 255, DXGI_FORMAT_BC1_UNORM, 7 },
+		{ "Transparent albedo", TextureCooking::TextureUsage::Albedo, 64, 128, DXGI_FORMAT_BC3_UNORM, 7 },
+		{ "Normal", TextureCooking::TextureUsage::Normal, 64, 255, DXGI_FORMAT_BC5_UNORM, 7 },
+		{ "MetallicRoughness", TextureCooking::TextureUsage::MetallicRoughness, 64, 255, DXGI_FORMAT_BC1_UNORM, 7 },
+		{ "Size not a multiple of 4", TextureCooking::TextureUsage::Albedo, 30, 255, DXGI_FORMAT_R8G8B8A8_UNORM, 5 },
+	};
+
+	for (const FormatCase& formatCase : cases)
+	{
+		const std::vector<uint8_t> pixels = MakeFlatImage(formatCase.Size, formatCase.Size, 128, 128, 255, formatCase.Alpha);
+		TextureCooking::Settings settings{};
+		settings.Usage = formatCase.Usage;
+		const TextureCooking::CookedTexture texture = TextureCooking::CookImage(pixels.data(), formatCase.Size, formatCase.Size, settings);
+
+		TEST_CHECK(texture.Format == formatCase.Format, formatCase.Name << " cooked to format " << texture.Format);
+		TEST_CHECK(texture.Width == formatCase.Size && texture.Height == formatCase.Size, formatCase.Name << " cooked to " << texture.Width << "x" << texture.Height);
+		TEST_CHECK(texture.NumMips == formatCase.NumMips, formatCase.Name << " has " << texture.NumMips << " mips");
+		TEST_CHECK(texture.Data.size() == GetTextureByteSize(texture), formatCase.Name << " has " << texture.Data.size() << " bytes instead of " << GetTextureByteSize(texture));
+	}
+
+	// Flat blocks decode to the color, MetallicRoughness keeps the channels as they are
+	{
+		const std::vector<uint8_t> pixels = MakeFlatImage(16, 16, 200, 100, 48, 255);
+		TextureCooking::Settings settings{};
+		settings.Usage = TextureCooking::TextureUsage::MetallicRoughness;
+		const TextureCooking::CookedTexture texture = TextureCooking::CookImage(pixels.data(), 16, 16, settings);
+
+		int rgb[3];
+		DecodeBC1Texel(texture.Data.data(), rgb);
+		TEST_CHECK(std::abs(rgb[0] - 200) <= 8 && std::abs(rgb[1] - 100) <= 4 && std::abs(rgb[2] - 48) <= 8, "flat block decoded to " << rgb[0] << ", " << rgb[1] << ", " << rgb[2]);
+	}
+
+	// Flat normal map pointing up decodes to the middle of the XY range
+	{
+		const std::vector<uint8_t> pixels = MakeFlatImage(16, 16, 128, 128, 255, 255);
+		TextureCooking::Settings settings{};
+		settings.Usage = TextureCooking::TextureUsage::Normal;
+		const TextureCooking::CookedTexture texture = TextureCooking::CookImage(pixels.data(), 16, 16, settings);
+
+		const int x = DecodeBC4Texel(texture.Data.data());
+		const int y = DecodeBC4Texel(texture.Data.data() + 8);
+		TEST_CHECK(std::abs(x - 128) <= 2 && std::abs(y - 128) <= 2, "flat normal decoded to " << x << ", " << y);
+	}
+
+	// Written texture reads back the same
+	{
+		const std::vector<uint8_t> pixels = MakeFlatImage(32, 32, 10, 20, 30, 40);
+		const TextureCooking::CookedTexture texture = TextureCooking::CookImage(pixels.data(), 32, 32, TextureCooking::Settings{});
+
+		const std::string path = (std::filesystem::temp_directory_path() / "texture_cooking_test.dds").string();
+		TextureCooking::CookedTexture readTexture{};
+		const bool written = TextureCooking::WriteTexture(path, texture);
+		const bool read = written && TextureCooking::ReadTexture(path, readTexture);
+		std::filesystem::remove(path);
+
+		TEST_CHECK(written && read, "DDS round trip through " << path << " failed");
+		TEST_CHECK(readTexture.Format == texture.Format && readTexture.Width == texture.Width && readTexture.Height == texture.Height && readTexture.NumMips == texture.NumMips,
+			"DDS header changed in the round trip");
+		TEST_CHECK(readTexture.Data == texture.Data, "DDS data changed in the round trip");
+	}
+}
+
+// Cooks a synthetic image for every texture usage, encoding throughput is logged
+BENCHMARK(TextureEncoding)
+{
+	constexpr uint32_t ImageSize = 2048;
+	constexpr uint32_t NumRepeats = 3;
+
+	// Smooth gradients with noise, so blocks have both flat and busy areas. Half of the albedo texels are transparent for BC3.
+	std::vector<uint8_t> pixels((size_t) ImageSize * ImageSize * 4);
+	for (uint32_t y = 0; y < ImageSize; y++)
+	{
+		for (uint32_t x = 0; x < ImageSize; x++)
+		{
+			uint8_t* texel = &pixels[((size_t) y * ImageSize + x) * 4];
+			const float noise = Random::UNorm((float) (y * ImageSize + x));
+			texel[0] = (uint8_t) (255.0f * x / ImageSize);
+			texel[1] = (uint8_t) (255.0f * y / ImageSize);
+			texel[2] = (uint8_t) (255.0f * std::abs(noise));
+			texel[3] = x < ImageSize / 2 ? 255 : 128;
+		}
+	}
+
+	struct EncodingCase
+	{
+		const char* Name;
+		TextureCooking::TextureUsage Usage;
+		bool HighQuality;
+	};
+	const EncodingCase cases[] = {
+		{ "Albedo", TextureCooking::TextureUsage::Albedo, false },
+		{ "Albedo HQ", TextureCooking::TextureUsage::Albedo, true },
+		{ "Normal", TextureCooking::TextureUsage::Normal, false },
+		{ "MetallicRoughness", TextureCooking::TextureUsage::MetallicRoughness, false },
+	};
+
+	std::cout << "[Tests]   Encoding " << ImageSize << "x" << ImageSize << " images with mips on " << JobPool::Get()->GetThreadCount() + 1 << " threads" << std::endl;
+	for (const EncodingCase& encodingCase : cases)
+	{
+		TextureCooking::Settings settings{};
+		settings.Usage = encodingCase.Usage;
+		settings.HighQuality = encodingCase.HighQuality;
+
+		// Best of the repeats, first one also warms up the job pool
+		TextureCooking::CookStats bestStats{};
+		TextureCooking::CookedTexture cookedTexture{};
+		for (uint32_t repeat = 0; repeat < NumRepeats; repeat++)
+		{
+			TextureCooking::CookStats stats{};
+			cookedTexture = TextureCooking::CookImage(pixels.data(), ImageSize, ImageSize, settings, &stats);
+			if (repeat == 0 || stats.FilterTimeMS + stats.EncodeTimeMS < bestStats.FilterTimeMS + bestStats.EncodeTimeMS) bestStats = stats;
+		}
+
+		const float totalTimeMS = bestStats.FilterTimeMS + bestStats.EncodeTimeMS;
+		const float megaPixelsPerSecond = bestStats.NumTexels / (MAX(totalTimeMS, 0.001f) * 1000.0f);
+		const float compressionRatio = (float) (bestStats.NumTexels * 4) / MAX(cookedTexture.Data.size(), (size_t) 1);
+		std::cout << "[Tests]   " << encodingCase.Name << ": " << megaPixelsPerSecond << " MP/s, filter " << bestStats.FilterTimeMS << " ms, encode " << bestStats.EncodeTimeMS
+			<< " ms, " << cookedTexture.Data.size() / 1024 << " KB (" << compressionRatio << "x smaller than R8G8B8A8)" << std::endl;
+	}
+}
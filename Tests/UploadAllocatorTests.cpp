@@ -0,0 +1,129 @@
+#include <deque>
+
+#include <Engine/Render/StagingPool.h>
+#include <Engine/Render/UploadAllocator.h>
+#include <Engine/Utility/Random.h>
+#include <Engine/Utility/Timer.h>
+
+#include "Test.h"
+
+// CPU only allocators on fake fences, memory of submits in flight must never be handed out again
+TEST(UploadAllocatorFramesInFlight)
+{
+	constexpr uint32_t NumFrames = 500;
+	constexpr uint32_t NumContexts = 3;
+	constexpr uint64_t PageSize = 64 * 1024;
+	constexpr uint32_t PageSizedUploads[] = { (uint32_t) PageSize, (uint32_t) PageSize + 1, 3 * (uint32_t) PageSize };
+
+	struct TaggedAllocation
+	{
+		uint8_t* CPUAddress;
+		uint32_t ByteSize;
+		uint8_t Tag;
+	};
+
+	struct FakeContext
+	{
+		FakeContext(StagingPool* pool, uint32_t latency) : Allocator(pool, PageSize), Latency(latency) {}
+
+		UploadAllocator Allocator;
+		uint32_t Latency;	// Fake fence, the GPU finishes a submit Latency submits later
+		uint64_t SubmittedFence = 0;
+		std::deque<std::pair<uint64_t, std::vector<TaggedAllocation>>> FramesInFlight;
+	};
+
+	// Contexts with different latencies share the chunks, a chunk can only move to another context once the fence of its previous owner passed it
+	StagingPool pool(true);
+	std::vector<ScopedRef<FakeContext>> contexts;
+	for (uint32_t i = 0; i < NumContexts; i++) contexts.push_back(ScopedRef<FakeContext>(new FakeContext{ &pool, i }));
+
+	uint32_t numMisaligned = 0;
+	uint32_t numOverwritten = 0;
+	uint32_t maxChunks = 0;
+	uint64_t maxFrameBytes = 0;
+
+	const auto checkCompleted = [&numOverwritten](FakeContext& context, uint64_t completedFence)
+	{
+		// Memory of submits the GPU could still read has to keep what was written to it
+		while (!context.FramesInFlight.empty() && context.FramesInFlight.front().first <= completedFence)
+		{
+			for (const TaggedAllocation& allocation : context.FramesInFlight.front().second)
+			{
+				for (uint32_t i = 0; i < allocation.ByteSize; i++) numOverwritten += allocation.CPUAddress[i] != allocation.Tag;
+			}
+			context.FramesInFlight.pop_front();
+		}
+		context.Allocator.Reclaim(completedFence);
+	};
+
+	for (uint32_t frame = 0; frame < NumFrames; frame++)
+	{
+		for (uint32_t c = 0; c < NumContexts; c++)
+		{
+			FakeContext& context = *contexts[c];
+			checkCompleted(context, context.SubmittedFence >= context.Latency ? context.SubmittedFence - context.Latency : 0);
+
+			// Burst frames grow the pool, the rest should reuse its chunks
+			const bool burstFrame = frame % 100 == 50 + c;
+			const uint32_t numAllocations = Random::UInt(1, burstFrame ? 4000 : 400);
+			std::vector<TaggedAllocation> allocations;
+			for (uint32_t i = 0; i < numAllocations; i++)
+			{
+				// Constants, texture staging and uploads of a page or more, Random::UInt is rand() based and never goes past 32K so the big sizes are explicit
+				const bool textureStaging = i % 13 == 0;
+				const uint64_t alignment = textureStaging ? UploadAllocator::MAX_ALIGNMENT : UploadAllocator::CONSTANT_ALIGNMENT;
+				const uint32_t byteSize = i % 97 == 0 ? PageSizedUploads[(i / 97) % STATIC_ARRAY_SIZE(PageSizedUploads)] : Random::UInt(1, textureStaging ? 16 * 1024 : 1024);
+				const UploadAllocation allocation = context.Allocator.Allocate(byteSize, alignment);
+				numMisaligned += (allocation.GPUAddress % alignment) != 0 || (allocation.Offset % alignment) != 0;
+
+				const uint8_t tag = (uint8_t) (frame * 31 + c * 7 + i);
+				memset(allocation.CPUAddress, tag, byteSize);
+				allocations.push_back({ allocation.CPUAddress, byteSize, tag });
+			}
+
+			maxFrameBytes = std::max(maxFrameBytes, context.Allocator.GetStats().AllocatedBytes);
+
+			context.SubmittedFence++;
+			context.Allocator.Retire(context.SubmittedFence);
+			context.FramesInFlight.push_back({ context.SubmittedFence, std::move(allocations) });
+		}
+		maxChunks = std::max(maxChunks, pool.GetStats().NumChunks);
+	}
+
+	// GPU finishes everything, every chunk is back in the pool
+	for (ScopedRef<FakeContext>& context : contexts) checkCompleted(*context, context->SubmittedFence);
+
+	const StagingPool::Stats stats = pool.GetStats();
+	TEST_CHECK(numMisaligned == 0, numMisaligned << " misaligned allocations");
+	TEST_CHECK(numOverwritten == 0, numOverwritten << " bytes of submits in flight overwritten");
+	TEST_CHECK(stats.NumChunks == stats.NumFreeChunks, stats.NumChunks - stats.NumFreeChunks << " chunks not returned to the pool");
+
+	std::cout << "[Tests]   " << stats.NumChunks << " chunks (" << stats.ChunkBytes / 1024 << " KB) at the end, " << maxChunks << " at most, "
+		<< stats.NumReuses << " of " << stats.NumAcquires << " acquires reused a chunk, biggest submit took " << maxFrameBytes / 1024 << " KB" << std::endl;
+}
+
+// Per draw cost, 256 bytes of constants each
+BENCHMARK(UploadAllocatorConstants)
+{
+	constexpr uint32_t NumDraws = 1000000;
+
+	uint8_t constants[256] = {};
+	StagingPool pool(true);
+	UploadAllocator allocator(&pool);
+
+	Timer timer;
+	timer.Start();
+	for (uint32_t i = 0; i < NumDraws; i++)
+	{
+		constants[0] = (uint8_t) i;
+		allocator.Upload(constants, sizeof(constants));
+		if (i % 10000 == 9999)
+		{
+			allocator.Retire(i);
+			allocator.Reclaim(i);
+		}
+	}
+	timer.Stop();
+
+	std::cout << "[Tests]   " << timer.GetTimeMS() * 1000000.0f / NumDraws << " ns per 256 byte constant upload" << std::endl;
+}
\ No newline at end of file
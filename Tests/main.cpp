@@ -0,0 +1,80 @@
+#include <algorithm>
+
+#include <Engine/Render/Device.h>
+#include <Engine/System/JobPool.h>
+#include <Engine/Utility/StringUtility.h>
+#include <Engine/Utility/Timer.h>
+
+#include "Test.h"
+
+namespace Tests
+{
+	static bool s_Failed = false;
+
+	std::vector<TestCase>& GetTestCases()
+	{
+		static std::vector<TestCase> testCases;
+		return testCases;
+	}
+
+	bool RegisterTest(const TestCase& testCase)
+	{
+		GetTestCases().push_back(testCase);
+		return true;
+	}
+
+	void Fail(const char* file, int line, const std::string& message)
+	{
+		s_Failed = true;
+		std::cout << "[Tests] " << file << "(" << line << "): " << message << std::endl;
+	}
+}
+
+// Tests.exe [-benchmarks] [names]
+// Without names every test runs, benchmarks only with -benchmarks. Names select cases that contain them, benchmarks included.
+// Returns the number of failed tests.
+int main(int argc, char** argv)
+{
+	bool runBenchmarks = false;
+	std::vector<std::string> filters;
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string argument = StringUtility::ToUpper(argv[i]);
+		if (argument == "-BENCHMARKS") runBenchmarks = true;
+		else filters.push_back(argument);
+	}
+
+	std::vector<Tests::TestCase> testCases;
+	for (const Tests::TestCase& testCase : Tests::GetTestCases())
+	{
+		bool selected = filters.empty() && (testCase.Kind == Tests::TestKind::Test || runBenchmarks);
+		for (const std::string& filter : filters) selected = selected || StringUtility::ToUpper(testCase.Name).find(filter) != std::string::npos;
+		if (selected) testCases.push_back(testCase);
+	}
+	std::sort(testCases.begin(), testCases.end(), [](const Tests::TestCase& a, const Tests::TestCase& b) { return std::string(a.Name) < b.Name; });
+
+	JobPool::Init();
+
+	uint32_t numFailed = 0;
+	for (const Tests::TestCase& testCase : testCases)
+	{
+		if (testCase.NeedsDevice && !Device::Get()) Device::Init();
+
+		std::cout << "[Tests] " << testCase.Name << std::endl;
+
+		Tests::s_Failed = false;
+		Timer timer;
+		timer.Start();
+		testCase.Func();
+		timer.Stop();
+
+		numFailed += Tests::s_Failed ? 1 : 0;
+		std::cout << "[Tests] " << testCase.Name << (Tests::s_Failed ? " FAILED" : " passed") << " in " << timer.GetTimeMS() << " ms" << std::endl;
+	}
+
+	Device::Destroy();
+	JobPool::Destroy();
+
+	std::cout << "[Tests] " << testCases.size() - numFailed << " of " << testCases.size() << " passed" << std::endl;
+	return (int) numFailed;
+}
\ No newline at end of file